@@ -23,7 +23,11 @@
 
 #include "n_rf24l01.h"
 
-static n_rf24l01_backend_t n_rf24l01_backend;
+// an instance the library works with unless a user selects another one
+static n_rf24l01_instance_t n_rf24l01_default_instance;
+
+// a currently selected instance: callbacks and a state of the transceiver
+static n_rf24l01_instance_t* n_rf24l01 = &n_rf24l01_default_instance;
 
 
 // write register with @reg_addr from @reg_val
@@ -36,7 +40,7 @@ static void write_register( u_char reg_addr, u_char reg_val )
   // clear first command-specified bits (for R_REGISTER and W_REGISTER)
   reg_addr &= REG_ADDR_BITS;
 
-  n_rf24l01_backend.send_cmd( W_REGISTER | reg_addr, NULL, &reg_val, 1, 1 );
+  n_rf24l01->backend.send_cmd( W_REGISTER | reg_addr, NULL, &reg_val, 1, 1 );
 }
 
 // read register with @reg_addr in @reg_val
@@ -44,7 +48,7 @@ static void write_register( u_char reg_addr, u_char reg_val )
 // reg_val - pointer to memory register's content will be written into
 // Note: only for 1-byte registers
 //======================================================================================================
-/*static void read_register( u_char reg_addr, u_char* reg_val )
+static void read_register( u_char reg_addr, u_char* reg_val )
 {
   if( !reg_val )
     return;
@@ -52,63 +56,75 @@ static void write_register( u_char reg_addr, u_char reg_val )
   // clear first command-specified bits (for R_REGISTER and W_REGISTER)
   reg_addr &= REG_ADDR_BITS;
 
-  n_rf24l01_backend.send_cmd( R_REGISTER | reg_addr, NULL, reg_val, 1, 0 );
-}*/
+  n_rf24l01->backend.send_cmd( R_REGISTER | reg_addr, NULL, reg_val, 1, 0 );
+}
 
-/**
- * @brief read status register via NOP cmd
- *
- * @param[out] status_reg - pointer to write obtained status register to
- */
+// send @num commands from @cmds, at once if a backend allows it
 //======================================================================================================
-static inline void read_status_reg( u_char* status_reg )
+static void send_cmds( const n_rf24l01_cmd_t* cmds, u_int num )
 {
-  // NOP command: for read status register
-  n_rf24l01_backend.send_cmd( NOP, status_reg, NULL, 0, 0 );
+  u_int i;
+
+  if( n_rf24l01->backend.send_cmds )
+  {
+    n_rf24l01->backend.send_cmds( cmds, num );
+    return;
+  }
+
+  for( i = 0; i < num; i++ )
+    n_rf24l01->backend.send_cmd( cmds[i].cmd, cmds[i].status_reg, cmds[i].data, cmds[i].num, cmds[i].direction );
 }
 
-// clear specified bits in register
-// reg_addr - address of register to be modified
-// bits - bits to be cleared
-// only for 1-byte registers
+// set CE pin to @value and remember it
 //======================================================================================================
-static void clear_bits( u_char reg_addr, u_char bits )
+static void set_ce( u_char value )
 {
-  u_char data = 0;
+  n_rf24l01->ce = value;
+  n_rf24l01->backend.set_up_ce_pin( value );
+}
 
-  // clear first command-specified bits (for R_REGISTER and W_REGISTER)
-  reg_addr &= REG_ADDR_BITS;
+// write the CONFIG register, if @config differs from what it is
+// return time the transceiver needs to get powered up, 0 - it's already powered up or stays down
+//======================================================================================================
+static u_int write_config( u_char config )
+{
+  u_int delay = 0;
 
-  // firstly we must read register...
-  n_rf24l01_backend.send_cmd( R_REGISTER | reg_addr, NULL, &data, 1, 0 );
+  if( config & PWR_UP && !(n_rf24l01->config & PWR_UP) )
+    delay = POWER_UP_MKS;
 
-  // apply new bits...
-  data &= ~bits;
+  if( config != n_rf24l01->config )
+  {
+    write_register( CONFIG_RG, config );
+    n_rf24l01->config = config;
+  }
 
-  // then set new bits
-  n_rf24l01_backend.send_cmd( W_REGISTER | reg_addr, NULL, &data, 1, 1 );
+  return delay;
 }
 
-// set specified bits in register
-// reg_addr - address of register to be modified
-// bits - bits to be set
-// only for 1-byte registers
+// get a pseudo-random number (xorshift32)
 //======================================================================================================
-static void set_bits( u_char reg_addr, u_char bits )
+static uint32_t get_rand( void )
 {
-  u_char data = 0;
+  uint32_t x = n_rf24l01->rand_state;
 
-  // clear first command-specified bits (for R_REGISTER and W_REGISTER)
-  reg_addr &= REG_ADDR_BITS;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
 
-  // firstly we must read register...
-  n_rf24l01_backend.send_cmd( R_REGISTER | reg_addr, NULL, &data, 1, 0 );
-
-  // apply new bits...
-  data |= bits;
+  return n_rf24l01->rand_state = x;
+}
 
-  // then set new bits
-  n_rf24l01_backend.send_cmd( W_REGISTER | reg_addr, NULL, &data, 1, 1 );
+/**
+ * @brief read status register via NOP cmd
+ *
+ * @param[out] status_reg - pointer to write obtained status register to
+ */
+//======================================================================================================
+static inline void read_status_reg( u_char* status_reg )
+{
+  // NOP command: for read status register
+  n_rf24l01->backend.send_cmd( NOP, status_reg, NULL, 0, 0 );
 }
 
 // for clear interrupts pending bits
@@ -132,12 +148,12 @@ static void clear_pending_interrupts( void )
 //======================================================================================================
 static void transmit_pkg( u_char* data )
 {
-  n_rf24l01_backend.send_cmd( W_TX_PAYLOAD, NULL, data, PKG_SIZE, 1 );
+  n_rf24l01->backend.send_cmd( W_TX_PAYLOAD, NULL, data, PKG_SIZE, 1 );
 
   // CE up... sleep 10 us... CE down - to actual data transmit (in space)
-  n_rf24l01_backend.set_up_ce_pin( 1 );
-  n_rf24l01_backend.usleep( 10 );
-  n_rf24l01_backend.set_up_ce_pin( 0 );
+  set_ce( 1 );
+  n_rf24l01->backend.usleep( 10 );
+  set_ce( 0 );
 }
 
 
@@ -170,12 +186,15 @@ void n_rf24l01_bottom_half_irq( void )
   read_status_reg( &status_reg );
 
   if( status_reg & RX_DR )
-    n_rf24l01_backend.send_cmd( R_RX_PAYLOAD, NULL, buf, PKG_SIZE, 0 );
+  {
+    n_rf24l01->rx_pipe = ( status_reg & RX_P_NO ) >> 1;
+    n_rf24l01->backend.send_cmd( R_RX_PAYLOAD, NULL, buf, PKG_SIZE, 0 );
+  }
 
   clear_pending_interrupts();
 
   if( status_reg & RX_DR )
-    n_rf24l01_backend.handle_received_data( buf, PKG_SIZE );
+    n_rf24l01->backend.handle_received_data( buf, PKG_SIZE );
 }
 
 /**
@@ -219,7 +238,7 @@ void n_rf24l01_transmit_pkgs( const void* data, u_int num )
       transmit_pkg( frame );
 
     // TODO: I think wait 300 mcs is quickly then wait TX irq, read STATUS reg and react on it
-    n_rf24l01_backend.usleep( 300 );
+    n_rf24l01->backend.usleep( 300 );
 
     return;
   }
@@ -229,7 +248,7 @@ void n_rf24l01_transmit_pkgs( const void* data, u_int num )
     // if it's last package to transmit
     if( i + 1 == pkgs_amount )
     {
-      memcpy( pkg, frame, num % PKG_SIZE );
+      memcpy( pkg, frame, num - i * PKG_SIZE );
       transmit_pkg( pkg );
     }
     else
@@ -238,7 +257,7 @@ void n_rf24l01_transmit_pkgs( const void* data, u_int num )
     frame += PKG_SIZE;
 
     // TODO: I think wait 300 mcs is quickly then wait TX irq, read STATUS reg and react on it
-    n_rf24l01_backend.usleep( 300 );
+    n_rf24l01->backend.usleep( 300 );
   }
 }
 
@@ -248,10 +267,46 @@ void n_rf24l01_transmit_pkgs( const void* data, u_int num )
 //======================================================================================================
 void n_rf24l01_prepare_to_transmit( void )
 {
-  n_rf24l01_backend.set_up_ce_pin( 0 );
+  u_int i, delay;
+  u_char rpd, rx = n_rf24l01->ce;
+
+  // listen before talk: a carrier can be sensed only by a receiver, a transceiver in standby
+  // or powered down (e.g. by a power saving) becomes one for as long as RPD needs
+  if( n_rf24l01->lbt_attempts && !rx )
+  {
+    delay = write_config( n_rf24l01->config | PWR_UP | PRIM_RX );
+    if( delay )
+      n_rf24l01->backend.usleep( delay );
+
+    set_ce( 1 );
+    n_rf24l01->backend.usleep( RPD_SETTLE_MKS );
+
+    rx = 1;
+  }
+
+  for( i = 0; i < n_rf24l01->lbt_attempts; i++ )
+  {
+    read_register( RPD_RG, &rpd );
+    if( !(rpd & RPD) )
+      break;
+
+    n_rf24l01->backend.usleep( n_rf24l01->lbt_backoff_mks + get_rand() % (n_rf24l01->lbt_backoff_mks + 1) );
+  }
 
-  clear_bits( CONFIG_RG, PRIM_RX );
-  n_rf24l01_backend.usleep( 140 );
+  if( rx )
+    set_ce( 0 );
+
+  // a transmitter left in standby-I is ready as it is
+  if( n_rf24l01->config == ( ( n_rf24l01->config | PWR_UP ) & ~PRIM_RX ) )
+    return;
+
+  // only an active receiver needs time to turn around, TX settling goes after CE is raised
+  delay = write_config( ( n_rf24l01->config | PWR_UP ) & ~PRIM_RX );
+  if( !delay && rx )
+    delay = 140;
+
+  if( delay )
+    n_rf24l01->backend.usleep( delay );
 }
 
 /**
@@ -260,43 +315,313 @@ void n_rf24l01_prepare_to_transmit( void )
 //======================================================================================================
 void n_rf24l01_prepare_to_receive( void )
 {
-  set_bits( CONFIG_RG, PRIM_RX );
+  u_int delay;
+
+  if( n_rf24l01->ce && n_rf24l01->config == ( n_rf24l01->config | PWR_UP | PRIM_RX ) )
+    return;
+
+  delay = write_config( n_rf24l01->config | PWR_UP | PRIM_RX );
+
+  set_ce( 1 );
+  n_rf24l01->backend.usleep( delay + 140 );
+}
+
+/**
+ * @brief put n_rf24l01 to standby-I
+ */
+//======================================================================================================
+void n_rf24l01_standby( void )
+{
+  u_int delay;
+
+  if( n_rf24l01->ce )
+    set_ce( 0 );
+
+  delay = write_config( n_rf24l01->config | PWR_UP );
+  if( delay )
+    n_rf24l01->backend.usleep( delay );
+}
+
+/**
+ * @brief power n_rf24l01 down
+ */
+//======================================================================================================
+void n_rf24l01_power_down( void )
+{
+  if( n_rf24l01->ce )
+    set_ce( 0 );
 
-  n_rf24l01_backend.set_up_ce_pin( 1 );
-  n_rf24l01_backend.usleep( 140 );
+  write_config( n_rf24l01->config & ~PWR_UP );
 }
 
 /**
  * @brief call this function before start work with library
  *
  * @param[in] - pointer to structure which is storage for callbacks
- * @return -1, if failed
+ * @return -1, if failed, 1 - a warm start (the transceiver was already powered up), 0 otherwise
  */
 //======================================================================================================
 int n_rf24l01_init( const n_rf24l01_backend_t* n_rf24l01_backend_local )
 {
+  n_rf24l01_cmd_t cmds[5];
+  u_char config = 0, en_aa = 0, rf_setup = 0, rx_pw = 0;
+  u_int num = 0;
+  int warm;
+
   if( !n_rf24l01_backend_local )
     return -1;
 
+  memset( n_rf24l01, 0, sizeof(*n_rf24l01) );
+
   // get copy of callback set
-  memcpy( &n_rf24l01_backend, n_rf24l01_backend_local, sizeof( n_rf24l01_backend ) );
+  memcpy( &n_rf24l01->backend, n_rf24l01_backend_local, sizeof( n_rf24l01->backend ) );
+
+  n_rf24l01->rand_state = 0x2545f491;
+
+  // read back a current configuration at once, the transceiver may be left configured
+  // and powered up by a previous run, then only differing registers get written
+  cmds[0] = (n_rf24l01_cmd_t){ R_REGISTER | CONFIG_RG, NULL, &config, 1, 0 };
+  cmds[1] = (n_rf24l01_cmd_t){ R_REGISTER | EN_AA_RG, NULL, &en_aa, 1, 0 };
+  cmds[2] = (n_rf24l01_cmd_t){ R_REGISTER | RF_CH_RG, NULL, &n_rf24l01->channel, 1, 0 };
+  cmds[3] = (n_rf24l01_cmd_t){ R_REGISTER | RF_SETUP_RG, NULL, &rf_setup, 1, 0 };
+  cmds[4] = (n_rf24l01_cmd_t){ R_REGISTER | RX_PW_P0_RG, NULL, &rx_pw, 1, 0 };
+  send_cmds( cmds, 5 );
+
+  warm = !!( config & PWR_UP );
 
   // disable acknowledge for all channels
-  write_register( EN_AA_RG, 0x00 );
+  if( en_aa != 0x00 )
+  {
+    en_aa = 0x00;
+    cmds[num++] = (n_rf24l01_cmd_t){ W_REGISTER | EN_AA_RG, NULL, &en_aa, 1, 1 };
+  }
+
+  // set data field size (we will transmit PKG_SIZE bytes for time)
+  if( rx_pw != PKG_SIZE )
+  {
+    rx_pw = PKG_SIZE;
+    cmds[num++] = (n_rf24l01_cmd_t){ W_REGISTER | RX_PW_P0_RG, NULL, &rx_pw, 1, 1 };
+  }
+
+  // set the lowermost transmit power and a default 2Mbps data rate, a previous run may have changed both
+  if( ( rf_setup & ( RF_PWR | RF_DR_LOW | RF_DR_HIGH ) ) != RF_DR_HIGH )
+  {
+    rf_setup = ( rf_setup & ~( RF_PWR | RF_DR_LOW ) ) | RF_DR_HIGH;
+    cmds[num++] = (n_rf24l01_cmd_t){ W_REGISTER | RF_SETUP_RG, NULL, &rf_setup, 1, 1 };
+  }
 
   // turn on n_rf24l01 transceiver
-  set_bits( CONFIG_RG, PWR_UP );
-  n_rf24l01_backend.usleep( 1500 );
+  if( !warm )
+  {
+    config |= PWR_UP;
+    cmds[num++] = (n_rf24l01_cmd_t){ W_REGISTER | CONFIG_RG, NULL, &config, 1, 1 };
+  }
 
-  // set data field size (we will transmit PKG_SIZE bytes for time)
-  write_register( RX_PW_P0_RG, PKG_SIZE );
+  if( num )
+    send_cmds( cmds, num );
+
+  // a crystal oscillator is already running, if the transceiver has been powered up
+  if( !warm )
+    n_rf24l01->backend.usleep( POWER_UP_MKS );
+
+  n_rf24l01->config = config;
+
+  return warm;
+}
 
-  // set the lowermost transmit power
-  clear_bits( RF_SETUP_RG, 0x06 );
+/**
+ * @brief tune n_rf24l01 to an RF channel
+ *
+ * @param[in] channel - a channel to tune to
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_set_channel( u_char channel )
+{
+  if( channel >= N_RF24L01_CHANNELS_AMOUNT )
+    return -1;
+
+  // a receiver passes through standby to get PLL relocked to a new channel,
+  // the only SPI transaction is the RF_CH write anyway
+  if( n_rf24l01->ce )
+    n_rf24l01->backend.set_up_ce_pin( 0 );
+
+  write_register( RF_CH_RG, channel );
+  n_rf24l01->channel = channel;
+
+  if( n_rf24l01->ce )
+    n_rf24l01->backend.set_up_ce_pin( 1 );
 
   return 0;
 }
 
+/**
+ * @brief set an air data rate
+ *
+ * @param[in] rate - one of N_RF24L01_DATA_RATE_*
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_set_data_rate( u_char rate )
+{
+  u_char rf_setup = 0;
+
+  if( rate > N_RF24L01_DATA_RATE_250KBPS )
+    return -1;
+
+  read_register( RF_SETUP_RG, &rf_setup );
+
+  rf_setup &= ~( RF_DR_LOW | RF_DR_HIGH );
+
+  if( rate == N_RF24L01_DATA_RATE_2MBPS )
+    rf_setup |= RF_DR_HIGH;
+  else if( rate == N_RF24L01_DATA_RATE_250KBPS )
+    rf_setup |= RF_DR_LOW;
+
+  write_register( RF_SETUP_RG, rf_setup );
+
+  return 0;
+}
+
+/**
+ * @brief set a transmit power
+ *
+ * @param[in] power - one of N_RF24L01_TX_POWER_*
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_set_tx_power( u_char power )
+{
+  u_char rf_setup = 0;
+
+  if( power > N_RF24L01_TX_POWER_0DBM )
+    return -1;
+
+  read_register( RF_SETUP_RG, &rf_setup );
+
+  rf_setup = ( rf_setup & ~RF_PWR ) | power << 1;
+
+  write_register( RF_SETUP_RG, rf_setup );
+
+  return 0;
+}
+
+/**
+ * @brief sweep all RF channels and sample RPD on each of them
+ *
+ * @param[out] occupancy - storage for N_RF24L01_CHANNELS_AMOUNT counters of detected carriers
+ * @param[in]  sweeps    - an amount of sweeps to perform
+ * @param[in]  dwell_mks - time to listen each channel
+ * @return -1, if failed
+ *
+ * Note: RPD gets latched when CE goes low, so a read of RPD for one channel and a tune to
+ *       the next one are sent as one batch while the transceiver is in standby
+ */
+//======================================================================================================
+int n_rf24l01_scan_channels( u_char* occupancy, u_int sweeps, u_int dwell_mks )
+{
+  n_rf24l01_cmd_t cmds[2];
+  u_char ce, config, rpd, next_channel;
+  u_int i, channel, delay;
+
+  if( !occupancy || !sweeps || sweeps > 255 )
+    return -1;
+
+  if( dwell_mks < RPD_SETTLE_MKS )
+    dwell_mks = RPD_SETTLE_MKS;
+
+  memset( occupancy, 0, N_RF24L01_CHANNELS_AMOUNT );
+
+  ce = n_rf24l01->ce;
+  set_ce( 0 );
+
+  // RPD works only in the receive mode, a powered down transceiver gets powered up for a scan
+  config = n_rf24l01->config;
+  delay = write_config( config | PWR_UP | PRIM_RX );
+  if( delay )
+    n_rf24l01->backend.usleep( delay );
+
+  write_register( RF_CH_RG, 0 );
+
+  cmds[0].cmd = R_REGISTER | RPD_RG;
+  cmds[0].status_reg = NULL;
+  cmds[0].data = &rpd;
+  cmds[0].num = 1;
+  cmds[0].direction = 0;
+
+  cmds[1].cmd = W_REGISTER | RF_CH_RG;
+  cmds[1].status_reg = NULL;
+  cmds[1].data = &next_channel;
+  cmds[1].num = 1;
+  cmds[1].direction = 1;
+
+  for( i = 0; i < sweeps; i++ )
+    for( channel = 0; channel < N_RF24L01_CHANNELS_AMOUNT; channel++ )
+    {
+      set_ce( 1 );
+      n_rf24l01->backend.usleep( dwell_mks );
+      set_ce( 0 );
+
+      // the last tune puts the transceiver back to the channel it was on
+      if( channel + 1 < N_RF24L01_CHANNELS_AMOUNT )
+        next_channel = channel + 1;
+      else if( i + 1 < sweeps )
+        next_channel = 0;
+      else
+        next_channel = n_rf24l01->channel;
+
+      send_cmds( cmds, 2 );
+
+      if( rpd & RPD )
+        occupancy[channel]++;
+    }
+
+  write_config( config );
+
+  if( ce )
+  {
+    set_ce( 1 );
+    n_rf24l01->backend.usleep( 140 );
+  }
+
+  return 0;
+}
+
+/**
+ * @brief set up a listen-before-talk check for n_rf24l01_prepare_to_transmit
+ *
+ * @param[in] attempts    - how many times to sample a carrier, 0 - disable the check
+ * @param[in] backoff_mks - a base time to wait between two attempts
+ */
+//======================================================================================================
+void n_rf24l01_set_lbt( u_int attempts, u_int backoff_mks )
+{
+  n_rf24l01->lbt_attempts = attempts;
+  n_rf24l01->lbt_backoff_mks = backoff_mks;
+}
+
+/**
+ * @brief select an instance all other library's calls work with
+ *
+ * @param[in] instance - an instance to select, NULL - a default one
+ */
+//======================================================================================================
+void n_rf24l01_select( n_rf24l01_instance_t* instance )
+{
+  n_rf24l01 = instance ? instance : &n_rf24l01_default_instance;
+}
+
+/**
+ * @brief get a pipe a last received package came over
+ *
+ * @return a pipe number, [0..5]
+ */
+//======================================================================================================
+u_char n_rf24l01_get_rx_pipe( void )
+{
+  return n_rf24l01->rx_pipe;
+}
+
 
 /* for debug purpose only */
 
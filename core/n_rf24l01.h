@@ -13,8 +13,10 @@
 // registers set
 #define CONFIG_RG 		0x00
 #define EN_AA_RG		0x01
+#define RF_CH_RG		0x05
 #define RF_SETUP_RG		0x06
 #define STATUS_RG		0x07
+#define RPD_RG			0x09
 
 //--------- 5-bytes registers ---------
 #define RX_ADDR_P0_RG 	0x0A
@@ -34,6 +36,23 @@
 #define RX_DR   0x40
 #define TX_DS   0x20
 #define MAX_RT  0x10
+#define RX_P_NO 0x0e  // a pipe a payload at the top of RX FIFO came over
+
+//  RF_SETUP register
+#define RF_DR_LOW  0x20
+#define RF_DR_HIGH 0x08
+#define RF_PWR     0x06  // a transmit power, 2 bits
+
+//  RPD register
+#define RPD     0x01
+
+// RPD gets valid only in 130us (RX settling) + 40us (AGC) after RX mode is entered
+#define RPD_SETTLE_MKS 170
+
+// a crystal oscillator starts in 1.5ms after PWR_UP is set (power down -> standby-I),
+// and RX/TX settling takes 130us after CE is raised (standby-I -> RX/TX)
+#define POWER_UP_MKS  1500
+#define RX_SETTLE_MKS 130
 
 // each register has 5 bits address in registers map
 // used for R_REGISTER and W_REGISTER commands
@@ -43,6 +62,6 @@
 #define COMMAND_DATA_SIZE 32
 
 // size of package to transmit/receive
-#define PKG_SIZE 0x20
+#define PKG_SIZE N_RF24L01_PKG_SIZE
 
 #endif // N_RF24L01_H
@@ -0,0 +1,373 @@
+/**
+ * @file link adaptation implementation
+ */
+
+// a package format:
+//  <type> <level>
+//
+// a request - a sender asks to switch to a level, an answer - a sender agrees and switches right after,
+// a probe - a hunting sender looks for a peer, a probe answer - a peer is there
+
+#include <string.h>
+
+#include "n_rf24l01_adapt.h"
+
+#define N_RF24L01_ADAPT_REQUEST      0xb0
+#define N_RF24L01_ADAPT_ANSWER       0xb1
+#define N_RF24L01_ADAPT_PROBE        0xb2
+#define N_RF24L01_ADAPT_PROBE_ANSWER 0xb3
+
+typedef struct
+{
+  u_char data_rate;
+  u_char tx_power;
+} level_t;
+
+static const level_t levels[N_RF24L01_ADAPT_LEVELS] =
+{
+  { N_RF24L01_DATA_RATE_250KBPS, N_RF24L01_TX_POWER_0DBM },
+  { N_RF24L01_DATA_RATE_1MBPS,   N_RF24L01_TX_POWER_0DBM },
+  { N_RF24L01_DATA_RATE_2MBPS,   N_RF24L01_TX_POWER_0DBM },
+  { N_RF24L01_DATA_RATE_2MBPS,   N_RF24L01_TX_POWER_M6DBM },
+  { N_RF24L01_DATA_RATE_2MBPS,   N_RF24L01_TX_POWER_M12DBM },
+  { N_RF24L01_DATA_RATE_2MBPS,   N_RF24L01_TX_POWER_M18DBM },
+};
+
+
+// get a pseudo-random number (xorshift32)
+//======================================================================================================
+static uint32_t get_rand( uint32_t* state )
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  return *state = x;
+}
+
+//======================================================================================================
+static void send_pkg( n_rf24l01_adapt_t* adapt, u_char type, u_char level )
+{
+  u_char pkg[N_RF24L01_PKG_SIZE] = { 0, };
+
+  pkg[0] = type;
+  pkg[1] = level;
+
+  adapt->send( adapt->ctx, pkg );
+}
+
+// a loss gets measured anew from now on, a first window is skipped, as packages
+// sent before a level change get lost and retransmitted within it
+//======================================================================================================
+static void restart_window( n_rf24l01_adapt_t* adapt )
+{
+  adapt->window_sent = adapt->last_sent;
+  adapt->window_retransmitted = adapt->last_retransmitted;
+  adapt->good_windows = 0;
+  adapt->level_windows = 0;
+  adapt->settling = 1;
+}
+
+// switch to a level agreed with a peer
+//======================================================================================================
+static void set_level( n_rf24l01_adapt_t* adapt, u_char level )
+{
+  if( level > adapt->level )
+    adapt->stats.levels_up++;
+  else if( level < adapt->level )
+    adapt->stats.levels_down++;
+
+  adapt->probing = level > adapt->level;
+  adapt->level = level;
+
+  adapt->apply( adapt->ctx, levels[level].data_rate, levels[level].tx_power );
+
+  restart_window( adapt );
+}
+
+//======================================================================================================
+static void ask( n_rf24l01_adapt_t* adapt, u_char level, uint64_t now_mks )
+{
+  adapt->state = N_RF24L01_ADAPT_ASKING;
+  adapt->asked_level = level;
+  adapt->tries = 1;
+  adapt->retry_mks = now_mks + N_RF24L01_ADAPT_RETRY_MKS;
+
+  send_pkg( adapt, N_RF24L01_ADAPT_REQUEST, level );
+}
+
+// go to a next level of a hunt, from the most robust one after the fastest one
+//======================================================================================================
+static void hunt( n_rf24l01_adapt_t* adapt, uint64_t now_mks )
+{
+  u_char level = adapt->level + 1 < N_RF24L01_ADAPT_LEVELS ? adapt->level + 1 : adapt->base_level;
+
+  adapt->level = level;
+  adapt->probing = 0;
+
+  adapt->apply( adapt->ctx, levels[level].data_rate, levels[level].tx_power );
+
+  adapt->hunt_mks = now_mks + N_RF24L01_ADAPT_DWELL_MKS + get_rand( &adapt->rand_state ) % N_RF24L01_ADAPT_DWELL_MKS;
+
+  send_pkg( adapt, N_RF24L01_ADAPT_PROBE, level );
+}
+
+// a window is over, a link goes a level down if it's too lossy, or up if it's been good for long
+//======================================================================================================
+static void on_window( n_rf24l01_adapt_t* adapt, u_int loss, uint64_t now_mks )
+{
+  adapt->stats.windows++;
+  adapt->stats.last_loss = loss;
+  adapt->level_windows++;
+
+  if( loss > adapt->target_loss )
+  {
+    if( adapt->probing )
+    {
+      adapt->stats.probes_failed++;
+      adapt->up_windows = adapt->up_windows * 2 < N_RF24L01_ADAPT_MAX_UP_WINDOWS ?
+                          adapt->up_windows * 2 : N_RF24L01_ADAPT_MAX_UP_WINDOWS;
+    }
+
+    adapt->probing = 0;
+    adapt->good_windows = 0;
+
+    if( adapt->level > adapt->base_level )
+      ask( adapt, adapt->level - 1, now_mks );
+
+    return;
+  }
+
+  // a level up has held, next probes may go sooner
+  if( adapt->probing && adapt->level_windows >= adapt->up_windows )
+  {
+    adapt->probing = 0;
+    adapt->up_windows = adapt->up_windows / 2 > N_RF24L01_ADAPT_MIN_UP_WINDOWS ?
+                        adapt->up_windows / 2 : N_RF24L01_ADAPT_MIN_UP_WINDOWS;
+  }
+
+  if( loss * 2 > adapt->target_loss )
+  {
+    adapt->good_windows = 0;
+    return;
+  }
+
+  if( ++adapt->good_windows >= adapt->up_windows && adapt->level + 1 < N_RF24L01_ADAPT_LEVELS )
+  {
+    adapt->good_windows = 0;
+    ask( adapt, adapt->level + 1, now_mks );
+  }
+}
+
+/**
+ * @brief initialize an adaptation and apply a base level
+ *
+ * @param[out] adapt       - an adaptation to initialize
+ * @param[in]  base_level  - a level a link starts at and never goes below
+ * @param[in]  target_loss - a max loss, in percent
+ * @param[in]  send        - a callback to transmit a package
+ * @param[in]  apply       - a callback to set a data rate and a transmit power
+ * @param[in]  ctx         - a context passed to callbacks
+ * @param[in]  now_mks     - a current time
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_adapt_init( n_rf24l01_adapt_t* adapt, u_char base_level, u_int target_loss,
+                          n_rf24l01_adapt_send_ptr send, n_rf24l01_adapt_apply_ptr apply, void* ctx,
+                          uint64_t now_mks )
+{
+  if( !adapt || !send || !apply || base_level >= N_RF24L01_ADAPT_LEVELS || !target_loss || target_loss > 50 )
+    return -1;
+
+  memset( adapt, 0, sizeof(*adapt) );
+
+  adapt->target_loss = target_loss;
+  adapt->base_level = base_level;
+  adapt->level = base_level;
+
+  adapt->send = send;
+  adapt->apply = apply;
+  adapt->ctx = ctx;
+
+  adapt->up_windows = N_RF24L01_ADAPT_MIN_UP_WINDOWS;
+  adapt->last_rx_mks = now_mks;
+
+  adapt->rand_state = (uint32_t)now_mks ^ 0x9e3779b9;
+  if( !adapt->rand_state )
+    adapt->rand_state = 0x9e3779b9;
+
+  apply( ctx, levels[base_level].data_rate, levels[base_level].tx_power );
+
+  return 0;
+}
+
+/**
+ * @brief handle a received package, each one has to be passed, as it tells a peer is heard
+ *
+ * @param[in] pkg     - a package (N_RF24L01_PKG_SIZE bytes)
+ * @param[in] now_mks - time the package was received at
+ * @return -1, if it isn't an adaptation package
+ */
+//======================================================================================================
+int n_rf24l01_adapt_on_pkg( n_rf24l01_adapt_t* adapt, const u_char* pkg, uint64_t now_mks )
+{
+  u_char level = pkg[1];
+
+  adapt->last_rx_mks = now_mks;
+
+  // a peer is at this level, retransmissions of a hunt don't tell anything about it
+  if( adapt->state == N_RF24L01_ADAPT_HUNTING )
+  {
+    adapt->state = N_RF24L01_ADAPT_STEADY;
+    restart_window( adapt );
+  }
+
+  if( pkg[0] < N_RF24L01_ADAPT_REQUEST || pkg[0] > N_RF24L01_ADAPT_PROBE_ANSWER )
+    return -1;
+
+  if( level < adapt->base_level || level >= N_RF24L01_ADAPT_LEVELS )
+    return 0;
+
+  switch( pkg[0] )
+  {
+    case N_RF24L01_ADAPT_REQUEST:
+      // if both sides ask at once, a more robust level wins, a peer agrees to ours then
+      if( adapt->state == N_RF24L01_ADAPT_ASKING && level > adapt->asked_level )
+        break;
+
+      adapt->state = N_RF24L01_ADAPT_STEADY;
+
+      send_pkg( adapt, N_RF24L01_ADAPT_ANSWER, level );
+
+      if( level != adapt->level )
+        set_level( adapt, level );
+      break;
+
+    case N_RF24L01_ADAPT_ANSWER:
+      if( adapt->state == N_RF24L01_ADAPT_ASKING && level == adapt->asked_level )
+      {
+        adapt->state = N_RF24L01_ADAPT_STEADY;
+        set_level( adapt, level );
+      }
+      break;
+
+    // a hunting peer may not hear us at our level, but it's at its own one
+    case N_RF24L01_ADAPT_PROBE:
+      adapt->state = N_RF24L01_ADAPT_STEADY;
+
+      send_pkg( adapt, N_RF24L01_ADAPT_PROBE_ANSWER, level );
+
+      if( level != adapt->level )
+        set_level( adapt, level );
+      break;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief measure a loss, change a level, ask a peer again or hunt for it, whatever is due
+ *
+ * @param[in] now_mks            - a current time
+ * @param[in] pkgs_sent          - packages a reliable layer has sent for the first time so far
+ * @param[in] pkgs_retransmitted - packages a reliable layer has retransmitted so far
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_adapt_poll( n_rf24l01_adapt_t* adapt, uint64_t now_mks, u_int pkgs_sent,
+                               u_int pkgs_retransmitted )
+{
+  uint32_t timeout = 0xffffffff;
+  u_int sent, retransmitted;
+
+  // counters of a reliable layer may have been running before
+  if( !adapt->counting )
+  {
+    adapt->counting = 1;
+    adapt->window_sent = adapt->last_sent = pkgs_sent;
+    adapt->window_retransmitted = adapt->last_retransmitted = pkgs_retransmitted;
+  }
+
+  if( pkgs_retransmitted != adapt->last_retransmitted )
+    adapt->last_retransmit_mks = now_mks;
+
+  adapt->last_sent = pkgs_sent;
+  adapt->last_retransmitted = pkgs_retransmitted;
+
+  // retransmissions nobody answers to, a peer is at another level
+  if( adapt->last_retransmit_mks > adapt->last_rx_mks &&
+      now_mks - adapt->last_retransmit_mks < N_RF24L01_ADAPT_SILENCE_MKS )
+  {
+    if( now_mks - adapt->last_rx_mks < N_RF24L01_ADAPT_SILENCE_MKS )
+      timeout = adapt->last_rx_mks + N_RF24L01_ADAPT_SILENCE_MKS - now_mks;
+    else if( adapt->state != N_RF24L01_ADAPT_HUNTING )
+    {
+      adapt->state = N_RF24L01_ADAPT_HUNTING;
+      adapt->stats.hunts++;
+      hunt( adapt, now_mks );
+    }
+  }
+  else if( adapt->state == N_RF24L01_ADAPT_HUNTING )
+  {
+    // nothing is retransmitted any more, so nothing to look for a peer for; a link goes back
+    // to a base level (a restarted peer starts there too), and a peer is asked to come there
+    adapt->level = adapt->base_level;
+    adapt->probing = 0;
+
+    adapt->apply( adapt->ctx, levels[adapt->base_level].data_rate, levels[adapt->base_level].tx_power );
+    restart_window( adapt );
+
+    ask( adapt, adapt->base_level, now_mks );
+  }
+
+  if( adapt->state == N_RF24L01_ADAPT_HUNTING )
+  {
+    if( now_mks >= adapt->hunt_mks )
+      hunt( adapt, now_mks );
+
+    return adapt->hunt_mks - now_mks;
+  }
+
+  if( adapt->state == N_RF24L01_ADAPT_ASKING )
+  {
+    if( now_mks >= adapt->retry_mks )
+    {
+      if( adapt->tries == N_RF24L01_ADAPT_TRIES )
+      {
+        adapt->stats.requests_failed++;
+        adapt->state = N_RF24L01_ADAPT_STEADY;
+        return timeout;
+      }
+
+      adapt->tries++;
+      adapt->retry_mks = now_mks + N_RF24L01_ADAPT_RETRY_MKS;
+      send_pkg( adapt, N_RF24L01_ADAPT_REQUEST, adapt->asked_level );
+    }
+
+    return adapt->retry_mks - now_mks < timeout ? adapt->retry_mks - now_mks : timeout;
+  }
+
+  sent = pkgs_sent - adapt->window_sent;
+  retransmitted = pkgs_retransmitted - adapt->window_retransmitted;
+
+  if( sent + retransmitted < N_RF24L01_ADAPT_WINDOW_PKGS )
+    return timeout;
+
+  adapt->window_sent = pkgs_sent;
+  adapt->window_retransmitted = pkgs_retransmitted;
+
+  if( adapt->settling )
+  {
+    adapt->settling = 0;
+    return timeout;
+  }
+
+  on_window( adapt, retransmitted * 100 / ( sent + retransmitted ), now_mks );
+
+  if( adapt->state == N_RF24L01_ADAPT_ASKING )
+    return adapt->retry_mks - now_mks < timeout ? adapt->retry_mks - now_mks : timeout;
+
+  return timeout;
+}
@@ -0,0 +1,180 @@
+#ifndef N_RF24L01_ADAPT_H
+#define N_RF24L01_ADAPT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A link adaptation on top of the library's core, picks the fastest data rate and the lowest
+ * transmit power which keep a loss of a link under a target, for both sides of the link.
+ *
+ * Settings are ordered into levels by a link budget they give, from the most robust one:
+ *  0 - 250kbps, 0dBm;  1 - 1Mbps, 0dBm;  2 - 2Mbps, 0dBm;
+ *  3 - 2Mbps, -6dBm;   4 - 2Mbps, -12dBm; 5 - 2Mbps, -18dBm;
+ * a faster rate takes less air time and so less energy per bit, so it goes before a lower power.
+ *
+ * A loss is measured by a reliable layer (e.g. the ARQ) a caller feeds counters of: a share of
+ * retransmissions among transmissions over a window of N_RF24L01_ADAPT_WINDOW_PKGS. A window
+ * above a target takes a link a level down at once, a level up is probed after enough windows
+ * well below the target; a level up which fails within as many windows doubles the amount for
+ * the next probe, one which holds halves it.
+ *
+ * Both sides have to be at the same level, so a side which wants another level asks a peer
+ * for it and switches when the peer agrees (the peer switches right after it answers). If an answer
+ * or a peer is lost, a side which keeps retransmitting but hears nothing for N_RF24L01_ADAPT_SILENCE_MKS
+ * hunts for the peer: it goes over levels with a random dwell on each and sends a probe on each,
+ * a peer which hears a probe switches to the prober's level, and the prober stays at a level it
+ * hears the peer at. A side which isn't retransmitting stays where it is,
+ * so it gets found. A hunt which outlasts retransmissions (for N_RF24L01_ADAPT_SILENCE_MKS) ends
+ * at a base level, a peer is asked for it as for any other level.
+ *
+ * The adaptation has no own clock, a time (in microseconds, any monotonic origin) is passed
+ * by a caller, and doesn't talk to the core directly, packages go out through a callback and
+ * a level gets applied through another one. */
+
+#include "../n_rf24l01_core.h"
+
+#define N_RF24L01_ADAPT_LEVELS 6
+
+/* transmissions a loss is measured over */
+#define N_RF24L01_ADAPT_WINDOW_PKGS 32
+
+/* windows well below a target (a half of it) before a first probe of a next level up,
+ * and the most windows a failed probe may make the next one wait for */
+#define N_RF24L01_ADAPT_MIN_UP_WINDOWS 2
+#define N_RF24L01_ADAPT_MAX_UP_WINDOWS 64
+
+/* a request for a level is repeated this often and this many times */
+#define N_RF24L01_ADAPT_RETRY_MKS 20000
+#define N_RF24L01_ADAPT_TRIES 5
+
+/* time without anything from a peer, while retransmitting, before a hunt for the peer,
+ * and time without retransmissions before the hunt ends */
+#define N_RF24L01_ADAPT_SILENCE_MKS 300000
+
+/* a hunt stays at a level for [N_RF24L01_ADAPT_DWELL_MKS..2 * N_RF24L01_ADAPT_DWELL_MKS) */
+#define N_RF24L01_ADAPT_DWELL_MKS 30000
+
+/**
+ * @brief transmit a package (N_RF24L01_PKG_SIZE bytes)
+ */
+typedef void (*n_rf24l01_adapt_send_ptr)( void* ctx, const u_char* pkg );
+
+/**
+ * @brief set a data rate and a transmit power of the transceiver
+ *
+ * @param[in] data_rate - one of N_RF24L01_DATA_RATE_*
+ * @param[in] tx_power  - one of N_RF24L01_TX_POWER_*
+ *
+ * Note: packages sent before the call have to be transmitted with a previous setting
+ */
+typedef void (*n_rf24l01_adapt_apply_ptr)( void* ctx, u_char data_rate, u_char tx_power );
+
+typedef enum
+{
+  N_RF24L01_ADAPT_STEADY,
+  N_RF24L01_ADAPT_ASKING,   /* waits for a peer to agree to a level */
+  N_RF24L01_ADAPT_HUNTING,  /* looks for a peer over levels */
+} n_rf24l01_adapt_state_t;
+
+typedef struct n_rf24l01_adapt_stats_t
+{
+  u_int levels_up;
+  u_int levels_down;
+  u_int probes_failed;    /* a level up turned out to be too lossy */
+  u_int requests_failed;  /* a peer didn't answer */
+  u_int hunts;
+  u_int windows;
+  u_int last_loss;        /* in the last window, in percent */
+} n_rf24l01_adapt_stats_t;
+
+typedef struct n_rf24l01_adapt_t
+{
+  u_int target_loss;
+  u_char base_level;
+  u_char level;
+
+  n_rf24l01_adapt_send_ptr send;
+  n_rf24l01_adapt_apply_ptr apply;
+  void* ctx;
+
+  n_rf24l01_adapt_state_t state;
+
+  /* a level asked for and how many times, and when to ask again */
+  u_char asked_level;
+  u_int tries;
+  uint64_t retry_mks;
+
+  /* the current level has been reached by a level up, it's on probation till up_windows
+   * windows at it end */
+  u_char probing;
+  u_int level_windows;
+
+  /* a hunt moves to a next level at hunt_mks */
+  uint64_t hunt_mks;
+  uint32_t rand_state;
+
+  /* counters of a reliable layer at a start of the current window, and the last ones seen,
+   * valid if @counting; a window after a level change is skipped if @settling */
+  u_char counting;
+  u_char settling;
+  u_int window_sent;
+  u_int window_retransmitted;
+  u_int last_sent;
+  u_int last_retransmitted;
+
+  u_int good_windows;
+  u_int up_windows;
+
+  uint64_t last_rx_mks;
+  uint64_t last_retransmit_mks;
+
+  n_rf24l01_adapt_stats_t stats;
+} n_rf24l01_adapt_t;
+
+/**
+ * @brief initialize an adaptation and apply a base level
+ *
+ * @param[out] adapt       - an adaptation to initialize
+ * @param[in]  base_level  - a level a link starts at and never goes below, [0..N_RF24L01_ADAPT_LEVELS),
+ *                           both sides have to use the same one (1 - for an nRF24L01 without '+')
+ * @param[in]  target_loss - a max loss, in percent, [1..50]
+ * @param[in]  send        - a callback to transmit a package
+ * @param[in]  apply       - a callback to set a data rate and a transmit power
+ * @param[in]  ctx         - a context passed to callbacks
+ * @param[in]  now_mks     - a current time
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_adapt_init( n_rf24l01_adapt_t* adapt, u_char base_level, u_int target_loss,
+                          n_rf24l01_adapt_send_ptr send, n_rf24l01_adapt_apply_ptr apply, void* ctx,
+                          uint64_t now_mks );
+
+/**
+ * @brief handle a received package, each one has to be passed, as it tells a peer is heard
+ *
+ * @param[in] pkg     - a package (N_RF24L01_PKG_SIZE bytes)
+ * @param[in] now_mks - time the package was received at
+ * @return -1, if it isn't an adaptation package
+ */
+//======================================================================================================
+int n_rf24l01_adapt_on_pkg( n_rf24l01_adapt_t* adapt, const u_char* pkg, uint64_t now_mks );
+
+/**
+ * @brief measure a loss, change a level, ask a peer again or hunt for it, whatever is due
+ *
+ * @param[in] now_mks            - a current time
+ * @param[in] pkgs_sent          - packages a reliable layer has sent for the first time so far
+ * @param[in] pkgs_retransmitted - packages a reliable layer has retransmitted so far
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ *         (but a next call is required once counters change)
+ */
+//======================================================================================================
+uint32_t n_rf24l01_adapt_poll( n_rf24l01_adapt_t* adapt, uint64_t now_mks, u_int pkgs_sent,
+                               u_int pkgs_retransmitted );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_ADAPT_H
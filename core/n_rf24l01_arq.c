@@ -0,0 +1,484 @@
+/**
+ * @file selective-repeat ARQ implementation
+ */
+
+// a package format:
+//  data:        <N_RF24L01_ARQ_DATA> <sequence number> <length> <epoch> <peer's epoch>
+//               <payload: N_RF24L01_ARQ_PAYLOAD_SIZE bytes>
+//  acknowledge: <N_RF24L01_ARQ_ACK> <next expected sequence number> <SACK: 4 bytes, LSByte first>
+//               <epoch> <peer's epoch>
+//
+// bit i of SACK is set if a package with a sequence number (next expected + 1 + i) has been received,
+// epochs are a sender's one and one the sender knows of a receiver
+
+#include <string.h>
+
+#include "n_rf24l01_arq.h"
+
+#define N_RF24L01_ARQ_DATA 0xd0
+#define N_RF24L01_ARQ_ACK  0xd1
+
+
+// get a slot for a sequence number
+//======================================================================================================
+static inline n_rf24l01_arq_slot_t* get_slot( n_rf24l01_arq_slot_t* slots, u_char seq )
+{
+  return &slots[seq % N_RF24L01_ARQ_MAX_WINDOW];
+}
+
+// (re)transmit a package with a sequence number @seq
+//======================================================================================================
+static void transmit_slot( n_rf24l01_arq_t* arq, u_char seq, uint64_t now_mks )
+{
+  n_rf24l01_arq_slot_t* slot = get_slot( arq->tx, seq );
+  u_char pkg[N_RF24L01_PKG_SIZE] = { 0, };
+
+  pkg[0] = N_RF24L01_ARQ_DATA;
+  pkg[1] = seq;
+  pkg[2] = slot->len;
+  pkg[3] = arq->epoch;
+  pkg[4] = arq->peer_epoch;
+  memcpy( pkg + 5, slot->data, slot->len );
+
+  if( slot->transmissions )
+    arq->stats.pkgs_retransmitted++;
+  else
+    arq->stats.pkgs_sent++;
+
+  if( slot->transmissions < 0xff )
+    slot->transmissions++;
+
+  slot->sent_mks = now_mks;
+  slot->sent_order = ++arq->tx_order;
+
+  arq->send( arq->ctx, pkg );
+}
+
+// send an acknowledge for everything received so far
+//======================================================================================================
+static void send_ack( n_rf24l01_arq_t* arq )
+{
+  u_char pkg[N_RF24L01_PKG_SIZE] = { 0, };
+  uint32_t sack = 0;
+  u_int i;
+
+  for( i = 0; i + 1 < arq->window; i++ )
+    if( get_slot( arq->rx, arq->rx_base + 1 + i )->used )
+      sack |= 1u << i;
+
+  pkg[0] = N_RF24L01_ARQ_ACK;
+  pkg[1] = arq->rx_base;
+  pkg[2] = sack;
+  pkg[3] = sack >> 8;
+  pkg[4] = sack >> 16;
+  pkg[5] = sack >> 24;
+  pkg[6] = arq->epoch;
+  pkg[7] = arq->peer_epoch;
+
+  arq->ack_pending = 0;
+  arq->unacked = 0;
+  arq->stats.acks_sent++;
+
+  arq->send( arq->ctx, pkg );
+}
+
+// update RTO by an RTT sample, as RFC 6298 does
+//======================================================================================================
+static void update_rto( n_rf24l01_arq_t* arq, uint32_t rtt_mks )
+{
+  uint32_t delta;
+
+  if( !arq->srtt_mks )
+  {
+    arq->srtt_mks = rtt_mks;
+    arq->rttvar_mks = rtt_mks / 2;
+  }
+  else
+  {
+    delta = arq->srtt_mks > rtt_mks ? arq->srtt_mks - rtt_mks : rtt_mks - arq->srtt_mks;
+
+    arq->rttvar_mks = ( 3 * arq->rttvar_mks + delta ) / 4;
+    arq->srtt_mks = ( 7 * arq->srtt_mks + rtt_mks ) / 8;
+  }
+
+  arq->rto_mks = arq->srtt_mks + 4 * arq->rttvar_mks;
+
+  if( arq->rto_mks < N_RF24L01_ARQ_MIN_RTO_MKS )
+    arq->rto_mks = N_RF24L01_ARQ_MIN_RTO_MKS;
+  else if( arq->rto_mks > N_RF24L01_ARQ_MAX_RTO_MKS )
+    arq->rto_mks = N_RF24L01_ARQ_MAX_RTO_MKS;
+}
+
+// handle a received data package
+//======================================================================================================
+static void on_data( n_rf24l01_arq_t* arq, const u_char* pkg, uint64_t now_mks )
+{
+  n_rf24l01_arq_slot_t* slot;
+  u_char seq = pkg[1];
+  u_char len = pkg[2];
+  u_char offset;
+
+  if( len > N_RF24L01_ARQ_PAYLOAD_SIZE )
+    return;
+
+  offset = seq - arq->rx_base;
+
+  arq->ack_pending = 1;
+  arq->unacked++;
+
+  // it was delivered already, so an acknowledge has got lost, repeat it right now
+  if( offset >= arq->window )
+  {
+    arq->stats.pkgs_duplicated++;
+    arq->ack_due_mks = now_mks;
+    return;
+  }
+
+  slot = get_slot( arq->rx, seq );
+  if( slot->used )
+  {
+    arq->stats.pkgs_duplicated++;
+    arq->ack_due_mks = now_mks;
+    return;
+  }
+
+  memcpy( slot->data, pkg + 5, len );
+  slot->len = len;
+  slot->used = 1;
+  arq->stats.pkgs_received++;
+
+  // a hole, let a transmitter know about it as soon as possible
+  if( offset )
+  {
+    arq->ack_due_mks = now_mks;
+    return;
+  }
+
+  while( ( slot = get_slot( arq->rx, arq->rx_base ) )->used )
+  {
+    arq->deliver( arq->ctx, slot->data, slot->len );
+
+    slot->used = 0;
+    arq->rx_base++;
+  }
+
+  // acknowledge once a transmitter stops sending, but don't let it run out of the window
+  if( arq->unacked >= ( arq->window + 1 ) / 2 )
+    arq->ack_due_mks = now_mks;
+  else
+    arq->ack_due_mks = now_mks + N_RF24L01_ARQ_ACK_DELAY_MKS;
+}
+
+// handle a received acknowledge package
+//======================================================================================================
+static void on_ack( n_rf24l01_arq_t* arq, const u_char* pkg, uint64_t now_mks )
+{
+  n_rf24l01_arq_slot_t* slot;
+  uint32_t last_acked_order = 0;
+  uint32_t sack, rtt_mks = 0;
+  u_char cum = pkg[1];
+  u_char in_flight, seq;
+  u_int i;
+
+  sack = pkg[2] | (uint32_t)pkg[3] << 8 | (uint32_t)pkg[4] << 16 | (uint32_t)pkg[5] << 24;
+
+  in_flight = arq->tx_next - arq->tx_base;
+
+  // a stale acknowledge
+  if( (u_char)( cum - arq->tx_base ) > in_flight )
+    return;
+
+  arq->stats.acks_received++;
+
+  for( i = 0; i < in_flight; i++ )
+  {
+    seq = arq->tx_base + i;
+    slot = get_slot( arq->tx, seq );
+
+    if( slot->acked )
+    {
+      if( slot->transmissions == 1 && slot->sent_order > last_acked_order )
+        last_acked_order = slot->sent_order;
+      continue;
+    }
+
+    if( (u_char)( seq - arq->tx_base ) < (u_char)( cum - arq->tx_base ) ||
+        ( (u_char)( seq - cum - 1 ) < 32 && ( sack >> (u_char)( seq - cum - 1 ) & 1 ) ) )
+    {
+      slot->acked = 1;
+
+      // Karn's algorithm: a retransmitted package gives an ambiguous sample, also it's
+      // unknown which of its copies has got through
+      if( slot->transmissions == 1 )
+      {
+        rtt_mks = now_mks - slot->sent_mks;
+
+        if( slot->sent_order > last_acked_order )
+          last_acked_order = slot->sent_order;
+      }
+    }
+  }
+
+  if( rtt_mks )
+    update_rto( arq, rtt_mks );
+
+  while( arq->tx_base != arq->tx_next && get_slot( arq->tx, arq->tx_base )->acked )
+  {
+    get_slot( arq->tx, arq->tx_base )->used = 0;
+    arq->tx_base++;
+  }
+
+  // a package sent before an acknowledged one is lost, no need to wait for its timeout
+  in_flight = arq->tx_next - arq->tx_base;
+
+  for( i = 0; i < in_flight; i++ )
+  {
+    seq = arq->tx_base + i;
+    slot = get_slot( arq->tx, seq );
+
+    if( !slot->acked && slot->sent_order < last_acked_order )
+      transmit_slot( arq, seq, now_mks );
+  }
+}
+
+// the peer has (re)started: drop what has been received from the previous one, number packages
+// in flight from 0 again and retransmit them all, as the peer has got none of them
+//======================================================================================================
+static void reset( n_rf24l01_arq_t* arq, uint64_t now_mks )
+{
+  n_rf24l01_arq_slot_t in_flight[N_RF24L01_ARQ_MAX_WINDOW];
+  u_char num = arq->tx_next - arq->tx_base;
+  u_char i;
+
+  memset( arq->rx, 0, sizeof(arq->rx) );
+  arq->rx_base = 0;
+  arq->unacked = 0;
+
+  for( i = 0; i < num; i++ )
+    in_flight[i] = *get_slot( arq->tx, arq->tx_base + i );
+
+  memset( arq->tx, 0, sizeof(arq->tx) );
+  memcpy( arq->tx, in_flight, num * sizeof(in_flight[0]) );
+
+  arq->tx_base = 0;
+  arq->tx_next = num;
+
+  for( i = 0; i < num; i++ )
+  {
+    arq->tx[i].acked = 0;
+    transmit_slot( arq, i, now_mks );
+  }
+}
+
+// check epochs of a received package, and realign with the peer if it has restarted
+// or doesn't know us; return -1, if the package has to be dropped
+//======================================================================================================
+static int check_epochs( n_rf24l01_arq_t* arq, u_char epoch, u_char peer_epoch, uint64_t now_mks )
+{
+  if( epoch != arq->peer_epoch )
+  {
+    if( arq->peer_epoch )
+      arq->stats.resets++;
+
+    arq->peer_epoch = epoch;
+    reset( arq, now_mks );
+  }
+
+  // the package is meant for our previous epoch, or the peer has just met us,
+  // an acknowledge lets it know the current one
+  if( peer_epoch != arq->epoch )
+  {
+    arq->ack_pending = 1;
+    arq->ack_due_mks = now_mks;
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief initialize an ARQ
+ *
+ * @param[out] arq     - an ARQ to initialize
+ * @param[in]  window  - a max amount of packages in flight
+ * @param[in]  send    - a callback to transmit a package
+ * @param[in]  deliver - a callback to deliver received data
+ * @param[in]  ctx     - a context passed to callbacks
+ * @param[in]  now_mks - a current time
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_arq_init( n_rf24l01_arq_t* arq, u_int window, n_rf24l01_arq_send_ptr send,
+                        n_rf24l01_arq_deliver_ptr deliver, void* ctx, uint64_t now_mks )
+{
+  if( !arq || !send || !deliver || !window || window > N_RF24L01_ARQ_MAX_WINDOW )
+    return -1;
+
+  memset( arq, 0, sizeof(*arq) );
+
+  arq->window = window;
+  arq->send = send;
+  arq->deliver = deliver;
+  arq->ctx = ctx;
+  arq->rto_mks = N_RF24L01_ARQ_INIT_RTO_MKS;
+
+  // a restart gets another epoch unless it's within the same microsecond, 0 is "unknown"
+  arq->epoch = (uint32_t)now_mks * 0x9e3779b9 >> 24;
+  if( !arq->epoch )
+    arq->epoch = 1;
+
+  return 0;
+}
+
+/**
+ * @brief forget a measured RTT and start with the initial RTO again
+ */
+//======================================================================================================
+void n_rf24l01_arq_restart_rtt( n_rf24l01_arq_t* arq )
+{
+  arq->srtt_mks = 0;
+  arq->rttvar_mks = 0;
+  arq->rto_mks = N_RF24L01_ARQ_INIT_RTO_MKS;
+}
+
+/**
+ * @brief get an amount of data n_rf24l01_arq_send can accept right now
+ */
+//======================================================================================================
+u_int n_rf24l01_arq_space( const n_rf24l01_arq_t* arq )
+{
+  return ( arq->window - (u_char)( arq->tx_next - arq->tx_base ) ) * N_RF24L01_ARQ_PAYLOAD_SIZE;
+}
+
+/**
+ * @brief transmit data
+ *
+ * @param[in] data    - data to transmit
+ * @param[in] num     - an amount of @data, in bytes
+ * @param[in] now_mks - a current time
+ * @return an amount of data accepted
+ */
+//======================================================================================================
+u_int n_rf24l01_arq_send( n_rf24l01_arq_t* arq, const void* data, u_int num, uint64_t now_mks )
+{
+  n_rf24l01_arq_slot_t* slot;
+  const u_char* ptr = data;
+  u_int accepted = 0;
+
+  while( num && (u_char)( arq->tx_next - arq->tx_base ) < arq->window )
+  {
+    slot = get_slot( arq->tx, arq->tx_next );
+
+    slot->len = num < N_RF24L01_ARQ_PAYLOAD_SIZE ? num : N_RF24L01_ARQ_PAYLOAD_SIZE;
+    memcpy( slot->data, ptr, slot->len );
+    slot->used = 1;
+    slot->acked = 0;
+    slot->transmissions = 0;
+
+    transmit_slot( arq, arq->tx_next++, now_mks );
+
+    ptr += slot->len;
+    num -= slot->len;
+    accepted += slot->len;
+  }
+
+  return accepted;
+}
+
+/**
+ * @brief handle a received package
+ *
+ * @param[in] pkg     - a package
+ * @param[in] now_mks - time the package was received at
+ * @return -1, if it isn't an ARQ package
+ */
+//======================================================================================================
+int n_rf24l01_arq_on_pkg( n_rf24l01_arq_t* arq, const u_char* pkg, uint64_t now_mks )
+{
+  switch( pkg[0] )
+  {
+    case N_RF24L01_ARQ_DATA:
+      if( !check_epochs( arq, pkg[3], pkg[4], now_mks ) )
+        on_data( arq, pkg, now_mks );
+      return 0;
+
+    case N_RF24L01_ARQ_ACK:
+      if( !check_epochs( arq, pkg[6], pkg[7], now_mks ) )
+        on_ack( arq, pkg, now_mks );
+      return 0;
+  }
+
+  return -1;
+}
+
+/**
+ * @brief retransmit timed out packages and send a delayed acknowledge
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_arq_poll( n_rf24l01_arq_t* arq, uint64_t now_mks )
+{
+  n_rf24l01_arq_slot_t* slot;
+  uint32_t timeout = 0xffffffff;
+  u_char in_flight, seq, timed_out = 0;
+  uint64_t deadline;
+  u_int i;
+
+  if( arq->ack_pending && now_mks >= arq->ack_due_mks )
+    send_ack( arq );
+
+  in_flight = arq->tx_next - arq->tx_base;
+
+  for( i = 0; i < in_flight; i++ )
+  {
+    seq = arq->tx_base + i;
+    slot = get_slot( arq->tx, seq );
+
+    if( slot->acked )
+      continue;
+
+    if( now_mks - slot->sent_mks >= arq->rto_mks )
+    {
+      transmit_slot( arq, seq, now_mks );
+      timed_out = 1;
+    }
+  }
+
+  // losses on a radio link are mostly random, so back off only if nothing has been heard
+  // from a receiver since the previous timeout
+  if( timed_out && arq->acks_at_timeout == arq->stats.acks_received )
+  {
+    arq->rto_mks *= 2;
+    if( arq->rto_mks > N_RF24L01_ARQ_MAX_RTO_MKS )
+      arq->rto_mks = N_RF24L01_ARQ_MAX_RTO_MKS;
+  }
+
+  if( timed_out )
+    arq->acks_at_timeout = arq->stats.acks_received;
+
+  for( i = 0; i < in_flight; i++ )
+  {
+    slot = get_slot( arq->tx, arq->tx_base + i );
+
+    if( slot->acked )
+      continue;
+
+    deadline = slot->sent_mks + arq->rto_mks;
+    if( deadline <= now_mks )
+      timeout = 0;
+    else if( deadline - now_mks < timeout )
+      timeout = deadline - now_mks;
+  }
+
+  if( arq->ack_pending )
+  {
+    if( arq->ack_due_mks <= now_mks )
+      timeout = 0;
+    else if( arq->ack_due_mks - now_mks < timeout )
+      timeout = arq->ack_due_mks - now_mks;
+  }
+
+  return timeout;
+}
@@ -0,0 +1,174 @@
+#ifndef N_RF24L01_ARQ_H
+#define N_RF24L01_ARQ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A selective-repeat ARQ on top of the library's core, makes a reliable byte stream over
+ * packages the transceiver transmits without acknowledges.
+ *
+ * Each data package carries a sequence number, a receiver buffers packages received out
+ * of order and delivers data in order; it acknowledges by a cumulative sequence number
+ * plus a bitmap of packages received beyond it (SACK). A transmitter keeps up to a window of
+ * packages in flight, retransmits a package either when a SACK shows a later package has
+ * got through or when the package's timeout expires, the timeout follows a smoothed RTT.
+ *
+ * Each side picks a random epoch at init and stamps packages with its epoch and the peer's one
+ * it knows; a package with a new epoch of the peer means the peer has (re)started, so received
+ * packages are dropped and packages in flight are numbered from 0 again and retransmitted, and
+ * a package for another epoch of ours is answered by an acknowledge which lets the peer know it,
+ * so either side may restart and the link realigns in a round trip.
+ *
+ * Both sides of a link use the same object to transmit and to receive. The ARQ has no own
+ * clock, a time (in microseconds, any monotonic origin) is passed by a caller, and doesn't
+ * talk to the core directly, packages go out through a callback, so a caller can batch them. */
+
+#include "../n_rf24l01_core.h"
+
+/* a max amount of packages in flight */
+#define N_RF24L01_ARQ_MAX_WINDOW 32
+
+/* an amount of user data a package carries */
+#define N_RF24L01_ARQ_PAYLOAD_SIZE ( N_RF24L01_PKG_SIZE - 5 )
+
+#define N_RF24L01_ARQ_MIN_RTO_MKS 2000
+#define N_RF24L01_ARQ_MAX_RTO_MKS 500000
+
+/* an initial RTO, till the first RTT sample */
+#define N_RF24L01_ARQ_INIT_RTO_MKS 50000
+
+/* how long a receiver waits for more packages to acknowledge them all at once */
+#define N_RF24L01_ARQ_ACK_DELAY_MKS 1000
+
+/**
+ * @brief transmit a package (N_RF24L01_PKG_SIZE bytes)
+ */
+typedef void (*n_rf24l01_arq_send_ptr)( void* ctx, const u_char* pkg );
+
+/**
+ * @brief deliver in-order data to a user
+ */
+typedef void (*n_rf24l01_arq_deliver_ptr)( void* ctx, const u_char* data, u_int num );
+
+typedef struct n_rf24l01_arq_slot_t
+{
+  u_char data[N_RF24L01_ARQ_PAYLOAD_SIZE];
+  u_char len;
+  u_char used;
+
+  /* transmitter only */
+  u_char acked;
+  u_char transmissions;
+  uint64_t sent_mks;
+  uint32_t sent_order;
+} n_rf24l01_arq_slot_t;
+
+typedef struct n_rf24l01_arq_stats_t
+{
+  u_int pkgs_sent;
+  u_int pkgs_retransmitted;
+  u_int pkgs_received;
+  u_int pkgs_duplicated;
+  u_int acks_sent;
+  u_int acks_received;
+  u_int resets;     /* the peer has restarted */
+} n_rf24l01_arq_stats_t;
+
+typedef struct n_rf24l01_arq_t
+{
+  u_int window;
+
+  n_rf24l01_arq_send_ptr send;
+  n_rf24l01_arq_deliver_ptr deliver;
+  void* ctx;
+
+  /* ours and the peer's epochs, 0 - the peer is unknown yet */
+  u_char epoch;
+  u_char peer_epoch;
+
+  /* transmitter */
+  n_rf24l01_arq_slot_t tx[N_RF24L01_ARQ_MAX_WINDOW];
+  u_char tx_base;   /* the oldest not acknowledged package */
+  u_char tx_next;   /* a sequence number for the next new package */
+  uint32_t tx_order; /* a counter of transmissions, to know what was sent before what */
+
+  uint32_t srtt_mks;
+  uint32_t rttvar_mks;
+  uint32_t rto_mks;
+  u_int acks_at_timeout;
+
+  /* receiver */
+  n_rf24l01_arq_slot_t rx[N_RF24L01_ARQ_MAX_WINDOW];
+  u_char rx_base;   /* the next package to deliver */
+  u_char ack_pending;
+  u_int unacked;
+  uint64_t ack_due_mks;
+
+  n_rf24l01_arq_stats_t stats;
+} n_rf24l01_arq_t;
+
+/**
+ * @brief initialize an ARQ
+ *
+ * @param[out] arq     - an ARQ to initialize
+ * @param[in]  window  - a max amount of packages in flight, [1..N_RF24L01_ARQ_MAX_WINDOW],
+ *                       both sides have to use the same window
+ * @param[in]  send    - a callback to transmit a package
+ * @param[in]  deliver - a callback to deliver received data
+ * @param[in]  ctx     - a context passed to callbacks
+ * @param[in]  now_mks - a current time, the epoch is picked by it
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_arq_init( n_rf24l01_arq_t* arq, u_int window, n_rf24l01_arq_send_ptr send,
+                        n_rf24l01_arq_deliver_ptr deliver, void* ctx, uint64_t now_mks );
+
+/**
+ * @brief forget a measured RTT and start with the initial RTO again,
+ *        e.g. a data rate of a link has changed
+ */
+//======================================================================================================
+void n_rf24l01_arq_restart_rtt( n_rf24l01_arq_t* arq );
+
+/**
+ * @brief get an amount of data n_rf24l01_arq_send can accept right now
+ */
+//======================================================================================================
+u_int n_rf24l01_arq_space( const n_rf24l01_arq_t* arq );
+
+/**
+ * @brief transmit data
+ *
+ * @param[in] data    - data to transmit
+ * @param[in] num     - an amount of @data, in bytes
+ * @param[in] now_mks - a current time
+ * @return an amount of data accepted, the rest has to be passed again later
+ */
+//======================================================================================================
+u_int n_rf24l01_arq_send( n_rf24l01_arq_t* arq, const void* data, u_int num, uint64_t now_mks );
+
+/**
+ * @brief handle a received package
+ *
+ * @param[in] pkg     - a package (N_RF24L01_PKG_SIZE bytes)
+ * @param[in] now_mks - time the package was received at
+ * @return -1, if it isn't an ARQ package
+ */
+//======================================================================================================
+int n_rf24l01_arq_on_pkg( n_rf24l01_arq_t* arq, const u_char* pkg, uint64_t now_mks );
+
+/**
+ * @brief retransmit timed out packages and send a delayed acknowledge
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_arq_poll( n_rf24l01_arq_t* arq, uint64_t now_mks );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_ARQ_H
@@ -0,0 +1,371 @@
+/**
+ * @file a bonding of several transceivers implementation
+ */
+
+// a package format:
+//  data:   <N_RF24L01_BOND_DATA> <sequence number: 2 bytes, LSByte first> <length>
+//          <payload: N_RF24L01_BOND_PAYLOAD_SIZE bytes>
+//  report: <N_RF24L01_BOND_REPORT> <an amount of links>
+//          <for each link: packages received over it, 2 bytes, LSByte first>
+
+#include <string.h>
+
+#include "n_rf24l01_bond.h"
+
+#define N_RF24L01_BOND_DATA   0xb0
+#define N_RF24L01_BOND_REPORT 0xbf
+
+// a least amount of packages sent over a link to re-estimate its weight
+#define N_RF24L01_BOND_MIN_SAMPLE 16
+
+// a distance to a sequence number a receiver considers a remote side to be restarted from
+#define N_RF24L01_BOND_RESYNC_DISTANCE ( 4 * N_RF24L01_BOND_WINDOW )
+
+
+// pick a link for a next package by a smooth weighted round-robin
+//======================================================================================================
+static u_int pick_link( n_rf24l01_bond_t* bond )
+{
+  u_int i, best = 0;
+  int total = 0;
+
+  for( i = 0; i < bond->links_num; i++ )
+  {
+    bond->links[i].credit += bond->links[i].weight;
+    total += bond->links[i].weight;
+
+    if( bond->links[i].credit > bond->links[best].credit )
+      best = i;
+  }
+
+  bond->links[best].credit -= total;
+
+  return best;
+}
+
+// deliver a package in a slot of rx_next, if any, and move to a next one
+//======================================================================================================
+static void advance( n_rf24l01_bond_t* bond )
+{
+  u_int slot = bond->rx_next % N_RF24L01_BOND_WINDOW;
+
+  if( bond->rx_map & ( 1ull << slot ) )
+  {
+    bond->rx_map &= ~( 1ull << slot );
+    bond->deliver( bond->ctx, bond->rx_data[slot], bond->rx_len[slot] );
+  }
+  else
+    bond->stats.pkgs_skipped++;
+
+  bond->rx_next++;
+}
+
+// deliver everything buffered in order from rx_next on, a wait for a next missing package
+// starts once the previous one has come (links with different latencies always leave a gap)
+//======================================================================================================
+static void deliver_in_order( n_rf24l01_bond_t* bond, uint64_t now_mks )
+{
+  uint16_t next = bond->rx_next;
+
+  while( bond->rx_map & ( 1ull << ( bond->rx_next % N_RF24L01_BOND_WINDOW ) ) )
+    advance( bond );
+
+  if( !bond->rx_map )
+    bond->holding = 0;
+  else if( !bond->holding || next != bond->rx_next )
+  {
+    bond->holding = 1;
+    bond->hold_mks = now_mks;
+  }
+}
+
+// give up on everything missing, deliver what's buffered and start from @seq
+//======================================================================================================
+static void resync( n_rf24l01_bond_t* bond, uint16_t seq )
+{
+  while( bond->rx_map )
+    advance( bond );
+
+  bond->rx_next = seq;
+  bond->holding = 0;
+}
+
+// handle a received data package
+//======================================================================================================
+static void on_data( n_rf24l01_bond_t* bond, const u_char* pkg, uint64_t now_mks )
+{
+  uint16_t seq, distance;
+  u_int slot, len;
+
+  seq = pkg[1] | pkg[2] << 8;
+  len = pkg[3];
+
+  if( len > N_RF24L01_BOND_PAYLOAD_SIZE )
+    return;
+
+  if( !bond->rx_synced )
+  {
+    bond->rx_synced = 1;
+    bond->rx_next = seq;
+  }
+
+  distance = seq - bond->rx_next;
+
+  // a package from the past: either a late one or a remote side has been restarted
+  if( distance >= 0x8000 )
+  {
+    if( (uint16_t)( bond->rx_next - seq ) <= N_RF24L01_BOND_RESYNC_DISTANCE )
+    {
+      bond->stats.pkgs_late++;
+      return;
+    }
+
+    resync( bond, seq );
+    distance = 0;
+  }
+
+  if( distance >= N_RF24L01_BOND_RESYNC_DISTANCE )
+  {
+    resync( bond, seq );
+    distance = 0;
+  }
+
+  // no room for the package, give up on the oldest missing ones
+  while( distance >= N_RF24L01_BOND_WINDOW )
+  {
+    advance( bond );
+    distance--;
+  }
+
+  slot = seq % N_RF24L01_BOND_WINDOW;
+  if( bond->rx_map & ( 1ull << slot ) )
+  {
+    bond->stats.pkgs_late++;
+    return;
+  }
+
+  memcpy( bond->rx_data[slot], pkg + 4, len );
+  bond->rx_len[slot] = len;
+  bond->rx_map |= 1ull << slot;
+
+  if( distance )
+    bond->stats.pkgs_reordered++;
+
+  deliver_in_order( bond, now_mks );
+}
+
+// handle a report of a remote side
+//======================================================================================================
+static void on_report( n_rf24l01_bond_t* bond, const u_char* pkg )
+{
+  n_rf24l01_bond_link_t* link;
+  uint16_t received, delta_received, delta_sent;
+  u_int i, ratio;
+
+  bond->stats.reports_received++;
+
+  for( i = 0; i < pkg[1] && i < bond->links_num && 2 + 2 * i + 1 < N_RF24L01_PKG_SIZE; i++ )
+  {
+    link = &bond->links[i];
+    received = pkg[2 + 2 * i] | pkg[2 + 2 * i + 1] << 8;
+
+    if( !link->reported )
+    {
+      link->reported = 1;
+      link->last_sent = link->pkgs_sent;
+      link->last_received = received;
+      continue;
+    }
+
+    delta_sent = (uint16_t)link->pkgs_sent - link->last_sent;
+    delta_received = received - link->last_received;
+
+    // too few packages to judge, let them accumulate
+    if( delta_sent < N_RF24L01_BOND_MIN_SAMPLE )
+      continue;
+
+    // packages in flight at the report's time get counted by the next one
+    if( delta_received > delta_sent )
+      delta_received = delta_sent;
+
+    ratio = delta_received * N_RF24L01_BOND_MAX_WEIGHT / delta_sent;
+
+    link->weight = ( 3 * link->weight + ratio ) / 4;
+    if( link->weight < N_RF24L01_BOND_MIN_WEIGHT )
+      link->weight = N_RF24L01_BOND_MIN_WEIGHT;
+
+    link->last_sent = link->pkgs_sent;
+    link->last_received = received;
+  }
+}
+
+// send a report over every link
+//======================================================================================================
+static void send_report( n_rf24l01_bond_t* bond )
+{
+  u_char pkg[N_RF24L01_PKG_SIZE] = { 0, };
+  u_int i;
+
+  pkg[0] = N_RF24L01_BOND_REPORT;
+  pkg[1] = bond->links_num;
+
+  for( i = 0; i < bond->links_num; i++ )
+  {
+    pkg[2 + 2 * i] = bond->links[i].rx_received;
+    pkg[2 + 2 * i + 1] = bond->links[i].rx_received >> 8;
+  }
+
+  for( i = 0; i < bond->links_num; i++ )
+  {
+    bond->send( bond->ctx, i, pkg );
+    bond->stats.reports_sent++;
+  }
+}
+
+/**
+ * @brief initialize a bonding
+ *
+ * @param[out] bond      - a bonding to initialize
+ * @param[in]  links_num - an amount of links
+ * @param[in]  send      - a callback to transmit a package
+ * @param[in]  deliver   - a callback to deliver received data
+ * @param[in]  ctx       - a context passed to callbacks
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_bond_init( n_rf24l01_bond_t* bond, u_int links_num, n_rf24l01_bond_send_ptr send,
+                         n_rf24l01_bond_deliver_ptr deliver, void* ctx )
+{
+  u_int i;
+
+  if( !bond || !send || !deliver || !links_num || links_num > N_RF24L01_BOND_MAX_LINKS )
+    return -1;
+
+  memset( bond, 0, sizeof(*bond) );
+
+  bond->links_num = links_num;
+  bond->send = send;
+  bond->deliver = deliver;
+  bond->ctx = ctx;
+
+  for( i = 0; i < links_num; i++ )
+    bond->links[i].weight = N_RF24L01_BOND_MAX_WEIGHT;
+
+  return 0;
+}
+
+/**
+ * @brief stripe data over links
+ *
+ * @param[in] data - data to transmit
+ * @param[in] num  - an amount of @data, in bytes
+ */
+//======================================================================================================
+void n_rf24l01_bond_send( n_rf24l01_bond_t* bond, const void* data, u_int num )
+{
+  const u_char* src = data;
+  u_char pkg[N_RF24L01_PKG_SIZE];
+  u_int len, link;
+
+  while( num )
+  {
+    len = num < N_RF24L01_BOND_PAYLOAD_SIZE ? num : N_RF24L01_BOND_PAYLOAD_SIZE;
+
+    memset( pkg, 0, sizeof(pkg) );
+    pkg[0] = N_RF24L01_BOND_DATA;
+    pkg[1] = bond->tx_seq;
+    pkg[2] = bond->tx_seq >> 8;
+    pkg[3] = len;
+    memcpy( pkg + 4, src, len );
+
+    bond->tx_seq++;
+
+    link = pick_link( bond );
+    bond->links[link].pkgs_sent++;
+    bond->send( bond->ctx, link, pkg );
+
+    src += len;
+    num -= len;
+  }
+}
+
+/**
+ * @brief handle a package received over a @link
+ *
+ * @param[in] link    - a link the package came over
+ * @param[in] pkg     - a package
+ * @param[in] now_mks - a current time
+ * @return -1, if it isn't a bonding package
+ */
+//======================================================================================================
+int n_rf24l01_bond_on_pkg( n_rf24l01_bond_t* bond, u_int link, const u_char* pkg, uint64_t now_mks )
+{
+  if( link >= bond->links_num )
+    return -1;
+
+  if( pkg[0] == N_RF24L01_BOND_REPORT )
+  {
+    on_report( bond, pkg );
+    return 0;
+  }
+
+  if( pkg[0] != N_RF24L01_BOND_DATA )
+    return -1;
+
+  bond->links[link].rx_received++;
+  bond->links[link].pkgs_received++;
+  bond->rx_activity = 1;
+
+  on_data( bond, pkg, now_mks );
+
+  return 0;
+}
+
+/**
+ * @brief give up waiting for missing packages and send reports, if it's time to
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_bond_poll( n_rf24l01_bond_t* bond, uint64_t now_mks )
+{
+  uint32_t timeout = 0xffffffff;
+  uint64_t deadline;
+
+  if( bond->holding )
+  {
+    deadline = bond->hold_mks + N_RF24L01_BOND_HOLD_MKS;
+
+    if( now_mks >= deadline )
+    {
+      // skip missing packages up to a buffered one, a wait for a next gap starts anew
+      bond->holding = 0;
+
+      while( bond->rx_map && !( bond->rx_map & ( 1ull << ( bond->rx_next % N_RF24L01_BOND_WINDOW ) ) ) )
+        advance( bond );
+
+      deliver_in_order( bond, now_mks );
+
+      if( bond->holding )
+        timeout = N_RF24L01_BOND_HOLD_MKS;
+    }
+    else
+      timeout = deadline - now_mks;
+  }
+
+  if( bond->rx_activity )
+  {
+    if( now_mks >= bond->report_mks )
+    {
+      send_report( bond );
+
+      bond->rx_activity = 0;
+      bond->report_mks = now_mks + N_RF24L01_BOND_REPORT_MKS;
+    }
+    else if( bond->report_mks - now_mks < timeout )
+      timeout = bond->report_mks - now_mks;
+  }
+
+  return timeout;
+}
@@ -0,0 +1,155 @@
+#ifndef N_RF24L01_BOND_H
+#define N_RF24L01_BOND_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A bonding of several transceivers (links) on top of the library's core.
+ *
+ * A stream is split into packages which get striped over links by a smooth weighted
+ * round-robin, a link's weight follows a share of its packages a remote side reports
+ * to have received, so a degraded link carries less traffic (but never less than
+ * N_RF24L01_BOND_MIN_WEIGHT, to notice when it gets better).
+ *
+ * A receiver puts packages back in order in a resequencing buffer of
+ * N_RF24L01_BOND_WINDOW packages; a missing package is waited for up to
+ * N_RF24L01_BOND_HOLD_MKS, then it's skipped, so there's no reliability here, a stream
+ * is as lossy as links are. Reports are sent over every link each N_RF24L01_BOND_REPORT_MKS
+ * while there's something received.
+ *
+ * The bonding has no own clock, a time (in microseconds, any monotonic origin) is passed
+ * by a caller, and doesn't talk to the core directly, packages go out through a callback,
+ * it's up to a caller to transmit them over a proper transceiver. */
+
+#include "../n_rf24l01_core.h"
+
+#define N_RF24L01_BOND_MAX_LINKS 4
+
+/* a size of a resequencing buffer, in packages */
+#define N_RF24L01_BOND_WINDOW 64
+
+/* how long a receiver waits for a missing package */
+#define N_RF24L01_BOND_HOLD_MKS 20000
+
+/* how often a receiver reports links' statistics back */
+#define N_RF24L01_BOND_REPORT_MKS 100000
+
+/* a weight of a link which delivers everything, and the least one */
+#define N_RF24L01_BOND_MAX_WEIGHT 256
+#define N_RF24L01_BOND_MIN_WEIGHT 8
+
+/* an amount of user data a package carries */
+#define N_RF24L01_BOND_PAYLOAD_SIZE ( N_RF24L01_PKG_SIZE - 4 )
+
+/**
+ * @brief transmit a package (N_RF24L01_PKG_SIZE bytes) over a @link
+ */
+typedef void (*n_rf24l01_bond_send_ptr)( void* ctx, u_int link, const u_char* pkg );
+
+/**
+ * @brief deliver data to a user
+ */
+typedef void (*n_rf24l01_bond_deliver_ptr)( void* ctx, const u_char* data, u_int num );
+
+typedef struct n_rf24l01_bond_link_t
+{
+  /* a transmitter's side */
+  u_int weight;           /* [N_RF24L01_BOND_MIN_WEIGHT..N_RF24L01_BOND_MAX_WEIGHT] */
+  int credit;             /* a current weight of the smooth weighted round-robin */
+  uint16_t last_sent;     /* counters at the last report */
+  uint16_t last_received;
+  u_char reported;
+
+  /* a receiver's side */
+  uint16_t rx_received;
+
+  u_int pkgs_sent;
+  u_int pkgs_received;
+} n_rf24l01_bond_link_t;
+
+typedef struct n_rf24l01_bond_stats_t
+{
+  u_int pkgs_reordered;  /* packages which came ahead of a missing one */
+  u_int pkgs_skipped;    /* packages given up to wait for */
+  u_int pkgs_late;       /* packages which came after they were skipped */
+  u_int reports_sent;
+  u_int reports_received;
+} n_rf24l01_bond_stats_t;
+
+typedef struct n_rf24l01_bond_t
+{
+  n_rf24l01_bond_link_t links[N_RF24L01_BOND_MAX_LINKS];
+  u_int links_num;
+
+  n_rf24l01_bond_send_ptr send;
+  n_rf24l01_bond_deliver_ptr deliver;
+  void* ctx;
+
+  uint16_t tx_seq;
+
+  /* a resequencing buffer, a slot of a sequence number is (seq % N_RF24L01_BOND_WINDOW) */
+  u_char rx_data[N_RF24L01_BOND_WINDOW][N_RF24L01_BOND_PAYLOAD_SIZE];
+  u_char rx_len[N_RF24L01_BOND_WINDOW];
+  uint64_t rx_map;        /* bit i - a slot i is occupied */
+  uint16_t rx_next;       /* a sequence number to deliver next */
+  u_char rx_synced;
+  u_char holding;         /* rx_next is missing, but there's something after it */
+  uint64_t hold_mks;      /* when a wait for a missing rx_next has begun */
+
+  uint64_t report_mks;    /* when to send a next report */
+  u_char rx_activity;     /* something has been received since the last report */
+
+  n_rf24l01_bond_stats_t stats;
+} n_rf24l01_bond_t;
+
+/**
+ * @brief initialize a bonding
+ *
+ * @param[out] bond      - a bonding to initialize
+ * @param[in]  links_num - an amount of links, [1..N_RF24L01_BOND_MAX_LINKS]
+ * @param[in]  send      - a callback to transmit a package
+ * @param[in]  deliver   - a callback to deliver received data
+ * @param[in]  ctx       - a context passed to callbacks
+ * @return -1, if failed
+ *
+ * Note: both sides have to have the same amount of links
+ */
+//======================================================================================================
+int n_rf24l01_bond_init( n_rf24l01_bond_t* bond, u_int links_num, n_rf24l01_bond_send_ptr send,
+                         n_rf24l01_bond_deliver_ptr deliver, void* ctx );
+
+/**
+ * @brief stripe data over links
+ *
+ * @param[in] data - data to transmit
+ * @param[in] num  - an amount of @data, in bytes
+ */
+//======================================================================================================
+void n_rf24l01_bond_send( n_rf24l01_bond_t* bond, const void* data, u_int num );
+
+/**
+ * @brief handle a package received over a @link
+ *
+ * @param[in] link    - a link the package came over
+ * @param[in] pkg     - a package (N_RF24L01_PKG_SIZE bytes)
+ * @param[in] now_mks - a current time
+ * @return -1, if it isn't a bonding package
+ */
+//======================================================================================================
+int n_rf24l01_bond_on_pkg( n_rf24l01_bond_t* bond, u_int link, const u_char* pkg, uint64_t now_mks );
+
+/**
+ * @brief give up waiting for missing packages and send reports, if it's time to
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_bond_poll( n_rf24l01_bond_t* bond, uint64_t now_mks );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_BOND_H
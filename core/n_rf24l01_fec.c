@@ -0,0 +1,429 @@
+/**
+ * @file forward error correction implementation
+ */
+
+// a package format:
+//  <N_RF24L01_FEC_TAG> <group> <index> <count> <length> <payload: N_RF24L01_FEC_PAYLOAD_SIZE bytes>
+//
+// index - [0..k) for data packages, 0x80 | [0..m) for parity packages
+// count - an amount of data packages in the group, only parity packages know it
+// <length> <payload> - a region the code covers, parity packages carry parity of it
+//
+// a parity package p is a sum of data packages j multiplied by 1 / (x_p + y_j), x_p = 0x80 | p,
+// y_j = j, as any square submatrix of such a (Cauchy) matrix is invertible, any k of k + m
+// packages are enough to recover a group
+
+#include <string.h>
+
+#include "n_rf24l01_fec.h"
+
+#define N_RF24L01_FEC_TAG 0xf0
+#define N_RF24L01_FEC_PARITY 0x80
+#define N_RF24L01_FEC_HEADER_SIZE 4
+
+// GF(256) with a 0x11d polynomial, gf_exp is doubled to not take a sum of logarithms by a modulo
+static u_char gf_exp[2 * 255];
+static u_char gf_log[256];
+static u_char gf_ready;
+
+
+//======================================================================================================
+static void gf_init( void )
+{
+  u_int i, x = 1;
+
+  if( gf_ready )
+    return;
+
+  for( i = 0; i < 255; i++ )
+  {
+    gf_exp[i] = gf_exp[i + 255] = x;
+    gf_log[x] = i;
+
+    x <<= 1;
+    if( x & 0x100 )
+      x ^= 0x11d;
+  }
+
+  gf_ready = 1;
+}
+
+//======================================================================================================
+static inline u_char gf_mul( u_char a, u_char b )
+{
+  return a && b ? gf_exp[gf_log[a] + gf_log[b]] : 0;
+}
+
+//======================================================================================================
+static inline u_char gf_inv( u_char a )
+{
+  return gf_exp[255 - gf_log[a]];
+}
+
+// a coefficient of a data package @data in a parity package @parity
+//======================================================================================================
+static inline u_char get_coef( u_int parity, u_int data )
+{
+  return gf_inv( ( N_RF24L01_FEC_PARITY | parity ) ^ data );
+}
+
+// invert an @n x @n matrix in place (Gauss-Jordan), the matrix is known to be invertible
+//======================================================================================================
+static void invert_matrix( u_char matrix[][N_RF24L01_FEC_MAX_PARITY], u_int n )
+{
+  u_char inverse[N_RF24L01_FEC_MAX_PARITY][N_RF24L01_FEC_MAX_PARITY];
+  u_char tmp[N_RF24L01_FEC_MAX_PARITY];
+  u_char c;
+  u_int i, j, row;
+
+  memset( inverse, 0, sizeof(inverse) );
+  for( i = 0; i < n; i++ )
+    inverse[i][i] = 1;
+
+  for( i = 0; i < n; i++ )
+  {
+    for( row = i; !matrix[row][i]; row++ )
+      ;
+
+    if( row != i )
+    {
+      memcpy( tmp, matrix[i], n ); memcpy( matrix[i], matrix[row], n ); memcpy( matrix[row], tmp, n );
+      memcpy( tmp, inverse[i], n ); memcpy( inverse[i], inverse[row], n ); memcpy( inverse[row], tmp, n );
+    }
+
+    c = gf_inv( matrix[i][i] );
+    for( j = 0; j < n; j++ )
+    {
+      matrix[i][j] = gf_mul( matrix[i][j], c );
+      inverse[i][j] = gf_mul( inverse[i][j], c );
+    }
+
+    for( row = 0; row < n; row++ )
+    {
+      if( row == i || !matrix[row][i] )
+        continue;
+
+      c = matrix[row][i];
+      n_rf24l01_fec_mul_add( matrix[row], matrix[i], c, n );
+      n_rf24l01_fec_mul_add( inverse[row], inverse[i], c, n );
+    }
+  }
+
+  for( i = 0; i < n; i++ )
+    memcpy( matrix[i], inverse[i], n );
+}
+
+//======================================================================================================
+static void send_parity( n_rf24l01_fec_t* fec )
+{
+  u_char pkg[N_RF24L01_PKG_SIZE];
+  u_int p, j;
+
+  for( p = 0; p < fec->m; p++ )
+  {
+    memset( pkg, 0, sizeof(pkg) );
+
+    pkg[0] = N_RF24L01_FEC_TAG;
+    pkg[1] = fec->tx_group;
+    pkg[2] = N_RF24L01_FEC_PARITY | p;
+    pkg[3] = fec->tx_count;
+
+    for( j = 0; j < fec->tx_count; j++ )
+      n_rf24l01_fec_mul_add( pkg + N_RF24L01_FEC_HEADER_SIZE, fec->tx_data[j], get_coef( p, j ),
+                             N_RF24L01_FEC_CODED_SIZE );
+
+    fec->stats.parity_pkgs_sent++;
+    fec->send( fec->ctx, pkg );
+  }
+
+  fec->tx_group++;
+  fec->tx_count = 0;
+}
+
+// deliver data packages in order till the first gap
+//======================================================================================================
+static void deliver_in_order( n_rf24l01_fec_t* fec )
+{
+  u_char* data;
+
+  while( fec->rx_delivered < N_RF24L01_FEC_MAX_DATA && fec->rx_data_map >> fec->rx_delivered & 1 )
+  {
+    data = fec->rx_data[fec->rx_delivered++];
+
+    if( data[0] <= N_RF24L01_FEC_PAYLOAD_SIZE )
+      fec->deliver( fec->ctx, data + 1, data[0] );
+  }
+}
+
+// recover lost data packages, if there're enough parity packages
+//======================================================================================================
+static void recover( n_rf24l01_fec_t* fec )
+{
+  u_char matrix[N_RF24L01_FEC_MAX_PARITY][N_RF24L01_FEC_MAX_PARITY];
+  u_char syndromes[N_RF24L01_FEC_MAX_PARITY][N_RF24L01_FEC_CODED_SIZE];
+  u_int lost[N_RF24L01_FEC_MAX_PARITY], parity[N_RF24L01_FEC_MAX_PARITY];
+  u_int lost_num = 0, parity_num = 0;
+  u_int i, j;
+
+  for( j = fec->rx_delivered; j < fec->rx_count; j++ )
+    if( !( fec->rx_data_map >> j & 1 ) )
+    {
+      if( lost_num == N_RF24L01_FEC_MAX_PARITY )
+        return;
+
+      lost[lost_num++] = j;
+    }
+
+  for( i = 0; i < N_RF24L01_FEC_MAX_PARITY && parity_num < lost_num; i++ )
+    if( fec->rx_parity_map >> i & 1 )
+      parity[parity_num++] = i;
+
+  if( !lost_num || parity_num < lost_num )
+    return;
+
+  // a syndrome of a parity package is a sum of lost data packages only
+  for( i = 0; i < lost_num; i++ )
+  {
+    memcpy( syndromes[i], fec->rx_parity[parity[i]], N_RF24L01_FEC_CODED_SIZE );
+
+    for( j = 0; j < fec->rx_count; j++ )
+      if( fec->rx_data_map >> j & 1 )
+        n_rf24l01_fec_mul_add( syndromes[i], fec->rx_data[j], get_coef( parity[i], j ), N_RF24L01_FEC_CODED_SIZE );
+
+    for( j = 0; j < lost_num; j++ )
+      matrix[i][j] = get_coef( parity[i], lost[j] );
+  }
+
+  invert_matrix( matrix, lost_num );
+
+  for( j = 0; j < lost_num; j++ )
+  {
+    memset( fec->rx_data[lost[j]], 0, N_RF24L01_FEC_CODED_SIZE );
+
+    for( i = 0; i < lost_num; i++ )
+      n_rf24l01_fec_mul_add( fec->rx_data[lost[j]], syndromes[i], matrix[j][i], N_RF24L01_FEC_CODED_SIZE );
+
+    fec->rx_data_map |= 1u << lost[j];
+    fec->stats.pkgs_recovered++;
+  }
+}
+
+// give up on a group: deliver what's left, skipping lost packages
+//======================================================================================================
+static void finish_group( n_rf24l01_fec_t* fec )
+{
+  u_int last;
+
+  if( fec->rx_count )
+    last = fec->rx_count;
+  else
+    for( last = N_RF24L01_FEC_MAX_DATA; last && !( fec->rx_data_map >> ( last - 1 ) & 1 ); last-- )
+      ;
+
+  while( fec->rx_delivered < last )
+  {
+    if( !( fec->rx_data_map >> fec->rx_delivered & 1 ) )
+    {
+      fec->stats.pkgs_lost++;
+      fec->rx_delivered++;
+      continue;
+    }
+
+    deliver_in_order( fec );
+  }
+}
+
+/**
+ * @brief multiply a region by a constant and add it to another one in GF(256)
+ *
+ * @param[out] dst - a region to add to
+ * @param[in]  src - a region to multiply
+ * @param[in]  c   - a constant
+ * @param[in]  num - a size of regions, in bytes
+ */
+//======================================================================================================
+void n_rf24l01_fec_mul_add( u_char* dst, const u_char* src, u_char c, u_int num )
+{
+  const u_char* exp;
+  u_int i;
+
+  if( !c )
+    return;
+
+  if( c == 1 )
+  {
+    for( i = 0; i < num; i++ )
+      dst[i] ^= src[i];
+    return;
+  }
+
+  // c * x = exp[log(c) + log(x)], so take log(c) out of the loop
+  exp = gf_exp + gf_log[c];
+
+  for( i = 0; i < num; i++ )
+    if( src[i] )
+      dst[i] ^= exp[gf_log[src[i]]];
+}
+
+/**
+ * @brief initialize an FEC
+ *
+ * @param[out] fec     - an FEC to initialize
+ * @param[in]  k       - data packages per group
+ * @param[in]  m       - parity packages per group
+ * @param[in]  send    - a callback to transmit a package
+ * @param[in]  deliver - a callback to deliver received data
+ * @param[in]  ctx     - a context passed to callbacks
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_fec_init( n_rf24l01_fec_t* fec, u_int k, u_int m, n_rf24l01_fec_send_ptr send,
+                        n_rf24l01_fec_deliver_ptr deliver, void* ctx )
+{
+  if( !fec || !send || !deliver )
+    return -1;
+
+  if( !k || k > N_RF24L01_FEC_MAX_DATA || !m || m > N_RF24L01_FEC_MAX_PARITY )
+    return -1;
+
+  gf_init();
+
+  memset( fec, 0, sizeof(*fec) );
+
+  fec->k = k;
+  fec->m = m;
+  fec->send = send;
+  fec->deliver = deliver;
+  fec->ctx = ctx;
+
+  return 0;
+}
+
+/**
+ * @brief transmit data
+ *
+ * @param[in] data    - data to transmit
+ * @param[in] num     - an amount of @data, in bytes
+ * @param[in] now_mks - a current time
+ */
+//======================================================================================================
+void n_rf24l01_fec_send( n_rf24l01_fec_t* fec, const void* data, u_int num, uint64_t now_mks )
+{
+  u_char pkg[N_RF24L01_PKG_SIZE];
+  const u_char* ptr = data;
+  u_char* coded;
+  u_int len;
+
+  while( num )
+  {
+    len = num < N_RF24L01_FEC_PAYLOAD_SIZE ? num : N_RF24L01_FEC_PAYLOAD_SIZE;
+
+    coded = fec->tx_data[fec->tx_count];
+    memset( coded, 0, N_RF24L01_FEC_CODED_SIZE );
+    coded[0] = len;
+    memcpy( coded + 1, ptr, len );
+
+    pkg[0] = N_RF24L01_FEC_TAG;
+    pkg[1] = fec->tx_group;
+    pkg[2] = fec->tx_count;
+    pkg[3] = 0;
+    memcpy( pkg + N_RF24L01_FEC_HEADER_SIZE, coded, N_RF24L01_FEC_CODED_SIZE );
+
+    fec->stats.data_pkgs_sent++;
+    fec->send( fec->ctx, pkg );
+
+    if( ++fec->tx_count == fec->k )
+      send_parity( fec );
+
+    ptr += len;
+    num -= len;
+  }
+
+  fec->tx_flush_mks = now_mks + N_RF24L01_FEC_FLUSH_MKS;
+}
+
+/**
+ * @brief handle a received package
+ *
+ * @param[in] pkg - a package
+ * @return -1, if it isn't an FEC package
+ */
+//======================================================================================================
+int n_rf24l01_fec_on_pkg( n_rf24l01_fec_t* fec, const u_char* pkg )
+{
+  u_char group = pkg[1];
+  u_char index = pkg[2];
+  u_char count = pkg[3];
+
+  if( pkg[0] != N_RF24L01_FEC_TAG )
+    return -1;
+
+  if( index & N_RF24L01_FEC_PARITY )
+  {
+    if( ( index & ~N_RF24L01_FEC_PARITY ) >= N_RF24L01_FEC_MAX_PARITY || !count || count > N_RF24L01_FEC_MAX_DATA )
+      return -1;
+  }
+  else if( index >= N_RF24L01_FEC_MAX_DATA )
+    return -1;
+
+  // packages don't get reordered on air, so another group means the current one is over
+  if( !fec->rx_active || group != fec->rx_group )
+  {
+    if( fec->rx_active )
+      finish_group( fec );
+
+    fec->rx_data_map = 0;
+    fec->rx_parity_map = 0;
+    fec->rx_count = 0;
+    fec->rx_delivered = 0;
+    fec->rx_group = group;
+    fec->rx_active = 1;
+  }
+
+  if( index & N_RF24L01_FEC_PARITY )
+  {
+    index &= ~N_RF24L01_FEC_PARITY;
+
+    memcpy( fec->rx_parity[index], pkg + N_RF24L01_FEC_HEADER_SIZE, N_RF24L01_FEC_CODED_SIZE );
+    fec->rx_parity_map |= 1u << index;
+    fec->rx_count = count;
+    fec->stats.parity_pkgs_received++;
+  }
+  else
+  {
+    memcpy( fec->rx_data[index], pkg + N_RF24L01_FEC_HEADER_SIZE, N_RF24L01_FEC_CODED_SIZE );
+    fec->rx_data_map |= 1u << index;
+    fec->stats.data_pkgs_received++;
+  }
+
+  deliver_in_order( fec );
+
+  if( fec->rx_count && fec->rx_delivered < fec->rx_count )
+  {
+    recover( fec );
+    deliver_in_order( fec );
+  }
+
+  return 0;
+}
+
+/**
+ * @brief send parity packages of a group which has been idle for too long
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_fec_poll( n_rf24l01_fec_t* fec, uint64_t now_mks )
+{
+  if( !fec->tx_count )
+    return 0xffffffff;
+
+  if( now_mks >= fec->tx_flush_mks )
+  {
+    send_parity( fec );
+    return 0xffffffff;
+  }
+
+  return fec->tx_flush_mks - now_mks;
+}
@@ -0,0 +1,146 @@
+#ifndef N_RF24L01_FEC_H
+#define N_RF24L01_FEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A forward error correction on top of the library's core, for streams without acknowledges.
+ *
+ * Data is split into groups of up to k data packages, each group is followed by m parity
+ * packages of a systematic Reed-Solomon (Cauchy) erasure code over GF(256), so a receiver
+ * recovers a group if any k of its k + m packages got through.
+ *
+ * Data packages are delivered as soon as they arrive in order, so there's no extra latency
+ * without losses; a receiver waits for parity packages only if there's a gap. A group which
+ * isn't full yet gets parity packages after it's been idle for N_RF24L01_FEC_FLUSH_MKS.
+ *
+ * The FEC has no own clock, a time (in microseconds, any monotonic origin) is passed
+ * by a caller, and doesn't talk to the core directly, packages go out through a callback. */
+
+#include "../n_rf24l01_core.h"
+
+#define N_RF24L01_FEC_MAX_DATA   32
+#define N_RF24L01_FEC_MAX_PARITY 16
+
+/* an amount of user data a package carries */
+#define N_RF24L01_FEC_PAYLOAD_SIZE ( N_RF24L01_PKG_SIZE - 5 )
+
+/* how long a group which isn't full may wait for more data before its parity is sent */
+#define N_RF24L01_FEC_FLUSH_MKS 2000
+
+/* a part of a package covered by the code: a length of user data and the data itself */
+#define N_RF24L01_FEC_CODED_SIZE ( N_RF24L01_FEC_PAYLOAD_SIZE + 1 )
+
+/**
+ * @brief transmit a package (N_RF24L01_PKG_SIZE bytes)
+ */
+typedef void (*n_rf24l01_fec_send_ptr)( void* ctx, const u_char* pkg );
+
+/**
+ * @brief deliver data to a user
+ */
+typedef void (*n_rf24l01_fec_deliver_ptr)( void* ctx, const u_char* data, u_int num );
+
+typedef struct n_rf24l01_fec_stats_t
+{
+  u_int data_pkgs_sent;
+  u_int parity_pkgs_sent;
+  u_int data_pkgs_received;
+  u_int parity_pkgs_received;
+  u_int pkgs_recovered;
+  u_int pkgs_lost;
+} n_rf24l01_fec_stats_t;
+
+typedef struct n_rf24l01_fec_t
+{
+  u_int k;
+  u_int m;
+
+  n_rf24l01_fec_send_ptr send;
+  n_rf24l01_fec_deliver_ptr deliver;
+  void* ctx;
+
+  /* encoder */
+  u_char tx_data[N_RF24L01_FEC_MAX_DATA][N_RF24L01_FEC_CODED_SIZE];
+  u_int tx_count;
+  u_char tx_group;
+  uint64_t tx_flush_mks;
+
+  /* decoder, only one group at time, as packages don't get reordered on air */
+  u_char rx_data[N_RF24L01_FEC_MAX_DATA][N_RF24L01_FEC_CODED_SIZE];
+  u_char rx_parity[N_RF24L01_FEC_MAX_PARITY][N_RF24L01_FEC_CODED_SIZE];
+  uint32_t rx_data_map;
+  uint32_t rx_parity_map;
+  u_int rx_count;       /* an amount of data packages in the group, 0 - unknown yet */
+  u_int rx_delivered;   /* data packages [0..rx_delivered) have been delivered */
+  u_char rx_group;
+  u_char rx_active;
+
+  n_rf24l01_fec_stats_t stats;
+} n_rf24l01_fec_t;
+
+/**
+ * @brief initialize an FEC
+ *
+ * @param[out] fec     - an FEC to initialize
+ * @param[in]  k       - data packages per group, [1..N_RF24L01_FEC_MAX_DATA]
+ * @param[in]  m       - parity packages per group, [1..N_RF24L01_FEC_MAX_PARITY]
+ * @param[in]  send    - a callback to transmit a package
+ * @param[in]  deliver - a callback to deliver received data
+ * @param[in]  ctx     - a context passed to callbacks
+ * @return -1, if failed
+ *
+ * Note: a receiver gets parameters of a group from packages, so @k and @m matter
+ *       only for a transmitter
+ */
+//======================================================================================================
+int n_rf24l01_fec_init( n_rf24l01_fec_t* fec, u_int k, u_int m, n_rf24l01_fec_send_ptr send,
+                        n_rf24l01_fec_deliver_ptr deliver, void* ctx );
+
+/**
+ * @brief transmit data
+ *
+ * @param[in] data    - data to transmit
+ * @param[in] num     - an amount of @data, in bytes
+ * @param[in] now_mks - a current time
+ */
+//======================================================================================================
+void n_rf24l01_fec_send( n_rf24l01_fec_t* fec, const void* data, u_int num, uint64_t now_mks );
+
+/**
+ * @brief handle a received package
+ *
+ * @param[in] pkg - a package (N_RF24L01_PKG_SIZE bytes)
+ * @return -1, if it isn't an FEC package
+ */
+//======================================================================================================
+int n_rf24l01_fec_on_pkg( n_rf24l01_fec_t* fec, const u_char* pkg );
+
+/**
+ * @brief send parity packages of a group which has been idle for too long
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_fec_poll( n_rf24l01_fec_t* fec, uint64_t now_mks );
+
+/**
+ * @brief multiply a region by a constant and add it to another one in GF(256): @dst += @c * @src
+ *
+ * @param[out] dst - a region to add to
+ * @param[in]  src - a region to multiply
+ * @param[in]  c   - a constant
+ * @param[in]  num - a size of regions, in bytes
+ *
+ * Note: it's an FEC's kernel, exported to let it be measured
+ */
+//======================================================================================================
+void n_rf24l01_fec_mul_add( u_char* dst, const u_char* src, u_char c, u_int num );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_FEC_H
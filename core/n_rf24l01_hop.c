@@ -0,0 +1,346 @@
+/**
+ * @file frequency hopping scheduler implementation
+ */
+
+#include <string.h>
+
+#include "n_rf24l01_hop.h"
+
+
+// get a pseudo-random number (xorshift32), both sides have to get the same numbers
+//======================================================================================================
+static uint32_t get_rand( uint32_t* state )
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  return *state = x;
+}
+
+// get a position within the current cycle of the sequence
+//======================================================================================================
+static uint64_t get_position( const n_rf24l01_hop_t* hop, uint64_t now_mks )
+{
+  int64_t cycle = (int64_t)hop->dwell_mks * hop->length;
+  int64_t elapsed = (int64_t)(now_mks - hop->epoch_mks);
+
+  return ( elapsed % cycle + cycle ) % cycle;
+}
+
+// get time elapsed since @since_mks, it's negative if @since_mks is later than @now_mks
+// (a package may be stamped after a caller has taken a current time)
+//======================================================================================================
+static int64_t elapsed_since( uint64_t since_mks, uint64_t now_mks )
+{
+  return (int64_t)(now_mks - since_mks);
+}
+
+// get time left till @deadline_mks, 0 if a caller is late for it
+//======================================================================================================
+static uint32_t time_till( uint64_t deadline_mks, uint64_t now_mks )
+{
+  int64_t left = (int64_t)(deadline_mks - now_mks);
+
+  if( left <= 0 )
+    return 0;
+
+  return left < 0xffffffff ? left : 0xfffffffe;
+}
+
+// tune the transceiver to a channel at @index in a sequence
+//======================================================================================================
+static void hop_to( n_rf24l01_hop_t* hop, u_int index )
+{
+  hop->index = index;
+  hop->hops++;
+
+  n_rf24l01_set_channel( hop->sequence[index] );
+}
+
+// park on the current channel till the master comes there
+//======================================================================================================
+static void park( n_rf24l01_hop_t* hop, uint64_t now_mks )
+{
+  hop->synced = 0;
+  hop->resyncs++;
+  hop->park_mks = now_mks;
+}
+
+// a per-package mode: a slave which misses the master's packages assumes they are lost and hops
+// on its own, a slave which has missed too many of them or has heard nothing for
+// N_RF24L01_HOP_PARK_MKS parks on the current channel till the master comes there, and moves
+// to a next channel if the master isn't heard there for as long again (the channel may be jammed)
+//======================================================================================================
+static uint32_t tick_per_pkg( n_rf24l01_hop_t* hop, uint64_t now_mks )
+{
+  uint64_t overdue_mks;
+
+  if( hop->role == N_RF24L01_HOP_MASTER )
+    return 0xffffffff;
+
+  // the master keeps streaming, but a package hasn't come, so the master has hopped without us
+  if( hop->synced && hop->rx_gap_mks )
+  {
+    overdue_mks = hop->last_rx_mks + (uint64_t)( hop->coasts + 1 ) * hop->rx_gap_mks + hop->rx_gap_mks / 2;
+
+    if( now_mks >= overdue_mks )
+    {
+      if( hop->coasts < N_RF24L01_HOP_MAX_COASTS )
+      {
+        hop->coasts++;
+        hop_to( hop, ( hop->index + 1 ) % hop->length );
+        overdue_mks += hop->rx_gap_mks;
+      }
+      else
+        park( hop, now_mks );
+    }
+
+    // a late caller coasts a channel per call, it's called again at once till it catches up
+    if( hop->synced && overdue_mks < hop->last_rx_mks + N_RF24L01_HOP_PARK_MKS )
+      return time_till( overdue_mks, now_mks );
+  }
+
+  if( hop->synced && elapsed_since( hop->last_rx_mks, now_mks ) >= N_RF24L01_HOP_PARK_MKS )
+    park( hop, now_mks );
+
+  if( hop->synced )
+    return time_till( hop->last_rx_mks + N_RF24L01_HOP_PARK_MKS, now_mks );
+
+  if( elapsed_since( hop->park_mks, now_mks ) >= N_RF24L01_HOP_PARK_MKS )
+  {
+    hop_to( hop, ( hop->index + 1 ) % hop->length );
+    hop->park_mks = now_mks;
+  }
+
+  return time_till( hop->park_mks + N_RF24L01_HOP_PARK_MKS, now_mks );
+}
+
+/**
+ * @brief build a hop sequence
+ *
+ * @param[out] hop       - a scheduler to initialize
+ * @param[in]  seed      - a seed both sides have to agree on
+ * @param[in]  channels  - channels to hop over, NULL - all of them
+ * @param[in]  num       - an amount of @channels
+ * @param[in]  dwell_mks - a slot duration, 0 - hop on each package
+ * @param[in]  role      - either the master or the slave
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_hop_init( n_rf24l01_hop_t* hop, uint32_t seed, const u_char* channels, u_int num,
+                        uint32_t dwell_mks, n_rf24l01_hop_role_t role )
+{
+  uint32_t rand_state;
+  u_int i, j;
+  u_char tmp;
+
+  if( !hop )
+    return -1;
+
+  if( dwell_mks && dwell_mks <= 2 * N_RF24L01_HOP_GUARD_MKS )
+    return -1;
+
+  // a scheduler in use has to stay intact if arguments are wrong
+  if( channels )
+  {
+    if( !num || num > N_RF24L01_CHANNELS_AMOUNT )
+      return -1;
+
+    for( i = 0; i < num; i++ )
+      if( channels[i] >= N_RF24L01_CHANNELS_AMOUNT )
+        return -1;
+  }
+
+  memset( hop, 0, sizeof(*hop) );
+
+  if( channels )
+  {
+    memcpy( hop->sequence, channels, num );
+    hop->length = num;
+  }
+  else
+  {
+    for( i = 0; i < N_RF24L01_CHANNELS_AMOUNT; i++ )
+      hop->sequence[i] = i;
+
+    hop->length = N_RF24L01_CHANNELS_AMOUNT;
+  }
+
+  // Fisher-Yates shuffle, xorshift mustn't be seeded by 0
+  rand_state = seed ? seed : 0x9e3779b9;
+
+  for( i = hop->length - 1; i > 0; i-- )
+  {
+    j = get_rand( &rand_state ) % ( i + 1 );
+
+    tmp = hop->sequence[i];
+    hop->sequence[i] = hop->sequence[j];
+    hop->sequence[j] = tmp;
+  }
+
+  hop->dwell_mks = dwell_mks;
+  hop->role = role;
+
+  return 0;
+}
+
+/**
+ * @brief start hopping, tune the transceiver to the first channel
+ *
+ * @param[in] now_mks - a current time
+ */
+//======================================================================================================
+void n_rf24l01_hop_start( n_rf24l01_hop_t* hop, uint64_t now_mks )
+{
+  hop->epoch_mks = now_mks;
+  hop->park_mks = now_mks;
+  hop->last_rx_mks = now_mks;
+  hop->synced = hop->role == N_RF24L01_HOP_MASTER;
+
+  hop_to( hop, 0 );
+}
+
+/**
+ * @brief retune the transceiver if the slot has changed
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_hop_tick( n_rf24l01_hop_t* hop, uint64_t now_mks )
+{
+  uint64_t position, cycle;
+  uint32_t timeout;
+  u_int index;
+
+  if( !hop->dwell_mks )
+    return tick_per_pkg( hop, now_mks );
+
+  cycle = (uint64_t)hop->dwell_mks * hop->length;
+
+  // the slave has heard nothing for a whole cycle, so the master might have gone away,
+  // stay on the current channel till the master visits it
+  if( hop->synced && hop->role == N_RF24L01_HOP_SLAVE && elapsed_since( hop->last_rx_mks, now_mks ) > (int64_t)cycle )
+    park( hop, now_mks );
+
+  // the master visits the channel the slave parks on for a whole slot once per cycle,
+  // if it hasn't been heard the channel may be jammed, so try the next one
+  if( !hop->synced )
+  {
+    if( elapsed_since( hop->park_mks, now_mks ) >= (int64_t)( cycle + hop->dwell_mks ) )
+    {
+      hop_to( hop, ( hop->index + 1 ) % hop->length );
+      hop->park_mks = now_mks;
+    }
+
+    return time_till( hop->park_mks + cycle + hop->dwell_mks, now_mks );
+  }
+
+  position = get_position( hop, now_mks );
+
+  index = position / hop->dwell_mks;
+  if( index != hop->index )
+    hop_to( hop, index );
+
+  timeout = hop->dwell_mks - position % hop->dwell_mks;
+
+  if( hop->role == N_RF24L01_HOP_SLAVE && time_till( hop->last_rx_mks + cycle + 1, now_mks ) < timeout )
+    timeout = time_till( hop->last_rx_mks + cycle + 1, now_mks );
+
+  return timeout;
+}
+
+/**
+ * @brief get time to wait before a package may be transmitted
+ *
+ * @param[in] now_mks - a current time
+ * @return 0, if a package may be transmitted right now
+ */
+//======================================================================================================
+uint32_t n_rf24l01_hop_tx_delay( const n_rf24l01_hop_t* hop, uint64_t now_mks )
+{
+  uint32_t phase;
+
+  if( !hop->dwell_mks || !hop->synced )
+    return 0;
+
+  phase = get_position( hop, now_mks ) % hop->dwell_mks;
+
+  if( phase < N_RF24L01_HOP_GUARD_MKS )
+    return N_RF24L01_HOP_GUARD_MKS - phase;
+
+  if( phase > hop->dwell_mks - N_RF24L01_HOP_GUARD_MKS )
+    return hop->dwell_mks - phase + N_RF24L01_HOP_GUARD_MKS;
+
+  return 0;
+}
+
+/**
+ * @brief notify the scheduler a package has been transmitted
+ */
+//======================================================================================================
+void n_rf24l01_hop_on_tx( n_rf24l01_hop_t* hop )
+{
+  // a parked slave waits for the master where it is
+  if( !hop->dwell_mks && hop->synced )
+    hop_to( hop, ( hop->index + 1 ) % hop->length );
+}
+
+/**
+ * @brief notify the scheduler a package has been received
+ *
+ * @param[in] now_mks - time the package was received at
+ */
+//======================================================================================================
+void n_rf24l01_hop_on_rx( n_rf24l01_hop_t* hop, uint64_t now_mks )
+{
+  int64_t cycle, expected, error;
+
+  // the master has sent the package on the current channel, its next one goes on the next channel;
+  // an interval is learnt from packages which come one after another only
+  if( !hop->dwell_mks )
+  {
+    if( hop->role == N_RF24L01_HOP_SLAVE && hop->synced && !hop->coasts )
+      hop->rx_gap_mks = hop->rx_gap_mks ? ( hop->rx_gap_mks * 7 + ( now_mks - hop->last_rx_mks ) ) / 8 :
+                                          now_mks - hop->last_rx_mks;
+
+    hop->last_rx_mks = now_mks;
+    hop->coasts = 0;
+    hop->synced = 1;
+    hop_to( hop, ( hop->index + 1 ) % hop->length );
+    return;
+  }
+
+  if( hop->role == N_RF24L01_HOP_SLAVE )
+    hop->last_rx_mks = now_mks;
+
+  if( hop->role == N_RF24L01_HOP_MASTER )
+    return;
+
+  // the master transmits within a slot only, so a package has been heard on the channel
+  // of the current slot, assume it was in a middle of the slot
+  if( !hop->synced )
+  {
+    hop->epoch_mks = now_mks - (uint64_t)hop->index * hop->dwell_mks - hop->dwell_mks / 2;
+    hop->synced = 1;
+    return;
+  }
+
+  // track the master's phase: packages are expected to be spread over a slot evenly,
+  // so move the epoch a bit to have them in a middle of the slot in average; packages of
+  // one slot are up to a half of the slot off the middle, so a step is small enough to not
+  // follow them, a larger one drags the epoch to a late end of a slot by its last packages
+  cycle = (int64_t)hop->dwell_mks * hop->length;
+  expected = (int64_t)hop->index * hop->dwell_mks + hop->dwell_mks / 2;
+  error = (int64_t)get_position( hop, now_mks ) - expected;
+
+  if( error > cycle / 2 )
+    error -= cycle;
+  else if( error < -cycle / 2 )
+    error += cycle;
+
+  hop->epoch_mks += error / 32;
+}
@@ -0,0 +1,153 @@
+#ifndef N_RF24L01_HOP_H
+#define N_RF24L01_HOP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A frequency hopping scheduler on top of the library's core.
+ *
+ * Both sides build the same pseudo-random permutation of channels from a shared seed
+ * and retune the transceiver (one RF_CH write) either on a slot timer or after each
+ * package. One side is a master, it just follows its own clock; another one is a slave,
+ * it synchronizes to the master by received packages:
+ *  - an unsynchronized slave parks on one channel of the sequence and waits, as the master
+ *    visits every channel once per cycle, the first package heard tells the slave
+ *    where the master is in the sequence; if nothing is heard for a cycle (e.g. the channel
+ *    is jammed) the slave parks on the next channel;
+ *  - a synchronized slave tracks the master's slot phase by arrival times of packages and
+ *    falls back to park-and-wait if nothing is heard for a whole cycle,
+ *    so the master is expected to transmit at least once per cycle.
+ *
+ * In a per-package mode both sides hop after each package sent or received, so a lost package
+ * puts them on different channels; a slave learns an interval between the master's packages
+ * and, if a package is overdue by a half of it, assumes it's lost and hops on its own, up to
+ * N_RF24L01_HOP_MAX_COASTS times in a row (so a jammed channel costs only its packages while
+ * the master streams); a slave which misses one more package or has heard nothing for
+ * N_RF24L01_HOP_PARK_MKS parks on its channel (it doesn't hop after own packages then)
+ * till the master transmits there, and moves
+ * to a next channel after as long again, so the master has to go over the whole sequence within
+ * N_RF24L01_HOP_PARK_MKS while a slave resyncs.
+ *
+ * The scheduler has no own clock, a time (in microseconds, any monotonic origin) is passed
+ * by a caller. */
+
+#include "../n_rf24l01_core.h"
+
+/* a time at the edges of a slot nothing should be transmitted within, to let
+ * both sides retune (130us settling) and to tolerate a phase error of the slave */
+#define N_RF24L01_HOP_GUARD_MKS 500
+
+/* a per-package mode: time a slave waits for a package before it parks, and then
+ * before it moves to a next channel */
+#define N_RF24L01_HOP_PARK_MKS 100000
+
+/* a per-package mode: how many overdue packages in a row a slave assumes to be lost */
+#define N_RF24L01_HOP_MAX_COASTS 6
+
+typedef enum
+{
+  N_RF24L01_HOP_MASTER,
+  N_RF24L01_HOP_SLAVE,
+} n_rf24l01_hop_role_t;
+
+typedef struct n_rf24l01_hop_t
+{
+  u_char sequence[N_RF24L01_CHANNELS_AMOUNT];
+  u_int length;
+
+  n_rf24l01_hop_role_t role;
+
+  /* 0 - hop after each package, otherwise a duration of a slot */
+  uint32_t dwell_mks;
+
+  /* a start time of the current cycle of the sequence */
+  uint64_t epoch_mks;
+
+  /* an index in @sequence the transceiver is tuned to */
+  u_int index;
+
+  u_char synced;
+
+  /* a time the last package was received at (slave only) */
+  uint64_t last_rx_mks;
+
+  /* a time the slave has parked on the current channel at */
+  uint64_t park_mks;
+
+  /* a per-package mode: an average interval between the master's packages (0 - unknown yet)
+   * and packages assumed to be lost since the last received one (slave only) */
+  uint32_t rx_gap_mks;
+  u_int coasts;
+
+  /* statistics */
+  u_int hops;
+  u_int resyncs;
+} n_rf24l01_hop_t;
+
+/**
+ * @brief build a hop sequence
+ *
+ * @param[out] hop       - a scheduler to initialize
+ * @param[in]  seed      - a seed both sides have to agree on
+ * @param[in]  channels  - channels to hop over (e.g. free ones by n_rf24l01_scan_channels),
+ *                         NULL - all of them
+ * @param[in]  num       - an amount of @channels
+ * @param[in]  dwell_mks - a slot duration (> 2 * N_RF24L01_HOP_GUARD_MKS), 0 - hop on each package
+ * @param[in]  role      - either the master or the slave
+ * @return -1, if failed
+ *
+ * Note: a sequence depends only on @seed and @channels
+ */
+//======================================================================================================
+int n_rf24l01_hop_init( n_rf24l01_hop_t* hop, uint32_t seed, const u_char* channels, u_int num,
+                        uint32_t dwell_mks, n_rf24l01_hop_role_t role );
+
+/**
+ * @brief start hopping, tune the transceiver to the first channel
+ *
+ * @param[in] now_mks - a current time
+ */
+//======================================================================================================
+void n_rf24l01_hop_start( n_rf24l01_hop_t* hop, uint64_t now_mks );
+
+/**
+ * @brief retune the transceiver if the slot has changed, or resync the slave
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_hop_tick( n_rf24l01_hop_t* hop, uint64_t now_mks );
+
+/**
+ * @brief get time to wait before a package may be transmitted (a slot timer mode only)
+ *
+ * @param[in] now_mks - a current time
+ * @return 0, if a package may be transmitted right now
+ *
+ * Note: call n_rf24l01_hop_tick after the wait
+ */
+//======================================================================================================
+uint32_t n_rf24l01_hop_tx_delay( const n_rf24l01_hop_t* hop, uint64_t now_mks );
+
+/**
+ * @brief notify the scheduler a package has been transmitted (hops in a per-package mode)
+ */
+//======================================================================================================
+void n_rf24l01_hop_on_tx( n_rf24l01_hop_t* hop );
+
+/**
+ * @brief notify the scheduler a package has been received (synchronizes the slave,
+ *        hops in a per-package mode)
+ *
+ * @param[in] now_mks - time the package was received at
+ */
+//======================================================================================================
+void n_rf24l01_hop_on_rx( n_rf24l01_hop_t* hop, uint64_t now_mks );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_HOP_H
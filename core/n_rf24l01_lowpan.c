@@ -0,0 +1,544 @@
+/**
+ * @file IP datagrams adaptation layer implementation
+ */
+
+// a package format:
+//  a whole datagram: <N_RF24L01_LOWPAN_SINGLE> <size> <compressed datagram: up to N_RF24L01_PKG_SIZE - 2 bytes>
+//  a fragment:       <N_RF24L01_LOWPAN_FRAG> <tag> <index> <size: 2 bytes, LSByte first> <FRAG_PAYLOAD_SIZE bytes>
+//
+// a compressed datagram starts with a dispatch byte:
+//  011xxxxx - IPHC encoded IPv6 headers (RFC 6282), inline fields follow in the RFC's order
+//  01000001 - an uncompressed datagram follows
+
+#include <string.h>
+
+#include "n_rf24l01_lowpan.h"
+
+#define N_RF24L01_LOWPAN_SINGLE 0xe0
+#define N_RF24L01_LOWPAN_FRAG   0xe8
+
+#define SINGLE_HEADER_SIZE 2
+#define FRAG_HEADER_SIZE 5
+#define FRAG_PAYLOAD_SIZE ( N_RF24L01_PKG_SIZE - FRAG_HEADER_SIZE )
+
+#define DISPATCH_IPV6 0x41
+#define DISPATCH_IPHC 0x60
+#define DISPATCH_IPHC_MASK 0xe0
+
+#define NHC_UDP 0xf0
+#define NHC_UDP_MASK 0xf8
+
+#define IPV6_HEADER_SIZE 40
+#define UDP_HEADER_SIZE 8
+#define IPPROTO_UDP_ 17
+
+// IPHC fields
+#define IPHC_TF_ELIDED   0x18
+#define IPHC_NH_COMPRESSED 0x04
+#define IPHC_HLIM_MASK   0x03
+#define IPHC_M           0x08
+#define IPHC_AM_FULL     0x00
+#define IPHC_AM_64       0x01
+#define IPHC_AM_16       0x02
+#define IPHC_AM_8        0x03
+
+static const u_char link_local_prefix[8] = { 0xfe, 0x80, 0, 0, 0, 0, 0, 0 };
+static const u_char short_iid_prefix[6] = { 0, 0, 0, 0xff, 0xfe, 0 };
+static const u_char zeroes[16];
+
+
+// compress a unicast address, return an address mode
+//======================================================================================================
+static u_char compress_unicast( const u_char* addr, u_char** out )
+{
+  if( memcmp( addr, link_local_prefix, 8 ) )
+  {
+    memcpy( *out, addr, 16 ); *out += 16;
+    return IPHC_AM_FULL;
+  }
+
+  if( !memcmp( addr + 8, short_iid_prefix, 6 ) )
+  {
+    memcpy( *out, addr + 14, 2 ); *out += 2;
+    return IPHC_AM_16;
+  }
+
+  memcpy( *out, addr + 8, 8 ); *out += 8;
+  return IPHC_AM_64;
+}
+
+// compress a multicast address, return an address mode
+//======================================================================================================
+static u_char compress_multicast( const u_char* addr, u_char** out )
+{
+  // ff02::00XX
+  if( addr[1] == 0x02 && !memcmp( addr + 2, zeroes, 13 ) )
+  {
+    *(*out)++ = addr[15];
+    return IPHC_AM_8;
+  }
+
+  // ffXX::00XX:XXXX
+  if( !memcmp( addr + 2, zeroes, 11 ) )
+  {
+    *(*out)++ = addr[1];
+    memcpy( *out, addr + 13, 3 ); *out += 3;
+    return IPHC_AM_16;
+  }
+
+  memcpy( *out, addr, 16 ); *out += 16;
+  return IPHC_AM_FULL;
+}
+
+// decompress an address, return -1 if broken
+//======================================================================================================
+static int decompress_address( u_char mode, u_char multicast, const u_char** in, const u_char* end, u_char* addr )
+{
+  static const u_char sizes[2][4] = { { 16, 8, 2, 0 }, { 16, 0, 4, 1 } };
+  u_char size = sizes[multicast][mode];
+
+  if( !size || *in + size > end )
+    return -1;
+
+  memset( addr, 0, 16 );
+
+  if( mode == IPHC_AM_FULL )
+    memcpy( addr, *in, 16 );
+  else if( !multicast )
+  {
+    memcpy( addr, link_local_prefix, 8 );
+    if( mode == IPHC_AM_16 )
+      memcpy( addr + 8, short_iid_prefix, 6 );
+    memcpy( addr + 16 - size, *in, size );
+  }
+  else
+  {
+    addr[0] = 0xff;
+    if( mode == IPHC_AM_8 )
+    {
+      addr[1] = 0x02;
+      addr[15] = (*in)[0];
+    }
+    else
+    {
+      addr[1] = (*in)[0];
+      memcpy( addr + 13, *in + 1, 3 );
+    }
+  }
+
+  *in += size;
+
+  return 0;
+}
+
+/**
+ * @brief compress headers of a datagram
+ *
+ * @param[in]  datagram - an IP datagram
+ * @param[in]  num      - a size of the datagram
+ * @param[out] dst      - a buffer for a compressed datagram
+ * @param[in]  dst_size - a size of @dst
+ * @return a size of the compressed datagram, -1 if @dst is too small
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_compress( const u_char* datagram, u_int num, u_char* dst, u_int dst_size )
+{
+  u_char buf[2 + 4 + 1 + 1 + 16 + 16 + 1 + 4 + 2];
+  u_char* out = buf + 2;
+  const u_char* payload;
+  u_int tc, flow, plen, src_port, dst_port;
+  u_char udp;
+
+  plen = num >= IPV6_HEADER_SIZE ? datagram[4] << 8 | datagram[5] : 0;
+  udp = num >= IPV6_HEADER_SIZE + UDP_HEADER_SIZE && datagram[6] == IPPROTO_UDP_ &&
+        ( datagram[IPV6_HEADER_SIZE + 4] << 8 | datagram[IPV6_HEADER_SIZE + 5] ) == plen;
+
+  // lengths get elided, so they have to be consistent to be restored
+  if( num < IPV6_HEADER_SIZE || datagram[0] >> 4 != 6 || plen != num - IPV6_HEADER_SIZE )
+  {
+    if( num + 1 > dst_size )
+      return -1;
+
+    dst[0] = DISPATCH_IPV6;
+    memcpy( dst + 1, datagram, num );
+
+    return num + 1;
+  }
+
+  tc = ( datagram[0] & 0x0f ) << 4 | datagram[1] >> 4;
+  flow = ( datagram[1] & 0x0f ) << 16 | datagram[2] << 8 | datagram[3];
+
+  buf[0] = DISPATCH_IPHC;
+  buf[1] = 0;
+
+  if( !tc && !flow )
+    buf[0] |= IPHC_TF_ELIDED;
+  else
+  {
+    // ECN, DSCP, then a flow label
+    *out++ = ( tc & 0x03 ) << 6 | tc >> 2;
+    *out++ = flow >> 16;
+    *out++ = flow >> 8;
+    *out++ = flow;
+  }
+
+  if( udp )
+    buf[0] |= IPHC_NH_COMPRESSED;
+  else
+    *out++ = datagram[6];
+
+  switch( datagram[7] )
+  {
+    case 1:   buf[0] |= 0x01; break;
+    case 64:  buf[0] |= 0x02; break;
+    case 255: buf[0] |= 0x03; break;
+    default:  *out++ = datagram[7];
+  }
+
+  buf[1] |= compress_unicast( datagram + 8, &out ) << 4;
+
+  if( datagram[24] == 0xff )
+    buf[1] |= IPHC_M | compress_multicast( datagram + 24, &out );
+  else
+    buf[1] |= compress_unicast( datagram + 24, &out );
+
+  payload = datagram + IPV6_HEADER_SIZE;
+
+  if( udp )
+  {
+    src_port = payload[0] << 8 | payload[1];
+    dst_port = payload[2] << 8 | payload[3];
+
+    if( ( src_port & 0xfff0 ) == 0xf0b0 && ( dst_port & 0xfff0 ) == 0xf0b0 )
+    {
+      *out++ = NHC_UDP | 0x03;
+      *out++ = ( src_port & 0x0f ) << 4 | ( dst_port & 0x0f );
+    }
+    else if( ( dst_port & 0xff00 ) == 0xf000 )
+    {
+      *out++ = NHC_UDP | 0x01;
+      *out++ = src_port >> 8; *out++ = src_port;
+      *out++ = dst_port;
+    }
+    else if( ( src_port & 0xff00 ) == 0xf000 )
+    {
+      *out++ = NHC_UDP | 0x02;
+      *out++ = src_port;
+      *out++ = dst_port >> 8; *out++ = dst_port;
+    }
+    else
+    {
+      *out++ = NHC_UDP;
+      memcpy( out, payload, 4 ); out += 4;
+    }
+
+    // a checksum is always inline
+    *out++ = payload[6];
+    *out++ = payload[7];
+
+    payload += UDP_HEADER_SIZE;
+  }
+
+  if( ( out - buf ) + ( datagram + num - payload ) > dst_size )
+    return -1;
+
+  memcpy( dst, buf, out - buf );
+  memcpy( dst + ( out - buf ), payload, datagram + num - payload );
+
+  return ( out - buf ) + ( datagram + num - payload );
+}
+
+/**
+ * @brief decompress headers of a datagram
+ *
+ * @param[in]  src      - a compressed datagram
+ * @param[in]  num      - a size of the compressed datagram
+ * @param[out] datagram - a buffer for an IP datagram
+ * @param[in]  size     - a size of @datagram
+ * @return a size of the datagram, -1 if the compressed datagram is broken or @datagram is too small
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_decompress( const u_char* src, u_int num, u_char* datagram, u_int size )
+{
+  const u_char* in = src + 2;
+  const u_char* end = src + num;
+  u_char header[IPV6_HEADER_SIZE + UDP_HEADER_SIZE];
+  u_int header_size = IPV6_HEADER_SIZE;
+  u_int tc = 0, flow = 0, plen, total;
+  u_char nhc = 0;
+
+  if( !num )
+    return -1;
+
+  if( src[0] == DISPATCH_IPV6 )
+  {
+    if( num - 1 > size )
+      return -1;
+
+    memcpy( datagram, src + 1, num - 1 );
+    return num - 1;
+  }
+
+  // stateless compression only: neither a context identifier nor context-based addresses
+  if( num < 2 || ( src[0] & DISPATCH_IPHC_MASK ) != DISPATCH_IPHC || src[1] & 0xc4 )
+    return -1;
+
+  memset( header, 0, sizeof(header) );
+
+  if( !( ( src[0] & IPHC_TF_ELIDED ) == IPHC_TF_ELIDED ) )
+  {
+    // only either fully elided or fully inline fields are produced
+    if( src[0] & IPHC_TF_ELIDED || in + 4 > end )
+      return -1;
+
+    tc = ( in[0] & 0x3f ) << 2 | in[0] >> 6;
+    flow = ( in[1] & 0x0f ) << 16 | in[2] << 8 | in[3];
+    in += 4;
+  }
+
+  header[0] = 0x60 | tc >> 4;
+  header[1] = ( tc & 0x0f ) << 4 | flow >> 16;
+  header[2] = flow >> 8;
+  header[3] = flow;
+
+  if( src[0] & IPHC_NH_COMPRESSED )
+    header[6] = IPPROTO_UDP_;
+  else
+  {
+    if( in + 1 > end )
+      return -1;
+    header[6] = *in++;
+  }
+
+  switch( src[0] & IPHC_HLIM_MASK )
+  {
+    case 0x01: header[7] = 1; break;
+    case 0x02: header[7] = 64; break;
+    case 0x03: header[7] = 255; break;
+    default:
+      if( in + 1 > end )
+        return -1;
+      header[7] = *in++;
+  }
+
+  if( decompress_address( src[1] >> 4 & 0x03, 0, &in, end, header + 8 ) < 0 )
+    return -1;
+
+  if( decompress_address( src[1] & 0x03, !!( src[1] & IPHC_M ), &in, end, header + 24 ) < 0 )
+    return -1;
+
+  if( src[0] & IPHC_NH_COMPRESSED )
+  {
+    u_char* udp = header + IPV6_HEADER_SIZE;
+
+    if( in + 1 > end || ( in[0] & NHC_UDP_MASK ) != NHC_UDP || in[0] & 0x04 )
+      return -1;
+
+    nhc = *in++;
+
+    switch( nhc & 0x03 )
+    {
+      case 0x00:
+        if( in + 4 > end ) return -1;
+        memcpy( udp, in, 4 ); in += 4;
+        break;
+      case 0x01:
+        if( in + 3 > end ) return -1;
+        udp[0] = in[0]; udp[1] = in[1]; udp[2] = 0xf0; udp[3] = in[2]; in += 3;
+        break;
+      case 0x02:
+        if( in + 3 > end ) return -1;
+        udp[0] = 0xf0; udp[1] = in[0]; udp[2] = in[1]; udp[3] = in[2]; in += 3;
+        break;
+      case 0x03:
+        if( in + 1 > end ) return -1;
+        udp[0] = 0xf0; udp[1] = 0xb0 | in[0] >> 4; udp[2] = 0xf0; udp[3] = 0xb0 | ( in[0] & 0x0f ); in += 1;
+        break;
+    }
+
+    if( in + 2 > end )
+      return -1;
+
+    udp[6] = *in++;
+    udp[7] = *in++;
+
+    header_size += UDP_HEADER_SIZE;
+  }
+
+  total = header_size + ( end - in );
+  if( total > size )
+    return -1;
+
+  plen = total - IPV6_HEADER_SIZE;
+  header[4] = plen >> 8;
+  header[5] = plen;
+
+  if( nhc )
+  {
+    header[IPV6_HEADER_SIZE + 4] = plen >> 8;
+    header[IPV6_HEADER_SIZE + 5] = plen;
+  }
+
+  memcpy( datagram, header, header_size );
+  memcpy( datagram + header_size, in, end - in );
+
+  return total;
+}
+
+/**
+ * @brief initialize an adaptation layer
+ *
+ * @param[out] lowpan  - an adaptation layer to initialize
+ * @param[in]  send    - a callback to transmit a package
+ * @param[in]  deliver - a callback to deliver received datagrams
+ * @param[in]  ctx     - a context passed to callbacks
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_init( n_rf24l01_lowpan_t* lowpan, n_rf24l01_lowpan_send_ptr send,
+                           n_rf24l01_lowpan_deliver_ptr deliver, void* ctx )
+{
+  if( !lowpan || !send || !deliver )
+    return -1;
+
+  memset( lowpan, 0, sizeof(*lowpan) );
+
+  lowpan->send = send;
+  lowpan->deliver = deliver;
+  lowpan->ctx = ctx;
+
+  return 0;
+}
+
+/**
+ * @brief compress and transmit a datagram
+ *
+ * @param[in] datagram - an IP datagram
+ * @param[in] num      - a size of the datagram
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_send( n_rf24l01_lowpan_t* lowpan, const u_char* datagram, u_int num )
+{
+  u_char compressed[N_RF24L01_LOWPAN_MAX_COMPRESSED];
+  u_char pkg[N_RF24L01_PKG_SIZE];
+  u_int offset, len;
+  int size;
+
+  if( !num || num > N_RF24L01_LOWPAN_MAX_DATAGRAM )
+    return -1;
+
+  size = n_rf24l01_lowpan_compress( datagram, num, compressed, sizeof(compressed) );
+  if( size < 0 )
+    return -1;
+
+  lowpan->stats.datagrams_sent++;
+  lowpan->stats.bytes_in += num;
+  lowpan->stats.bytes_out += size;
+
+  if( size <= N_RF24L01_PKG_SIZE - SINGLE_HEADER_SIZE )
+  {
+    memset( pkg, 0, sizeof(pkg) );
+    pkg[0] = N_RF24L01_LOWPAN_SINGLE;
+    pkg[1] = size;
+    memcpy( pkg + SINGLE_HEADER_SIZE, compressed, size );
+
+    lowpan->stats.pkgs_sent++;
+    lowpan->send( lowpan->ctx, pkg );
+
+    return 0;
+  }
+
+  for( offset = 0; offset < (u_int)size; offset += FRAG_PAYLOAD_SIZE )
+  {
+    len = size - offset < FRAG_PAYLOAD_SIZE ? size - offset : FRAG_PAYLOAD_SIZE;
+
+    memset( pkg, 0, sizeof(pkg) );
+    pkg[0] = N_RF24L01_LOWPAN_FRAG;
+    pkg[1] = lowpan->tx_tag;
+    pkg[2] = offset / FRAG_PAYLOAD_SIZE;
+    pkg[3] = size;
+    pkg[4] = size >> 8;
+    memcpy( pkg + FRAG_HEADER_SIZE, compressed + offset, len );
+
+    lowpan->stats.pkgs_sent++;
+    lowpan->send( lowpan->ctx, pkg );
+  }
+
+  lowpan->tx_tag++;
+
+  return 0;
+}
+
+// decompress and deliver a datagram
+//======================================================================================================
+static void deliver( n_rf24l01_lowpan_t* lowpan, const u_char* compressed, u_int num )
+{
+  u_char datagram[N_RF24L01_LOWPAN_MAX_DATAGRAM];
+  int size;
+
+  size = n_rf24l01_lowpan_decompress( compressed, num, datagram, sizeof(datagram) );
+  if( size < 0 )
+  {
+    lowpan->stats.datagrams_dropped++;
+    return;
+  }
+
+  lowpan->stats.datagrams_received++;
+  lowpan->deliver( lowpan->ctx, datagram, size );
+}
+
+/**
+ * @brief handle a received package
+ *
+ * @param[in] pkg - a package
+ * @return -1, if it isn't a package of the adaptation layer
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_on_pkg( n_rf24l01_lowpan_t* lowpan, const u_char* pkg )
+{
+  u_int size, index, count, len;
+
+  if( pkg[0] == N_RF24L01_LOWPAN_SINGLE )
+  {
+    if( !pkg[1] || pkg[1] > N_RF24L01_PKG_SIZE - SINGLE_HEADER_SIZE )
+      return -1;
+
+    deliver( lowpan, pkg + SINGLE_HEADER_SIZE, pkg[1] );
+    return 0;
+  }
+
+  if( pkg[0] != N_RF24L01_LOWPAN_FRAG )
+    return -1;
+
+  size = pkg[3] | pkg[4] << 8;
+  index = pkg[2];
+  count = ( size + FRAG_PAYLOAD_SIZE - 1 ) / FRAG_PAYLOAD_SIZE;
+
+  if( !size || size > N_RF24L01_LOWPAN_MAX_COMPRESSED || index >= count )
+    return -1;
+
+  // packages don't get reordered on air, so another datagram means the current one is lost
+  if( !lowpan->rx_active || lowpan->rx_tag != pkg[1] || lowpan->rx_size != size )
+  {
+    if( lowpan->rx_active )
+      lowpan->stats.datagrams_dropped++;
+
+    lowpan->rx_active = 1;
+    lowpan->rx_tag = pkg[1];
+    lowpan->rx_size = size;
+    lowpan->rx_map = 0;
+  }
+
+  len = size - index * FRAG_PAYLOAD_SIZE < FRAG_PAYLOAD_SIZE ? size - index * FRAG_PAYLOAD_SIZE : FRAG_PAYLOAD_SIZE;
+  memcpy( lowpan->rx_buf + index * FRAG_PAYLOAD_SIZE, pkg + FRAG_HEADER_SIZE, len );
+  lowpan->rx_map |= (uint64_t)1 << index;
+
+  if( lowpan->rx_map == ( count == 64 ? ~(uint64_t)0 : ( (uint64_t)1 << count ) - 1 ) )
+  {
+    lowpan->rx_active = 0;
+    deliver( lowpan, lowpan->rx_buf, size );
+  }
+
+  return 0;
+}
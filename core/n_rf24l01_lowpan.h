@@ -0,0 +1,128 @@
+#ifndef N_RF24L01_LOWPAN_H
+#define N_RF24L01_LOWPAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* An IP datagrams adaptation layer (6LoWPAN-like) on top of the library's core.
+ *
+ * IPv6 headers (and UDP ones after them) get compressed by a stateless subset of IPHC
+ * (RFC 6282): a traffic class and a flow label are elided if zero, a hop limit of 1/64/255,
+ * a payload length and a UDP length are elided, link-local addresses with a 16-bit
+ * (fe80::ff:fe00:XXXX) or a 64-bit interface identifier and multicast addresses of
+ * ff02::XX and ffXX::XX:XXXX form are shortened, UDP ports of 0xf0bX and 0xf0XX form too.
+ * Other datagrams (e.g. IPv4) go as is.
+ *
+ * A compressed datagram which fits in one package goes with a 2-byte header, a larger one
+ * gets split into fragments with a 5-byte header. A receiver reassembles one datagram at
+ * time, as packages don't get reordered on air, a datagram with a lost fragment is dropped. */
+
+#include "../n_rf24l01_core.h"
+
+/* a max size of a datagram to carry */
+#define N_RF24L01_LOWPAN_MAX_DATAGRAM 1500
+
+/* a max size of a compressed datagram (a dispatch byte plus an uncompressed datagram) */
+#define N_RF24L01_LOWPAN_MAX_COMPRESSED ( N_RF24L01_LOWPAN_MAX_DATAGRAM + 1 )
+
+/**
+ * @brief transmit a package (N_RF24L01_PKG_SIZE bytes)
+ */
+typedef void (*n_rf24l01_lowpan_send_ptr)( void* ctx, const u_char* pkg );
+
+/**
+ * @brief deliver a reassembled and decompressed datagram
+ */
+typedef void (*n_rf24l01_lowpan_deliver_ptr)( void* ctx, const u_char* datagram, u_int num );
+
+typedef struct n_rf24l01_lowpan_stats_t
+{
+  u_int datagrams_sent;
+  u_int datagrams_received;
+  u_int datagrams_dropped;
+  u_int pkgs_sent;
+
+  /* sizes of datagrams before and after compression of headers */
+  u_int bytes_in;
+  u_int bytes_out;
+} n_rf24l01_lowpan_stats_t;
+
+typedef struct n_rf24l01_lowpan_t
+{
+  n_rf24l01_lowpan_send_ptr send;
+  n_rf24l01_lowpan_deliver_ptr deliver;
+  void* ctx;
+
+  u_char tx_tag;
+
+  u_char rx_buf[N_RF24L01_LOWPAN_MAX_COMPRESSED];
+  uint64_t rx_map;
+  u_int rx_size;
+  u_char rx_tag;
+  u_char rx_active;
+
+  n_rf24l01_lowpan_stats_t stats;
+} n_rf24l01_lowpan_t;
+
+/**
+ * @brief initialize an adaptation layer
+ *
+ * @param[out] lowpan  - an adaptation layer to initialize
+ * @param[in]  send    - a callback to transmit a package
+ * @param[in]  deliver - a callback to deliver received datagrams
+ * @param[in]  ctx     - a context passed to callbacks
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_init( n_rf24l01_lowpan_t* lowpan, n_rf24l01_lowpan_send_ptr send,
+                           n_rf24l01_lowpan_deliver_ptr deliver, void* ctx );
+
+/**
+ * @brief compress and transmit a datagram
+ *
+ * @param[in] datagram - an IP datagram
+ * @param[in] num      - a size of the datagram, up to N_RF24L01_LOWPAN_MAX_DATAGRAM
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_send( n_rf24l01_lowpan_t* lowpan, const u_char* datagram, u_int num );
+
+/**
+ * @brief handle a received package
+ *
+ * @param[in] pkg - a package (N_RF24L01_PKG_SIZE bytes)
+ * @return -1, if it isn't a package of the adaptation layer
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_on_pkg( n_rf24l01_lowpan_t* lowpan, const u_char* pkg );
+
+/**
+ * @brief compress headers of a datagram
+ *
+ * @param[in]  datagram - an IP datagram
+ * @param[in]  num      - a size of the datagram
+ * @param[out] dst      - a buffer for a compressed datagram, N_RF24L01_LOWPAN_MAX_COMPRESSED is enough
+ * @param[in]  dst_size - a size of @dst
+ * @return a size of the compressed datagram, -1 if @dst is too small
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_compress( const u_char* datagram, u_int num, u_char* dst, u_int dst_size );
+
+/**
+ * @brief decompress headers of a datagram
+ *
+ * @param[in]  src      - a compressed datagram
+ * @param[in]  num      - a size of the compressed datagram
+ * @param[out] datagram - a buffer for an IP datagram
+ * @param[in]  size     - a size of @datagram
+ * @return a size of the datagram, -1 if the compressed datagram is broken or @datagram is too small
+ */
+//======================================================================================================
+int n_rf24l01_lowpan_decompress( const u_char* src, u_int num, u_char* datagram, u_int size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_LOWPAN_H
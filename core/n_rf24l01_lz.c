@@ -0,0 +1,168 @@
+/**
+ * @file LZSS codec implementation
+ */
+
+#include <string.h>
+
+#include "n_rf24l01_lz.h"
+
+#define MIN_MATCH 3
+#define MAX_MATCH ( MIN_MATCH + 15 )
+#define MAX_OFFSET 4096
+
+// how many earlier occurrences to try, trades a ratio for CPU time
+#define MAX_CHAIN 16
+
+
+//======================================================================================================
+static inline u_int get_hash( const u_char* data )
+{
+  return ( ( data[0] << 5 ) ^ ( data[1] << 2 ) ^ data[2] ^ ( data[0] >> 3 ) ) & ( ( 1 << N_RF24L01_LZ_HASH_BITS ) - 1 );
+}
+
+/**
+ * @brief compress a frame
+ *
+ * @param[in]  lz       - an encoder's state
+ * @param[in]  src      - a frame to compress
+ * @param[in]  num      - a size of the frame
+ * @param[out] dst      - a buffer for a compressed frame
+ * @param[in]  dst_size - a size of @dst
+ * @return a size of the compressed frame, 0 - the frame doesn't get smaller or @dst is too small
+ */
+//======================================================================================================
+u_int n_rf24l01_lz_compress( n_rf24l01_lz_t* lz, const u_char* src, u_int num, u_char* dst, u_int dst_size )
+{
+  u_int pos = 0, out = 0, flags_pos = 0, item = 8;
+  u_int best_len, best_offset, len, chain, hash;
+  uint16_t candidate;
+
+  if( !num || num > N_RF24L01_LZ_MAX_FRAME )
+    return 0;
+
+  // a compressed frame has to be smaller than an original one to make sense
+  if( dst_size > num - 1 )
+    dst_size = num - 1;
+
+  memset( lz->head, 0, sizeof(lz->head) );
+
+  while( pos < num )
+  {
+    // the flag byte plus two bytes of the largest item
+    if( item == 8 )
+    {
+      if( out + 1 > dst_size )
+        return 0;
+
+      flags_pos = out++;
+      dst[flags_pos] = 0;
+      item = 0;
+    }
+
+    best_len = 0;
+    best_offset = 0;
+
+    if( pos + MIN_MATCH <= num )
+    {
+      hash = get_hash( src + pos );
+
+      for( candidate = lz->head[hash], chain = 0; candidate && chain < MAX_CHAIN; candidate = lz->prev[candidate - 1], chain++ )
+      {
+        if( pos - ( candidate - 1 ) > MAX_OFFSET )
+          break;
+
+        for( len = 0; len < MAX_MATCH && pos + len < num && src[candidate - 1 + len] == src[pos + len]; len++ )
+          ;
+
+        if( len > best_len )
+        {
+          best_len = len;
+          best_offset = pos - ( candidate - 1 );
+
+          if( len == MAX_MATCH )
+            break;
+        }
+      }
+    }
+
+    if( best_len >= MIN_MATCH )
+    {
+      if( out + 2 > dst_size )
+        return 0;
+
+      dst[flags_pos] |= 1 << item;
+      dst[out++] = ( best_offset - 1 ) & 0xff;
+      dst[out++] = ( ( best_offset - 1 ) >> 8 ) << 4 | ( best_len - MIN_MATCH );
+    }
+    else
+    {
+      if( out + 1 > dst_size )
+        return 0;
+
+      best_len = 1;
+      dst[out++] = src[pos];
+    }
+
+    item++;
+
+    // remember all positions the item covers
+    for( len = 0; len < best_len; len++, pos++ )
+      if( pos + MIN_MATCH <= num )
+      {
+        hash = get_hash( src + pos );
+        lz->prev[pos] = lz->head[hash];
+        lz->head[hash] = pos + 1;
+      }
+  }
+
+  return out;
+}
+
+/**
+ * @brief decompress a frame
+ *
+ * @param[in]  src      - a compressed frame
+ * @param[in]  num      - a size of the compressed frame
+ * @param[out] dst      - a buffer for a frame
+ * @param[in]  dst_size - a size of @dst
+ * @return a size of the frame, -1 if the compressed frame is broken or @dst is too small
+ */
+//======================================================================================================
+int n_rf24l01_lz_decompress( const u_char* src, u_int num, u_char* dst, u_int dst_size )
+{
+  u_int pos = 0, out = 0, item, offset, len;
+  u_char flags;
+
+  while( pos < num )
+  {
+    flags = src[pos++];
+
+    for( item = 0; item < 8 && pos < num; item++ )
+    {
+      if( !( flags >> item & 1 ) )
+      {
+        if( out + 1 > dst_size )
+          return -1;
+
+        dst[out++] = src[pos++];
+        continue;
+      }
+
+      if( pos + 2 > num )
+        return -1;
+
+      offset = ( src[pos] | ( src[pos + 1] >> 4 ) << 8 ) + 1;
+      len = ( src[pos + 1] & 0x0f ) + MIN_MATCH;
+      pos += 2;
+
+      if( offset > out || out + len > dst_size )
+        return -1;
+
+      // byte by byte, as a match may overlap data it produces
+      for( ; len; len--, out++ )
+        dst[out] = dst[out - offset];
+    }
+  }
+
+  return out;
+}
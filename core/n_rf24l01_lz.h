@@ -0,0 +1,64 @@
+#ifndef N_RF24L01_LZ_H
+#define N_RF24L01_LZ_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A small LZSS codec to compress data before it's split into packages.
+ *
+ * Each frame is compressed on its own, so a lost frame doesn't break the following ones.
+ * An encoder finds matches by hash chains over the frame itself, so its memory footprint
+ * is static and bounded by N_RF24L01_LZ_MAX_FRAME; a decoder needs no memory at all.
+ *
+ * A compressed frame is a sequence of groups: a flag byte and up to 8 items, bit i of
+ * the flag byte tells whether an item i is a literal (0, one byte) or a match (1, two bytes:
+ * 12 bits of (offset - 1) and 4 bits of (length - 3), LSByte first). */
+
+#include "../n_rf24l01_core.h"
+
+/* a max size of a frame to compress */
+#define N_RF24L01_LZ_MAX_FRAME 1024
+
+/* a max size of a compressed frame, if the frame is incompressible */
+#define N_RF24L01_LZ_BOUND( num ) ( (num) + ( (num) + 7 ) / 8 )
+
+#define N_RF24L01_LZ_HASH_BITS 8
+
+typedef struct n_rf24l01_lz_t
+{
+  /* positions (+1) of the last and previous occurrences of 3-byte sequences */
+  uint16_t head[1 << N_RF24L01_LZ_HASH_BITS];
+  uint16_t prev[N_RF24L01_LZ_MAX_FRAME];
+} n_rf24l01_lz_t;
+
+/**
+ * @brief compress a frame
+ *
+ * @param[in]  lz       - an encoder's state
+ * @param[in]  src      - a frame to compress
+ * @param[in]  num      - a size of the frame, up to N_RF24L01_LZ_MAX_FRAME
+ * @param[out] dst      - a buffer for a compressed frame
+ * @param[in]  dst_size - a size of @dst
+ * @return a size of the compressed frame, 0 - the frame doesn't get smaller or @dst is too small
+ */
+//======================================================================================================
+u_int n_rf24l01_lz_compress( n_rf24l01_lz_t* lz, const u_char* src, u_int num, u_char* dst, u_int dst_size );
+
+/**
+ * @brief decompress a frame
+ *
+ * @param[in]  src      - a compressed frame
+ * @param[in]  num      - a size of the compressed frame
+ * @param[out] dst      - a buffer for a frame
+ * @param[in]  dst_size - a size of @dst
+ * @return a size of the frame, -1 if the compressed frame is broken or @dst is too small
+ */
+//======================================================================================================
+int n_rf24l01_lz_decompress( const u_char* src, u_int num, u_char* dst, u_int dst_size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_LZ_H
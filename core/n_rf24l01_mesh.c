@@ -0,0 +1,237 @@
+/**
+ * @file multi-hop forwarding implementation
+ */
+
+// a package format:
+//  <N_RF24L01_MESH_TAG> <next hop> <previous hop> <destination> <source> <seq> <source's epoch>
+//  <relays> <length> <payload: N_RF24L01_MESH_PAYLOAD_SIZE bytes>
+//
+// relays - how many times the package has been forwarded
+
+#include <string.h>
+
+#include "n_rf24l01_mesh.h"
+
+#define N_RF24L01_MESH_TAG 0xa0
+#define N_RF24L01_MESH_HEADER_SIZE 9
+
+enum
+{
+  TAG,
+  NEXT_HOP,
+  PREV_HOP,
+  DST,
+  SRC,
+  SEQ,
+  EPOCH,
+  RELAYS,
+  LENGTH,
+};
+
+
+// check a package of @src against recent ones and remember it
+//======================================================================================================
+static int is_duplicate( n_rf24l01_mesh_t* mesh, u_char src, u_char seq, u_char epoch )
+{
+  uint32_t* map = &mesh->dup_map[src];
+  u_char behind = mesh->dup_newest[src] - seq;
+  u_char ahead = seq - mesh->dup_newest[src];
+
+  // the source has been restarted, its numbers start anew
+  if( epoch != mesh->dup_epoch[src] )
+  {
+    mesh->dup_epoch[src] = epoch;
+    *map = 0;
+  }
+
+  if( *map && behind < 0x80 )
+  {
+    if( behind < N_RF24L01_MESH_DUP_WINDOW )
+    {
+      if( *map & ( 1u << behind ) )
+        return 1;
+
+      *map |= 1u << behind;
+      return 0;
+    }
+
+    // a source which is far behind has been restarted within the same epoch, start it anew
+    *map = 0;
+  }
+
+  *map = *map && ahead < N_RF24L01_MESH_DUP_WINDOW ? *map << ahead | 1 : 1;
+  mesh->dup_newest[src] = seq;
+
+  return 0;
+}
+
+//======================================================================================================
+static u_char get_next_hop( const n_rf24l01_mesh_t* mesh, u_char dst )
+{
+  if( dst == N_RF24L01_MESH_BROADCAST )
+    return N_RF24L01_MESH_BROADCAST;
+
+  if( mesh->routes[dst] != N_RF24L01_MESH_NONE )
+    return mesh->routes[dst];
+
+  if( mesh->default_route != N_RF24L01_MESH_NONE )
+    return mesh->default_route;
+
+  return dst;
+}
+
+// transmit a package to a next hop, the package is modified
+//======================================================================================================
+static void transmit( n_rf24l01_mesh_t* mesh, u_char* pkg )
+{
+  pkg[NEXT_HOP] = get_next_hop( mesh, pkg[DST] );
+  pkg[PREV_HOP] = mesh->addr;
+
+  mesh->send( mesh->ctx, pkg );
+  mesh->stats.hop_pkgs_sent[pkg[NEXT_HOP]]++;
+}
+
+/**
+ * @brief initialize a mesh, a routing table is empty
+ *
+ * @param[out] mesh    - a mesh to initialize
+ * @param[in]  addr    - an address of this node
+ * @param[in]  send    - a callback to transmit a package
+ * @param[in]  deliver - a callback to deliver received data
+ * @param[in]  ctx     - a context passed to callbacks
+ * @param[in]  now_mks - a current time, the epoch is picked by it
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_mesh_init( n_rf24l01_mesh_t* mesh, u_char addr, n_rf24l01_mesh_send_ptr send,
+                         n_rf24l01_mesh_deliver_ptr deliver, void* ctx, uint64_t now_mks )
+{
+  if( !mesh || !send || !deliver || addr == N_RF24L01_MESH_NONE || addr == N_RF24L01_MESH_BROADCAST )
+    return -1;
+
+  memset( mesh, 0, sizeof(*mesh) );
+
+  mesh->addr = addr;
+  mesh->send = send;
+  mesh->deliver = deliver;
+  mesh->ctx = ctx;
+
+  // as the ARQ's one, another epoch unless a restart is within the same microsecond
+  mesh->epoch = (uint32_t)now_mks * 0x9e3779b9 >> 24;
+
+  return 0;
+}
+
+/**
+ * @brief set a route
+ *
+ * @param[in] dst      - a destination, N_RF24L01_MESH_BROADCAST - a default route
+ * @param[in] next_hop - a node to transmit packages to @dst to, N_RF24L01_MESH_NONE - remove the route
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_mesh_set_route( n_rf24l01_mesh_t* mesh, u_char dst, u_char next_hop )
+{
+  if( dst == N_RF24L01_MESH_NONE || next_hop == N_RF24L01_MESH_BROADCAST )
+    return -1;
+
+  if( dst == N_RF24L01_MESH_BROADCAST )
+    mesh->default_route = next_hop;
+  else
+    mesh->routes[dst] = next_hop;
+
+  return 0;
+}
+
+/**
+ * @brief transmit data
+ *
+ * @param[in] dst  - a destination
+ * @param[in] data - data to transmit
+ * @param[in] num  - an amount of @data, in bytes
+ */
+//======================================================================================================
+void n_rf24l01_mesh_send( n_rf24l01_mesh_t* mesh, u_char dst, const void* data, u_int num )
+{
+  const u_char* src = data;
+  u_char pkg[N_RF24L01_PKG_SIZE];
+  u_int size;
+
+  while( num )
+  {
+    size = num < N_RF24L01_MESH_PAYLOAD_SIZE ? num : N_RF24L01_MESH_PAYLOAD_SIZE;
+
+    memset( pkg, 0, sizeof(pkg) );
+
+    pkg[TAG] = N_RF24L01_MESH_TAG;
+    pkg[DST] = dst;
+    pkg[SRC] = mesh->addr;
+    pkg[SEQ] = mesh->tx_seq++;
+    pkg[EPOCH] = mesh->epoch;
+    pkg[RELAYS] = 0;
+    pkg[LENGTH] = size;
+    memcpy( pkg + N_RF24L01_MESH_HEADER_SIZE, src, size );
+
+    transmit( mesh, pkg );
+    mesh->stats.pkgs_sent++;
+
+    src += size;
+    num -= size;
+  }
+}
+
+/**
+ * @brief handle a received package, deliver or forward it
+ *
+ * @param[in] pkg - a package (N_RF24L01_PKG_SIZE bytes)
+ * @return -1, if it isn't a mesh package
+ */
+//======================================================================================================
+int n_rf24l01_mesh_on_pkg( n_rf24l01_mesh_t* mesh, const u_char* pkg )
+{
+  u_char forward[N_RF24L01_PKG_SIZE];
+
+  if( pkg[TAG] != N_RF24L01_MESH_TAG || pkg[LENGTH] > N_RF24L01_MESH_PAYLOAD_SIZE ||
+      pkg[RELAYS] > N_RF24L01_MESH_MAX_RELAYS )
+    return -1;
+
+  if( pkg[NEXT_HOP] != mesh->addr && pkg[NEXT_HOP] != N_RF24L01_MESH_BROADCAST )
+  {
+    mesh->stats.pkgs_overheard++;
+    return 0;
+  }
+
+  mesh->stats.hop_pkgs_received[pkg[PREV_HOP]]++;
+
+  // an own package may come back by a flood or a loop
+  if( pkg[SRC] == mesh->addr || is_duplicate( mesh, pkg[SRC], pkg[SEQ], pkg[EPOCH] ) )
+  {
+    mesh->stats.pkgs_duplicated++;
+    return 0;
+  }
+
+  if( pkg[DST] == mesh->addr || pkg[DST] == N_RF24L01_MESH_BROADCAST )
+  {
+    mesh->deliver( mesh->ctx, pkg[SRC], pkg + N_RF24L01_MESH_HEADER_SIZE, pkg[LENGTH] );
+
+    mesh->stats.pkgs_delivered++;
+    mesh->stats.delivered_relays[pkg[RELAYS]]++;
+
+    if( pkg[DST] == mesh->addr )
+      return 0;
+  }
+
+  if( pkg[RELAYS] == N_RF24L01_MESH_MAX_RELAYS )
+  {
+    mesh->stats.pkgs_expired++;
+    return 0;
+  }
+
+  memcpy( forward, pkg, N_RF24L01_PKG_SIZE );
+  forward[RELAYS]++;
+
+  transmit( mesh, forward );
+  mesh->stats.pkgs_forwarded++;
+
+  return 0;
+}
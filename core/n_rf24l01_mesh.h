@@ -0,0 +1,142 @@
+#ifndef N_RF24L01_MESH_H
+#define N_RF24L01_MESH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A multi-hop forwarding on top of the library's core, for nodes out of a direct range
+ * of each other.
+ *
+ * Each node has an address, a package carries addresses of its source and its final
+ * destination, and of a next hop it's transmitted to; a node which is the next hop either
+ * delivers the package or forwards it right away (on the same channel, so a relay costs
+ * no trip through a user). A next hop is looked up in a routing table by a destination,
+ * then a default route is tried, a destination without both is assumed to be in a direct range.
+ * A broadcast is delivered to everyone and flooded by every node once.
+ *
+ * As a package may come over several paths (a flood, a routing loop), duplicates are
+ * suppressed by a window of recent sequence numbers of each source, and a package is
+ * forwarded up to N_RF24L01_MESH_MAX_RELAYS times. A node picks a random epoch at init and
+ * stamps its packages with it, so a source which restarts and counts sequence numbers anew
+ * isn't taken for a duplicate of itself.
+ *
+ * The mesh doesn't talk to the core directly, packages go out through a callback. */
+
+#include "../n_rf24l01_core.h"
+
+#define N_RF24L01_MESH_ADDRESSES 256
+
+/* an address of nobody (e.g. no route), valid addresses are [1..254] */
+#define N_RF24L01_MESH_NONE 0
+#define N_RF24L01_MESH_BROADCAST 0xff
+
+#define N_RF24L01_MESH_MAX_RELAYS 7
+
+/* an amount of user data a package carries */
+#define N_RF24L01_MESH_PAYLOAD_SIZE ( N_RF24L01_PKG_SIZE - 9 )
+
+/* how many sequence numbers below the newest one of a source are remembered */
+#define N_RF24L01_MESH_DUP_WINDOW 32
+
+/**
+ * @brief transmit a package (N_RF24L01_PKG_SIZE bytes)
+ */
+typedef void (*n_rf24l01_mesh_send_ptr)( void* ctx, const u_char* pkg );
+
+/**
+ * @brief deliver data of a source @src to a user
+ */
+typedef void (*n_rf24l01_mesh_deliver_ptr)( void* ctx, u_char src, const u_char* data, u_int num );
+
+typedef struct n_rf24l01_mesh_stats_t
+{
+  u_int pkgs_sent;        /* originated by this node */
+  u_int pkgs_delivered;   /* addressed to this node or broadcast */
+  u_int pkgs_forwarded;
+  u_int pkgs_duplicated;  /* suppressed */
+  u_int pkgs_expired;     /* forwarded too many times already */
+  u_int pkgs_overheard;   /* transmitted to another next hop */
+
+  /* delivered packages by an amount of relays they came over */
+  u_int delivered_relays[N_RF24L01_MESH_MAX_RELAYS + 1];
+
+  /* packages transmitted to each next hop and received from each previous one */
+  u_int hop_pkgs_sent[N_RF24L01_MESH_ADDRESSES];
+  u_int hop_pkgs_received[N_RF24L01_MESH_ADDRESSES];
+} n_rf24l01_mesh_stats_t;
+
+typedef struct n_rf24l01_mesh_t
+{
+  u_char addr;
+
+  /* next hops by destinations, N_RF24L01_MESH_NONE - no route */
+  u_char routes[N_RF24L01_MESH_ADDRESSES];
+  u_char default_route;
+
+  n_rf24l01_mesh_send_ptr send;
+  n_rf24l01_mesh_deliver_ptr deliver;
+  void* ctx;
+
+  u_char tx_seq;
+  u_char epoch;
+
+  /* sequence numbers seen of each source: an epoch they belong to, the newest one and
+   * a bitmap of ones below it (bit 0 - the newest one), 0 - nothing is seen yet */
+  u_char dup_epoch[N_RF24L01_MESH_ADDRESSES];
+  u_char dup_newest[N_RF24L01_MESH_ADDRESSES];
+  uint32_t dup_map[N_RF24L01_MESH_ADDRESSES];
+
+  n_rf24l01_mesh_stats_t stats;
+} n_rf24l01_mesh_t;
+
+/**
+ * @brief initialize a mesh, a routing table is empty
+ *
+ * @param[out] mesh    - a mesh to initialize
+ * @param[in]  addr    - an address of this node, [1..254]
+ * @param[in]  send    - a callback to transmit a package
+ * @param[in]  deliver - a callback to deliver received data
+ * @param[in]  ctx     - a context passed to callbacks
+ * @param[in]  now_mks - a current time, the epoch is picked by it
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_mesh_init( n_rf24l01_mesh_t* mesh, u_char addr, n_rf24l01_mesh_send_ptr send,
+                         n_rf24l01_mesh_deliver_ptr deliver, void* ctx, uint64_t now_mks );
+
+/**
+ * @brief set a route
+ *
+ * @param[in] dst      - a destination, [1..254], N_RF24L01_MESH_BROADCAST - a default route
+ * @param[in] next_hop - a node to transmit packages to @dst to, [1..254],
+ *                       N_RF24L01_MESH_NONE - remove the route
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_mesh_set_route( n_rf24l01_mesh_t* mesh, u_char dst, u_char next_hop );
+
+/**
+ * @brief transmit data
+ *
+ * @param[in] dst  - a destination, [1..254] or N_RF24L01_MESH_BROADCAST
+ * @param[in] data - data to transmit
+ * @param[in] num  - an amount of @data, in bytes
+ */
+//======================================================================================================
+void n_rf24l01_mesh_send( n_rf24l01_mesh_t* mesh, u_char dst, const void* data, u_int num );
+
+/**
+ * @brief handle a received package, deliver or forward it
+ *
+ * @param[in] pkg - a package (N_RF24L01_PKG_SIZE bytes)
+ * @return -1, if it isn't a mesh package
+ */
+//======================================================================================================
+int n_rf24l01_mesh_on_pkg( n_rf24l01_mesh_t* mesh, const u_char* pkg );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_MESH_H
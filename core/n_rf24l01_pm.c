@@ -0,0 +1,211 @@
+/**
+ * @file power management implementation
+ */
+
+#include <string.h>
+
+#include "n_rf24l01.h"
+#include "n_rf24l01_pm.h"
+
+
+// get time to start a wake at, to be a receiver by a start of a next window
+//======================================================================================================
+static uint64_t get_wake_mks( const n_rf24l01_pm_t* pm )
+{
+  u_int wake_mks = 0;
+
+  if( pm->state == N_RF24L01_PM_DOWN )
+    wake_mks = POWER_UP_MKS + RX_SETTLE_MKS;
+  else if( pm->state == N_RF24L01_PM_STANDBY )
+    wake_mks = RX_SETTLE_MKS;
+
+  return pm->window_start_mks > wake_mks ? pm->window_start_mks - wake_mks : 0;
+}
+
+// account time of a current state and switch to a @state, the transceiver is put to it unless it's TX
+//======================================================================================================
+static void set_state( n_rf24l01_pm_t* pm, n_rf24l01_pm_state_t state, uint64_t now_mks )
+{
+  if( state == pm->state )
+    return;
+
+  if( now_mks > pm->state_start_mks )
+    pm->stats.state_mks[pm->state] += now_mks - pm->state_start_mks;
+
+  if( state == N_RF24L01_PM_RX || state == N_RF24L01_PM_TX )
+  {
+    if( pm->state == N_RF24L01_PM_DOWN )
+      pm->stats.wakes++;
+    else if( pm->state == N_RF24L01_PM_STANDBY )
+      pm->stats.fast_wakes++;
+  }
+
+  pm->state = state;
+  pm->state_start_mks = now_mks;
+
+  if( state != N_RF24L01_PM_TX )
+    pm->apply( pm->ctx, state );
+}
+
+// traffic has just ended, stay a receiver, then in standby-I
+//======================================================================================================
+static void hold( n_rf24l01_pm_t* pm, uint64_t now_mks )
+{
+  if( pm->rx_until_mks < now_mks + pm->rx_hold_mks )
+    pm->rx_until_mks = now_mks + pm->rx_hold_mks;
+
+  pm->standby_until_mks = pm->rx_until_mks + pm->standby_mks;
+
+  if( pm->rx_until_mks > now_mks )
+    set_state( pm, N_RF24L01_PM_RX, now_mks );
+  else
+    set_state( pm, pm->standby_mks ? N_RF24L01_PM_STANDBY : N_RF24L01_PM_DOWN, now_mks );
+}
+
+
+//======================================================================================================
+//======================================================================================================
+
+
+/**
+ * @brief initialize a power management
+ *
+ * @param[out] pm          - a power management to initialize
+ * @param[in]  rx_hold_mks - time to stay a receiver after traffic
+ * @param[in]  standby_mks - time to stay in standby-I then
+ * @param[in]  period_mks  - a period of listen windows, 0 - no windows
+ * @param[in]  window_mks  - a length of a listen window
+ * @param[in]  apply       - a callback to put the transceiver to a state
+ * @param[in]  ctx         - a context passed to the callback
+ * @param[in]  now_mks     - a current time
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_pm_init( n_rf24l01_pm_t* pm, u_int rx_hold_mks, u_int standby_mks, u_int period_mks,
+                       u_int window_mks, n_rf24l01_pm_apply_ptr apply, void* ctx, uint64_t now_mks )
+{
+  if( !pm || !apply || ( period_mks && ( !window_mks || window_mks >= period_mks ) ) )
+    return -1;
+
+  memset( pm, 0, sizeof(*pm) );
+
+  pm->rx_hold_mks = rx_hold_mks;
+  pm->standby_mks = standby_mks;
+  pm->period_mks = period_mks;
+  pm->window_mks = window_mks;
+
+  pm->apply = apply;
+  pm->ctx = ctx;
+
+  // the transceiver is whatever it is, the first apply gets it to a known state
+  pm->state = N_RF24L01_PM_TX;
+  pm->state_start_mks = now_mks;
+
+  pm->window_start_mks = now_mks + period_mks;
+
+  hold( pm, now_mks );
+
+  return 0;
+}
+
+/**
+ * @brief tell about a burst of packages the transceiver has transmitted
+ *
+ * @param[in] start_mks - time the burst started at
+ * @param[in] end_mks   - time the burst ended at
+ */
+//======================================================================================================
+void n_rf24l01_pm_on_tx( n_rf24l01_pm_t* pm, uint64_t start_mks, uint64_t end_mks )
+{
+  pm->stats.bursts++;
+
+  set_state( pm, N_RF24L01_PM_TX, start_mks );
+  hold( pm, end_mks );
+}
+
+/**
+ * @brief tell about a received package
+ *
+ * @param[in] now_mks - time the package was received at
+ */
+//======================================================================================================
+void n_rf24l01_pm_on_rx( n_rf24l01_pm_t* pm, uint64_t now_mks )
+{
+  // a package may only be received by a receiver
+  if( pm->state == N_RF24L01_PM_RX )
+    hold( pm, now_mks );
+}
+
+/**
+ * @brief move the transceiver to a next state, whatever is due
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_pm_poll( n_rf24l01_pm_t* pm, uint64_t now_mks )
+{
+  uint64_t next_mks = UINT64_MAX, wake_mks;
+
+  if( pm->period_mks )
+  {
+    // windows missed as the caller was late are skipped
+    if( now_mks >= pm->window_start_mks + pm->window_mks )
+      pm->window_start_mks += ( ( now_mks - pm->window_start_mks - pm->window_mks ) / pm->period_mks + 1 ) *
+                              pm->period_mks;
+
+    if( now_mks >= get_wake_mks( pm ) )
+    {
+      pm->stats.windows++;
+
+      if( pm->rx_until_mks < pm->window_start_mks + pm->window_mks )
+        pm->rx_until_mks = pm->window_start_mks + pm->window_mks;
+
+      pm->window_start_mks += pm->period_mks;
+
+      set_state( pm, N_RF24L01_PM_RX, now_mks );
+    }
+  }
+
+  if( pm->state == N_RF24L01_PM_RX && now_mks >= pm->rx_until_mks )
+  {
+    pm->standby_until_mks = pm->rx_until_mks + pm->standby_mks;
+    set_state( pm, pm->standby_until_mks > now_mks ? N_RF24L01_PM_STANDBY : N_RF24L01_PM_DOWN, now_mks );
+  }
+
+  if( pm->state == N_RF24L01_PM_STANDBY && now_mks >= pm->standby_until_mks )
+    set_state( pm, N_RF24L01_PM_DOWN, now_mks );
+
+  if( pm->state == N_RF24L01_PM_RX )
+    next_mks = pm->rx_until_mks;
+  else if( pm->state == N_RF24L01_PM_STANDBY )
+    next_mks = pm->standby_until_mks;
+
+  if( pm->period_mks )
+  {
+    // a receiver just gets a window added to its time
+    wake_mks = get_wake_mks( pm );
+    if( wake_mks < next_mks )
+      next_mks = wake_mks;
+  }
+
+  if( next_mks == UINT64_MAX )
+    return 0xffffffff;
+
+  if( next_mks <= now_mks )
+    return 0;
+
+  return next_mks - now_mks < 0xffffffff ? next_mks - now_mks : 0xfffffffe;
+}
+
+/**
+ * @brief get statistics, with time of the current state up to @now_mks
+ */
+//======================================================================================================
+void n_rf24l01_pm_get_stats( const n_rf24l01_pm_t* pm, uint64_t now_mks, n_rf24l01_pm_stats_t* stats )
+{
+  *stats = pm->stats;
+
+  if( now_mks > pm->state_start_mks )
+    stats->state_mks[pm->state] += now_mks - pm->state_start_mks;
+}
@@ -0,0 +1,136 @@
+#ifndef N_RF24L01_PM_H
+#define N_RF24L01_PM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A power management on top of the library's core, for nodes on a battery: the transceiver
+ * is a receiver only while it's expected to hear something and is powered down otherwise.
+ *
+ * After a burst of traffic (packages sent or received) the transceiver stays a receiver for
+ * @rx_hold_mks (a peer's reply, acknowledges), then in standby-I for @standby_mks, where a next
+ * burst starts without any SPI transaction, and then it's powered down, where a next burst
+ * waits 1.5ms for a crystal oscillator to start (one CONFIG write).
+ *
+ * A powered down node may listen in windows of @window_mks every @period_mks, peers which know
+ * the schedule transmit within a window; a window is entered early by a wake time (1.5ms + 130us
+ * from a power down, 130us from standby-I), so the transceiver is a receiver by the window's start,
+ * and traffic within a window prolongs it by @rx_hold_mks. Without windows (@period_mks = 0)
+ * a node is heard only for @rx_hold_mks after it has sent something.
+ *
+ * Time spent in each state is accounted for, so a latency can be traded against energy,
+ * a wake time is accounted for as a time of a state being woken to.
+ *
+ * The power management has no own clock, a time (in microseconds, any monotonic origin) is passed
+ * by a caller, and doesn't talk to the core directly, a state gets applied through a callback;
+ * packages are transmitted by a caller (n_rf24l01_prepare_to_transmit wakes the transceiver up
+ * from any state), which tells about a burst afterwards. */
+
+#include "../n_rf24l01_core.h"
+
+typedef enum
+{
+  N_RF24L01_PM_DOWN,      /* powered down, ~0.9uA */
+  N_RF24L01_PM_STANDBY,   /* standby-I, ~26uA */
+  N_RF24L01_PM_RX,        /* a receiver, ~13mA */
+  N_RF24L01_PM_TX,        /* a caller's burst, ~7..11mA */
+  N_RF24L01_PM_STATES
+} n_rf24l01_pm_state_t;
+
+/**
+ * @brief put the transceiver to a state
+ *
+ * @param[in] state - N_RF24L01_PM_DOWN (n_rf24l01_power_down), N_RF24L01_PM_STANDBY (n_rf24l01_standby)
+ *                    or N_RF24L01_PM_RX (n_rf24l01_prepare_to_receive)
+ */
+typedef void (*n_rf24l01_pm_apply_ptr)( void* ctx, n_rf24l01_pm_state_t state );
+
+typedef struct n_rf24l01_pm_stats_t
+{
+  uint64_t state_mks[N_RF24L01_PM_STATES];  /* time spent in each state */
+  u_int wakes;          /* from a power down */
+  u_int fast_wakes;     /* from standby-I */
+  u_int windows;        /* listen windows entered */
+  u_int bursts;
+} n_rf24l01_pm_stats_t;
+
+typedef struct n_rf24l01_pm_t
+{
+  u_int rx_hold_mks;
+  u_int standby_mks;
+  u_int period_mks;
+  u_int window_mks;
+
+  n_rf24l01_pm_apply_ptr apply;
+  void* ctx;
+
+  n_rf24l01_pm_state_t state;
+  uint64_t state_start_mks;
+
+  /* the transceiver is a receiver till rx_until_mks, then in standby-I till standby_until_mks */
+  uint64_t rx_until_mks;
+  uint64_t standby_until_mks;
+
+  /* a start of a next listen window, valid if @period_mks */
+  uint64_t window_start_mks;
+
+  n_rf24l01_pm_stats_t stats;
+} n_rf24l01_pm_t;
+
+/**
+ * @brief initialize a power management, the transceiver is a receiver for @rx_hold_mks first
+ *
+ * @param[out] pm          - a power management to initialize
+ * @param[in]  rx_hold_mks - time to stay a receiver after traffic
+ * @param[in]  standby_mks - time to stay in standby-I then, before a power down
+ * @param[in]  period_mks  - a period of listen windows, 0 - no windows
+ * @param[in]  window_mks  - a length of a listen window, (0..@period_mks)
+ * @param[in]  apply       - a callback to put the transceiver to a state
+ * @param[in]  ctx         - a context passed to the callback
+ * @param[in]  now_mks     - a current time, a first window starts a period later
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_pm_init( n_rf24l01_pm_t* pm, u_int rx_hold_mks, u_int standby_mks, u_int period_mks,
+                       u_int window_mks, n_rf24l01_pm_apply_ptr apply, void* ctx, uint64_t now_mks );
+
+/**
+ * @brief tell about a burst of packages the transceiver has transmitted, it's left to be a receiver
+ *        or in standby-I after the call
+ *
+ * @param[in] start_mks - time the burst started at (n_rf24l01_prepare_to_transmit was called)
+ * @param[in] end_mks   - time the burst ended at
+ */
+//======================================================================================================
+void n_rf24l01_pm_on_tx( n_rf24l01_pm_t* pm, uint64_t start_mks, uint64_t end_mks );
+
+/**
+ * @brief tell about a received package, it prolongs a time the transceiver stays a receiver
+ *
+ * @param[in] now_mks - time the package was received at
+ */
+//======================================================================================================
+void n_rf24l01_pm_on_rx( n_rf24l01_pm_t* pm, uint64_t now_mks );
+
+/**
+ * @brief move the transceiver to a next state, whatever is due
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ *         (but a next call is required after a burst or a received package)
+ */
+//======================================================================================================
+uint32_t n_rf24l01_pm_poll( n_rf24l01_pm_t* pm, uint64_t now_mks );
+
+/**
+ * @brief get statistics, with time of the current state up to @now_mks
+ */
+//======================================================================================================
+void n_rf24l01_pm_get_stats( const n_rf24l01_pm_t* pm, uint64_t now_mks, n_rf24l01_pm_stats_t* stats );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_PM_H
@@ -0,0 +1,525 @@
+/**
+ * @file time-division channel access implementation
+ */
+
+// a package format, a header is <type: 2 MSBits> <a sender's slot: 6 LSBits>:
+//  a beacon: <header> <seq> <slots> <slot_mks: 2 bytes> <late_mks: 2 bytes> <count>
+//            <count announcements: <node id: 2 bytes> <slot>>, node id 0 - a freed slot
+//  data:     <header> <length> <payload: N_RF24L01_TDMA_PAYLOAD_SIZE bytes>, length 0 - a keepalive
+//  a join:   <header> <node id: 2 bytes>
+//
+// late_mks - how late after a frame start the gateway has sent a beacon at
+// all multibyte fields are LSByte first
+
+#include <string.h>
+
+#include "n_rf24l01_tdma.h"
+
+#define N_RF24L01_TDMA_TYPE_MASK 0xc0
+#define N_RF24L01_TDMA_SLOT_MASK 0x3f
+
+#define N_RF24L01_TDMA_BEACON 0x40
+#define N_RF24L01_TDMA_DATA   0x80
+#define N_RF24L01_TDMA_JOIN   0xc0
+
+#define N_RF24L01_TDMA_BEACON_HEADER_SIZE 8
+#define N_RF24L01_TDMA_ANNOUNCE_SIZE 3
+
+#define N_RF24L01_TDMA_QUEUE_MASK ( N_RF24L01_TDMA_QUEUE_SIZE - 1 )
+
+
+// get a pseudo-random number (xorshift32)
+//======================================================================================================
+static uint32_t get_rand( uint32_t* state )
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  return *state = x;
+}
+
+//======================================================================================================
+static uint64_t get_frame_mks( const n_rf24l01_tdma_t* tdma )
+{
+  return (uint64_t)tdma->slots * tdma->slot_mks;
+}
+
+// move the current frame to the one @now_mks is within
+//======================================================================================================
+static void advance( n_rf24l01_tdma_t* tdma, uint64_t now_mks )
+{
+  uint64_t frame = get_frame_mks( tdma );
+
+  if( now_mks < tdma->frame_mks + frame )
+    return;
+
+  tdma->frame_mks += ( now_mks - tdma->frame_mks ) / frame * frame;
+  tdma->beacon_sent = 0;
+}
+
+// get bounds a package may be started within in @slot of the current frame
+//======================================================================================================
+static void get_window( const n_rf24l01_tdma_t* tdma, u_int slot, uint64_t* start, uint64_t* end )
+{
+  *start = tdma->frame_mks + (uint64_t)slot * tdma->slot_mks + N_RF24L01_TDMA_GUARD_MKS;
+  *end = tdma->frame_mks + (uint64_t)( slot + 1 ) * tdma->slot_mks - N_RF24L01_TDMA_GUARD_MKS -
+         N_RF24L01_TDMA_PKG_MKS;
+}
+
+//======================================================================================================
+static void send_beacon( n_rf24l01_tdma_t* tdma, uint64_t now_mks )
+{
+  u_char pkg[N_RF24L01_PKG_SIZE] = { 0, };
+  u_char* announce = pkg + N_RF24L01_TDMA_BEACON_HEADER_SIZE;
+  uint64_t late = now_mks - tdma->frame_mks;
+  u_int nodes = tdma->slots - N_RF24L01_TDMA_SERVICE_SLOTS;
+  u_int i, slot, count = 0;
+
+  // a beacon is too late to be useful if it doesn't fit its field
+  if( late > 0xffff )
+    late = 0xffff;
+
+  pkg[0] = N_RF24L01_TDMA_BEACON;
+  pkg[1] = tdma->beacon_seq++;
+  pkg[2] = tdma->slots;
+  pkg[3] = tdma->slot_mks;
+  pkg[4] = tdma->slot_mks >> 8;
+  pkg[5] = late;
+  pkg[6] = late >> 8;
+
+  // assigned and freed slots are announced in turn, a few of them per beacon
+  for( i = 0; i < nodes && count < N_RF24L01_TDMA_MAX_ANNOUNCES; i++ )
+  {
+    slot = 1 + ( tdma->announce + i ) % nodes;
+    if( !tdma->owners[slot] && !tdma->revoked[slot] )
+      continue;
+
+    if( !tdma->owners[slot] )
+      tdma->revoked[slot]--;
+
+    announce[0] = tdma->owners[slot];
+    announce[1] = tdma->owners[slot] >> 8;
+    announce[2] = slot;
+
+    announce += N_RF24L01_TDMA_ANNOUNCE_SIZE;
+    count++;
+  }
+
+  tdma->announce = ( tdma->announce + i ) % nodes;
+
+  pkg[7] = count;
+
+  tdma->send( tdma->ctx, pkg );
+  tdma->beacon_sent = 1;
+  tdma->stats.beacons_sent++;
+}
+
+//======================================================================================================
+static void send_join( n_rf24l01_tdma_t* tdma )
+{
+  u_char pkg[N_RF24L01_PKG_SIZE] = { 0, };
+
+  pkg[0] = N_RF24L01_TDMA_JOIN;
+  pkg[1] = tdma->node_id;
+  pkg[2] = tdma->node_id >> 8;
+
+  tdma->send( tdma->ctx, pkg );
+  tdma->stats.joins_sent++;
+}
+
+// the gateway gives a node its old slot, if any, or a free one, a slot someone transmits in
+// (a node with a static slot) isn't free
+//======================================================================================================
+static void on_join( n_rf24l01_tdma_t* tdma, uint16_t node_id, uint64_t now_mks )
+{
+  uint64_t leave = N_RF24L01_TDMA_LEAVE_FRAMES * get_frame_mks( tdma );
+  u_int slot, free = 0;
+
+  if( !node_id )
+    return;
+
+  for( slot = 1; slot < tdma->slots - 1; slot++ )
+  {
+    if( tdma->owners[slot] == node_id )
+      break;
+
+    if( !free && !tdma->owners[slot] && ( !tdma->heard_mks[slot] || now_mks - tdma->heard_mks[slot] > leave ) )
+      free = slot;
+  }
+
+  if( slot == tdma->slots - 1 )
+  {
+    if( !free )
+      return;
+
+    slot = free;
+    tdma->owners[slot] = node_id;
+    tdma->revoked[slot] = 0;
+    tdma->stats.joins_accepted++;
+  }
+
+  tdma->heard_mks[slot] = now_mks;
+
+  // to let the node know it as soon as possible
+  tdma->announce = slot - 1;
+}
+
+//======================================================================================================
+static void on_beacon( n_rf24l01_tdma_t* tdma, const u_char* pkg, uint64_t now_mks )
+{
+  const u_char* announce = pkg + N_RF24L01_TDMA_BEACON_HEADER_SIZE;
+  uint32_t slot_mks = pkg[3] | pkg[4] << 8;
+  u_int late = pkg[5] | pkg[6] << 8;
+  u_int slots = pkg[2];
+  u_int i, count = pkg[7];
+  uint16_t node_id;
+
+  if( slots <= N_RF24L01_TDMA_SERVICE_SLOTS || slots > N_RF24L01_TDMA_MAX_SLOTS ||
+      slot_mks < N_RF24L01_TDMA_MIN_SLOT_MKS || count > N_RF24L01_TDMA_MAX_ANNOUNCES )
+    return;
+
+  tdma->slots = slots;
+  tdma->slot_mks = slot_mks;
+  tdma->frame_mks = now_mks - late - N_RF24L01_TDMA_BEACON_DELAY_MKS;
+  tdma->last_beacon_mks = now_mks;
+  tdma->synced = 1;
+  tdma->stats.beacons_received++;
+
+  if( tdma->static_slot )
+  {
+    tdma->assigned = tdma->slot < slots - 1;
+    return;
+  }
+
+  for( i = 0; i < count; i++, announce += N_RF24L01_TDMA_ANNOUNCE_SIZE )
+  {
+    node_id = announce[0] | announce[1] << 8;
+
+    if( node_id == tdma->node_id )
+    {
+      // a keepalive goes out soon after a node gets a slot
+      if( !tdma->assigned || tdma->slot != announce[2] )
+        tdma->tx_mks = 0;
+
+      tdma->slot = announce[2];
+      tdma->assigned = 1;
+    }
+    else if( tdma->assigned && tdma->slot == announce[2] )
+      tdma->assigned = 0;   // the gateway has forgotten us (e.g. restarted), ask again
+  }
+
+  if( tdma->assigned && tdma->slot >= slots - 1 )
+    tdma->assigned = 0;
+}
+
+// a node sends a join request at a random time within the contention slot of a random frame
+//======================================================================================================
+static uint64_t poll_join( n_rf24l01_tdma_t* tdma, uint64_t now_mks )
+{
+  uint64_t start, end;
+
+  get_window( tdma, tdma->slots - 1, &start, &end );
+
+  if( tdma->join_frame_mks != tdma->frame_mks )
+  {
+    tdma->join_frame_mks = tdma->frame_mks;
+    tdma->join_mks = 0;
+
+    if( !( get_rand( &tdma->rand_state ) % N_RF24L01_TDMA_JOIN_BACKOFF ) )
+      tdma->join_mks = start + get_rand( &tdma->rand_state ) % ( end - start + 1 );
+  }
+
+  if( tdma->join_mks && now_mks >= tdma->join_mks )
+  {
+    if( now_mks <= end )
+      send_join( tdma );
+
+    tdma->join_mks = 0;
+  }
+
+  // a decision for a next frame is taken at its start
+  return tdma->join_mks ? tdma->join_mks : tdma->frame_mks + get_frame_mks( tdma );
+}
+
+// send queued packages which fit in time left within an own slot
+//======================================================================================================
+static uint64_t poll_queue( n_rf24l01_tdma_t* tdma, uint64_t now_mks, u_int pkgs_before )
+{
+  u_char* pkg;
+  uint64_t start, end;
+
+  get_window( tdma, tdma->slot, &start, &end );
+
+  if( now_mks > end )
+    return start + get_frame_mks( tdma );
+
+  if( now_mks < start )
+    return start;
+
+  // packages sent by this call before (e.g. a beacon) take time of a slot too
+  for( now_mks += pkgs_before * N_RF24L01_TDMA_PKG_MKS; now_mks <= end && tdma->queue_head != tdma->queue_tail; now_mks += N_RF24L01_TDMA_PKG_MKS )
+  {
+    pkg = tdma->queue[tdma->queue_tail++ & N_RF24L01_TDMA_QUEUE_MASK];
+    pkg[0] = N_RF24L01_TDMA_DATA | tdma->slot;
+
+    tdma->send( tdma->ctx, pkg );
+    tdma->stats.pkgs_sent++;
+    tdma->tx_mks = now_mks;
+  }
+
+  // packages have to be transmitted before it's known what's left of a slot
+  return 0;
+}
+
+// the gateway frees slots of nodes it hasn't heard for a while
+//======================================================================================================
+static void expire_slots( n_rf24l01_tdma_t* tdma, uint64_t now_mks )
+{
+  uint64_t leave = N_RF24L01_TDMA_LEAVE_FRAMES * get_frame_mks( tdma );
+  u_int slot;
+
+  for( slot = 1; slot < tdma->slots - 1; slot++ )
+    if( tdma->owners[slot] && now_mks - tdma->heard_mks[slot] > leave )
+    {
+      tdma->owners[slot] = 0;
+      tdma->revoked[slot] = N_RF24L01_TDMA_SYNC_FRAMES;
+      tdma->stats.leaves++;
+    }
+}
+
+// an idle node lets the gateway know it's still there
+//======================================================================================================
+static void queue_keepalive( n_rf24l01_tdma_t* tdma, uint64_t now_mks )
+{
+  u_char* pkg;
+
+  if( tdma->queue_head != tdma->queue_tail ||
+      ( tdma->tx_mks && now_mks - tdma->tx_mks < N_RF24L01_TDMA_KEEPALIVE_FRAMES * get_frame_mks( tdma ) ) )
+    return;
+
+  pkg = tdma->queue[tdma->queue_head++ & N_RF24L01_TDMA_QUEUE_MASK];
+  memset( pkg, 0, N_RF24L01_PKG_SIZE );
+}
+
+/**
+ * @brief initialize a TDMA
+ *
+ * @param[out] tdma     - a TDMA to initialize
+ * @param[in]  role     - either the gateway or a node
+ * @param[in]  node_id  - an id of a node (a node only)
+ * @param[in]  slot     - a static slot of a node, 0 - ask the gateway for a slot (a node only)
+ * @param[in]  slots    - slots in a frame (the gateway only)
+ * @param[in]  slot_mks - a slot duration (the gateway only)
+ * @param[in]  send     - a callback to transmit a package
+ * @param[in]  deliver  - a callback to deliver received data
+ * @param[in]  ctx      - a context passed to callbacks
+ * @param[in]  now_mks  - a current time
+ * @return -1, if failed
+ */
+//======================================================================================================
+int n_rf24l01_tdma_init( n_rf24l01_tdma_t* tdma, n_rf24l01_tdma_role_t role, uint16_t node_id, u_char slot,
+                         u_int slots, uint32_t slot_mks, n_rf24l01_tdma_send_ptr send,
+                         n_rf24l01_tdma_deliver_ptr deliver, void* ctx, uint64_t now_mks )
+{
+  if( !tdma || !send || !deliver )
+    return -1;
+
+  if( role == N_RF24L01_TDMA_GATEWAY && ( slots <= N_RF24L01_TDMA_SERVICE_SLOTS ||
+      slots > N_RF24L01_TDMA_MAX_SLOTS || slot_mks < N_RF24L01_TDMA_MIN_SLOT_MKS || slot_mks > 0xffff ) )
+    return -1;
+
+  if( role == N_RF24L01_TDMA_NODE && ( !node_id || slot > N_RF24L01_TDMA_MAX_SLOTS - 2 ) )
+    return -1;
+
+  memset( tdma, 0, sizeof(*tdma) );
+
+  tdma->role = role;
+  tdma->node_id = node_id;
+  tdma->send = send;
+  tdma->deliver = deliver;
+  tdma->ctx = ctx;
+
+  // a node is told a layout by the gateway
+  if( role == N_RF24L01_TDMA_GATEWAY )
+  {
+    tdma->slots = slots;
+    tdma->slot_mks = slot_mks;
+    tdma->frame_mks = now_mks;
+    tdma->synced = 1;
+    tdma->assigned = 1;
+  }
+  else
+  {
+    tdma->slot = slot;
+    tdma->static_slot = !!slot;
+  }
+
+  // xorshift mustn't be seeded by 0, nodes mustn't get the same numbers
+  tdma->rand_state = ( node_id * 0x9e3779b9 ) ^ (uint32_t)now_mks;
+  if( !tdma->rand_state )
+    tdma->rand_state = 0x9e3779b9;
+
+  return 0;
+}
+
+/**
+ * @brief queue data to be transmitted within an own slot
+ *
+ * @param[in] data - data to transmit
+ * @param[in] num  - an amount of @data, in bytes
+ * @return an amount of data queued
+ */
+//======================================================================================================
+u_int n_rf24l01_tdma_send( n_rf24l01_tdma_t* tdma, const void* data, u_int num )
+{
+  const u_char* src = data;
+  u_char* pkg;
+  u_int size, queued = 0;
+
+  while( queued < num )
+  {
+    if( tdma->queue_head - tdma->queue_tail == N_RF24L01_TDMA_QUEUE_SIZE )
+    {
+      tdma->stats.pkgs_dropped += ( num - queued + N_RF24L01_TDMA_PAYLOAD_SIZE - 1 ) / N_RF24L01_TDMA_PAYLOAD_SIZE;
+      break;
+    }
+
+    size = num - queued < N_RF24L01_TDMA_PAYLOAD_SIZE ? num - queued : N_RF24L01_TDMA_PAYLOAD_SIZE;
+
+    // a header is filled in once a slot is known
+    pkg = tdma->queue[tdma->queue_head++ & N_RF24L01_TDMA_QUEUE_MASK];
+    pkg[1] = size;
+    memcpy( pkg + 2, src + queued, size );
+    memset( pkg + 2 + size, 0, N_RF24L01_TDMA_PAYLOAD_SIZE - size );
+
+    queued += size;
+  }
+
+  return queued;
+}
+
+/**
+ * @brief get an amount of data n_rf24l01_tdma_send can queue at once
+ */
+//======================================================================================================
+u_int n_rf24l01_tdma_space( const n_rf24l01_tdma_t* tdma )
+{
+  return ( N_RF24L01_TDMA_QUEUE_SIZE - ( tdma->queue_head - tdma->queue_tail ) ) * N_RF24L01_TDMA_PAYLOAD_SIZE;
+}
+
+/**
+ * @brief handle a received package
+ *
+ * @param[in] pkg     - a package (N_RF24L01_PKG_SIZE bytes)
+ * @param[in] now_mks - time the package was received at
+ * @return -1, if it isn't a TDMA package
+ */
+//======================================================================================================
+int n_rf24l01_tdma_on_pkg( n_rf24l01_tdma_t* tdma, const u_char* pkg, uint64_t now_mks )
+{
+  u_int slot = pkg[0] & N_RF24L01_TDMA_SLOT_MASK;
+
+  switch( pkg[0] & N_RF24L01_TDMA_TYPE_MASK )
+  {
+    case N_RF24L01_TDMA_BEACON:
+      if( tdma->role == N_RF24L01_TDMA_NODE )
+        on_beacon( tdma, pkg, now_mks );
+    break;
+
+    case N_RF24L01_TDMA_DATA:
+      if( pkg[1] > N_RF24L01_TDMA_PAYLOAD_SIZE )
+        return -1;
+
+      tdma->stats.pkgs_received++;
+
+      // nodes hear each other, but talk to the gateway only
+      if( tdma->role == N_RF24L01_TDMA_GATEWAY ? slot == 0 : slot != 0 )
+        break;
+
+      if( tdma->role == N_RF24L01_TDMA_GATEWAY && slot < N_RF24L01_TDMA_MAX_SLOTS )
+        tdma->heard_mks[slot] = now_mks;
+
+      if( pkg[1] )
+        tdma->deliver( tdma->ctx, slot, slot < N_RF24L01_TDMA_MAX_SLOTS ? tdma->owners[slot] : 0, pkg + 2,
+                       pkg[1] );
+    break;
+
+    case N_RF24L01_TDMA_JOIN:
+      if( tdma->role == N_RF24L01_TDMA_GATEWAY )
+        on_join( tdma, pkg[1] | pkg[2] << 8, now_mks );
+    break;
+
+    default:
+      return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief send a beacon, a join request and queued packages, whatever is due
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ */
+//======================================================================================================
+uint32_t n_rf24l01_tdma_poll( n_rf24l01_tdma_t* tdma, uint64_t now_mks )
+{
+  uint64_t next, ret;
+  u_int beacons = 0;
+
+  if( tdma->role == N_RF24L01_TDMA_NODE )
+  {
+    if( tdma->synced && now_mks - tdma->last_beacon_mks > N_RF24L01_TDMA_SYNC_FRAMES * get_frame_mks( tdma ) )
+    {
+      tdma->synced = 0;
+      tdma->stats.sync_losses++;
+    }
+
+    // a next beacon resumes everything
+    if( !tdma->synced )
+      return 0xffffffff;
+  }
+
+  advance( tdma, now_mks );
+
+  if( tdma->role == N_RF24L01_TDMA_GATEWAY )
+  {
+    if( !tdma->beacon_sent && now_mks >= tdma->frame_mks + N_RF24L01_TDMA_GUARD_MKS )
+    {
+      expire_slots( tdma, now_mks );
+      send_beacon( tdma, now_mks );
+      beacons = 1;
+    }
+
+    next = tdma->frame_mks + N_RF24L01_TDMA_GUARD_MKS + ( tdma->beacon_sent ? get_frame_mks( tdma ) : 0 );
+  }
+  else
+  {
+    next = tdma->last_beacon_mks + N_RF24L01_TDMA_SYNC_FRAMES * get_frame_mks( tdma ) + 1;
+
+    if( !tdma->assigned )
+    {
+      ret = poll_join( tdma, now_mks );
+      if( ret < next )
+        next = ret;
+    }
+    else if( !tdma->static_slot )
+      queue_keepalive( tdma, now_mks );
+  }
+
+  if( tdma->assigned && tdma->queue_head != tdma->queue_tail )
+  {
+    ret = poll_queue( tdma, now_mks, beacons );
+    if( ret < next )
+      next = ret;
+  }
+
+  if( next <= now_mks )
+    return 0;
+
+  return next - now_mks < 0xffffffff ? next - now_mks : 0xfffffffe;
+}
@@ -0,0 +1,225 @@
+#ifndef N_RF24L01_TDMA_H
+#define N_RF24L01_TDMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* A time-division channel access on top of the library's core, for a star of nodes around
+ * a gateway which share one channel without acknowledges, so they don't collide.
+ *
+ * Time is split into frames of equal slots:
+ *  - slot 0 belongs to the gateway, it starts with a beacon which carries a layout of a frame
+ *    and the gateway's transmit delay, nodes align their frame clocks to beacons;
+ *  - slots [1..slots - 2] belong to nodes, one slot per node;
+ *  - the last slot is a contention one, nodes which have no slot yet send join requests
+ *    there (with a random backoff, as they may collide);
+ * the gateway assigns a free slot to a node which asks for it and announces assignments in
+ * beacons, several of them per beacon in turn. A node may have a static slot instead.
+ *
+ * A node with an assigned slot which has nothing to send sends an empty package once per
+ * N_RF24L01_TDMA_KEEPALIVE_FRAMES frames; the gateway frees a slot it hasn't heard from for
+ * N_RF24L01_TDMA_LEAVE_FRAMES frames (a node has left or was switched off) and announces it
+ * as a free one for a while, so a node which still takes it for its own asks again.
+ *
+ * Packages wait in a queue till the owner's slot, a package is started within a slot only if
+ * it ends N_RF24L01_TDMA_GUARD_MKS before the slot does, so a clock error of a node is
+ * tolerated. A node which hasn't heard beacons for N_RF24L01_TDMA_SYNC_FRAMES frames stops
+ * transmitting till the next beacon.
+ *
+ * The TDMA has no own clock, a time (in microseconds, any monotonic origin) is passed
+ * by a caller, and doesn't talk to the core directly, packages go out through a callback. */
+
+#include "../n_rf24l01_core.h"
+
+#define N_RF24L01_TDMA_MAX_SLOTS 64
+
+/* slots in a frame besides the ones of nodes: a beacon one and a contention one */
+#define N_RF24L01_TDMA_SERVICE_SLOTS 2
+
+/* an amount of user data a package carries */
+#define N_RF24L01_TDMA_PAYLOAD_SIZE ( N_RF24L01_PKG_SIZE - 2 )
+
+/* packages waiting for a slot, a power of 2 */
+#define N_RF24L01_TDMA_QUEUE_SIZE 64
+
+/* time at edges of a slot nothing is transmitted within */
+#define N_RF24L01_TDMA_GUARD_MKS 500
+
+/* time one package takes to be transmitted, a core's wait included */
+#define N_RF24L01_TDMA_PKG_MKS 400
+
+/* time from a start of a beacon's transmission till a node handles it */
+#define N_RF24L01_TDMA_BEACON_DELAY_MKS 300
+
+#define N_RF24L01_TDMA_MIN_SLOT_MKS ( 2 * N_RF24L01_TDMA_GUARD_MKS + 2 * N_RF24L01_TDMA_PKG_MKS )
+
+/* frames without a beacon a node stays synchronized for */
+#define N_RF24L01_TDMA_SYNC_FRAMES 4
+
+/* a node which has no slot sends a join request in one of this many frames in average */
+#define N_RF24L01_TDMA_JOIN_BACKOFF 4
+
+/* assignments a beacon announces at most */
+#define N_RF24L01_TDMA_MAX_ANNOUNCES 8
+
+/* frames an idle node with an assigned slot sends an empty package once per */
+#define N_RF24L01_TDMA_KEEPALIVE_FRAMES 8
+
+/* frames the gateway keeps an assigned slot for without hearing its node */
+#define N_RF24L01_TDMA_LEAVE_FRAMES 32
+
+/**
+ * @brief transmit a package (N_RF24L01_PKG_SIZE bytes)
+ */
+typedef void (*n_rf24l01_tdma_send_ptr)( void* ctx, const u_char* pkg );
+
+/**
+ * @brief deliver data to a user
+ *
+ * @param[in] slot    - a slot of a sender, 0 - the gateway
+ * @param[in] node_id - an id of a node the gateway has assigned the slot to,
+ *                      0 - the gateway or a node with a static slot
+ */
+typedef void (*n_rf24l01_tdma_deliver_ptr)( void* ctx, u_int slot, uint16_t node_id, const u_char* data, u_int num );
+
+typedef enum
+{
+  N_RF24L01_TDMA_GATEWAY,
+  N_RF24L01_TDMA_NODE,
+} n_rf24l01_tdma_role_t;
+
+typedef struct n_rf24l01_tdma_stats_t
+{
+  u_int beacons_sent;
+  u_int beacons_received;
+  u_int sync_losses;
+  u_int joins_sent;
+  u_int joins_accepted;  /* the gateway only */
+  u_int leaves;          /* slots the gateway has freed, as it hasn't heard their nodes */
+  u_int pkgs_sent;
+  u_int pkgs_received;
+  u_int pkgs_dropped;    /* got no room in a queue */
+} n_rf24l01_tdma_stats_t;
+
+typedef struct n_rf24l01_tdma_t
+{
+  n_rf24l01_tdma_role_t role;
+  uint16_t node_id;
+
+  n_rf24l01_tdma_send_ptr send;
+  n_rf24l01_tdma_deliver_ptr deliver;
+  void* ctx;
+
+  /* a layout of a frame, a node learns it from beacons */
+  u_int slots;
+  uint32_t slot_mks;
+
+  /* an own slot, valid if @assigned; a static slot is never given up */
+  u_char slot;
+  u_char assigned;
+  u_char static_slot;
+
+  /* a start of the current frame, a node knows it if @synced */
+  uint64_t frame_mks;
+  u_char synced;
+  u_char beacon_seq;
+  uint64_t last_beacon_mks;
+
+  /* the gateway: a beacon of the current frame has been sent */
+  u_char beacon_sent;
+
+  /* the gateway: node ids slots are assigned to, 0 - a free slot, and a slot
+   * to start announcements of a next beacon from */
+  uint16_t owners[N_RF24L01_TDMA_MAX_SLOTS];
+  u_int announce;
+
+  /* the gateway: a last time a slot was heard (of a static one too), 0 - never,
+   * and announcements of a freed slot left */
+  uint64_t heard_mks[N_RF24L01_TDMA_MAX_SLOTS];
+  u_char revoked[N_RF24L01_TDMA_MAX_SLOTS];
+
+  /* a node: a last time a package was sent in an own slot */
+  uint64_t tx_mks;
+
+  /* a node: a time to send a join request at in the current frame, 0 - none */
+  uint64_t join_mks;
+  uint64_t join_frame_mks;
+  uint32_t rand_state;
+
+  /* packages waiting for a slot, positions are free-running */
+  u_char queue[N_RF24L01_TDMA_QUEUE_SIZE][N_RF24L01_PKG_SIZE];
+  u_int queue_head;
+  u_int queue_tail;
+
+  n_rf24l01_tdma_stats_t stats;
+} n_rf24l01_tdma_t;
+
+/**
+ * @brief initialize a TDMA
+ *
+ * @param[out] tdma     - a TDMA to initialize
+ * @param[in]  role     - either the gateway or a node
+ * @param[in]  node_id  - an id of a node, unique within a network, [1..0xffff] (a node only)
+ * @param[in]  slot     - a static slot of a node, [1..N_RF24L01_TDMA_MAX_SLOTS - 2],
+ *                        0 - ask the gateway for a slot (a node only)
+ * @param[in]  slots    - slots in a frame, [N_RF24L01_TDMA_SERVICE_SLOTS + 1..N_RF24L01_TDMA_MAX_SLOTS]
+ *                        (the gateway only)
+ * @param[in]  slot_mks - a slot duration, [N_RF24L01_TDMA_MIN_SLOT_MKS..0xffff] (the gateway only)
+ * @param[in]  send     - a callback to transmit a package
+ * @param[in]  deliver  - a callback to deliver received data
+ * @param[in]  ctx      - a context passed to callbacks
+ * @param[in]  now_mks  - a current time, the gateway starts a first frame at it
+ * @return -1, if failed
+ *
+ * Note: the gateway delivers data of all nodes, each with a sender's slot and node id,
+ *       a node - data of the gateway only
+ */
+//======================================================================================================
+int n_rf24l01_tdma_init( n_rf24l01_tdma_t* tdma, n_rf24l01_tdma_role_t role, uint16_t node_id, u_char slot,
+                         u_int slots, uint32_t slot_mks, n_rf24l01_tdma_send_ptr send,
+                         n_rf24l01_tdma_deliver_ptr deliver, void* ctx, uint64_t now_mks );
+
+/**
+ * @brief queue data to be transmitted within an own slot
+ *
+ * @param[in] data - data to transmit
+ * @param[in] num  - an amount of @data, in bytes
+ * @return an amount of data queued, the rest got no room
+ */
+//======================================================================================================
+u_int n_rf24l01_tdma_send( n_rf24l01_tdma_t* tdma, const void* data, u_int num );
+
+/**
+ * @brief get an amount of data n_rf24l01_tdma_send can queue at once
+ */
+//======================================================================================================
+u_int n_rf24l01_tdma_space( const n_rf24l01_tdma_t* tdma );
+
+/**
+ * @brief handle a received package
+ *
+ * @param[in] pkg     - a package (N_RF24L01_PKG_SIZE bytes)
+ * @param[in] now_mks - time the package was received at
+ * @return -1, if it isn't a TDMA package
+ */
+//======================================================================================================
+int n_rf24l01_tdma_on_pkg( n_rf24l01_tdma_t* tdma, const u_char* pkg, uint64_t now_mks );
+
+/**
+ * @brief send a beacon, a join request and queued packages, whatever is due
+ *
+ * @param[in] now_mks - a current time
+ * @return time till the next call is required, in microseconds, 0xffffffff - no need
+ *
+ * Note: packages sent by a call have to be transmitted right away, as their amount
+ *       is limited by time left in a slot
+ */
+//======================================================================================================
+uint32_t n_rf24l01_tdma_poll( n_rf24l01_tdma_t* tdma, uint64_t now_mks );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // N_RF24L01_TDMA_H
@@ -0,0 +1,891 @@
+/*
+ * n_rf24l01.hpp
+ *
+ * A header-only C++20 layer over the library's fd: coroutines await send/receive on
+ * an event loop instead of blocking a thread each, so a single thread may run as many
+ * logical conversations as there's memory for.
+ *
+ *   n_rf24l01::event_loop loop;
+ *   n_rf24l01::frame_pool pool;
+ *   n_rf24l01::radio radio( loop, pool );
+ *
+ *   n_rf24l01::task echo( n_rf24l01::radio& radio )
+ *   {
+ *     for( ;; )
+ *     {
+ *       n_rf24l01::frame frame = co_await radio.receive();
+ *       if( frame.empty() )
+ *         co_return;
+ *
+ *       co_await radio.send( std::move( frame ) );
+ *     }
+ *   }
+ *
+ *   echo( radio );
+ *   loop.run();
+ *
+ * Payloads are read to and written from pooled frames directly, a frame is moved, never copied.
+ * The fd is a byte stream (as it's for read/write), so a received frame is whatever
+ * a single read got, it's up to a user to split it into messages; or a mux splits it
+ * into messages of conversations, each of them awaits its own ones:
+ *
+ *   n_rf24l01::mux mux( radio );
+ *   n_rf24l01::mux::conversation conversation = mux.open( 7 );
+ *
+ *   co_await conversation.send( std::move( frame ) );
+ *   frame = co_await conversation.receive();
+ *
+ * Everything here belongs to a thread which runs a loop, nothing is thread-safe.
+ */
+
+#ifndef N_RF24L01_HPP
+#define N_RF24L01_HPP
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cerrno>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <span>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/uio.h>
+
+#include "n_rf24l01_linux.h"
+
+namespace n_rf24l01
+{
+
+class frame_pool;
+
+/* a buffer which belongs to a pool, it goes back to the pool once it's destroyed */
+class frame
+{
+public:
+  frame() = default;
+
+  frame( frame&& other ) noexcept
+    : pool_( std::exchange( other.pool_, nullptr ) ), data_( std::exchange( other.data_, nullptr ) ),
+      size_( std::exchange( other.size_, 0 ) )
+  {
+  }
+
+  frame& operator=( frame&& other ) noexcept
+  {
+    if( this != &other )
+    {
+      release();
+
+      pool_ = std::exchange( other.pool_, nullptr );
+      data_ = std::exchange( other.data_, nullptr );
+      size_ = std::exchange( other.size_, 0 );
+    }
+
+    return *this;
+  }
+
+  frame( const frame& ) = delete;
+  frame& operator=( const frame& ) = delete;
+
+  ~frame() { release(); }
+
+  std::byte* data() noexcept { return data_; }
+  const std::byte* data() const noexcept { return data_; }
+
+  std::size_t size() const noexcept { return size_; }
+  std::size_t capacity() const noexcept;
+  bool empty() const noexcept { return !size_; }
+
+  /* @size is cut down to a capacity */
+  void resize( std::size_t size ) noexcept;
+
+  std::span<std::byte> bytes() noexcept { return { data_, size_ }; }
+  std::span<const std::byte> bytes() const noexcept { return { data_, size_ }; }
+
+  inline void release() noexcept;
+
+private:
+  friend class frame_pool;
+
+  frame( frame_pool* pool, std::byte* data ) noexcept : pool_( pool ), data_( data ) {}
+
+  frame_pool* pool_ = nullptr;
+  std::byte* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+/* frames of the same capacity; blocks are allocated once, as a pool runs out of free ones,
+ * and get reused since then, so a steady traffic doesn't allocate at all;
+ * a pool has to outlive its frames */
+class frame_pool
+{
+public:
+  explicit frame_pool( std::size_t frame_capacity = 4096, std::size_t preallocate = 64 )
+    : capacity_( frame_capacity )
+  {
+    free_.reserve( preallocate );
+
+    for( std::size_t i = 0; i < preallocate; i++ )
+      free_.push_back( allocate() );
+  }
+
+  frame_pool( const frame_pool& ) = delete;
+  frame_pool& operator=( const frame_pool& ) = delete;
+
+  /* a frame of zero size, its capacity is a pool's one */
+  frame acquire()
+  {
+    std::byte* data;
+
+    if( free_.empty() )
+      data = allocate();
+    else
+    {
+      data = free_.back();
+      free_.pop_back();
+    }
+
+    return frame( this, data );
+  }
+
+  std::size_t capacity() const noexcept { return capacity_; }
+
+  /* how many blocks were allocated and how many of them are free */
+  std::size_t allocated() const noexcept { return blocks_.size(); }
+  std::size_t available() const noexcept { return free_.size(); }
+
+private:
+  friend class frame;
+
+  std::byte* allocate()
+  {
+    blocks_.push_back( std::make_unique<std::byte[]>( capacity_ ) );
+    free_.reserve( blocks_.size() );
+
+    return blocks_.back().get();
+  }
+
+  /* a room for every block was reserved as it was allocated, so a push never reallocates */
+  void put( std::byte* data ) noexcept { free_.push_back( data ); }
+
+  std::size_t capacity_;
+  std::vector<std::unique_ptr<std::byte[]>> blocks_;
+  std::vector<std::byte*> free_;
+};
+
+inline std::size_t frame::capacity() const noexcept
+{
+  return pool_ ? pool_->capacity() : 0;
+}
+
+inline void frame::resize( std::size_t size ) noexcept
+{
+  size_ = size < capacity() ? size : capacity();
+}
+
+inline void frame::release() noexcept
+{
+  if( pool_ )
+    pool_->put( data_ );
+
+  pool_ = nullptr;
+  data_ = nullptr;
+  size_ = 0;
+}
+
+
+/* a coroutine which starts right away and is owned by no one: it runs till it returns,
+ * suspending on awaits in between; an exception which escapes it terminates a process */
+struct task
+{
+  struct promise_type
+  {
+    task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+
+/* something which waits for an fd's events */
+class io_watcher
+{
+public:
+  virtual void on_events( std::uint32_t events ) = 0;
+
+protected:
+  ~io_watcher() = default;
+};
+
+/* an epoll based executor: resumes coroutines which are ready and dispatches fd events */
+class event_loop
+{
+public:
+  event_loop()
+  {
+    epoll_fd_ = epoll_create1( EPOLL_CLOEXEC );
+    if( epoll_fd_ < 0 )
+      throw std::system_error( errno, std::generic_category(), "epoll_create1" );
+  }
+
+  event_loop( const event_loop& ) = delete;
+  event_loop& operator=( const event_loop& ) = delete;
+
+  ~event_loop() { close( epoll_fd_ ); }
+
+  /* resume @handle on a next loop's iteration */
+  void post( std::coroutine_handle<> handle ) { ready_.push_back( handle ); }
+
+  /* events are edge-triggered, a watcher has to consume them till EAGAIN */
+  void watch( int fd, io_watcher* watcher )
+  {
+    epoll_event event = {};
+
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.ptr = watcher;
+
+    if( epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, fd, &event ) < 0 )
+      throw std::system_error( errno, std::generic_category(), "epoll_ctl" );
+  }
+
+  void unwatch( int fd ) noexcept { epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, fd, nullptr ); }
+
+  /* run till stop() is called */
+  void run()
+  {
+    stopped_ = false;
+
+    while( !stopped_ )
+      run_once( -1 );
+  }
+
+  /* resume ready coroutines and wait up to @timeout_ms (-1 - infinite) for events,
+   * there's no wait if there're coroutines to resume */
+  void run_once( int timeout_ms )
+  {
+    epoll_event events[64];
+    int num;
+
+    /* coroutines posted meanwhile wait for a next iteration, not to starve fds */
+    for( std::size_t ready = ready_.size(); ready; ready-- )
+    {
+      std::coroutine_handle<> handle = ready_.front();
+
+      ready_.pop_front();
+      handle.resume();
+    }
+
+    if( stopped_ )
+      return;
+
+    num = epoll_wait( epoll_fd_, events, std::size( events ), ready_.empty() ? timeout_ms : 0 );
+
+    for( int i = 0; i < num; i++ )
+      static_cast<io_watcher*>( events[i].data.ptr )->on_events( events[i].events );
+  }
+
+  void stop() noexcept { stopped_ = true; }
+
+private:
+  int epoll_fd_;
+  bool stopped_ = false;
+  std::deque<std::coroutine_handle<>> ready_;
+};
+
+
+class mux;
+
+/* the library's fd: it's opened (or adopted) and closed by n_rf24l01_close;
+ * awaiters of each direction are served in order they came in, so a send isn't mixed
+ * with another one in a stream even if it takes several writes */
+class radio
+{
+  struct state;
+
+public:
+  class send_awaiter;
+  class receive_awaiter;
+
+  /* open the transceiver with n_rf24l01_open */
+  radio( event_loop& loop, frame_pool& pool ) : radio( loop, pool, n_rf24l01_open() ) {}
+
+  /* adopt an fd from n_rf24l01_open/n_rf24l01_open_bonded, it's switched to non-blocking */
+  radio( event_loop& loop, frame_pool& pool, int fd )
+  {
+    if( fd < 0 )
+      throw std::system_error( EIO, std::generic_category(), "n_rf24l01_open" );
+
+    /* the fd is closed if it can't be adopted */
+    try
+    {
+      state_ = std::make_unique<state>( loop, pool, fd );
+
+      if( fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK ) < 0 )
+        throw std::system_error( errno, std::generic_category(), "fcntl" );
+
+      loop.watch( fd, state_.get() );
+    }
+    catch( ... )
+    {
+      n_rf24l01_close( fd );
+      throw;
+    }
+  }
+
+  radio( radio&& ) noexcept = default;
+  radio& operator=( radio&& other ) noexcept
+  {
+    if( this != &other )
+    {
+      shut();
+      state_ = std::move( other.state_ );
+    }
+
+    return *this;
+  }
+
+  /* awaiters which are still waiting get resumed with an error */
+  ~radio() { shut(); }
+
+  int fd() const noexcept { return state_ ? state_->fd : -1; }
+
+  /* an fd to call other n_rf24l01_* functions with */
+  operator int() const noexcept { return fd(); }
+
+  /* co_await gives 0, or an -errno if the fd is broken (EPIPE) or closed (ECANCELED),
+   * the frame goes back to a pool in any case once it's sent */
+  send_awaiter send( frame frame ) noexcept { return send_awaiter( state_.get(), std::move( frame ) ); }
+
+  /* co_await gives a frame with data, an empty frame means the fd is broken or closed;
+   * mustn't be used once a mux has taken the radio over */
+  receive_awaiter receive() noexcept { return receive_awaiter( state_.get() ); }
+
+  class send_awaiter
+  {
+  public:
+    send_awaiter( state* state, frame frame ) noexcept : state_( state ), frame_( std::move( frame ) ) {}
+
+    /* sends with no one to wait behind go right away, most of them don't suspend at all */
+    bool await_ready() noexcept
+    {
+      if( !state_ && !result_ )
+        result_ = -ECANCELED;
+
+      if( result_ )
+        return true;
+
+      return state_->senders.empty() && try_send();
+    }
+
+    void await_suspend( std::coroutine_handle<> handle )
+    {
+      handle_ = handle;
+      state_->senders.push_back( this );
+    }
+
+    int await_resume() noexcept
+    {
+      frame_.release();
+
+      return result_;
+    }
+
+  private:
+    friend struct radio::state;
+    friend class mux;
+
+    /* a mux's message: a header <id: 2 bytes> <size: 2 bytes> goes right before the frame,
+     * an empty frame isn't sent at all */
+    send_awaiter( state* state, frame frame, std::uint16_t id ) noexcept : send_awaiter( state, std::move( frame ) )
+    {
+      if( frame_.size() > 0xffff )
+        result_ = -EMSGSIZE;
+      else if( !frame_.empty() )
+      {
+        header_[0] = static_cast<std::byte>( id );
+        header_[1] = static_cast<std::byte>( id >> 8 );
+        header_[2] = static_cast<std::byte>( frame_.size() );
+        header_[3] = static_cast<std::byte>( frame_.size() >> 8 );
+        header_size_ = sizeof(header_);
+      }
+    }
+
+    /* returns true if the whole frame is sent or an error happened */
+    bool try_send() noexcept
+    {
+      while( sent_ < header_size_ + frame_.size() )
+      {
+        iovec iov[2];
+        int num = 0;
+
+        if( sent_ < header_size_ )
+          iov[num++] = { header_ + sent_, header_size_ - sent_ };
+
+        std::size_t offset = sent_ > header_size_ ? sent_ - header_size_ : 0;
+        iov[num++] = { frame_.data() + offset, frame_.size() - offset };
+
+        ssize_t ret = writev( state_->fd, iov, num );
+
+        if( ret < 0 && errno == EINTR )
+          continue;
+
+        if( ret < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+          return false;
+
+        if( ret < 0 )
+        {
+          result_ = -errno;
+          return true;
+        }
+
+        sent_ += ret;
+      }
+
+      return true;
+    }
+
+    state* state_;
+    frame frame_;
+    std::byte header_[4];
+    std::size_t header_size_ = 0;
+    std::size_t sent_ = 0;
+    int result_ = 0;
+    std::coroutine_handle<> handle_;
+  };
+
+  class receive_awaiter
+  {
+  public:
+    explicit receive_awaiter( state* state ) noexcept : state_( state ) {}
+
+    bool await_ready()
+    {
+      return !state_ || ( state_->receivers.empty() && try_receive() );
+    }
+
+    void await_suspend( std::coroutine_handle<> handle )
+    {
+      handle_ = handle;
+      state_->receivers.push_back( this );
+    }
+
+    frame await_resume() noexcept { return std::move( frame_ ); }
+
+  private:
+    friend struct radio::state;
+
+    /* returns true if there's data or the fd is gone (the frame is left empty then) */
+    bool try_receive()
+    {
+      ssize_t ret;
+
+      if( !frame_.capacity() )
+        frame_ = state_->pool.acquire();
+
+      do
+        ret = read( state_->fd, frame_.data(), frame_.capacity() );
+      while( ret < 0 && errno == EINTR );
+
+      if( ret < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+        return false;
+
+      if( ret > 0 )
+        frame_.resize( ret );
+      else
+        frame_.release();
+
+      return true;
+    }
+
+    state* state_;
+    frame frame_;
+    std::coroutine_handle<> handle_;
+  };
+
+private:
+  friend class mux;
+
+  struct state final : io_watcher
+  {
+    state( event_loop& loop, frame_pool& pool, int fd ) noexcept : loop( loop ), pool( pool ), fd( fd ) {}
+
+    /* awaiters are resumed through a loop, not from here, so one may destroy the radio
+     * right after it's resumed */
+    inline void on_events( std::uint32_t events ) override;
+    inline void cancel() noexcept;
+
+    event_loop& loop;
+    frame_pool& pool;
+    int fd;
+
+    std::deque<send_awaiter*> senders;
+    std::deque<receive_awaiter*> receivers;
+
+    /* a mux which has taken receiving over */
+    mux* demux = nullptr;
+  };
+
+  void shut() noexcept
+  {
+    if( !state_ )
+      return;
+
+    state_->loop.unwatch( state_->fd );
+    n_rf24l01_close( state_->fd );
+
+    state_->cancel();
+    state_.reset();
+  }
+
+  std::unique_ptr<state> state_;
+};
+
+
+/* conversations multiplexed over one radio, so a single thread may keep thousands of them
+ * over one fd: each message goes with a header <id: 2 bytes> <size: 2 bytes>, LSByte first,
+ * and is read straight to a frame of its own; a message for an id which isn't open
+ * (yet or any more) is dropped; both sides have to use a mux and pools of the same capacity,
+ * a message bigger than a frame can't be followed and breaks a stream.
+ * A mux takes receiving of the radio over, sends of the radio itself may still go in between
+ * messages; a radio or a mux which goes first cancels everyone who waits, as a broken fd does,
+ * conversations which are left are closed */
+class mux
+{
+  struct inbox;
+
+public:
+  class conversation;
+  class receive_awaiter;
+
+  explicit mux( radio& radio ) : state_( radio.state_.get() )
+  {
+    if( !state_ )
+      throw std::system_error( ECANCELED, std::generic_category(), "n_rf24l01::mux" );
+
+    if( state_->demux )
+      throw std::system_error( EBUSY, std::generic_category(), "n_rf24l01::mux" );
+
+    loop_ = &state_->loop;
+    state_->demux = this;
+
+    /* events are edge-triggered, what has come before won't be told about again */
+    on_readable();
+  }
+
+  mux( const mux& ) = delete;
+  mux& operator=( const mux& ) = delete;
+
+  ~mux()
+  {
+    if( state_ )
+      state_->demux = nullptr;
+
+    shut();
+
+    for( auto& [id, inbox] : inboxes_ )
+      inbox->owner = nullptr;
+  }
+
+  /* start a conversation with @id, throws if it's open already */
+  inline conversation open( std::uint16_t id );
+
+  /* messages which were dropped, as no one had their conversations open */
+  std::size_t dropped() const noexcept { return dropped_; }
+
+private:
+  friend struct radio::state;
+
+  struct inbox
+  {
+    mux* owner;
+    std::deque<frame> frames;
+    std::deque<receive_awaiter*> receivers;
+  };
+
+  inline void on_readable();
+  inline void deliver( std::uint16_t id, frame frame );
+
+  /* the fd is broken or the radio is gone, awaiters get empty frames from now on,
+   * after messages which have come so far */
+  inline void shut() noexcept;
+
+  radio::state* state_;
+  event_loop* loop_ = nullptr;
+  bool broken_ = false;
+
+  std::unordered_map<std::uint16_t, inbox*> inboxes_;
+  std::size_t dropped_ = 0;
+
+  /* a message being read */
+  std::byte header_[4];
+  std::size_t header_got_ = 0;
+  std::uint16_t id_ = 0;
+  std::size_t size_ = 0;
+  std::size_t got_ = 0;
+  frame body_;
+};
+
+class mux::receive_awaiter
+{
+public:
+  explicit receive_awaiter( inbox* inbox ) noexcept : inbox_( inbox ) {}
+
+  /* queued messages go without a suspend, unless someone waits already */
+  bool await_ready() noexcept
+  {
+    if( !inbox_ )
+      return true;
+
+    if( !inbox_->receivers.empty() )
+      return false;
+
+    if( !inbox_->frames.empty() )
+    {
+      frame_ = std::move( inbox_->frames.front() );
+      inbox_->frames.pop_front();
+      return true;
+    }
+
+    return !inbox_->owner || inbox_->owner->broken_;
+  }
+
+  void await_suspend( std::coroutine_handle<> handle )
+  {
+    handle_ = handle;
+    inbox_->receivers.push_back( this );
+  }
+
+  frame await_resume() noexcept { return std::move( frame_ ); }
+
+private:
+  friend class mux;
+
+  inbox* inbox_;
+  frame frame_;
+  std::coroutine_handle<> handle_;
+};
+
+/* a handle of a conversation, messages for its id wait for it in order they came in */
+class mux::conversation
+{
+public:
+  conversation( conversation&& ) noexcept = default;
+
+  conversation& operator=( conversation&& other ) noexcept
+  {
+    if( this != &other )
+    {
+      close();
+
+      id_ = other.id_;
+      inbox_ = std::move( other.inbox_ );
+    }
+
+    return *this;
+  }
+
+  /* awaiters which are still waiting get resumed with empty frames */
+  ~conversation() { close(); }
+
+  std::uint16_t id() const noexcept { return id_; }
+
+  /* co_await gives 0 or an -errno, as radio::send does, EMSGSIZE - a frame is above 64KB */
+  radio::send_awaiter send( frame frame ) noexcept
+  {
+    mux* owner = inbox_ ? inbox_->owner : nullptr;
+
+    return radio::send_awaiter( owner ? owner->state_ : nullptr, std::move( frame ), id_ );
+  }
+
+  /* co_await gives a next message, an empty frame means the fd is broken or closed */
+  receive_awaiter receive() noexcept { return receive_awaiter( inbox_.get() ); }
+
+private:
+  friend class mux;
+
+  conversation( mux* owner, std::uint16_t id ) : id_( id ), inbox_( std::make_unique<inbox>( owner ) ) {}
+
+  void close() noexcept
+  {
+    if( !inbox_ )
+      return;
+
+    if( inbox_->owner )
+    {
+      inbox_->owner->inboxes_.erase( id_ );
+
+      for( receive_awaiter* receiver : inbox_->receivers )
+        inbox_->owner->loop_->post( receiver->handle_ );
+    }
+
+    inbox_.reset();
+  }
+
+  std::uint16_t id_;
+  std::unique_ptr<inbox> inbox_;
+};
+
+inline mux::conversation mux::open( std::uint16_t id )
+{
+  if( inboxes_.count( id ) )
+    throw std::system_error( EBUSY, std::generic_category(), "n_rf24l01::mux::open" );
+
+  conversation conversation( this, id );
+  inboxes_.emplace( id, conversation.inbox_.get() );
+
+  return conversation;
+}
+
+inline void mux::on_readable()
+{
+  while( state_ && !broken_ )
+  {
+    ssize_t ret;
+
+    if( header_got_ < sizeof(header_) )
+      ret = read( state_->fd, header_ + header_got_, sizeof(header_) - header_got_ );
+    else
+      ret = read( state_->fd, body_.data() + got_, size_ - got_ );
+
+    if( ret < 0 && errno == EINTR )
+      continue;
+
+    if( ret < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+      return;
+
+    if( ret <= 0 )
+    {
+      shut();
+      return;
+    }
+
+    if( header_got_ < sizeof(header_) )
+    {
+      header_got_ += ret;
+      if( header_got_ < sizeof(header_) )
+        continue;
+
+      id_ = std::to_integer<std::uint16_t>( header_[0] ) | std::to_integer<std::uint16_t>( header_[1] ) << 8;
+      size_ = std::to_integer<std::size_t>( header_[2] ) | std::to_integer<std::size_t>( header_[3] ) << 8;
+      got_ = 0;
+
+      if( size_ > state_->pool.capacity() )
+      {
+        shut();
+        return;
+      }
+
+      body_ = state_->pool.acquire();
+    }
+    else
+      got_ += ret;
+
+    if( got_ == size_ )
+    {
+      header_got_ = 0;
+      body_.resize( size_ );
+
+      if( size_ )
+        deliver( id_, std::move( body_ ) );
+      else
+        body_.release();
+    }
+  }
+}
+
+inline void mux::deliver( std::uint16_t id, frame frame )
+{
+  auto it = inboxes_.find( id );
+
+  if( it == inboxes_.end() )
+  {
+    dropped_++;
+    return;
+  }
+
+  inbox* inbox = it->second;
+
+  if( inbox->receivers.empty() )
+  {
+    inbox->frames.push_back( std::move( frame ) );
+    return;
+  }
+
+  receive_awaiter* receiver = inbox->receivers.front();
+  inbox->receivers.pop_front();
+
+  receiver->frame_ = std::move( frame );
+  loop_->post( receiver->handle_ );
+}
+
+inline void mux::shut() noexcept
+{
+  broken_ = true;
+  body_.release();
+
+  for( auto& [id, inbox] : inboxes_ )
+  {
+    for( receive_awaiter* receiver : inbox->receivers )
+      loop_->post( receiver->handle_ );
+
+    inbox->receivers.clear();
+  }
+}
+
+
+inline void radio::state::on_events( std::uint32_t events )
+{
+  if( events & ( EPOLLOUT | EPOLLERR | EPOLLHUP ) )
+    while( !senders.empty() && senders.front()->try_send() )
+    {
+      loop.post( senders.front()->handle_ );
+      senders.pop_front();
+    }
+
+  if( !( events & ( EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP ) ) )
+    return;
+
+  if( demux )
+    demux->on_readable();
+  else
+    while( !receivers.empty() && receivers.front()->try_receive() )
+    {
+      loop.post( receivers.front()->handle_ );
+      receivers.pop_front();
+    }
+}
+
+inline void radio::state::cancel() noexcept
+{
+  for( send_awaiter* sender : senders )
+  {
+    sender->result_ = -ECANCELED;
+    loop.post( sender->handle_ );
+  }
+
+  for( receive_awaiter* receiver : receivers )
+  {
+    receiver->frame_.release();
+    loop.post( receiver->handle_ );
+  }
+
+  if( demux )
+  {
+    demux->state_ = nullptr;
+    demux->shut();
+  }
+}
+
+} /* namespace n_rf24l01 */
+
+#endif /* N_RF24L01_HPP */
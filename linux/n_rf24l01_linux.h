@@ -1,13 +1,83 @@
-#ifndef N_RF24L01_H
-#define N_RF24L01_H
+#ifndef N_RF24L01_LINUX_H
+#define N_RF24L01_LINUX_H
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 int n_rf24l01_open( void );
+
+/* an alternative to n_rf24l01_open: expose the transceiver as a TUN network interface
+ * @ifname (NULL - let the kernel choose a name) with an @mtu [68..1500], it's brought up,
+ * but addresses and routes have to be set up by a user;
+ * IPv6/UDP headers are compressed (6LoWPAN-like), so small datagrams between link-local
+ * addresses of fe80::ff:fe00:XXXX form fit in a single package, larger datagrams are split
+ * into fragments; the ARQ, the FEC and the compression apply to an fd stream only (the ARQ
+ * and the FEC can not be enabled in this mode),
+ * datagrams go over the transceiver as they are, the network stack copes with losses;
+ * the interface is gone on n_rf24l01_close;
+ * returns an fd of the TUN device to pass to other calls of the library, it's read and
+ * written by the library's thread, so a user mustn't do I/O on it or close it;
+ * requires CAP_NET_ADMIN, returns -1 if failed */
+int n_rf24l01_open_tun( const char* ifname, unsigned int mtu );
+
+/* how many transceivers may be bonded */
+#define N_RF24L01_MAX_RADIOS 4
+
+/* a transceiver to bond */
+typedef struct n_rf24l01_radio_t
+{
+  const char* spi_device_file;      /* e.g. "/dev/spidev1.0" */
+  unsigned int ce_line_pin;         /* sysfs gpio numbers, pins have to be exported */
+  unsigned int interrupt_line_pin;  /* and configured by a user, look at prepare.sh */
+  unsigned int channel;             /* each radio has to be on its own RF channel */
+} n_rf24l01_radio_t;
+
+/* an alternative to n_rf24l01_open: open the library over @num [1..N_RF24L01_MAX_RADIOS]
+ * transceivers, a stream written to a returned fd is striped over all of them, a remote
+ * side has to have the same amount of radios on the same channels in the same order;
+ * a receiver puts packages back in order (a bounded wait for a missing one, so there's
+ * no reliability, as without bonding), a degraded radio carries less traffic;
+ * n_rf24l01_tune, n_rf24l01_hop, the ARQ and the FEC aren't available, n_rf24l01_scan
+ * uses radio 0, n_rf24l01_listen_before_talk applies to all radios;
+ * returns -1 if failed */
+int n_rf24l01_open_bonded( const n_rf24l01_radio_t* radios, unsigned int num );
 // int n_rf24l01_setup( int fd, ... );
 
+/* a daemon mode: share the transceiver with other processes, they connect to a unix
+ * socket @path (n_rf24l01_connect) and get a memory shared with the library's thread and
+ * a pair of eventfds, so a stream and register accesses go without extra copies and
+ * syscalls besides doorbells; the library's thread serializes everything, so clients
+ * don't contend for an SPI bus (unlike n_rf24l01_open_dbg from another process);
+ * a received stream goes to every client (a client which doesn't keep up loses data),
+ * @fd is an fd n_rf24l01_open or n_rf24l01_open_bonded has returned, nothing is written
+ * to it any more, but it's still accepted for writing; writes of clients and @fd get
+ * interleaved by chunks of up to 256 bytes;
+ * the socket is removed on n_rf24l01_close, returns -1 if failed */
+int n_rf24l01_serve( int fd, const char* path );
+
+#define N_RF24L01_DAEMON_SOCKET "/run/n_rf24l01.sock"
+
+/* connect to a daemon (n_rf24l01_serve), returns an fd to poll for POLLIN (data to read
+ * or a room to write) and to pass to other n_rf24l01_client_* calls, -1 if failed;
+ * a client mustn't read from/write to the fd directly */
+int n_rf24l01_connect( const char* path );
+
+/* take up to @num bytes of a received stream, doesn't block, returns an amount of bytes */
+int n_rf24l01_client_read( int fd, void* buf, unsigned int num );
+
+/* blocks till all data is queued to a daemon, returns @num, -1 if a daemon's gone */
+int n_rf24l01_client_write( int fd, const void* data, unsigned int num );
+
+/* an amount of received bytes a daemon has thrown away, as a client didn't keep up */
+unsigned int n_rf24l01_client_dropped( int fd );
+
+/* registers access serialized with the library's work (look at n_rf24l01_open_dbg) */
+int n_rf24l01_client_read_register( int fd, unsigned char reg_addr, unsigned long long* value );
+int n_rf24l01_client_write_register( int fd, unsigned char reg_addr, unsigned long long value );
+
+void n_rf24l01_disconnect( int fd );
+
 /* for internal reasons, a close() system call may be not
  * enough to deinitialize the library */
 void n_rf24l01_close( int fd );
@@ -20,8 +90,364 @@ void n_rf24l01_close( int fd );
  * */
 int n_rf24l01_open_dbg( void );
 
+/* number of RF channels n_rf24l01_scan reports an occupancy for */
+#define N_RF24L01_CHANNELS 126
+
+/* sweep all RF channels @sweeps times [1..255] and fill an @occupancy array of
+ * N_RF24L01_CHANNELS elements with an amount of sweeps a carrier was detected
+ * on each channel; @dwell_us - time to listen each channel (not less than 170us);
+ * incoming packets aren't received while the scan is in progress;
+ * returns -1 if failed */
+int n_rf24l01_scan( int fd, unsigned char* occupancy, unsigned int sweeps, unsigned int dwell_us );
+
+/* tune the transceiver to an RF channel [0..N_RF24L01_CHANNELS),
+ * returns -1 if failed */
+int n_rf24l01_tune( int fd, unsigned int channel );
+
+/* air data rates, 250kbps is supported by an nRF24L01+ only */
+#define N_RF24L01_RATE_1MBPS   0
+#define N_RF24L01_RATE_2MBPS   1
+#define N_RF24L01_RATE_250KBPS 2
+
+/* set an air data @rate (N_RF24L01_RATE_*), both sides have to use the same one,
+ * bonded radios get it all; returns -1 if failed */
+int n_rf24l01_set_rate( int fd, unsigned int rate );
+
+/* transmit powers */
+#define N_RF24L01_POWER_M18DBM 0  /* a default */
+#define N_RF24L01_POWER_M12DBM 1
+#define N_RF24L01_POWER_M6DBM  2
+#define N_RF24L01_POWER_0DBM   3
+
+/* set a transmit @power (N_RF24L01_POWER_*), bonded radios get it all; returns -1 if failed */
+int n_rf24l01_set_power( int fd, unsigned int power );
+
+/* enable a listen-before-talk check before each transmission: a carrier is sampled
+ * up to @attempts times with a random backoff [@backoff_us..2*@backoff_us] between samples;
+ * with a power saving, a transceiver which isn't a receiver listens for 170us before a first
+ * sample (plus 1.5ms to wake, if it's powered down); @attempts = 0 disables the check */
+void n_rf24l01_listen_before_talk( int fd, unsigned int attempts, unsigned int backoff_us );
+
+/* start frequency hopping over @num @channels (NULL - over all channels) in a pseudo-random
+ * order defined by @seed, both sides have to use the same @seed and @channels;
+ * @dwell_us - time to stay on each channel (> 1000us), 0 - hop after each package;
+ * one side has to be a @master, another one synchronizes to the master by received packages,
+ * so the master has to transmit something at least once per a hop cycle to keep the sync;
+ * returns -1 if failed */
+int n_rf24l01_hop( int fd, unsigned int seed, const unsigned char* channels, unsigned int num,
+                   unsigned int dwell_us, int master );
+
+/* stop frequency hopping, the transceiver stays on the current channel */
+void n_rf24l01_hop_stop( int fd );
+
+/* share a channel among a gateway and up to 62 nodes by time division, so they never
+ * transmit at once: the gateway splits time into frames of @slots slots [3..64] @slot_us long
+ * [1800..65535] and starts each frame with a beacon, nodes synchronize to beacons and
+ * transmit in their own slots only, the last slot is for nodes to ask the gateway for a slot;
+ * the gateway gets data of all nodes in one stream, a metadata mode (n_rf24l01_set_rx_metadata)
+ * tells which node each chunk came from, a node gets data of the gateway only; a node which
+ * has asked for a slot keeps it alive, the gateway frees a slot it hasn't heard for 32 frames;
+ * each package carries 30 bytes of user data, data waits for a slot in a queue, so a write
+ * may block for a frame; can't be used together with the ARQ, the FEC, hopping and a power saving;
+ * returns -1 if failed */
+int n_rf24l01_tdma_gateway( int fd, unsigned int slots, unsigned int slot_us );
+
+/* join the gateway's frames as a node with a @node_id [1..65535] unique within a network,
+ * @slot - a slot to transmit in [1..62], 0 - ask the gateway for a free one;
+ * returns -1 if failed */
+int n_rf24l01_tdma_node( int fd, unsigned int node_id, unsigned int slot );
+
+/* stop a time division, queued data is lost */
+void n_rf24l01_tdma_stop( int fd );
+
+/* save a battery: the transceiver stays a receiver for @rx_hold_us after it has sent or received
+ * something, then in standby-I for @standby_us, where a next transmission starts at once, and then
+ * it's powered down, where a next transmission waits 1.5ms more; a powered down node listens
+ * for @window_us [1..@period_us) every @period_us, peers have to transmit within a window
+ * to be heard, @period_us = 0 - no windows, a node is heard only after it has transmitted;
+ * time spent in each state is in n_rf24l01_get_stats; can't be used together with the TDMA
+ * and bonding; returns -1 if failed */
+int n_rf24l01_set_power_saving( int fd, unsigned int rx_hold_us, unsigned int standby_us,
+                                unsigned int period_us, unsigned int window_us );
+
+/* stop a power saving, the transceiver is a receiver all the time */
+void n_rf24l01_power_saving_stop( int fd );
+
+/* the mesh's addresses and limits, the same as the core's ones (the library checks it) */
+#define N_RF24L01_MESH_ADDRESSES 256
+#define N_RF24L01_MESH_BROADCAST 0xff
+#define N_RF24L01_MESH_MAX_RELAYS 7
+
+/* relay a byte stream over several hops: this node gets an address @addr [1..254] and
+ * data a user writes goes to a node @dst [1..254] (N_RF24L01_MESH_BROADCAST - to everyone),
+ * data of any node addressed to this one (or broadcast) is delivered to a user;
+ * packages addressed to other nodes this one is a next hop for are forwarded by the library
+ * (a user isn't involved), a next hop is taken from routes (n_rf24l01_mesh_route), a node
+ * without a route is assumed to be in a direct range; each package carries 23 bytes of user
+ * data and is forwarded up to N_RF24L01_MESH_MAX_RELAYS times; duplicates are suppressed
+ * (a restarted node isn't taken for one);
+ * can't be used together with the ARQ, the FEC, the TDMA and hopping;
+ * data delivered gets an address of a node it came from (n_rf24l01_rx_meta_t's source);
+ * @addr = 0 disables the mesh, returns -1 if failed */
+int n_rf24l01_set_mesh( int fd, unsigned int addr, unsigned int dst );
+
+/* route packages to @dst via a neighbour @next_hop, @dst = N_RF24L01_MESH_BROADCAST sets
+ * a default route, @next_hop = 0 removes a route, returns -1 if failed */
+int n_rf24l01_mesh_route( int fd, unsigned int dst, unsigned int next_hop );
+
+typedef struct
+{
+  unsigned int pkgs_sent;        /* originated by this node */
+  unsigned int pkgs_delivered;   /* addressed to this node or broadcast */
+  unsigned int pkgs_forwarded;
+  unsigned int pkgs_duplicated;  /* suppressed */
+  unsigned int pkgs_expired;     /* forwarded too many times already */
+  unsigned int pkgs_overheard;   /* transmitted to another next hop */
+
+  /* delivered packages by an amount of relays they came over */
+  unsigned int delivered_relays[N_RF24L01_MESH_MAX_RELAYS + 1];
+
+  /* packages transmitted to each next hop and received from each previous one, by addresses */
+  unsigned int hop_pkgs_sent[N_RF24L01_MESH_ADDRESSES];
+  unsigned int hop_pkgs_received[N_RF24L01_MESH_ADDRESSES];
+} n_rf24l01_mesh_report_t;
+
+/* get statistics of the mesh, returns -1 if failed (e.g. the mesh is disabled) */
+int n_rf24l01_get_mesh_stats( int fd, n_rf24l01_mesh_report_t* report );
+
+/* make a byte stream over the fd reliable by a selective-repeat ARQ with up to @window
+ * packages in flight [1..32], both sides have to enable it with the same @window before
+ * they start to exchange data; each package carries 27 bytes of user data; a side which
+ * restarts (or re-enables the ARQ) is met by the peer anew, data the peer has in flight is
+ * retransmitted then, data it has received from the previous side is dropped;
+ * @window = 0 disables the ARQ, data in flight is lost;
+ * returns -1 if failed */
+int n_rf24l01_set_reliable( int fd, unsigned int window );
+
+/* adapt a data rate and a transmit power of a link to a loss the ARQ sees: the fastest rate and
+ * then the lowest power which keep retransmissions under @target_loss percent [1..50] are picked;
+ * a change is agreed with a remote side in-band, and a side which loses a remote one looks for it
+ * over all settings; both sides have to enable it with the same @slowest_rate (N_RF24L01_RATE_*,
+ * a link starts at it with 0dBm and never goes slower) after the ARQ is enabled, re-enabling
+ * the ARQ disables it, as does n_rf24l01_close (a next open starts at 2Mbps with the lowest power);
+ * @target_loss = 0 disables it, the last setting stays; returns -1 if failed */
+int n_rf24l01_set_adaptation( int fd, unsigned int target_loss, unsigned int slowest_rate );
+
+/* protect a byte stream over the fd by a forward error correction, for links without
+ * acknowledges (e.g. a broadcast): each group of up to @k data packages [1..32] is followed
+ * by @m parity packages [1..16], so a group is recovered if any @k of its packages got through;
+ * each data package carries 27 bytes of user data; a receiver has to enable the FEC too,
+ * but it gets @k and @m from packages; the FEC can't be used together with the ARQ;
+ * @k = 0 disables the FEC;
+ * returns -1 if failed */
+int n_rf24l01_set_fec( int fd, unsigned int k, unsigned int m );
+
+/* compress each chunk of data a user writes to the fd as a separate frame (LZSS), before
+ * it gets split into packages, and decompress frames before they're delivered to a user;
+ * both sides have to enable it; as frames are compressed independently a lost frame
+ * doesn't affect others, but frames get lost as a whole (a lost package drops a frame it was
+ * a part of), so combine it with the ARQ or the FEC on lossy links; frames take a byte of each
+ * package's payload; @enable = 0 disables the compression */
+void n_rf24l01_set_compression( int fd, int enable );
+
+/* pack small chunks of data a user writes to the fd into full package payloads, each chunk
+ * as a length-prefixed frame (compressed, if the compression is on), so a receiver splits
+ * them again; a payload goes out when no next frame fits into it or @deadline_us after
+ * a first frame was packed into it, whichever comes first; a chunk which doesn't fit into
+ * an empty payload goes out as is; both sides have to enable it (a receiver may pass any
+ * @deadline_us); @deadline_us = 0 disables the coalescing */
+void n_rf24l01_set_coalescing( int fd, unsigned int deadline_us );
+
+/* a size of a queue received data waits for a user in, if a user doesn't keep up */
+#define N_RF24L01_RX_QUEUE_SIZE 16384
+
+/* what happens to received data if the queue is full */
+#define N_RF24L01_RX_DROP_NEWEST 0  /* data which doesn't fit is dropped, a default */
+#define N_RF24L01_RX_DROP_OLDEST 1  /* queued data is dropped to make a room */
+#define N_RF24L01_RX_BLOCK       2  /* the library's thread waits up to @timeout_ms for a user
+                                     * to take data (nothing is received or transmitted meanwhile),
+                                     * then a newest data is dropped */
+
+/* configure the queue between the library's thread and a user: a @policy and a @high_watermark
+ * (bytes) [1..N_RF24L01_RX_QUEUE_SIZE] an event fd (n_rf24l01_get_rx_queue_event_fd) is signaled
+ * at, a default is 3/4 of the queue; dropped data leaves a gap in a stream;
+ * returns -1 if failed */
+int n_rf24l01_set_rx_queue( int fd, int policy, unsigned int timeout_ms, unsigned int high_watermark );
+
+/* get an eventfd which becomes readable each time the queue reaches a high watermark (again
+ * after it has been drained below a half of it), a user reads it to reset it,
+ * it's closed on n_rf24l01_close, returns -1 if failed */
+int n_rf24l01_get_rx_queue_event_fd( int fd );
+
+/* a header received data is preceded by in a metadata mode, times are CLOCK_MONOTONIC */
+typedef struct n_rf24l01_rx_meta_t
+{
+  unsigned long long irq_ns;      /* the library noticed an interrupt of a package (sysfs gpio
+                                   * gives no time of an edge) */
+  unsigned long long read_ns;     /* the package was read out of the transceiver */
+  unsigned long long deliver_ns;  /* data was handed to the fd */
+  unsigned int length;            /* bytes of data after the header */
+  unsigned char pipe;             /* a pipe the package came over */
+  unsigned char slot;             /* the TDMA gateway: a slot of a node data came from */
+  unsigned short source;          /* the TDMA gateway: an id of a node data came from,
+                                   * 0 - the node has a static slot;
+                                   * the mesh: an address of a node data came from */
+} n_rf24l01_rx_meta_t;
+
+/* precede each chunk of received data written to the fd by a header (n_rf24l01_rx_meta_t),
+ * it describes a package whose reception made the chunk available (e.g. a last package of
+ * a compressed frame, or one which filled a gap for the ARQ), a chunk is up to 1024 bytes,
+ * more data made available at once comes as several records; the queue drops whole records
+ * then (a record a socket has started to take is never dropped); a daemon's clients
+ * get no headers; @enable = 0 disables it, returns -1 if failed */
+int n_rf24l01_set_rx_metadata( int fd, int enable );
+
+/* a latency histogram: buckets[0] - below 1us, buckets[i] - [2^(i-1)..2^i)us,
+ * the last bucket takes everything above */
+#define N_RF24L01_LATENCY_BUCKETS 16
+
+typedef struct n_rf24l01_latency_t
+{
+  unsigned long long count;
+  unsigned long long sum_ns;
+  unsigned long long max_ns;
+  unsigned int buckets[N_RF24L01_LATENCY_BUCKETS];
+} n_rf24l01_latency_t;
+
+/* where received data spends time on its way to a user */
+typedef struct n_rf24l01_latency_report_t
+{
+  n_rf24l01_latency_t irq_to_read;        /* SPI traffic and a thread's wakeup */
+  n_rf24l01_latency_t read_to_deliver;    /* protocol layers (reordering, holding, decompression) */
+  n_rf24l01_latency_t deliver_to_socket;  /* the queue for a slow user, in a metadata mode only */
+} n_rf24l01_latency_report_t;
+
+/* get a latency breakdown of received data, @reset - start to collect it anew,
+ * returns -1 if failed */
+int n_rf24l01_get_latency_report( int fd, n_rf24l01_latency_report_t* report, int reset );
+
+typedef struct
+{
+  /* a reliable byte stream (n_rf24l01_set_reliable) */
+  unsigned int arq_pkgs_sent;
+  unsigned int arq_pkgs_retransmitted;
+  unsigned int arq_pkgs_received;
+  unsigned int arq_pkgs_duplicated;
+  unsigned int arq_srtt_us;
+  unsigned int arq_rto_us;
+  unsigned int arq_resets;    /* the peer has restarted */
+
+  /* a link adaptation (n_rf24l01_set_adaptation), adapt_level - [0..5], from the most robust one,
+   * adapt_loss - a share of retransmissions in the last window, in percent */
+  unsigned int adapt_data_rate;
+  unsigned int adapt_level;
+  unsigned int adapt_loss;
+  unsigned int adapt_levels_up;
+  unsigned int adapt_levels_down;
+  unsigned int adapt_probes_failed;
+  unsigned int adapt_hunts;
+
+  /* a forward error correction (n_rf24l01_set_fec) */
+  unsigned int fec_pkgs_sent;
+  unsigned int fec_pkgs_received;
+  unsigned int fec_pkgs_recovered;
+  unsigned int fec_pkgs_lost;
+
+  /* a compression (n_rf24l01_set_compression),
+   * a compression ratio is lz_bytes_in / lz_bytes_out,
+   * a CPU cost per frame is lz_compress_ns / lz_frames_compressed */
+  unsigned long long lz_bytes_in;
+  unsigned long long lz_bytes_out;
+  unsigned long long lz_compress_ns;
+  unsigned long long lz_decompress_ns;
+  unsigned int lz_frames_compressed;
+  unsigned int lz_frames_decompressed;
+  unsigned int lz_frames_broken;
+
+  /* a coalescing (n_rf24l01_set_coalescing),
+   * a fill ratio of payloads is coalesce_bytes / coalesce_room,
+   * coalesce_records_bypassed - chunks which went out as is, as they fill a payload by themselves */
+  unsigned long long coalesce_records;
+  unsigned long long coalesce_bytes;
+  unsigned long long coalesce_room;
+  unsigned int coalesce_payloads;
+  unsigned int coalesce_full_flushes;
+  unsigned int coalesce_deadline_flushes;
+  unsigned int coalesce_records_bypassed;
+
+  /* a TUN interface (n_rf24l01_open_tun),
+   * tun_bytes_in/tun_bytes_out - datagrams' sizes before/after a header compression */
+  unsigned int tun_datagrams_sent;
+  unsigned int tun_datagrams_received;
+  unsigned int tun_datagrams_dropped;
+  unsigned int tun_pkgs_sent;
+  unsigned int tun_bytes_in;
+  unsigned int tun_bytes_out;
+
+  /* bonded transceivers (n_rf24l01_open_bonded),
+   * bond_link_weight - a share of traffic a radio gets, [8..256] */
+  unsigned int bond_pkgs_reordered;
+  unsigned int bond_pkgs_skipped;
+  unsigned int bond_pkgs_late;
+  unsigned int bond_link_weight[N_RF24L01_MAX_RADIOS];
+  unsigned int bond_link_pkgs_sent[N_RF24L01_MAX_RADIOS];
+  unsigned int bond_link_pkgs_received[N_RF24L01_MAX_RADIOS];
+
+  /* a time division (n_rf24l01_tdma_gateway/n_rf24l01_tdma_node),
+   * tdma_slot - an own slot, -1 - none yet, tdma_joins - join requests a node has sent
+   * or the gateway has accepted, tdma_leaves - slots the gateway has freed */
+  unsigned int tdma_synced;
+  int tdma_slot;
+  unsigned int tdma_beacons_sent;
+  unsigned int tdma_beacons_received;
+  unsigned int tdma_sync_losses;
+  unsigned int tdma_joins;
+  unsigned int tdma_pkgs_sent;
+  unsigned int tdma_pkgs_received;
+  unsigned int tdma_leaves;
+
+  /* an spi speed the backend has calibrated (of radio 0, if bonded), in Hz */
+  unsigned int spi_speed_hz;
+
+  /* how long the transceiver(s) took to be brought up when opened, in us,
+   * warm_start - 1 if they were found already powered up (e.g. by a previous run),
+   * a power-up delay and unchanged registers were skipped then; it doesn't include a wait
+   * for a first package, 'n_rf24l01_perf -c open' measures that */
+  unsigned int init_us;
+  unsigned int warm_start;
+
+  /* records of the library's log which were dropped, as they were logged faster than printed */
+  unsigned int log_records_dropped;
+
+  /* the queue between the library's thread and a user (n_rf24l01_set_rx_queue) */
+  unsigned int rx_queue_bytes;
+  unsigned int rx_queue_peak_bytes;
+  unsigned long long rx_queue_bytes_dropped;
+  unsigned int rx_queue_high_watermark_hits;
+
+  /* an io_uring (built with IO_URING), uring_active - 1 if the library's thread uses one,
+   * uring_spi_cmd - 1 if spi transfers go through one too (a spidev driver has to support it),
+   * uring_enters - io_uring_enter calls of the thread */
+  unsigned int uring_active;
+  unsigned int uring_spi_cmd;
+  unsigned long long uring_enters;
+
+  /* a power saving (n_rf24l01_set_power_saving), time the transceiver has spent in each state, in us,
+   * pm_wakes - wakes from a power down, pm_fast_wakes - from standby-I, pm_windows - listen windows */
+  unsigned long long pm_down_us;
+  unsigned long long pm_standby_us;
+  unsigned long long pm_rx_us;
+  unsigned long long pm_tx_us;
+  unsigned int pm_wakes;
+  unsigned int pm_fast_wakes;
+  unsigned int pm_windows;
+} n_rf24l01_stats_t;
+
+/* get statistics of the library, returns -1 if failed */
+int n_rf24l01_get_stats( int fd, n_rf24l01_stats_t* stats );
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif // N_RF24L01_H
+#endif // N_RF24L01_LINUX_H
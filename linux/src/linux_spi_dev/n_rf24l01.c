@@ -5,9 +5,12 @@
  *      Author: sergs (ivan0ivanov0@mail.ru)
  */
 
+#define _GNU_SOURCE /* ppoll, memfd_create, accept4 */
+
 #include "config.h"
 
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <poll.h>
 #include <unistd.h>
@@ -18,11 +21,98 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <errno.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/un.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+#include <stdatomic.h>
 
 #include "n_rf24l01_core.h"
+#include "core/n_rf24l01_hop.h"
+#include "core/n_rf24l01_arq.h"
+#include "core/n_rf24l01_fec.h"
+#include "core/n_rf24l01_lz.h"
+#include "core/n_rf24l01_lowpan.h"
+#include "core/n_rf24l01_bond.h"
+#include "core/n_rf24l01_tdma.h"
+#include "core/n_rf24l01_mesh.h"
+#include "core/n_rf24l01_adapt.h"
+#include "core/n_rf24l01_pm.h"
 #include "n_rf24l01_linux.h"
 #include "n_rf24l01_backend.h"
+#include "n_rf24l01_shm.h"
+#include "n_rf24l01_log.h"
+
+#ifdef IO_URING
+#include "n_rf24l01_uring.h"
+#endif
+
+
+/* an ARQ may retransmit a whole window and send new packages and an acknowledge
+ * between two flushes */
+#define TX_BATCH_SIZE ( 2 * N_RF24L01_ARQ_MAX_WINDOW + 2 )
+
+#define USER_BUFF_SIZE 256
+
+/* received data waits for a user in a queue of this size (a power of 2),
+ * if a user doesn't keep up with a remote side */
+#define RX_QUEUE_SIZE N_RF24L01_RX_QUEUE_SIZE
+#define RX_QUEUE_MASK ( RX_QUEUE_SIZE - 1 )
+#define RX_QUEUE_HIGH_WATERMARK ( RX_QUEUE_SIZE / 4 * 3 )
+
+/* how many processes may be served at once by a daemon */
+#define MAX_CLIENTS 8
+
+/* fds the library's thread waits on: a user's socket (or a tun device), interrupt line 0,
+ * a wakeup eventfd, interrupt lines of other bonded radios, then a daemon's listening socket
+ * and a connection and a doorbell of each client */
+#define SERVE_FDS ( 3 + N_RF24L01_MAX_RADIOS - 1 )
+#define POLL_FDS ( SERVE_FDS + 1 + 2 * MAX_CLIENTS )
 
+#ifdef IO_URING
+/* entries of a ring of the library's thread, enough for all polls and reads at once */
+#define URING_ENTRIES 64
+
+/* kinds of requests of the library's thread, a kind is in the upper byte of user_data,
+ * a poll also carries its slot (an index in events_fd) and a generation to tell a stale one */
+#define URING_POLL      1
+#define URING_SINK      2  /* nobody needs a result: a poll removal, a read of an eventfd */
+#define URING_USER_READ 3
+#define URING_LINE_READ 4
+#define URING_DATA( KIND, GEN, SLOT ) ( (uint64_t)(KIND) << 56 | (uint64_t)(GEN) << 8 | (SLOT) )
+#endif
+
+/* a bonding stripes a user's chunk (and a frame header) over links, plus reports */
+#define BOND_BATCH_SIZE 16
+
+/* the longest wait of the core which is a CE pulse, not a wait for a radio */
+#define CE_PULSE_US 10
+
+/* how often a logging thread drains records of other threads */
+#define LOG_DRAIN_PERIOD_US 100000
+
+/* a compressed frame header: 15 bits of a size and a 'compressed' flag in MSBit, LSByte first;
+ * a zero header is a padding till the end of a package */
+#define FRAME_HEADER_SIZE 2
+#define FRAME_COMPRESSED 0x8000
+
+/* a payload of a package of frames starts with a unit byte: FRAME_UNIT_START if a frame starts
+ * right after it, and a counter of such packages, so a receiver notices a lost package and drops
+ * a frame it was a part of instead of misparsing the stream after it */
+#define FRAME_UNIT_START 0x80
+#define FRAME_UNIT_SEQ 0x7f
+
+/* a client of a daemon (n_rf24l01_serve) */
+typedef struct
+{
+  int sock_fd;      /* a connection to notice the client is gone, -1 - a free slot */
+  int daemon_bell;  /* an eventfd the client rings */
+  int client_bell;  /* an eventfd a daemon rings */
+  n_rf24l01_shm_t* shm;
+} n_rf24l01_client_t;
 
 typedef struct
 {
@@ -34,226 +124,3048 @@ typedef struct
    * as with files */
   int interrupt_line_fd;
 
+  /* the library's thread quits, once it's woken up with n_rf_thread_stop set */
   pthread_t n_rf_thread;
+  int n_rf_thread_running;
+  _Atomic int n_rf_thread_stop;
+
+  /* formats and prints records a library's thread logs, to keep stdio off hot paths */
+  pthread_t log_thread;
+  int log_thread_running;
+  _Atomic int log_thread_stop;
+
+  /* the library's core isn't thread-safe, but it's used both by a library's thread
+   * and by a user (e.g. n_rf24l01_scan) */
+  pthread_mutex_t core_lock;
+
+  /* to wake a library's thread up if a user changes something the thread depends on */
+  int wakeup_fd;
+
+  /* a TUN device, if the library is opened by n_rf24l01_open_tun,
+   * it's used instead of sockets_pair */
+  int tun_fd;
+  n_rf24l01_lowpan_t lowpan;
+
+  /* bonded transceivers (n_rf24l01_open_bonded), each of them has its own core instance,
+   * radio_interrupt_fds[0] is the same as interrupt_line_fd */
+  int bonded;
+  n_rf24l01_bond_t bond;
+  u_int radios_num;
+  u_int radio;    /* a radio the core and the backend are switched to */
+  n_rf24l01_instance_t radios[N_RF24L01_MAX_RADIOS];
+  int radio_interrupt_fds[N_RF24L01_MAX_RADIOS];
+
+  /* to load all radios with packages in turn and let them transmit simultaneously,
+   * sleeps the core asks for are turned into deadlines to not touch a radio before */
+  int defer_sleep;
+  uint64_t radio_busy_until[N_RF24L01_MAX_RADIOS];
+  u_char bond_batch[N_RF24L01_MAX_RADIOS][BOND_BATCH_SIZE][N_RF24L01_PKG_SIZE];
+  int bond_batch_count[N_RF24L01_MAX_RADIOS];
+
+  /* a daemon mode (n_rf24l01_serve), clients are handled by a library's thread only */
+  int listen_fd;
+  char listen_path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+  n_rf24l01_client_t clients[MAX_CLIENTS];
+
+  /* a user learns about a queue of received data getting full through it */
+  int rx_queue_event_fd;
+
+  /* how long it took to bring transceivers up, and whether they were found
+   * already powered up and configured (a warm start) */
+  uint64_t init_us;
+  int warm_start;
+
+#ifdef IO_URING
+  /* the library's thread waits for events, reads eventfds and interrupt lines and takes
+   * a user's data through an io_uring, if a kernel has one; polls stay armed between waits,
+   * uring_armed[slot] - events a poll of events_fd[slot] is armed for, 0 - none,
+   * uring_revents[slot] - a poll has fired, but a wait hasn't reported it yet */
+  int uring_active;
+  n_rf24l01_uring_t uring;
+  short uring_armed[POLL_FDS];
+  int uring_armed_fd[POLL_FDS];
+  uint32_t uring_gen[POLL_FDS];
+  short uring_revents[POLL_FDS];
+  u_int uring_line_reads;   /* reads of interrupt lines in flight */
+  uint64_t uring_sink;
+
+  /* a read of a user's data is kept in flight, uring_user_read - its size, 0 - none,
+   * uring_user_eof - a user has closed a socket, nothing to read anymore;
+   * protocol layers may take less than has been read, as their room may have shrunk since
+   * the read was sized, the rest (uring_user_tail_len bytes at uring_user_tail_pos of the buffer)
+   * goes before a next read */
+  int uring_user_read;
+  int uring_user_read_done;
+  int uring_user_read_res;
+  int uring_user_eof;
+  int uring_user_tail_pos;
+  int uring_user_tail_len;
+  char uring_user_buff[USER_BUFF_SIZE];
+#endif
+
+  /* everything from here on is a session's: protocol layers a user has turned on, settings
+   * and statistics; n_rf24l01_close zeroes it as a whole (_reset_session), so a next open
+   * starts with a raw link; protected by core_lock */
+  int hopping;
+  n_rf24l01_hop_t hop;
+
+  int reliable;
+  n_rf24l01_arq_t arq;
+
+  /* a data rate and a transmit power follow a loss the ARQ sees, adapt_data_rate - the current rate */
+  int adapt_enabled;
+  n_rf24l01_adapt_t adapt;
+  u_char adapt_data_rate;
+
+  /* either an ARQ or an FEC may be used, not both */
+  int fec_enabled;
+  n_rf24l01_fec_t fec;
+
+  /* a time-division access to a channel shared by several nodes, packages wait
+   * for a slot in the TDMA's queue */
+  int tdma_enabled;
+  n_rf24l01_tdma_t tdma;
+
+  /* the transceiver is a receiver only after traffic and in listen windows, it's in standby-I
+   * or powered down otherwise, a transmission wakes it up from whatever state */
+  int pm_enabled;
+  n_rf24l01_pm_t pm;
+
+  /* a multi-hop forwarding, a user's data goes to mesh_dst, packages to relay get
+   * forwarded from within a bottom half and go out in one TX batch */
+  int mesh_enabled;
+  u_char mesh_dst;
+  n_rf24l01_mesh_t mesh;
+
+  /* received data a user hasn't taken yet, positions are free-running,
+   * rx_queue_above - a fill level has reached a high watermark and hasn't dropped
+   * below a half of it since */
+  u_char rx_queue[RX_QUEUE_SIZE];
+  u_int rx_queue_head;
+  u_int rx_queue_tail;
+  int rx_queue_policy;
+  u_int rx_queue_timeout_ms;
+  u_int rx_queue_high_watermark;
+  int rx_queue_above;
+  int rx_queue_stalled;   /* a wait has timed out, don't wait till a user takes something */
+  u_int rx_queue_boundary; /* in a metadata mode, a start of the oldest record a socket hasn't
+                            * started to take */
+  u_int rx_queue_peak;
+  unsigned long long rx_queue_bytes_dropped;
+  u_int rx_queue_high_watermark_hits;
+
+  /* a package being handled: when an interrupt was noticed, when the package was read,
+   * a pipe it came over and a sender a protocol layer has told of, in a metadata mode
+   * (n_rf24l01_set_rx_metadata) they precede data */
+  int rx_metadata;
+  uint64_t irq_ns;
+  uint64_t read_ns;
+  u_char rx_pipe;
+  u_char rx_slot;
+  uint16_t rx_source;
+  n_rf24l01_latency_report_t latency;
+
+  int compression;
+  n_rf24l01_lz_t lz;
+  u_char rx_frame[FRAME_HEADER_SIZE + N_RF24L01_LZ_MAX_FRAME];
+  u_int rx_frame_len;
+  u_char rx_unit_seq;   /* a counter a next package of frames has to carry */
+  u_char tx_unit_seq;
+  uint64_t lz_bytes_in;
+  uint64_t lz_bytes_out;
+  uint64_t lz_compress_ns;
+  uint64_t lz_decompress_ns;
+  u_int lz_frames_compressed;
+  u_int lz_frames_decompressed;
+  u_int lz_frames_broken;
+
+  /* small chunks of a user's data are packed as frames into one package's payload, which
+   * goes out when it's full or at coalesce_deadline_us, coalesce_us = 0 - no coalescing */
+  u_int coalesce_us;
+  u_char coalesce_buff[N_RF24L01_PKG_SIZE];
+  u_int coalesce_len;
+  uint64_t coalesce_deadline_us;
+  unsigned long long coalesce_records;
+  unsigned long long coalesce_bytes;
+  unsigned long long coalesce_room;
+  u_int coalesce_payloads;
+  u_int coalesce_full_flushes;
+  u_int coalesce_deadline_flushes;
+  u_int coalesce_records_bypassed;
+
+  /* packages a protocol layer (e.g. ARQ) has produced, they get transmitted
+   * at once to not switch the transceiver between RX and TX for each of them */
+  u_char tx_batch[TX_BATCH_SIZE][N_RF24L01_PKG_SIZE];
+  int tx_batch_count;
 } n_rf24l01_t;
 
 
-static n_rf24l01_t n_rf24l01 = {{-1, -1}, -1};
+static n_rf24l01_t n_rf24l01 = {{-1, -1}, -1, .core_lock = PTHREAD_MUTEX_INITIALIZER, .wakeup_fd = -1, .tun_fd = -1,
+                                 .listen_fd = -1, .clients = { [0 ... MAX_CLIENTS - 1] = { .sock_fd = -1 } },
+                                 .rx_queue_high_watermark = RX_QUEUE_HIGH_WATERMARK, .rx_queue_event_fd = -1 };
 
 
-static void _stop_n_rf24l01_library()
+static uint64_t _get_cpu_time_ns( void )
 {
-  close( n_rf24l01.sockets_pair[0] );
-  close( n_rf24l01.sockets_pair[1] );
+  struct timespec ts;
 
-  pthread_cancel( n_rf24l01.n_rf_thread );
+  clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
 
-  deinit_n_rf24l01_backend();
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
 }
 
-static void _data_from_user()
+static uint64_t _get_time_ns( void )
 {
-  char buff[256];
-  int ret;
+  struct timespec ts;
 
-  ret = read( n_rf24l01.sockets_pair[1], buff, sizeof(buff) );
-  if( ret < 0 )
-    return;
+  clock_gettime( CLOCK_MONOTONIC, &ts );
 
-  printf( "some data from user.\n" );
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
 
-  n_rf24l01_prepare_to_transmit();
-  n_rf24l01_transmit_pkgs( buff, ret );
-  n_rf24l01_prepare_to_receive();
+static uint64_t _get_time_us( void )
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
-/* gets called if the library's core (and the transceiver) received some data from a remote side */
-static void _handle_received_data( const void* data, u_int num )
+static void _wakeup_n_rf_thread( void )
 {
-  int count_to_write, current_offset;
-  int ret;
+  uint64_t value = 1;
+
+  write( n_rf24l01.wakeup_fd, &value, sizeof(value) );
+}
 
-  count_to_write = num;
-  current_offset = 0;
 
-  while( 1 )
+static void _ring_bell( int bell_fd )
+{
+  uint64_t value = 1;
+
+  write( bell_fd, &value, sizeof(value) );
+}
+
+static int _is_uring_active( void )
+{
+#ifdef IO_URING
+  return n_rf24l01.uring_active;
+#else
+  return 0;
+#endif
+}
+
+#ifdef IO_URING
+static void _uring_complete( const struct io_uring_cqe* cqe )
+{
+  u_int kind = cqe->user_data >> 56;
+  u_int slot = cqe->user_data & 0xff;
+  uint32_t gen = cqe->user_data >> 8;
+
+  switch( kind )
   {
-    /* try to write up to count_to_write bytes  */
-    ret = write( n_rf24l01.sockets_pair[1], data + current_offset, count_to_write );
+    case URING_POLL:
+      /* a poll which has been removed may still complete */
+      if( gen != n_rf24l01.uring_gen[slot] || !n_rf24l01.uring_armed[slot] )
+        break;
 
-    if( ret < 0 && errno == EINTR )
-      continue;
+      n_rf24l01.uring_armed[slot] = 0;
+      n_rf24l01.uring_revents[slot] = cqe->res < 0 ? POLLERR : cqe->res;
+      break;
 
-    /* keep on till all data is written */
-    if( ret < 0 && errno == EWOULDBLOCK )
-      continue;
+    case URING_USER_READ:
+      n_rf24l01.uring_user_read_done = 1;
+      n_rf24l01.uring_user_read_res = cqe->res;
+      break;
 
-    if( ret < 0 )
+    case URING_LINE_READ:
+      if( n_rf24l01.uring_line_reads )
+        n_rf24l01.uring_line_reads--;
+      break;
+  }
+}
+
+static void _uring_reap( void )
+{
+  struct io_uring_cqe* cqe;
+
+  while( ( cqe = n_rf24l01_uring_peek_cqe( &n_rf24l01.uring ) ) )
+  {
+    _uring_complete( cqe );
+    n_rf24l01_uring_cqe_seen( &n_rf24l01.uring );
+  }
+}
+
+/* a ppoll through the ring: a poll is armed again only if it has fired or its fd or events
+ * have changed, so fds which stay quiet cost nothing, and requests queued since a last call
+ * go with the same io_uring_enter as the wait;
+ * Note: a poll keeps a file it's armed on, so an fd which gets closed has to be passed as -1
+ *       at least once before its number may come back in the same slot */
+static int _uring_poll( struct pollfd* fds, u_int num, const struct timespec* timeout )
+{
+  struct io_uring_sqe* sqe;
+  u_int slot;
+  short events;
+  int ret, count = 0, pending = n_rf24l01.uring_user_read_done;
+
+  for( slot = 0; slot < num; slot++ )
+  {
+    events = fds[slot].fd >= 0 ? fds[slot].events : 0;
+
+    if( n_rf24l01.uring_armed_fd[slot] != fds[slot].fd )
+      n_rf24l01.uring_revents[slot] = 0;
+
+    n_rf24l01.uring_revents[slot] &= events | POLLERR | POLLHUP | POLLNVAL;
+
+    if( n_rf24l01.uring_armed[slot] && ( n_rf24l01.uring_armed_fd[slot] != fds[slot].fd ||
+                                         n_rf24l01.uring_armed[slot] != events ) )
     {
-      char error_buf[256];
-      int err = errno;
+      sqe = n_rf24l01_uring_get_sqe( &n_rf24l01.uring );
+      if( sqe )
+      {
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->addr = URING_DATA( URING_POLL, n_rf24l01.uring_gen[slot], slot );
+        sqe->user_data = URING_DATA( URING_SINK, 0, 0 );
+      }
 
-      strerror_r( err, error_buf, sizeof(error_buf) );
+      /* if the removal can't be queued, a generation tells a completion is stale */
+      n_rf24l01.uring_armed[slot] = 0;
+    }
 
-      printf( "_handle_received_data: fail to write to a socket: %s.\n", error_buf );
-      return;
+    if( n_rf24l01.uring_revents[slot] )
+      pending = 1;
+    else if( !n_rf24l01.uring_armed[slot] && events )
+    {
+      sqe = n_rf24l01_uring_get_sqe( &n_rf24l01.uring );
+      if( !sqe )
+        return -1;
+
+      sqe->opcode = IORING_OP_POLL_ADD;
+      sqe->fd = fds[slot].fd;
+      sqe->poll32_events = events;
+      sqe->user_data = URING_DATA( URING_POLL, ++n_rf24l01.uring_gen[slot], slot );
+
+      n_rf24l01.uring_armed[slot] = events;
+      n_rf24l01.uring_armed_fd[slot] = fds[slot].fd;
     }
+  }
 
-    count_to_write -= ret;
-    current_offset += ret;
+  /* what has completed since a last call is reported at once; the thread is stopped
+   * by a flag and a wakeup (a poll of wakeup_fd completes), not canceled in the wait */
+  if( pending )
+    ret = n_rf24l01.uring.to_submit ? n_rf24l01_uring_submit( &n_rf24l01.uring, 0, NULL ) : 0;
+  else
+    ret = n_rf24l01_uring_submit( &n_rf24l01.uring, 1, timeout );
 
-    /* no more data to write */
-    if( count_to_write == 0 )
-      break;
+  _uring_reap();
+
+  if( ret < 0 && ret != -ETIME )
+  {
+    errno = -ret;
+    return -1;
+  }
+
+  for( slot = 0; slot < num; slot++ )
+  {
+    fds[slot].revents = n_rf24l01.uring_revents[slot];
+    n_rf24l01.uring_revents[slot] = 0;
+
+    if( fds[slot].revents )
+      count++;
   }
+
+  return count;
 }
+#endif
 
-static void _interrupt_on_n_rf24l01_device()
+/* wait for events of the library's thread */
+static int _wait_events( struct pollfd* fds, u_int num, const struct timespec* timeout )
 {
-  static int first_interrupt = 1;
-  char buff[1]; /* "value" ... reads as either 0 (low) or 1 (high). */
+#ifdef IO_URING
+  if( n_rf24l01.uring_active )
+    return _uring_poll( fds, num, timeout );
+#endif
 
-  /* Linux SYSFS GPIO API requires such operations to be performed;
-   * Note: actually we don't need to know the exact value on an
-   *       interrupt line, only the fact that an interrupt happened */
-  lseek( n_rf24l01.interrupt_line_fd, 0, SEEK_SET );
-  read( n_rf24l01.interrupt_line_fd, buff, sizeof(buff) );
+  return ppoll( fds, num, timeout, NULL );
+}
 
-  printf( "got an interrupt on an n_rf24l01 device.\n" );
+/* take a counter of an eventfd to rearm it, through the ring a read goes with a next wait */
+static void _read_eventfd( int fd )
+{
+  uint64_t value;
 
-  /* for some reason there's a fake interrupt at the beginning,
-   * so just skip it */
-  if( first_interrupt )
+#ifdef IO_URING
+  struct io_uring_sqe* sqe;
+
+  if( n_rf24l01.uring_active && ( sqe = n_rf24l01_uring_get_sqe( &n_rf24l01.uring ) ) )
   {
-    first_interrupt = 0;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uintptr_t)&n_rf24l01.uring_sink;
+    sqe->len = sizeof(n_rf24l01.uring_sink);
+    sqe->user_data = URING_DATA( URING_SINK, 0, 0 );
     return;
   }
+#endif
 
-  /* let library's core to do it work */
-  n_rf24l01_upper_half_irq();
-  n_rf24l01_bottom_half_irq();
+  read( fd, &value, sizeof(value) );
 }
 
-static void* _n_rf_thread( void* data )
+static void _drop_client( n_rf24l01_client_t* client )
 {
-  struct pollfd events_fd[2];
+  munmap( client->shm, sizeof(n_rf24l01_shm_t) );
 
-  events_fd[0].events = POLLIN;
-  events_fd[0].fd = n_rf24l01.sockets_pair[1];
+  close( client->sock_fd );
+  close( client->daemon_bell );
+  close( client->client_bell );
 
-  /* Linux SYSFS GPIO API requires to set POLLPRI and POLLERR
-   * as events to wait for */
-  events_fd[1].events = POLLPRI | POLLERR;
-  events_fd[1].fd = n_rf24l01.interrupt_line_fd;
+  client->sock_fd = -1;
+}
 
-  printf( "_n_rf_thread: wait for events...\n" );
+static void _stop_serving( void )
+{
+  int i;
 
-  while( 1 )
-  {
-    int ret;
+  if( n_rf24l01.listen_fd < 0 )
+    return;
 
-    ret = poll( events_fd, sizeof(events_fd) / sizeof(struct pollfd), -1 );
-    if( ret < 0 && errno == EINTR )
-      continue;
+  for( i = 0; i < MAX_CLIENTS; i++ )
+    if( n_rf24l01.clients[i].sock_fd >= 0 )
+      _drop_client( &n_rf24l01.clients[i] );
 
-    if( ret < 0 )
+  close( n_rf24l01.listen_fd );
+  n_rf24l01.listen_fd = -1;
+
+  unlink( n_rf24l01.listen_path );
+}
+
+/* protocol layers, a received data queue, settings and statistics go away with a library,
+ * a next open starts with a raw link (e.g. the transceiver is at 2Mbps after n_rf24l01_init,
+ * whatever level an adaptation has been at) */
+static void _reset_session( void )
+{
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  memset( &n_rf24l01.hopping, 0, sizeof(n_rf24l01) - offsetof( n_rf24l01_t, hopping ) );
+  n_rf24l01.rx_queue_high_watermark = RX_QUEUE_HIGH_WATERMARK;
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+
+static void _stop_n_rf24l01_library()
+{
+  /* the thread uses everything below (clients' shared memory, fds, the backend), so it goes first;
+   * the thread stops the library itself on an error and returns right after, it's just detached then */
+  if( n_rf24l01.n_rf_thread_running )
+  {
+    if( pthread_equal( pthread_self(), n_rf24l01.n_rf_thread ) )
+      pthread_detach( n_rf24l01.n_rf_thread );
+    else
     {
-      _stop_n_rf24l01_library();
-      return NULL;  /* implicitly call ptread_exit( NULL ) */
+      atomic_store( &n_rf24l01.n_rf_thread_stop, 1 );
+      _wakeup_n_rf_thread();
+      pthread_join( n_rf24l01.n_rf_thread, NULL );
     }
 
-    if( events_fd[0].revents == POLLIN )
-      _data_from_user();
+    n_rf24l01.n_rf_thread_running = 0;
+  }
 
-    /* it's not enough clear what type of event Linux SYSFS GPIO provides in case of
-     * an interrupt on a line, so handle only a POLLPRI | POLLERR combination */
-    if( events_fd[1].revents == (POLLPRI | POLLERR) )
-      _interrupt_on_n_rf24l01_device();
+#ifdef IO_URING
+  if( n_rf24l01.uring_active )
+  {
+    n_rf24l01_uring_exit( &n_rf24l01.uring );
+    n_rf24l01.uring_active = 0;
+  }
+#endif
+
+  _stop_serving();
+
+  /* the logging thread prints what's left before it quits */
+  if( n_rf24l01.log_thread_running )
+  {
+    atomic_store( &n_rf24l01.log_thread_stop, 1 );
+    pthread_join( n_rf24l01.log_thread, NULL );
+    n_rf24l01.log_thread_running = 0;
   }
+
+  close( n_rf24l01.sockets_pair[0] );
+  close( n_rf24l01.sockets_pair[1] );
+  n_rf24l01.sockets_pair[0] = n_rf24l01.sockets_pair[1] = -1;
+
+  close( n_rf24l01.wakeup_fd );
+  n_rf24l01.wakeup_fd = -1;
+
+  close( n_rf24l01.rx_queue_event_fd );
+  n_rf24l01.rx_queue_event_fd = -1;
+
+  close( n_rf24l01.tun_fd );
+  n_rf24l01.tun_fd = -1;
+
+  n_rf24l01.bonded = 0;
+  n_rf24l01.radios_num = 0;
+  n_rf24l01_select( NULL );
+
+  _reset_session();
+
+  deinit_n_rf24l01_backend();
 }
 
-static int _init_n_rf24l01_backend( void )
+/* transmit package by package, as either each package is on its own channel
+ * or a package mustn't cross a slot boundary */
+static void _transmit_hopping( const char* data, int num )
 {
-  n_rf24l01_backend_t backend;
-  int ret;
+  uint32_t delay;
+  int offset, size;
 
-  ret = init_n_rf24l01_backend();
-  if( ret < 0 )
-    return -1;
+  for( offset = 0; offset < num; offset += N_RF24L01_PKG_SIZE )
+  {
+    delay = n_rf24l01_hop_tx_delay( &n_rf24l01.hop, _get_time_us() );
+    if( delay )
+      usleep( delay );
 
-  backend.set_up_ce_pin = set_up_ce_pin;
-  backend.send_cmd = send_cmd;
-  backend.usleep = usleep_;
-  backend.handle_received_data = _handle_received_data;
+    n_rf24l01_hop_tick( &n_rf24l01.hop, _get_time_us() );
 
-  ret = n_rf24l01_init( &backend );
-  if( ret < 0 )
-    return -1;
+    size = num - offset < N_RF24L01_PKG_SIZE ? num - offset : N_RF24L01_PKG_SIZE;
+    n_rf24l01_transmit_pkgs( data + offset, size );
 
-  /* by default a transceiver is in a receive mode,
-   * waiting for incoming data */
-  n_rf24l01_prepare_to_receive();
+    n_rf24l01_hop_on_tx( &n_rf24l01.hop );
+  }
+}
 
-  return 0;
+/* transmit data, the transceiver is a receiver after the call, unless a power management
+ * decides otherwise */
+static void _transmit( const void* data, int num )
+{
+  uint64_t start = n_rf24l01.pm_enabled ? _get_time_us() : 0;
+
+  n_rf24l01_prepare_to_transmit();
+
+  if( n_rf24l01.hopping )
+    _transmit_hopping( data, num );
+  else
+    n_rf24l01_transmit_pkgs( data, num );
+
+  if( n_rf24l01.pm_enabled )
+    n_rf24l01_pm_on_tx( &n_rf24l01.pm, start, _get_time_us() );
+  else
+    n_rf24l01_prepare_to_receive();
 }
 
+static void _flush_tx_batch( void )
+{
+  if( !n_rf24l01.tx_batch_count )
+    return;
 
-/* Public API */
+  _transmit( n_rf24l01.tx_batch, n_rf24l01.tx_batch_count * N_RF24L01_PKG_SIZE );
+  n_rf24l01.tx_batch_count = 0;
+}
 
+/* a protocol layer's cb to transmit a package, must be followed by _flush_tx_batch;
+ * Note: it may be called from within the core's handle_received_data cb, it's safe to
+ *       transmit there, as the core is done with a received package by then */
+static void _queue_pkg( void* ctx, const u_char* pkg )
+{
+  if( n_rf24l01.tx_batch_count == TX_BATCH_SIZE )
+    _flush_tx_batch();
 
-int n_rf24l01_open( void )
+  memcpy( n_rf24l01.tx_batch[n_rf24l01.tx_batch_count++], pkg, N_RF24L01_PKG_SIZE );
+}
+
+/* an adaptation's cb to set a data rate and a transmit power, queued packages go out
+ * with a previous setting, as a peer switches only after it has received them */
+static void _apply_level( void* ctx, u_char data_rate, u_char tx_power )
 {
-  int ret;
+  _flush_tx_batch();
 
-  ret = _init_n_rf24l01_backend();
-  if( ret < 0 )
-    return -1;
+  /* an RTT at another rate tells nothing */
+  if( data_rate != n_rf24l01.adapt_data_rate && n_rf24l01.reliable )
+    n_rf24l01_arq_restart_rtt( &n_rf24l01.arq );
 
-  n_rf24l01.interrupt_line_fd = get_n_rf24l01_interrupt_line_fd();
-  if( n_rf24l01.interrupt_line_fd < 0 )
-  {
-    _stop_n_rf24l01_library();
-    return -1;
-  }
+  n_rf24l01_set_data_rate( data_rate );
+  n_rf24l01_set_tx_power( tx_power );
 
-  printf( "an n_rf24l01 backend was successfully prepared to use.\n" );
+  n_rf24l01.adapt_data_rate = data_rate;
+}
 
-  ret = socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, n_rf24l01.sockets_pair );
-  if( ret < 0 )
+/* a power management's cb to put the transceiver to a @state */
+static void _apply_pm_state( void* ctx, n_rf24l01_pm_state_t state )
+{
+  if( state == N_RF24L01_PM_RX )
+    n_rf24l01_prepare_to_receive();
+  else if( state == N_RF24L01_PM_STANDBY )
+    n_rf24l01_standby();
+  else
+    n_rf24l01_power_down();
+}
+
+/* switch the core and the backend to a @radio */
+static void _select_radio( u_int radio )
+{
+  n_rf24l01.radio = radio;
+
+  select_n_rf24l01_backend_radio( radio );
+  n_rf24l01_select( &n_rf24l01.radios[radio] );
+}
+
+/* a usleep cb for bonded radios: a CE pulse (10us) has to be held for real, longer waits are
+ * for a radio to settle and to send a package on its own, they are deferred while radios
+ * are loaded in turn */
+static void _usleep_radio( u_int delay_mks )
+{
+  if( n_rf24l01.defer_sleep && delay_mks > CE_PULSE_US )
+    n_rf24l01.radio_busy_until[n_rf24l01.radio] = _get_time_us() + delay_mks;
+  else
+    usleep( delay_mks );
+}
+
+/* wait till a selected radio is done with what it was asked for */
+static void _wait_radio( void )
+{
+  uint64_t now = _get_time_us();
+
+  if( n_rf24l01.radio_busy_until[n_rf24l01.radio] > now )
+    usleep( n_rf24l01.radio_busy_until[n_rf24l01.radio] - now );
+}
+
+/* transmit packages a bonding has produced, all radios transmit simultaneously */
+static void _flush_bond_batches( void )
+{
+  int i, max_count = 0;
+  u_int radio;
+
+  for( radio = 0; radio < n_rf24l01.radios_num; radio++ )
   {
-    _stop_n_rf24l01_library();
-    return -1;
+    if( !n_rf24l01.bond_batch_count[radio] )
+      continue;
+
+    if( n_rf24l01.bond_batch_count[radio] > max_count )
+      max_count = n_rf24l01.bond_batch_count[radio];
+
+    _select_radio( radio );
+    n_rf24l01_prepare_to_transmit();
   }
 
-  ret = pthread_create( &n_rf24l01.n_rf_thread, NULL, _n_rf_thread, NULL );
-  if( ret < 0 )
+  n_rf24l01.defer_sleep = 1;
+
+  for( i = 0; i < max_count; i++ )
+    for( radio = 0; radio < n_rf24l01.radios_num; radio++ )
+    {
+      if( i >= n_rf24l01.bond_batch_count[radio] )
+        continue;
+
+      _select_radio( radio );
+      _wait_radio();
+      n_rf24l01_transmit_pkgs( n_rf24l01.bond_batch[radio][i], N_RF24L01_PKG_SIZE );
+    }
+
+  n_rf24l01.defer_sleep = 0;
+
+  for( radio = 0; radio < n_rf24l01.radios_num; radio++ )
   {
-    _stop_n_rf24l01_library();
-    return -1;
-  }
+    if( !n_rf24l01.bond_batch_count[radio] )
+      continue;
 
-  /* return NO duplicate to be able to somehow notice a user that we have some problem
-   * (in case of a some insoluble error we just close the sockets) */
-  return n_rf24l01.sockets_pair[0];
+    _select_radio( radio );
+    _wait_radio();
+    n_rf24l01_prepare_to_receive();
+
+    n_rf24l01.bond_batch_count[radio] = 0;
+  }
 }
 
-void n_rf24l01_close( int fd )
+/* a bonding's cb to transmit a package over a @link (a radio), must be followed by _flush_bond_batches */
+static void _queue_bond_pkg( void* ctx, u_int link, const u_char* pkg )
 {
-  _stop_n_rf24l01_library();
+  if( n_rf24l01.bond_batch_count[link] == BOND_BATCH_SIZE )
+    _flush_bond_batches();
+
+  memcpy( n_rf24l01.bond_batch[link][n_rf24l01.bond_batch_count[link]++], pkg, N_RF24L01_PKG_SIZE );
 }
 
-int n_rf24l01_open_dbg( void )
+/* put data received from a remote side to each client's ring, a client which doesn't
+ * keep up loses data, as a transceiver can't wait for it */
+static void _deliver_to_clients( const void* data, u_int num )
 {
-  n_rf24l01_backend_t backend;
-  int ret;
+  n_rf24l01_client_t* client;
+  u_int count;
+  int i;
 
-  memset( &backend, 0, sizeof(backend) );
+  for( i = 0; i < MAX_CLIENTS; i++ )
+  {
+    client = &n_rf24l01.clients[i];
+    if( client->sock_fd < 0 )
+      continue;
 
-  ret = init_n_rf24l01_backend();
+    count = n_rf24l01_shm_ring_write( &client->shm->to_client, data, num );
+    if( count < num )
+      atomic_fetch_add_explicit( &client->shm->to_client_dropped, num - count, memory_order_relaxed );
+
+    _ring_bell( client->client_bell );
+  }
+}
+
+/* account a latency of a stage in a histogram */
+static void _account_latency( n_rf24l01_latency_t* latency, uint64_t ns )
+{
+  u_int bucket = 0;
+  uint64_t us = ns / 1000;
+
+  while( us && bucket < N_RF24L01_LATENCY_BUCKETS - 1 )
+  {
+    us >>= 1;
+    bucket++;
+  }
+
+  latency->count++;
+  latency->sum_ns += ns;
+  latency->buckets[bucket]++;
+
+  if( ns > latency->max_ns )
+    latency->max_ns = ns;
+}
+
+/* copy @num bytes out of the queue from a free-running position @pos */
+static void _peek_rx_queue( u_int pos, void* buf, u_int num )
+{
+  u_int count;
+
+  pos &= RX_QUEUE_MASK;
+  count = RX_QUEUE_SIZE - pos < num ? RX_QUEUE_SIZE - pos : num;
+
+  memcpy( buf, n_rf24l01.rx_queue + pos, count );
+  memcpy( (u_char*)buf + count, n_rf24l01.rx_queue, num - count );
+}
+
+/* in a metadata mode move rx_queue_boundary over records a socket has started to take;
+ * it has to be done right after the socket takes something, as taken bytes are free to be
+ * overwritten by next records */
+static void _pass_taken_records( void )
+{
+  n_rf24l01_rx_meta_t meta;
+
+  while( (int)( n_rf24l01.rx_queue_tail - n_rf24l01.rx_queue_boundary ) > 0 )
+  {
+    _peek_rx_queue( n_rf24l01.rx_queue_boundary, &meta, sizeof(meta) );
+
+    n_rf24l01.rx_queue_boundary += sizeof(meta) + meta.length;
+    _account_latency( &n_rf24l01.latency.deliver_to_socket, _get_time_ns() - meta.deliver_ns );
+  }
+}
+
+/* write as much of queued data to a user as a socket takes */
+static void _flush_rx_queue( void )
+{
+  u_int pos, count;
+  int ret;
+
+  while( n_rf24l01.rx_queue_head != n_rf24l01.rx_queue_tail )
+  {
+    pos = n_rf24l01.rx_queue_tail & RX_QUEUE_MASK;
+    count = n_rf24l01.rx_queue_head - n_rf24l01.rx_queue_tail;
+    if( count > RX_QUEUE_SIZE - pos )
+      count = RX_QUEUE_SIZE - pos;
+
+    ret = send( n_rf24l01.sockets_pair[1], n_rf24l01.rx_queue + pos, count, MSG_DONTWAIT | MSG_NOSIGNAL );
+    if( ret < 0 && errno == EINTR )
+      continue;
+
+    if( ret <= 0 )
+    {
+      if( errno != EWOULDBLOCK )
+        N_RF24L01_LOG_ERRNO( "_flush_rx_queue: fail to write to a socket" );
+      break;
+    }
+
+    n_rf24l01.rx_queue_tail += ret;
+    n_rf24l01.rx_queue_stalled = 0;
+  }
+
+  if( n_rf24l01.rx_metadata )
+    _pass_taken_records();
+
+  if( n_rf24l01.rx_queue_head - n_rf24l01.rx_queue_tail < n_rf24l01.rx_queue_high_watermark / 2 )
+    n_rf24l01.rx_queue_above = 0;
+}
+
+/* wait for a user to take some data, as long as a policy allows, returns 0 on a timeout */
+static int _wait_rx_queue_room( uint64_t deadline, u_int num )
+{
+  struct pollfd event_fd;
+  uint64_t now;
+  int ret;
+
+  while( RX_QUEUE_SIZE - ( n_rf24l01.rx_queue_head - n_rf24l01.rx_queue_tail ) < num )
+  {
+    now = _get_time_us();
+    if( now >= deadline )
+      return 0;
+
+    event_fd.fd = n_rf24l01.sockets_pair[1];
+    event_fd.events = POLLOUT;
+
+    ret = poll( &event_fd, 1, ( deadline - now + 999 ) / 1000 );
+    if( ret < 0 && errno != EINTR )
+      return 0;
+
+    if( event_fd.revents & ( POLLERR | POLLHUP ) )
+      return 0;
+
+    _flush_rx_queue();
+  }
+
+  return 1;
+}
+
+/* make a room for @num bytes by dropping the oldest data, in a metadata mode only whole records
+ * a socket hasn't started to take are dropped, returns a room */
+static u_int _drop_oldest_rx_data( u_int num )
+{
+  n_rf24l01_rx_meta_t meta;
+  u_int room, size;
+
+  room = RX_QUEUE_SIZE - ( n_rf24l01.rx_queue_head - n_rf24l01.rx_queue_tail );
+
+  if( !n_rf24l01.rx_metadata )
+  {
+    n_rf24l01.rx_queue_bytes_dropped += num - room;
+    n_rf24l01.rx_queue_tail += num - room;
+
+    return num;
+  }
+
+  while( room < num && n_rf24l01.rx_queue_boundary == n_rf24l01.rx_queue_tail &&
+         n_rf24l01.rx_queue_tail != n_rf24l01.rx_queue_head )
+  {
+    _peek_rx_queue( n_rf24l01.rx_queue_tail, &meta, sizeof(meta) );
+    size = sizeof(meta) + meta.length;
+
+    n_rf24l01.rx_queue_bytes_dropped += size;
+    n_rf24l01.rx_queue_tail += size;
+    n_rf24l01.rx_queue_boundary = n_rf24l01.rx_queue_tail;
+    room += size;
+  }
+
+  return room;
+}
+
+/* put data a socket didn't take to the queue, a policy decides what to drop if there's no room,
+ * a @partial record (a socket has taken a beginning of it) is never dropped */
+static void _queue_rx_data( const u_char* data, u_int num, int partial )
+{
+  u_int room, pos, count, used;
+  uint64_t deadline;
+
+  room = RX_QUEUE_SIZE - ( n_rf24l01.rx_queue_head - n_rf24l01.rx_queue_tail );
+
+  if( num > room && n_rf24l01.rx_queue_policy == N_RF24L01_RX_BLOCK && !n_rf24l01.rx_queue_stalled )
+  {
+    /* the queue can't take more than its size anyway */
+    deadline = _get_time_us() + n_rf24l01.rx_queue_timeout_ms * 1000ull;
+    n_rf24l01.rx_queue_stalled = !_wait_rx_queue_room( deadline, num < RX_QUEUE_SIZE ? num : RX_QUEUE_SIZE );
+
+    room = RX_QUEUE_SIZE - ( n_rf24l01.rx_queue_head - n_rf24l01.rx_queue_tail );
+  }
+
+  if( num > room && n_rf24l01.rx_queue_policy == N_RF24L01_RX_DROP_OLDEST )
+  {
+    if( num > RX_QUEUE_SIZE )
+    {
+      n_rf24l01.rx_queue_bytes_dropped += num - RX_QUEUE_SIZE;
+      data += num - RX_QUEUE_SIZE;
+      num = RX_QUEUE_SIZE;
+    }
+
+    room = _drop_oldest_rx_data( num );
+  }
+
+  /* either a newest data is dropped by a policy, or a wait has timed out,
+   * a record is dropped as a whole */
+  if( num > room )
+  {
+    n_rf24l01.rx_queue_bytes_dropped += n_rf24l01.rx_metadata ? num : num - room;
+    num = n_rf24l01.rx_metadata ? 0 : room;
+  }
+
+  if( n_rf24l01.rx_queue_head == n_rf24l01.rx_queue_tail )
+    n_rf24l01.rx_queue_boundary = n_rf24l01.rx_queue_head + ( partial ? num : 0 );
+
+  pos = n_rf24l01.rx_queue_head & RX_QUEUE_MASK;
+  count = RX_QUEUE_SIZE - pos < num ? RX_QUEUE_SIZE - pos : num;
+
+  memcpy( n_rf24l01.rx_queue + pos, data, count );
+  memcpy( n_rf24l01.rx_queue, data + count, num - count );
+
+  n_rf24l01.rx_queue_head += num;
+
+  used = n_rf24l01.rx_queue_head - n_rf24l01.rx_queue_tail;
+  if( used > n_rf24l01.rx_queue_peak )
+    n_rf24l01.rx_queue_peak = used;
+
+  /* a user learns about a consumer falling behind once per crossing */
+  if( used >= n_rf24l01.rx_queue_high_watermark && !n_rf24l01.rx_queue_above )
+  {
+    uint64_t value = 1;
+
+    n_rf24l01.rx_queue_above = 1;
+    n_rf24l01.rx_queue_high_watermark_hits++;
+
+    if( n_rf24l01.rx_queue_event_fd >= 0 )
+      write( n_rf24l01.rx_queue_event_fd, &value, sizeof(value) );
+  }
+}
+
+/* write a chunk of up to N_RF24L01_LZ_MAX_FRAME bytes to a user, what a socket doesn't take
+ * waits in the queue; in a metadata mode the chunk is preceded by a header */
+static void _write_to_user( const void* data, u_int num, uint64_t now )
+{
+  u_char record[sizeof(n_rf24l01_rx_meta_t) + N_RF24L01_LZ_MAX_FRAME];
+  n_rf24l01_rx_meta_t meta;
+  int ret = 0;
+
+  if( n_rf24l01.rx_metadata )
+  {
+    memset( &meta, 0, sizeof(meta) );
+    meta.irq_ns = n_rf24l01.irq_ns;
+    meta.read_ns = n_rf24l01.read_ns;
+    meta.deliver_ns = now;
+    meta.length = num;
+    meta.pipe = n_rf24l01.rx_pipe;
+    meta.slot = n_rf24l01.rx_slot;
+    meta.source = n_rf24l01.rx_source;
+
+    memcpy( record, &meta, sizeof(meta) );
+    memcpy( record + sizeof(meta), data, num );
+
+    data = record;
+    num += sizeof(meta);
+  }
+
+  /* through the ring, data the library's thread delivers in one go is queued
+   * and written at once when the thread is done (look at _n_rf_thread) */
+  if( !_is_uring_active() )
+    _flush_rx_queue();
+
+  /* keep an order, nothing goes past queued data */
+  if( n_rf24l01.rx_queue_head == n_rf24l01.rx_queue_tail && !_is_uring_active() )
+  {
+    do
+      ret = send( n_rf24l01.sockets_pair[1], data, num, MSG_DONTWAIT | MSG_NOSIGNAL );
+    while( ret < 0 && errno == EINTR );
+
+    if( ret < 0 && errno != EWOULDBLOCK )
+    {
+      N_RF24L01_LOG_ERRNO( "_deliver_to_user: fail to write to a socket" );
+      return;
+    }
+
+    if( ret < 0 )
+      ret = 0;
+
+    if( n_rf24l01.rx_metadata && (u_int)ret == num )
+      _account_latency( &n_rf24l01.latency.deliver_to_socket, 0 );
+  }
+
+  if( (u_int)ret < num )
+    _queue_rx_data( (const u_char*)data + ret, num - ret, ret > 0 );
+}
+
+/* write data received from a remote side to a user, so the library's thread never waits
+ * for a user (unless asked); a longer chunk (e.g. what the ARQ has held back behind a gap)
+ * goes as several records, each with a header of the package that made them available */
+static void _deliver_to_user( const void* data, u_int num )
+{
+  uint64_t now = _get_time_ns();
+  u_int offset, size;
+
+  if( n_rf24l01.read_ns )
+    _account_latency( &n_rf24l01.latency.read_to_deliver, now - n_rf24l01.read_ns );
+
+  if( n_rf24l01.listen_fd >= 0 )
+  {
+    _deliver_to_clients( data, num );
+    return;
+  }
+
+  for( offset = 0; offset < num; offset += size )
+  {
+    size = num - offset < N_RF24L01_LZ_MAX_FRAME ? num - offset : N_RF24L01_LZ_MAX_FRAME;
+    _write_to_user( (const u_char*)data + offset, size, now );
+  }
+}
+
+/* split a payload of a package into frames and decompress them, a frame may go on
+ * in next packages */
+static void _deframe( const u_char* data, u_int num )
+{
+  u_char frame[N_RF24L01_LZ_MAX_FRAME];
+  u_int header, size, count;
+  uint64_t start;
+  u_char unit;
+  int ret;
+
+  if( !num )
+    return;
+
+  unit = *data++;
+  num--;
+
+  /* a package has been lost, so is a frame in progress, packages are skipped till a frame starts */
+  if( n_rf24l01.rx_frame_len && ( ( unit & FRAME_UNIT_START ) || ( unit & FRAME_UNIT_SEQ ) != n_rf24l01.rx_unit_seq ) )
+  {
+    n_rf24l01.rx_frame_len = 0;
+    n_rf24l01.lz_frames_broken++;
+  }
+
+  n_rf24l01.rx_unit_seq = ( unit + 1 ) & FRAME_UNIT_SEQ;
+
+  if( !n_rf24l01.rx_frame_len && !( unit & FRAME_UNIT_START ) )
+    return;
+
+  while( num )
+  {
+    if( n_rf24l01.rx_frame_len < FRAME_HEADER_SIZE )
+      size = FRAME_HEADER_SIZE;
+    else
+    {
+      header = n_rf24l01.rx_frame[0] | n_rf24l01.rx_frame[1] << 8;
+      size = FRAME_HEADER_SIZE + ( header & ~FRAME_COMPRESSED );
+    }
+
+    count = size - n_rf24l01.rx_frame_len < num ? size - n_rf24l01.rx_frame_len : num;
+    memcpy( n_rf24l01.rx_frame + n_rf24l01.rx_frame_len, data, count );
+    n_rf24l01.rx_frame_len += count;
+    data += count;
+    num -= count;
+
+    if( n_rf24l01.rx_frame_len < size )
+      continue;
+
+    header = n_rf24l01.rx_frame[0] | n_rf24l01.rx_frame[1] << 8;
+
+    if( size == FRAME_HEADER_SIZE )
+    {
+      /* the rest of a package is a padding */
+      if( !( header & ~FRAME_COMPRESSED ) )
+      {
+        n_rf24l01.rx_frame_len = 0;
+        return;
+      }
+
+      if( ( header & ~FRAME_COMPRESSED ) > N_RF24L01_LZ_MAX_FRAME )
+      {
+        n_rf24l01.rx_frame_len = 0;
+        n_rf24l01.lz_frames_broken++;
+        return;
+      }
+
+      continue;
+    }
+
+    n_rf24l01.rx_frame_len = 0;
+
+    if( !( header & FRAME_COMPRESSED ) )
+    {
+      _deliver_to_user( n_rf24l01.rx_frame + FRAME_HEADER_SIZE, size - FRAME_HEADER_SIZE );
+      continue;
+    }
+
+    start = _get_cpu_time_ns();
+    ret = n_rf24l01_lz_decompress( n_rf24l01.rx_frame + FRAME_HEADER_SIZE, size - FRAME_HEADER_SIZE, frame, sizeof(frame) );
+    n_rf24l01.lz_decompress_ns += _get_cpu_time_ns() - start;
+
+    if( ret < 0 )
+    {
+      n_rf24l01.lz_frames_broken++;
+      continue;
+    }
+
+    n_rf24l01.lz_frames_decompressed++;
+    _deliver_to_user( frame, ret );
+  }
+
+  /* a header never spans packages, a byte left at the end of a package is a padding */
+  if( n_rf24l01.rx_frame_len < FRAME_HEADER_SIZE )
+    n_rf24l01.rx_frame_len = 0;
+}
+
+/* hand a payload of a package received from a remote side over to the next stage,
+ * a raw package is padded if it's short */
+static void _receive_stream( const u_char* data, u_int num )
+{
+  if( n_rf24l01.compression || n_rf24l01.coalesce_us )
+    _deframe( data, num );
+  else
+    _deliver_to_user( data, num );
+}
+
+/* a protocol layer's cb to deliver data */
+static void _deliver_data( void* ctx, const u_char* data, u_int num )
+{
+  _receive_stream( data, num );
+}
+
+/* the TDMA's cb to deliver data, the gateway gets data of all nodes, a sender goes to a metadata */
+static void _deliver_tdma( void* ctx, u_int slot, uint16_t node_id, const u_char* data, u_int num )
+{
+  n_rf24l01.rx_slot = slot;
+  n_rf24l01.rx_source = node_id;
+
+  _receive_stream( data, num );
+}
+
+/* the mesh's cb to deliver data, a source node goes to a metadata */
+static void _deliver_mesh( void* ctx, u_char src, const u_char* data, u_int num )
+{
+  n_rf24l01.rx_source = src;
+
+  _receive_stream( data, num );
+}
+
+/* transmit data over a protocol layer in use, returns an amount of data taken,
+ * only an ARQ's window and a TDMA's queue may take less than @num */
+static int _send_stream( const void* data, int num )
+{
+  if( n_rf24l01.reliable )
+  {
+    num = n_rf24l01_arq_send( &n_rf24l01.arq, data, num, _get_time_us() );
+    _flush_tx_batch();
+  }
+  else if( n_rf24l01.fec_enabled )
+  {
+    n_rf24l01_fec_send( &n_rf24l01.fec, data, num, _get_time_us() );
+    _flush_tx_batch();
+  }
+  else if( n_rf24l01.bonded )
+  {
+    n_rf24l01_bond_send( &n_rf24l01.bond, data, num );
+    _flush_bond_batches();
+  }
+  else if( n_rf24l01.tdma_enabled )
+    num = n_rf24l01_tdma_send( &n_rf24l01.tdma, data, num );  /* transmitted by _handle_timers */
+  else if( n_rf24l01.mesh_enabled )
+  {
+    n_rf24l01_mesh_send( &n_rf24l01.mesh, n_rf24l01.mesh_dst, data, num );
+    _flush_tx_batch();
+  }
+  else
+    _transmit( data, num );
+
+  return num;
+}
+
+/* make a frame of data, compressed if the compression is on, returns a size of the frame */
+static u_int _make_frame( u_char* frame, const void* data, int num )
+{
+  uint64_t start;
+  u_int size, header;
+
+  if( !n_rf24l01.compression )
+  {
+    memcpy( frame + FRAME_HEADER_SIZE, data, num );
+    frame[0] = num;
+    frame[1] = num >> 8;
+
+    return FRAME_HEADER_SIZE + num;
+  }
+
+  start = _get_cpu_time_ns();
+  size = n_rf24l01_lz_compress( &n_rf24l01.lz, data, num, frame + FRAME_HEADER_SIZE, USER_BUFF_SIZE );
+  n_rf24l01.lz_compress_ns += _get_cpu_time_ns() - start;
+
+  n_rf24l01.lz_frames_compressed++;
+  n_rf24l01.lz_bytes_in += num;
+
+  if( size )
+    header = size | FRAME_COMPRESSED;
+  else
+  {
+    /* incompressible data goes as is */
+    memcpy( frame + FRAME_HEADER_SIZE, data, num );
+    size = header = num;
+  }
+
+  n_rf24l01.lz_bytes_out += FRAME_HEADER_SIZE + size;
+
+  frame[0] = header;
+  frame[1] = header >> 8;
+
+  return FRAME_HEADER_SIZE + size;
+}
+
+/* get an amount of a user's data a package of a protocol layer in use carries */
+static u_int _get_pkg_payload_size( void )
+{
+  if( n_rf24l01.reliable )
+    return N_RF24L01_ARQ_PAYLOAD_SIZE;
+
+  if( n_rf24l01.fec_enabled )
+    return N_RF24L01_FEC_PAYLOAD_SIZE;
+
+  if( n_rf24l01.bonded )
+    return N_RF24L01_BOND_PAYLOAD_SIZE;
+
+  if( n_rf24l01.tdma_enabled )
+    return N_RF24L01_TDMA_PAYLOAD_SIZE;
+
+  if( n_rf24l01.mesh_enabled )
+    return N_RF24L01_MESH_PAYLOAD_SIZE;
+
+  return N_RF24L01_PKG_SIZE;
+}
+
+/* transmit frames, a payload of each package gets a unit byte ahead,
+ * the rest of the last package gets padded by zeros if it's a raw one */
+static void _send_frames( const u_char* frames, u_int num )
+{
+  u_char units[2 * ( FRAME_HEADER_SIZE + USER_BUFF_SIZE )];
+  u_int room = _get_pkg_payload_size() - 1;
+  u_int size = 0, count;
+  u_char start = FRAME_UNIT_START;
+
+  while( num )
+  {
+    count = num < room ? num : room;
+
+    units[size++] = start | ( n_rf24l01.tx_unit_seq++ & FRAME_UNIT_SEQ );
+    memcpy( units + size, frames, count );
+    size += count;
+    frames += count;
+    num -= count;
+    start = 0;
+  }
+
+  _send_stream( units, size );
+}
+
+/* transmit coalesced frames */
+static void _flush_coalesced( void )
+{
+  if( !n_rf24l01.coalesce_len )
+    return;
+
+  n_rf24l01.coalesce_payloads++;
+  n_rf24l01.coalesce_bytes += n_rf24l01.coalesce_len;
+  n_rf24l01.coalesce_room += _get_pkg_payload_size() - 1;
+
+  _send_frames( n_rf24l01.coalesce_buff, n_rf24l01.coalesce_len );
+  n_rf24l01.coalesce_len = 0;
+}
+
+/* pack a frame into a package's payload along with previous ones,
+ * a frame which fills a payload by itself goes out as is */
+static void _coalesce_frame( const u_char* frame, u_int size )
+{
+  u_int payload = _get_pkg_payload_size() - 1;
+
+  if( n_rf24l01.coalesce_len && n_rf24l01.coalesce_len + size > payload )
+  {
+    n_rf24l01.coalesce_full_flushes++;
+    _flush_coalesced();
+  }
+
+  if( size >= payload )
+  {
+    n_rf24l01.coalesce_records_bypassed++;
+    _send_frames( frame, size );
+    return;
+  }
+
+  if( !n_rf24l01.coalesce_len )
+    n_rf24l01.coalesce_deadline_us = _get_time_us() + n_rf24l01.coalesce_us;
+
+  memcpy( n_rf24l01.coalesce_buff + n_rf24l01.coalesce_len, frame, size );
+  n_rf24l01.coalesce_len += size;
+  n_rf24l01.coalesce_records++;
+
+  /* no room for a header and a byte of a next frame */
+  if( payload - n_rf24l01.coalesce_len <= FRAME_HEADER_SIZE )
+  {
+    n_rf24l01.coalesce_full_flushes++;
+    _flush_coalesced();
+  }
+}
+
+/* get an amount of data a user may pass at once, 0 - nothing for now */
+static int _get_user_read_size( void )
+{
+  int size = USER_BUFF_SIZE;
+  int space, payload;
+
+  if( !n_rf24l01.reliable && !n_rf24l01.tdma_enabled )
+    return size;
+
+  /* take only what an ARQ's window or a TDMA's queue can accept, the rest waits in the socket */
+  if( n_rf24l01.reliable )
+    space = n_rf24l01_arq_space( &n_rf24l01.arq );
+  else
+    space = n_rf24l01_tdma_space( &n_rf24l01.tdma );
+
+  /* coalesced frames take a package of their own */
+  if( n_rf24l01.coalesce_len )
+  {
+    payload = _get_pkg_payload_size();
+    space = space > payload ? space - payload : 0;
+  }
+
+  /* packages of frames start with a unit byte */
+  if( n_rf24l01.compression || n_rf24l01.coalesce_us )
+  {
+    payload = _get_pkg_payload_size();
+    space = space / payload * ( payload - 1 );
+    space = space > FRAME_HEADER_SIZE ? space - FRAME_HEADER_SIZE : 0;
+  }
+
+  return space < size ? space : size;
+}
+
+/* transmit a chunk of a user's data, returns an amount of data taken, a frame is taken
+ * whole, as _get_user_read_size leaves a room for it */
+static int _send_user_data( const void* data, int num )
+{
+  u_char frame[FRAME_HEADER_SIZE + USER_BUFF_SIZE];
+  u_int size;
+
+  if( !n_rf24l01.compression && !n_rf24l01.coalesce_us )
+    return _send_stream( data, num );
+
+  size = _make_frame( frame, data, num );
+
+  if( n_rf24l01.coalesce_us )
+    _coalesce_frame( frame, size );
+  else
+    _send_frames( frame, size );
+
+  return num;
+}
+
+static void _data_from_user()
+{
+  char buff[USER_BUFF_SIZE];
+  int size, ret;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  size = _get_user_read_size();
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  if( !size )
+    return;
+
+  ret = read( n_rf24l01.sockets_pair[1], buff, size );
+  if( ret <= 0 )
+    return;
+
+  N_RF24L01_LOG_DEBUG( "some data from user: %lld bytes.", ret );
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  _send_user_data( buff, ret );
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+
+#ifdef IO_URING
+/* give protocol layers what they have a room for of a read which has completed */
+static void _uring_send_user_tail( void )
+{
+  int size = _get_user_read_size();
+
+  if( size > n_rf24l01.uring_user_tail_len )
+    size = n_rf24l01.uring_user_tail_len;
+
+  if( !size )
+    return;
+
+  size = _send_user_data( n_rf24l01.uring_user_buff + n_rf24l01.uring_user_tail_pos, size );
+
+  n_rf24l01.uring_user_tail_pos += size;
+  n_rf24l01.uring_user_tail_len -= size;
+}
+
+/* keep a read of a user's data in flight, as long as protocol layers take it */
+static void _uring_read_user( void )
+{
+  struct io_uring_sqe* sqe;
+  int size;
+
+  if( n_rf24l01.uring_user_read || n_rf24l01.uring_user_read_done || n_rf24l01.uring_user_eof )
+    return;
+
+  /* a buffer is reused only once what has been read into it is gone */
+  if( n_rf24l01.uring_user_tail_len )
+  {
+    _uring_send_user_tail();
+    if( n_rf24l01.uring_user_tail_len )
+      return;
+  }
+
+  size = _get_user_read_size();
+  if( !size )
+    return;
+
+  sqe = n_rf24l01_uring_get_sqe( &n_rf24l01.uring );
+  if( !sqe )
+    return;
+
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = n_rf24l01.sockets_pair[1];
+  sqe->addr = (uintptr_t)n_rf24l01.uring_user_buff;
+  sqe->len = size;
+  sqe->user_data = URING_DATA( URING_USER_READ, 0, 0 );
+
+  n_rf24l01.uring_user_read = size;
+}
+
+static void _uring_data_from_user( void )
+{
+  int ret = n_rf24l01.uring_user_read_res;
+
+  n_rf24l01.uring_user_read = 0;
+  n_rf24l01.uring_user_read_done = 0;
+
+  /* a user has closed a socket, other failures are tried again by a next read */
+  if( ret == 0 || ret == -ECONNRESET )
+  {
+    n_rf24l01.uring_user_eof = 1;
+    return;
+  }
+
+  if( ret < 0 )
+  {
+    if( ret != -EINTR && ret != -EAGAIN )
+      N_RF24L01_LOG_WARN( "_uring_data_from_user: a read has failed: %lld.", -ret );
+    return;
+  }
+
+  N_RF24L01_LOG_DEBUG( "some data from user: %lld bytes.", ret );
+
+  /* a room of protocol layers may have shrunk since the read was sized */
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  n_rf24l01.uring_user_tail_pos = 0;
+  n_rf24l01.uring_user_tail_len = ret;
+  _uring_send_user_tail();
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+#endif
+
+/* a lowpan's cb to deliver a datagram to the network stack */
+static void _deliver_datagram( void* ctx, const u_char* datagram, u_int num )
+{
+  int ret;
+
+  do
+    ret = write( n_rf24l01.tun_fd, datagram, num );
+  while( ret < 0 && errno == EINTR );
+
+  /* the network stack takes care of lost datagrams */
+  if( ret < 0 )
+    N_RF24L01_LOG_ERRNO( "_deliver_datagram: fail to write to a tun device" );
+}
+
+static void _datagram_from_tun()
+{
+  u_char datagram[N_RF24L01_LOWPAN_MAX_DATAGRAM];
+  int ret;
+
+  ret = read( n_rf24l01.tun_fd, datagram, sizeof(datagram) );
+  if( ret <= 0 )
+    return;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  n_rf24l01_lowpan_send( &n_rf24l01.lowpan, datagram, ret );
+  _flush_tx_batch();
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+
+/* gets called if the library's core (and the transceiver) received some data from a remote side */
+static void _handle_received_data( const void* data, u_int num )
+{
+  uint64_t now = _get_time_us();
+
+  n_rf24l01.read_ns = _get_time_ns();
+  n_rf24l01.rx_pipe = n_rf24l01_get_rx_pipe();
+  n_rf24l01.rx_slot = 0;
+  n_rf24l01.rx_source = 0;
+  if( n_rf24l01.irq_ns )
+    _account_latency( &n_rf24l01.latency.irq_to_read, n_rf24l01.read_ns - n_rf24l01.irq_ns );
+
+  /* called by the core, so core_lock is already held */
+  if( n_rf24l01.hopping )
+    n_rf24l01_hop_on_rx( &n_rf24l01.hop, now );
+
+  if( n_rf24l01.pm_enabled )
+    n_rf24l01_pm_on_rx( &n_rf24l01.pm, now );
+
+  if( n_rf24l01.tun_fd >= 0 )
+  {
+    n_rf24l01_lowpan_on_pkg( &n_rf24l01.lowpan, data );
+    return;
+  }
+
+  /* a radio the package came over is a selected one */
+  if( n_rf24l01.bonded )
+  {
+    n_rf24l01_bond_on_pkg( &n_rf24l01.bond, n_rf24l01.radio, data, now );
+    return;
+  }
+
+  /* packages an ARQ produces get queued, the batch is flushed when the core is done */
+  if( n_rf24l01.reliable )
+  {
+    if( n_rf24l01.adapt_enabled && n_rf24l01_adapt_on_pkg( &n_rf24l01.adapt, data, now ) == 0 )
+      return;
+
+    n_rf24l01_arq_on_pkg( &n_rf24l01.arq, data, now );
+    return;
+  }
+
+  if( n_rf24l01.fec_enabled )
+  {
+    n_rf24l01_fec_on_pkg( &n_rf24l01.fec, data );
+    return;
+  }
+
+  if( n_rf24l01.tdma_enabled )
+  {
+    n_rf24l01_tdma_on_pkg( &n_rf24l01.tdma, data, now );
+    return;
+  }
+
+  if( n_rf24l01.mesh_enabled )
+  {
+    n_rf24l01_mesh_on_pkg( &n_rf24l01.mesh, data );
+    return;
+  }
+
+  _receive_stream( data, num );
+}
+
+/* Linux SYSFS GPIO API requires a value to be read from the start of a file to get
+ * a next interrupt, interrupt lines of @radios which have fired together are read at once;
+ * Note: actually we don't need to know the exact value on an
+ *       interrupt line, only the fact that an interrupt happened */
+static void _read_interrupt_lines( const u_int* radios, u_int num )
+{
+  char buff[1]; /* "value" ... reads as either 0 (low) or 1 (high). */
+  u_int i;
+  int fd;
+
+  /* sysfs doesn't tell when an edge happened, so a package's latency starts here */
+  n_rf24l01.irq_ns = _get_time_ns();
+
+  for( i = 0; i < num; i++ )
+  {
+    fd = radios[i] ? n_rf24l01.radio_interrupt_fds[radios[i]] : n_rf24l01.interrupt_line_fd;
+
+#ifdef IO_URING
+    if( n_rf24l01.uring_active )
+    {
+      struct io_uring_sqe* sqe = n_rf24l01_uring_get_sqe( &n_rf24l01.uring );
+
+      if( sqe )
+      {
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fd;
+        sqe->addr = (uintptr_t)&n_rf24l01.uring_sink;
+        sqe->len = sizeof(buff);
+        sqe->off = 0;
+        sqe->user_data = URING_DATA( URING_LINE_READ, 0, 0 );
+
+        n_rf24l01.uring_line_reads++;
+        continue;
+      }
+    }
+#endif
+
+    pread( fd, buff, sizeof(buff), 0 );
+  }
+
+#ifdef IO_URING
+  /* sysfs reads complete right away, so it's one io_uring_enter for all lines */
+  while( n_rf24l01.uring_line_reads )
+  {
+    int ret = n_rf24l01_uring_submit( &n_rf24l01.uring, n_rf24l01.uring_line_reads, NULL );
+
+    _uring_reap();
+
+    if( ret < 0 && ret != -EINTR )
+    {
+      errno = -ret;
+      N_RF24L01_LOG_ERRNO( "_read_interrupt_lines: fail to read interrupt lines" );
+      n_rf24l01.uring_line_reads = 0;
+    }
+  }
+#endif
+}
+
+static void _interrupt_on_n_rf24l01_device( u_int radio )
+{
+  static int first_interrupt[N_RF24L01_MAX_RADIOS] = { [0 ... N_RF24L01_MAX_RADIOS - 1] = 1 };
+
+  N_RF24L01_LOG_DEBUG( "got an interrupt on an n_rf24l01 device #%lld.", radio );
+
+  /* for some reason there's a fake interrupt at the beginning,
+   * so just skip it */
+  if( first_interrupt[radio] )
+  {
+    first_interrupt[radio] = 0;
+    return;
+  }
+
+  /* let library's core to do it work */
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  if( n_rf24l01.bonded )
+    _select_radio( radio );
+
+  n_rf24l01_upper_half_irq();
+  n_rf24l01_bottom_half_irq();
+
+  if( n_rf24l01.bonded )
+    _flush_bond_batches();
+  else
+    _flush_tx_batch();
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+
+/* handle expired timers of protocol layers and get a timeout for the next poll, NULL - infinite */
+static struct timespec* _handle_timers( struct timespec* timeout )
+{
+  uint32_t timeout_us = 0xffffffff;
+  uint32_t ret;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  /* coalesced frames go out at a deadline even if a payload isn't full */
+  if( n_rf24l01.coalesce_len )
+  {
+    uint64_t now = _get_time_us();
+
+    if( now >= n_rf24l01.coalesce_deadline_us )
+    {
+      n_rf24l01.coalesce_deadline_flushes++;
+      _flush_coalesced();
+    }
+    else
+      timeout_us = n_rf24l01.coalesce_deadline_us - now;
+  }
+
+  if( n_rf24l01.hopping )
+  {
+    ret = n_rf24l01_hop_tick( &n_rf24l01.hop, _get_time_us() );
+    if( ret < timeout_us )
+      timeout_us = ret;
+  }
+
+  if( n_rf24l01.reliable )
+  {
+    ret = n_rf24l01_arq_poll( &n_rf24l01.arq, _get_time_us() );
+    if( ret < timeout_us )
+      timeout_us = ret;
+
+    if( n_rf24l01.adapt_enabled )
+    {
+      ret = n_rf24l01_adapt_poll( &n_rf24l01.adapt, _get_time_us(), n_rf24l01.arq.stats.pkgs_sent,
+                                  n_rf24l01.arq.stats.pkgs_retransmitted );
+      if( ret < timeout_us )
+        timeout_us = ret;
+    }
+
+    _flush_tx_batch();
+  }
+
+  if( n_rf24l01.fec_enabled )
+  {
+    ret = n_rf24l01_fec_poll( &n_rf24l01.fec, _get_time_us() );
+    if( ret < timeout_us )
+      timeout_us = ret;
+
+    _flush_tx_batch();
+  }
+
+  /* packages a slot has room for go out right away, a next poll sees what's left of the slot */
+  if( n_rf24l01.tdma_enabled )
+  {
+    ret = n_rf24l01_tdma_poll( &n_rf24l01.tdma, _get_time_us() );
+    if( ret < timeout_us )
+      timeout_us = ret;
+
+    _flush_tx_batch();
+  }
+
+  if( n_rf24l01.bonded )
+  {
+    ret = n_rf24l01_bond_poll( &n_rf24l01.bond, _get_time_us() );
+    if( ret < timeout_us )
+      timeout_us = ret;
+
+    _flush_bond_batches();
+  }
+
+  /* goes after layers which may have transmitted something */
+  if( n_rf24l01.pm_enabled )
+  {
+    ret = n_rf24l01_pm_poll( &n_rf24l01.pm, _get_time_us() );
+    if( ret < timeout_us )
+      timeout_us = ret;
+  }
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  if( timeout_us == 0xffffffff )
+    return NULL;
+
+  timeout->tv_sec = timeout_us / 1000000;
+  timeout->tv_nsec = ( timeout_us % 1000000 ) * 1000;
+
+  return timeout;
+}
+
+/* create a shared memory and doorbells for a new client and pass them over */
+static void _accept_client( void )
+{
+  n_rf24l01_client_t* client = NULL;
+  char control[CMSG_SPACE(3 * sizeof(int))];
+  struct msghdr msg;
+  struct cmsghdr* cmsg;
+  struct iovec iov;
+  u_char version = 1;
+  int fds[3];
+  int sock_fd, i, ret;
+
+  sock_fd = accept4( n_rf24l01.listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK );
+  if( sock_fd < 0 )
+    return;
+
+  for( i = 0; i < MAX_CLIENTS; i++ )
+    if( n_rf24l01.clients[i].sock_fd < 0 )
+    {
+      client = &n_rf24l01.clients[i];
+      break;
+    }
+
+  if( !client )
+  {
+    N_RF24L01_LOG_WARN( "_accept_client: too many clients." );
+    close( sock_fd );
+    return;
+  }
+
+  fds[0] = memfd_create( "n_rf24l01_client", MFD_CLOEXEC );
+  fds[1] = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+  fds[2] = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+
+  client->shm = MAP_FAILED;
+  if( fds[0] >= 0 && ftruncate( fds[0], sizeof(n_rf24l01_shm_t) ) == 0 )
+    client->shm = mmap( NULL, sizeof(n_rf24l01_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0 );
+
+  if( client->shm == MAP_FAILED || fds[1] < 0 || fds[2] < 0 )
+  {
+    N_RF24L01_LOG_ERRNO( "_accept_client: fail to prepare a shared memory" );
+    goto fail;
+  }
+
+  client->shm->magic = N_RF24L01_SHM_MAGIC;
+
+  iov.iov_base = &version;
+  iov.iov_len = sizeof(version);
+
+  memset( &msg, 0, sizeof(msg) );
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  cmsg = CMSG_FIRSTHDR( &msg );
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN( sizeof(fds) );
+  memcpy( CMSG_DATA( cmsg ), fds, sizeof(fds) );
+
+  ret = sendmsg( sock_fd, &msg, MSG_NOSIGNAL );
+  if( ret < 0 )
+  {
+    N_RF24L01_LOG_ERRNO( "_accept_client: fail to pass a shared memory" );
+    goto fail;
+  }
+
+  /* the mapping keeps the memory */
+  close( fds[0] );
+
+  client->sock_fd = sock_fd;
+  client->daemon_bell = fds[1];
+  client->client_bell = fds[2];
+
+  N_RF24L01_LOG_INFO( "_accept_client: a client #%lld has been connected.", i );
+  return;
+
+fail:
+  if( client->shm != MAP_FAILED )
+    munmap( client->shm, sizeof(n_rf24l01_shm_t) );
+
+  for( i = 0; i < 3; i++ )
+    close( fds[i] );
+
+  close( sock_fd );
+}
+
+/* perform a client's register access on behalf of it */
+static void _serve_register_access( n_rf24l01_client_t* client )
+{
+  n_rf24l01_shm_t* shm = client->shm;
+
+  if( atomic_load_explicit( &shm->reg_state, memory_order_acquire ) != N_RF24L01_SHM_REG_REQUEST )
+    return;
+
+  /* registers of bonded radios are accessed on radio 0 */
+  if( n_rf24l01.bonded )
+    _select_radio( 0 );
+
+  if( shm->reg_write )
+    n_rf24l01_write_register_dbg( shm->reg_addr, shm->reg_value );
+  else
+    shm->reg_value = n_rf24l01_read_register_dbg( shm->reg_addr );
+
+  atomic_store_explicit( &shm->reg_state, N_RF24L01_SHM_REG_DONE, memory_order_release );
+  _ring_bell( client->client_bell );
+}
+
+/* transmit a client's record, if a protocol layer in use can take it, returns 1 if done */
+static int _serve_record( n_rf24l01_client_t* client )
+{
+  const u_char* record;
+  u_int num;
+
+  record = n_rf24l01_shm_ring_peek_record( &client->shm->to_daemon, &num );
+  if( !record || num > _get_user_read_size() )
+    return 0;
+
+  /* a record goes right from the shared memory */
+  _send_user_data( record, num );
+
+  n_rf24l01_shm_ring_drop_record( &client->shm->to_daemon );
+
+  /* let a client know there's a room */
+  _ring_bell( client->client_bell );
+
+  return 1;
+}
+
+/* handle clients' requests, records of different clients are taken in turn */
+static void _serve_clients( void )
+{
+  n_rf24l01_client_t* client;
+  int i, progress;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  for( i = 0; i < MAX_CLIENTS; i++ )
+    if( n_rf24l01.clients[i].sock_fd >= 0 )
+      _serve_register_access( &n_rf24l01.clients[i] );
+
+  do
+  {
+    progress = 0;
+
+    for( i = 0; i < MAX_CLIENTS; i++ )
+    {
+      client = &n_rf24l01.clients[i];
+
+      if( client->sock_fd >= 0 )
+        progress |= _serve_record( client );
+    }
+  } while( progress );
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+
+static void* _n_rf_thread( void* data )
+{
+  /* interrupt lines of bonded radios, except radio 0, go after the first three,
+   * then a daemon's listening socket and a connection and a doorbell of each client */
+  struct pollfd events_fd[POLL_FDS];
+  struct pollfd* serve_fds = events_fd + SERVE_FDS;
+  u_int radio, lines[N_RF24L01_MAX_RADIOS], lines_num;
+  int i;
+
+  events_fd[0].events = POLLIN;
+  events_fd[0].fd = n_rf24l01.tun_fd >= 0 ? n_rf24l01.tun_fd : n_rf24l01.sockets_pair[1];
+
+  /* Linux SYSFS GPIO API requires to set POLLPRI and POLLERR
+   * as events to wait for */
+  events_fd[1].events = POLLPRI | POLLERR;
+  events_fd[1].fd = n_rf24l01.interrupt_line_fd;
+
+  events_fd[2].events = POLLIN;
+  events_fd[2].fd = n_rf24l01.wakeup_fd;
+
+  for( radio = 1; radio < N_RF24L01_MAX_RADIOS; radio++ )
+  {
+    events_fd[2 + radio].events = POLLPRI | POLLERR;
+    events_fd[2 + radio].fd = radio < n_rf24l01.radios_num ? n_rf24l01.radio_interrupt_fds[radio] : -1;
+  }
+
+  N_RF24L01_LOG_INFO( "_n_rf_thread: wait for events..." );
+
+  while( 1 )
+  {
+    struct timespec* timeout;
+    struct timespec timeout_storage;
+    int ret;
+
+    timeout = _handle_timers( &timeout_storage );
+
+    /* don't take data from a user while an ARQ's window is full */
+    pthread_mutex_lock( &n_rf24l01.core_lock );
+    events_fd[0].events = n_rf24l01.tun_fd >= 0 || _get_user_read_size() ? POLLIN : 0;
+
+#ifdef IO_URING
+    /* through the ring a user's data is read by a request kept in flight, not after a poll */
+    if( n_rf24l01.uring_active && n_rf24l01.tun_fd < 0 )
+    {
+      events_fd[0].events = 0;
+      _uring_read_user();
+    }
+#endif
+
+    /* and give a user queued data as soon as a socket has a room */
+    if( n_rf24l01.rx_queue_head != n_rf24l01.rx_queue_tail )
+      events_fd[0].events |= POLLOUT;
+
+    /* a daemon mode may be turned on at any time */
+    serve_fds[0].fd = n_rf24l01.listen_fd;
+    serve_fds[0].events = POLLIN;
+
+    for( i = 0; i < MAX_CLIENTS; i++ )
+    {
+      serve_fds[1 + 2 * i].fd = n_rf24l01.clients[i].sock_fd;
+      serve_fds[1 + 2 * i].events = POLLIN;
+      serve_fds[2 + 2 * i].fd = n_rf24l01.clients[i].sock_fd >= 0 ? n_rf24l01.clients[i].daemon_bell : -1;
+      serve_fds[2 + 2 * i].events = POLLIN;
+    }
+
+    pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+    ret = _wait_events( events_fd, POLL_FDS, timeout );
+
+    /* a library is being stopped, by _stop_n_rf24l01_library, which waits for the thread */
+    if( atomic_load( &n_rf24l01.n_rf_thread_stop ) )
+      return NULL;
+
+    if( ret < 0 && errno == EINTR )
+      continue;
+
+    if( ret < 0 )
+    {
+      _stop_n_rf24l01_library();
+      return NULL;  /* implicitly call ptread_exit( NULL ) */
+    }
+
+    if( events_fd[0].revents & POLLOUT )
+    {
+      pthread_mutex_lock( &n_rf24l01.core_lock );
+      _flush_rx_queue();
+      pthread_mutex_unlock( &n_rf24l01.core_lock );
+    }
+
+    if( events_fd[0].revents & POLLIN )
+    {
+      if( n_rf24l01.tun_fd >= 0 )
+        _datagram_from_tun();
+      else
+        _data_from_user();
+    }
+
+#ifdef IO_URING
+    if( n_rf24l01.uring_user_read_done )
+      _uring_data_from_user();
+#endif
+
+    /* it's not enough clear what type of event Linux SYSFS GPIO provides in case of
+     * an interrupt on a line, so handle only a POLLPRI | POLLERR combination */
+    lines_num = 0;
+
+    if( events_fd[1].revents == (POLLPRI | POLLERR) )
+      lines[lines_num++] = 0;
+
+    for( radio = 1; radio < n_rf24l01.radios_num; radio++ )
+      if( events_fd[2 + radio].revents == (POLLPRI | POLLERR) )
+        lines[lines_num++] = radio;
+
+    if( lines_num )
+      _read_interrupt_lines( lines, lines_num );
+
+    for( i = 0; i < (int)lines_num; i++ )
+      _interrupt_on_n_rf24l01_device( lines[i] );
+
+    /* data delivered through the ring is written at once, as the thread is done with interrupts */
+    if( _is_uring_active() )
+    {
+      pthread_mutex_lock( &n_rf24l01.core_lock );
+      _flush_rx_queue();
+      pthread_mutex_unlock( &n_rf24l01.core_lock );
+    }
+
+    if( events_fd[2].revents == POLLIN )
+      _read_eventfd( n_rf24l01.wakeup_fd );
+
+    if( serve_fds[0].fd < 0 )
+      continue;
+
+    if( serve_fds[0].revents & POLLIN )
+      _accept_client();
+
+    for( i = 0; i < MAX_CLIENTS; i++ )
+    {
+      n_rf24l01_client_t* client = &n_rf24l01.clients[i];
+      char buf[1];
+
+      /* a client only talks over the shared memory, so anything on a connection means it's gone */
+      if( serve_fds[1 + 2 * i].fd >= 0 && serve_fds[1 + 2 * i].revents &&
+          recv( client->sock_fd, buf, sizeof(buf), MSG_DONTWAIT ) <= 0 )
+      {
+        pthread_mutex_lock( &n_rf24l01.core_lock );
+        _drop_client( client );
+        pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+        N_RF24L01_LOG_INFO( "_n_rf_thread: a client #%lld has gone.", i );
+        continue;
+      }
+
+      if( serve_fds[2 + 2 * i].fd >= 0 && serve_fds[2 + 2 * i].revents & POLLIN )
+        _read_eventfd( client->daemon_bell );
+    }
+
+    /* records a protocol layer couldn't take before get another chance each time */
+    _serve_clients();
+  }
+}
+
+static int _init_n_rf24l01_backend( void )
+{
+  n_rf24l01_backend_t backend;
+  uint64_t start = _get_time_us();
+  int ret;
+
+  ret = init_n_rf24l01_backend();
+  if( ret < 0 )
+    return -1;
+
+  /* only a library's open calibrates, n_rf24l01_open_dbg talks at the slowest speed */
+  ret = calibrate_n_rf24l01_spi_speed();
+  if( ret < 0 )
+  {
+    deinit_n_rf24l01_backend();
+    return -1;
+  }
+
+  backend.set_up_ce_pin = set_up_ce_pin;
+  backend.send_cmd = send_cmd;
+  backend.send_cmds = send_cmds;
+  backend.usleep = usleep_;
+  backend.handle_received_data = _handle_received_data;
+
+  ret = n_rf24l01_init( &backend );
+  if( ret < 0 )
+    return -1;
+
+  n_rf24l01.warm_start = ret;
+
+  /* by default a transceiver is in a receive mode,
+   * waiting for incoming data */
+  n_rf24l01_prepare_to_receive();
+
+  n_rf24l01.init_us = _get_time_us() - start;
+
+  return 0;
+}
+
+
+/* Public API */
+
+
+/* prepare a backend and the core to work */
+static int _open_n_rf24l01_library( void )
+{
+  int ret;
+
+  ret = _init_n_rf24l01_backend();
+  if( ret < 0 )
+    return -1;
+
+  n_rf24l01.interrupt_line_fd = get_n_rf24l01_interrupt_line_fd();
+  if( n_rf24l01.interrupt_line_fd < 0 )
+  {
+    _stop_n_rf24l01_library();
+    return -1;
+  }
+
+  printf( "an n_rf24l01 backend was successfully prepared to use.\n" );
+
+  return 0;
+}
+
+static void* _log_thread( void* data )
+{
+  while( !atomic_load( &n_rf24l01.log_thread_stop ) )
+  {
+    n_rf24l01_log_drain( STDOUT_FILENO );
+    usleep( LOG_DRAIN_PERIOD_US );
+  }
+
+  n_rf24l01_log_drain( STDOUT_FILENO );
+
+  return NULL;
+}
+
+static int _start_n_rf_thread( void )
+{
+  int ret;
+
+  atomic_store( &n_rf24l01.log_thread_stop, 0 );
+
+  ret = pthread_create( &n_rf24l01.log_thread, NULL, _log_thread, NULL );
+  if( ret )
+  {
+    _stop_n_rf24l01_library();
+    return -1;
+  }
+
+  n_rf24l01.log_thread_running = 1;
+
+  n_rf24l01.wakeup_fd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+  if( n_rf24l01.wakeup_fd < 0 )
+  {
+    _stop_n_rf24l01_library();
+    return -1;
+  }
+
+#ifdef IO_URING
+  /* without a ring (an old kernel, io_uring is disabled) the thread uses ppoll */
+  memset( n_rf24l01.uring_armed, 0, sizeof(n_rf24l01.uring_armed) );
+  memset( n_rf24l01.uring_revents, 0, sizeof(n_rf24l01.uring_revents) );
+  n_rf24l01.uring_line_reads = 0;
+  n_rf24l01.uring_user_read = 0;
+  n_rf24l01.uring_user_read_done = 0;
+  n_rf24l01.uring_user_eof = 0;
+  n_rf24l01.uring_user_tail_len = 0;
+
+  n_rf24l01.uring_active = n_rf24l01_uring_init( &n_rf24l01.uring, URING_ENTRIES ) == 0;
+  N_RF24L01_LOG_INFO( "_start_n_rf_thread: io_uring is %lld.", n_rf24l01.uring_active );
+#endif
+
+  atomic_store( &n_rf24l01.n_rf_thread_stop, 0 );
+
+  ret = pthread_create( &n_rf24l01.n_rf_thread, NULL, _n_rf_thread, NULL );
+  if( ret )
+  {
+    _stop_n_rf24l01_library();
+    return -1;
+  }
+
+  n_rf24l01.n_rf_thread_running = 1;
+
+  return 0;
+}
+
+/* create a TUN device @ifname, set its @mtu and bring it up */
+static int _open_tun_device( const char* ifname, unsigned int mtu )
+{
+  struct ifreq ifr;
+  int sock_fd, ret;
+
+  n_rf24l01.tun_fd = open( "/dev/net/tun", O_RDWR | O_CLOEXEC );
+  if( n_rf24l01.tun_fd < 0 )
+  {
+    perror( "error while open /dev/net/tun" );
+    return -1;
+  }
+
+  memset( &ifr, 0, sizeof(ifr) );
+  ifr.ifr_flags = IFF_TUN | IFF_NO_PI;
+  if( ifname )
+    strncpy( ifr.ifr_name, ifname, IFNAMSIZ - 1 );
+
+  ret = ioctl( n_rf24l01.tun_fd, TUNSETIFF, &ifr );
+  if( ret < 0 )
+  {
+    perror( "error while TUNSETIFF ioctl call" );
+    return -1;
+  }
+
+  sock_fd = socket( AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0 );
+  if( sock_fd < 0 )
+    return -1;
+
+  ifr.ifr_mtu = mtu;
+  ret = ioctl( sock_fd, SIOCSIFMTU, &ifr );
+  if( ret < 0 )
+    perror( "error while SIOCSIFMTU ioctl call" );
+
+  if( ret == 0 )
+    ret = ioctl( sock_fd, SIOCGIFFLAGS, &ifr );
+
+  if( ret == 0 )
+  {
+    ifr.ifr_flags |= IFF_UP;
+    ret = ioctl( sock_fd, SIOCSIFFLAGS, &ifr );
+    if( ret < 0 )
+      perror( "error while SIOCSIFFLAGS ioctl call" );
+  }
+
+  close( sock_fd );
+
+  if( ret < 0 )
+    return -1;
+
+  printf( "a tun device %s was successfully prepared to use.\n", ifr.ifr_name );
+
+  return 0;
+}
+
+int n_rf24l01_open( void )
+{
+  int ret;
+
+  ret = _open_n_rf24l01_library();
+  if( ret < 0 )
+    return -1;
+
+  ret = socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, n_rf24l01.sockets_pair );
+  if( ret < 0 )
+  {
+    _stop_n_rf24l01_library();
+    return -1;
+  }
+
+  ret = _start_n_rf_thread();
+  if( ret < 0 )
+    return -1;
+
+  /* return NO duplicate to be able to somehow notice a user that we have some problem
+   * (in case of a some insoluble error we just close the sockets) */
+  return n_rf24l01.sockets_pair[0];
+}
+
+/* prepare each of @num radios with its own core instance */
+static int _init_bonded_radios( const n_rf24l01_radio_t* radios, u_int num )
+{
+  n_rf24l01_backend_t backend;
+  uint64_t start = _get_time_us();
+  u_int radio;
+  int ret;
+
+  backend.set_up_ce_pin = set_up_ce_pin;
+  backend.send_cmd = send_cmd;
+  backend.send_cmds = send_cmds;
+  backend.usleep = _usleep_radio;
+  backend.handle_received_data = _handle_received_data;
+
+  for( radio = 0; radio < num; radio++ )
+  {
+    ret = init_n_rf24l01_backend_radio( radio, radios[radio].spi_device_file, radios[radio].ce_line_pin,
+                                        radios[radio].interrupt_line_pin );
+    if( ret < 0 || calibrate_n_rf24l01_spi_speed() < 0 )
+      return -1;
+
+    n_rf24l01.radio_interrupt_fds[radio] = get_n_rf24l01_interrupt_line_fd();
+
+    _select_radio( radio );
+
+    ret = n_rf24l01_init( &backend );
+    if( ret < 0 )
+      return -1;
+
+    n_rf24l01.warm_start = radio ? n_rf24l01.warm_start && ret : ret;
+
+    ret = n_rf24l01_set_channel( radios[radio].channel );
+    if( ret < 0 )
+      return -1;
+
+    n_rf24l01_prepare_to_receive();
+  }
+
+  n_rf24l01.interrupt_line_fd = n_rf24l01.radio_interrupt_fds[0];
+  n_rf24l01.radios_num = num;
+  n_rf24l01.init_us = _get_time_us() - start;
+
+  return 0;
+}
+
+int n_rf24l01_open_bonded( const n_rf24l01_radio_t* radios, unsigned int num )
+{
+  u_int radio;
+  int ret;
+
+  if( !radios || !num || num > N_RF24L01_MAX_RADIOS || num > N_RF24L01_BOND_MAX_LINKS ||
+      num > N_RF24L01_BACKEND_MAX_RADIOS )
+    return -1;
+
+  for( radio = 0; radio < num; radio++ )
+    if( !radios[radio].spi_device_file || radios[radio].channel >= N_RF24L01_CHANNELS )
+      return -1;
+
+  ret = _init_bonded_radios( radios, num );
+  if( ret < 0 )
+  {
+    _stop_n_rf24l01_library();
+    return -1;
+  }
+
+  printf( "%u bonded n_rf24l01 backends were successfully prepared to use.\n", num );
+
+  n_rf24l01_bond_init( &n_rf24l01.bond, num, _queue_bond_pkg, _deliver_data, NULL );
+  n_rf24l01.bonded = 1;
+
+  ret = socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, n_rf24l01.sockets_pair );
+  if( ret < 0 )
+  {
+    _stop_n_rf24l01_library();
+    return -1;
+  }
+
+  ret = _start_n_rf_thread();
+  if( ret < 0 )
+    return -1;
+
+  return n_rf24l01.sockets_pair[0];
+}
+
+int n_rf24l01_open_tun( const char* ifname, unsigned int mtu )
+{
+  int ret;
+
+  if( mtu < 68 || mtu > N_RF24L01_LOWPAN_MAX_DATAGRAM )
+    return -1;
+
+  ret = _open_n_rf24l01_library();
+  if( ret < 0 )
+    return -1;
+
+  n_rf24l01_lowpan_init( &n_rf24l01.lowpan, _queue_pkg, _deliver_datagram, NULL );
+
+  ret = _open_tun_device( ifname, mtu );
+  if( ret < 0 )
+  {
+    _stop_n_rf24l01_library();
+    return -1;
+  }
+
+  ret = _start_n_rf_thread();
+  if( ret < 0 )
+    return -1;
+
+  return n_rf24l01.tun_fd;
+}
+
+int n_rf24l01_serve( int fd, const char* path )
+{
+  n_rf24l01_backend_t backend;
+  struct sockaddr_un addr;
+  int listen_fd, ret;
+
+  /* a daemon serves a library n_rf24l01_open has opened, @fd is what the call has returned */
+  if( fd < 0 || fd != n_rf24l01.sockets_pair[0] )
+    return -1;
+
+  if( !path || strlen( path ) >= sizeof(addr.sun_path) || n_rf24l01.tun_fd >= 0 || n_rf24l01.listen_fd >= 0 )
+    return -1;
+
+  listen_fd = socket( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0 );
+  if( listen_fd < 0 )
+    return -1;
+
+  memset( &addr, 0, sizeof(addr) );
+  addr.sun_family = AF_UNIX;
+  strcpy( addr.sun_path, path );
+
+  /* a socket a previous daemon has left */
+  unlink( path );
+
+  ret = bind( listen_fd, (struct sockaddr*)&addr, sizeof(addr) );
+  if( ret == 0 )
+    ret = listen( listen_fd, MAX_CLIENTS );
+
+  if( ret < 0 )
+  {
+    perror( "n_rf24l01_serve: fail to listen" );
+    close( listen_fd );
+    return -1;
+  }
+
+  /* clients' register accesses go through the library's thread, with the same spidev fd */
+  memset( &backend, 0, sizeof(backend) );
+  backend.send_cmd = send_cmd;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  n_rf24l01_init_dbg( &backend );
+
+  strcpy( n_rf24l01.listen_path, path );
+  n_rf24l01.listen_fd = listen_fd;
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  _wakeup_n_rf_thread();
+
+  printf( "n_rf24l01_serve: wait for clients on %s.\n", path );
+
+  return 0;
+}
+
+void n_rf24l01_close( int fd )
+{
+  _stop_n_rf24l01_library();
+}
+
+int n_rf24l01_open_dbg( void )
+{
+  n_rf24l01_backend_t backend;
+  int ret;
+
+  memset( &backend, 0, sizeof(backend) );
+
+  ret = init_n_rf24l01_backend();
   if( ret < 0 )
     return -1;
 
-  backend.send_cmd = send_cmd;
+  backend.send_cmd = send_cmd;
+
+  return n_rf24l01_init_dbg( &backend );
+}
+
+int n_rf24l01_scan( int fd, unsigned char* occupancy, unsigned int sweeps, unsigned int dwell_us )
+{
+  int ret;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  if( n_rf24l01.bonded )
+    _select_radio( 0 );
+
+  ret = n_rf24l01_scan_channels( occupancy, sweeps, dwell_us );
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return ret;
+}
+
+int n_rf24l01_tune( int fd, unsigned int channel )
+{
+  int ret;
+
+  if( channel >= N_RF24L01_CHANNELS )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  /* bonded radios keep channels they were opened with */
+  ret = n_rf24l01.bonded ? -1 : n_rf24l01_set_channel( channel );
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return ret;
+}
+
+int n_rf24l01_set_rate( int fd, unsigned int rate )
+{
+  u_int radio;
+  int ret = 0;
+
+  if( rate > N_RF24L01_RATE_250KBPS )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  if( n_rf24l01.bonded )
+    for( radio = 0; radio < n_rf24l01.radios_num && ret == 0; radio++ )
+    {
+      _select_radio( radio );
+      ret = n_rf24l01_set_data_rate( rate );
+    }
+  else
+    ret = n_rf24l01_set_data_rate( rate );
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return ret;
+}
+
+int n_rf24l01_set_power( int fd, unsigned int power )
+{
+  u_int radio;
+  int ret = 0;
+
+  if( power > N_RF24L01_POWER_0DBM )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
 
-  return n_rf24l01_init_dbg( &backend );
+  if( n_rf24l01.bonded )
+    for( radio = 0; radio < n_rf24l01.radios_num && ret == 0; radio++ )
+    {
+      _select_radio( radio );
+      ret = n_rf24l01_set_tx_power( power );
+    }
+  else
+    ret = n_rf24l01_set_tx_power( power );
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return ret;
+}
+
+void n_rf24l01_listen_before_talk( int fd, unsigned int attempts, unsigned int backoff_us )
+{
+  u_int radio;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  if( n_rf24l01.bonded )
+    for( radio = 0; radio < n_rf24l01.radios_num; radio++ )
+    {
+      _select_radio( radio );
+      n_rf24l01_set_lbt( attempts, backoff_us );
+    }
+  else
+    n_rf24l01_set_lbt( attempts, backoff_us );
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+
+int n_rf24l01_hop( int fd, unsigned int seed, const unsigned char* channels, unsigned int num,
+                   unsigned int dwell_us, int master )
+{
+  n_rf24l01_hop_role_t role;
+  int ret;
+
+  role = master ? N_RF24L01_HOP_MASTER : N_RF24L01_HOP_SLAVE;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  ret = n_rf24l01.bonded || n_rf24l01.tdma_enabled || n_rf24l01.mesh_enabled ? -1 :
+        n_rf24l01_hop_init( &n_rf24l01.hop, seed, channels, num, dwell_us, role );
+  if( ret == 0 )
+  {
+    n_rf24l01_hop_start( &n_rf24l01.hop, _get_time_us() );
+    n_rf24l01.hopping = 1;
+  }
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  /* let the thread to know about a new slot timer */
+  _wakeup_n_rf_thread();
+
+  return ret;
+}
+
+void n_rf24l01_hop_stop( int fd )
+{
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  n_rf24l01.hopping = 0;
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  /* let the thread to drop a slot timer it waits for */
+  _wakeup_n_rf_thread();
+}
+
+int n_rf24l01_set_reliable( int fd, unsigned int window )
+{
+  int ret = 0;
+
+  if( window > N_RF24L01_ARQ_MAX_WINDOW )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  /* the adaptation follows counters of the ARQ, which start anew */
+  n_rf24l01.reliable = 0;
+  n_rf24l01.adapt_enabled = 0;
+
+  if( window && ( n_rf24l01.fec_enabled || n_rf24l01.tun_fd >= 0 || n_rf24l01.bonded || n_rf24l01.tdma_enabled ||
+                  n_rf24l01.mesh_enabled ) )
+    ret = -1;
+  else if( window )
+  {
+    ret = n_rf24l01_arq_init( &n_rf24l01.arq, window, _queue_pkg, _deliver_data, NULL, _get_time_us() );
+    if( ret == 0 )
+      n_rf24l01.reliable = 1;
+  }
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  _wakeup_n_rf_thread();
+
+  return ret;
+}
+
+int n_rf24l01_set_adaptation( int fd, unsigned int target_loss, unsigned int slowest_rate )
+{
+  /* levels the slowest rate is at, by N_RF24L01_RATE_* */
+  static const u_char base_levels[] = { 1, 2, 0 };
+  int ret = 0;
+
+  if( slowest_rate > N_RF24L01_RATE_250KBPS )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  n_rf24l01.adapt_enabled = 0;
+
+  if( target_loss && !n_rf24l01.reliable )
+    ret = -1;
+  else if( target_loss )
+  {
+    n_rf24l01.adapt_data_rate = 0xff;
+
+    ret = n_rf24l01_adapt_init( &n_rf24l01.adapt, base_levels[slowest_rate], target_loss, _queue_pkg,
+                                _apply_level, NULL, _get_time_us() );
+    if( ret == 0 )
+      n_rf24l01.adapt_enabled = 1;
+  }
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  _wakeup_n_rf_thread();
+
+  return ret;
+}
+
+int n_rf24l01_set_fec( int fd, unsigned int k, unsigned int m )
+{
+  int ret = 0;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  n_rf24l01.fec_enabled = 0;
+
+  if( k && ( n_rf24l01.reliable || n_rf24l01.tun_fd >= 0 || n_rf24l01.bonded || n_rf24l01.tdma_enabled ||
+             n_rf24l01.mesh_enabled ) )
+    ret = -1;
+  else if( k )
+  {
+    ret = n_rf24l01_fec_init( &n_rf24l01.fec, k, m, _queue_pkg, _deliver_data, NULL );
+    if( ret == 0 )
+      n_rf24l01.fec_enabled = 1;
+  }
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  _wakeup_n_rf_thread();
+
+  return ret;
+}
+
+/* (re)start the TDMA in a @role, parameters are n_rf24l01_tdma_init's ones */
+static int _start_tdma( n_rf24l01_tdma_role_t role, u_int node_id, u_int slot, u_int slots, u_int slot_us )
+{
+  int ret;
+
+  if( node_id > 0xffff || slot > 0xff )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  n_rf24l01.tdma_enabled = 0;
+
+  /* the TDMA carries a raw stream only, and gates transmissions on its own */
+  if( n_rf24l01.reliable || n_rf24l01.fec_enabled || n_rf24l01.tun_fd >= 0 || n_rf24l01.bonded ||
+      n_rf24l01.hopping || n_rf24l01.mesh_enabled || n_rf24l01.pm_enabled )
+    ret = -1;
+  else
+    ret = n_rf24l01_tdma_init( &n_rf24l01.tdma, role, node_id, slot, slots, slot_us, _queue_pkg,
+                               _deliver_tdma, NULL, _get_time_us() );
+
+  if( ret == 0 )
+    n_rf24l01.tdma_enabled = 1;
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  /* let the thread to know about a new slot timer */
+  _wakeup_n_rf_thread();
+
+  return ret;
+}
+
+int n_rf24l01_tdma_gateway( int fd, unsigned int slots, unsigned int slot_us )
+{
+  return _start_tdma( N_RF24L01_TDMA_GATEWAY, 0, 0, slots, slot_us );
+}
+
+int n_rf24l01_tdma_node( int fd, unsigned int node_id, unsigned int slot )
+{
+  return _start_tdma( N_RF24L01_TDMA_NODE, node_id, slot, 0, 0 );
+}
+
+void n_rf24l01_tdma_stop( int fd )
+{
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  n_rf24l01.tdma_enabled = 0;
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  _wakeup_n_rf_thread();
+}
+
+int n_rf24l01_set_power_saving( int fd, unsigned int rx_hold_us, unsigned int standby_us,
+                                unsigned int period_us, unsigned int window_us )
+{
+  int ret;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  n_rf24l01.pm_enabled = 0;
+
+  /* the TDMA has its own schedule of a receiver, bonded radios are driven all at once */
+  if( n_rf24l01.tdma_enabled || n_rf24l01.bonded )
+    ret = -1;
+  else
+    ret = n_rf24l01_pm_init( &n_rf24l01.pm, rx_hold_us, standby_us, period_us, window_us, _apply_pm_state,
+                             NULL, _get_time_us() );
+
+  if( ret == 0 )
+    n_rf24l01.pm_enabled = 1;
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  /* let the thread to know about a new state timer */
+  _wakeup_n_rf_thread();
+
+  return ret;
+}
+
+void n_rf24l01_power_saving_stop( int fd )
+{
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  if( n_rf24l01.pm_enabled )
+  {
+    n_rf24l01.pm_enabled = 0;
+    n_rf24l01_prepare_to_receive();
+  }
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+
+int n_rf24l01_set_mesh( int fd, unsigned int addr, unsigned int dst )
+{
+  int ret = 0;
+
+  if( addr > 0xff || dst == N_RF24L01_MESH_NONE || dst > 0xff )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  n_rf24l01.mesh_enabled = 0;
+
+  /* a mesh carries a raw stream only */
+  if( addr && ( n_rf24l01.reliable || n_rf24l01.fec_enabled || n_rf24l01.tun_fd >= 0 || n_rf24l01.bonded ||
+                n_rf24l01.tdma_enabled || n_rf24l01.hopping ) )
+    ret = -1;
+  else if( addr )
+  {
+    ret = n_rf24l01_mesh_init( &n_rf24l01.mesh, addr, _queue_pkg, _deliver_mesh, NULL, _get_time_us() );
+    if( ret == 0 )
+    {
+      n_rf24l01.mesh_dst = dst;
+      n_rf24l01.mesh_enabled = 1;
+    }
+  }
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  /* let the thread to take a user's data by payloads of a mesh (or of a raw link) from now on */
+  _wakeup_n_rf_thread();
+
+  return ret;
+}
+
+int n_rf24l01_mesh_route( int fd, unsigned int dst, unsigned int next_hop )
+{
+  int ret;
+
+  if( dst > 0xff || next_hop > 0xff )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  ret = n_rf24l01.mesh_enabled ? n_rf24l01_mesh_set_route( &n_rf24l01.mesh, dst, next_hop ) : -1;
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return ret;
+}
+
+/* a public header has the mesh's bounds of its own, to not pull the core's headers in */
+_Static_assert( sizeof(((n_rf24l01_mesh_report_t*)0)->delivered_relays) ==
+                sizeof(((n_rf24l01_mesh_stats_t*)0)->delivered_relays) &&
+                sizeof(((n_rf24l01_mesh_report_t*)0)->hop_pkgs_sent) ==
+                sizeof(((n_rf24l01_mesh_stats_t*)0)->hop_pkgs_sent),
+                "the mesh's bounds of n_rf24l01_linux.h differ from the core's ones" );
+
+int n_rf24l01_get_mesh_stats( int fd, n_rf24l01_mesh_report_t* report )
+{
+  n_rf24l01_mesh_stats_t* stats = &n_rf24l01.mesh.stats;
+  u_int i;
+
+  if( !report )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  if( !n_rf24l01.mesh_enabled )
+  {
+    pthread_mutex_unlock( &n_rf24l01.core_lock );
+    return -1;
+  }
+
+  report->pkgs_sent = stats->pkgs_sent;
+  report->pkgs_delivered = stats->pkgs_delivered;
+  report->pkgs_forwarded = stats->pkgs_forwarded;
+  report->pkgs_duplicated = stats->pkgs_duplicated;
+  report->pkgs_expired = stats->pkgs_expired;
+  report->pkgs_overheard = stats->pkgs_overheard;
+
+  for( i = 0; i < N_RF24L01_MESH_MAX_RELAYS + 1; i++ )
+    report->delivered_relays[i] = stats->delivered_relays[i];
+
+  for( i = 0; i < N_RF24L01_MESH_ADDRESSES; i++ )
+  {
+    report->hop_pkgs_sent[i] = stats->hop_pkgs_sent[i];
+    report->hop_pkgs_received[i] = stats->hop_pkgs_received[i];
+  }
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return 0;
+}
+
+void n_rf24l01_set_compression( int fd, int enable )
+{
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  n_rf24l01.compression = !!enable;
+  n_rf24l01.rx_frame_len = 0;
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  _wakeup_n_rf_thread();
+}
+
+void n_rf24l01_set_coalescing( int fd, unsigned int deadline_us )
+{
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  /* what's been coalesced so far goes out framed as it was */
+  _flush_coalesced();
+
+  n_rf24l01.coalesce_us = deadline_us;
+  n_rf24l01.rx_frame_len = 0;
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  _wakeup_n_rf_thread();
+}
+
+int n_rf24l01_set_rx_queue( int fd, int policy, unsigned int timeout_ms, unsigned int high_watermark )
+{
+  if( policy != N_RF24L01_RX_DROP_NEWEST && policy != N_RF24L01_RX_DROP_OLDEST && policy != N_RF24L01_RX_BLOCK )
+    return -1;
+
+  if( !high_watermark || high_watermark > N_RF24L01_RX_QUEUE_SIZE )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  n_rf24l01.rx_queue_policy = policy;
+  n_rf24l01.rx_queue_timeout_ms = timeout_ms;
+  n_rf24l01.rx_queue_high_watermark = high_watermark;
+  n_rf24l01.rx_queue_above = 0;
+  n_rf24l01.rx_queue_stalled = 0;
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return 0;
+}
+
+int n_rf24l01_set_rx_metadata( int fd, int enable )
+{
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  /* data already queued is a stream to be taken as a whole */
+  if( !n_rf24l01.rx_metadata && enable )
+    n_rf24l01.rx_queue_boundary = n_rf24l01.rx_queue_head;
+
+  n_rf24l01.rx_metadata = !!enable;
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return 0;
+}
+
+int n_rf24l01_get_latency_report( int fd, n_rf24l01_latency_report_t* report, int reset )
+{
+  if( !report )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  *report = n_rf24l01.latency;
+
+  if( reset )
+    memset( &n_rf24l01.latency, 0, sizeof(n_rf24l01.latency) );
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return 0;
+}
+
+int n_rf24l01_get_rx_queue_event_fd( int fd )
+{
+  int ret;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  if( n_rf24l01.rx_queue_event_fd < 0 )
+    n_rf24l01.rx_queue_event_fd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+
+  ret = n_rf24l01.rx_queue_event_fd;
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return ret;
+}
+
+int n_rf24l01_get_stats( int fd, n_rf24l01_stats_t* stats )
+{
+  if( !stats )
+    return -1;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+
+  memset( stats, 0, sizeof(*stats) );
+
+  if( n_rf24l01.bonded )
+    _select_radio( 0 );
+
+  stats->spi_speed_hz = get_n_rf24l01_spi_speed();
+
+  stats->init_us = n_rf24l01.init_us;
+  stats->warm_start = n_rf24l01.warm_start;
+
+  stats->log_records_dropped = n_rf24l01_log_dropped();
+
+  stats->rx_queue_bytes = n_rf24l01.rx_queue_head - n_rf24l01.rx_queue_tail;
+  stats->rx_queue_peak_bytes = n_rf24l01.rx_queue_peak;
+  stats->rx_queue_bytes_dropped = n_rf24l01.rx_queue_bytes_dropped;
+  stats->rx_queue_high_watermark_hits = n_rf24l01.rx_queue_high_watermark_hits;
+
+#ifdef IO_URING
+  stats->uring_active = n_rf24l01.uring_active;
+  stats->uring_spi_cmd = get_n_rf24l01_spi_uring_cmd();
+  stats->uring_enters = n_rf24l01.uring.enters;
+#endif
+
+  stats->lz_bytes_in = n_rf24l01.lz_bytes_in;
+  stats->lz_bytes_out = n_rf24l01.lz_bytes_out;
+  stats->lz_compress_ns = n_rf24l01.lz_compress_ns;
+  stats->lz_decompress_ns = n_rf24l01.lz_decompress_ns;
+  stats->lz_frames_compressed = n_rf24l01.lz_frames_compressed;
+  stats->lz_frames_decompressed = n_rf24l01.lz_frames_decompressed;
+  stats->lz_frames_broken = n_rf24l01.lz_frames_broken;
+
+  stats->coalesce_records = n_rf24l01.coalesce_records;
+  stats->coalesce_bytes = n_rf24l01.coalesce_bytes;
+  stats->coalesce_room = n_rf24l01.coalesce_room;
+  stats->coalesce_payloads = n_rf24l01.coalesce_payloads;
+  stats->coalesce_full_flushes = n_rf24l01.coalesce_full_flushes;
+  stats->coalesce_deadline_flushes = n_rf24l01.coalesce_deadline_flushes;
+  stats->coalesce_records_bypassed = n_rf24l01.coalesce_records_bypassed;
+
+  if( n_rf24l01.reliable )
+  {
+    stats->arq_pkgs_sent = n_rf24l01.arq.stats.pkgs_sent;
+    stats->arq_pkgs_retransmitted = n_rf24l01.arq.stats.pkgs_retransmitted;
+    stats->arq_pkgs_received = n_rf24l01.arq.stats.pkgs_received;
+    stats->arq_pkgs_duplicated = n_rf24l01.arq.stats.pkgs_duplicated;
+    stats->arq_srtt_us = n_rf24l01.arq.srtt_mks;
+    stats->arq_rto_us = n_rf24l01.arq.rto_mks;
+    stats->arq_resets = n_rf24l01.arq.stats.resets;
+  }
+
+  if( n_rf24l01.adapt_enabled )
+  {
+    stats->adapt_data_rate = n_rf24l01.adapt_data_rate;
+    stats->adapt_level = n_rf24l01.adapt.level;
+    stats->adapt_loss = n_rf24l01.adapt.stats.last_loss;
+    stats->adapt_levels_up = n_rf24l01.adapt.stats.levels_up;
+    stats->adapt_levels_down = n_rf24l01.adapt.stats.levels_down;
+    stats->adapt_probes_failed = n_rf24l01.adapt.stats.probes_failed;
+    stats->adapt_hunts = n_rf24l01.adapt.stats.hunts;
+  }
+
+  if( n_rf24l01.fec_enabled )
+  {
+    stats->fec_pkgs_sent = n_rf24l01.fec.stats.data_pkgs_sent + n_rf24l01.fec.stats.parity_pkgs_sent;
+    stats->fec_pkgs_received = n_rf24l01.fec.stats.data_pkgs_received + n_rf24l01.fec.stats.parity_pkgs_received;
+    stats->fec_pkgs_recovered = n_rf24l01.fec.stats.pkgs_recovered;
+    stats->fec_pkgs_lost = n_rf24l01.fec.stats.pkgs_lost;
+  }
+
+  if( n_rf24l01.tdma_enabled )
+  {
+    stats->tdma_synced = n_rf24l01.tdma.synced;
+    stats->tdma_slot = n_rf24l01.tdma.assigned ? n_rf24l01.tdma.slot : -1;
+    stats->tdma_beacons_sent = n_rf24l01.tdma.stats.beacons_sent;
+    stats->tdma_beacons_received = n_rf24l01.tdma.stats.beacons_received;
+    stats->tdma_sync_losses = n_rf24l01.tdma.stats.sync_losses;
+    stats->tdma_joins = n_rf24l01.tdma.role == N_RF24L01_TDMA_GATEWAY ? n_rf24l01.tdma.stats.joins_accepted :
+                                                                       n_rf24l01.tdma.stats.joins_sent;
+    stats->tdma_pkgs_sent = n_rf24l01.tdma.stats.pkgs_sent;
+    stats->tdma_pkgs_received = n_rf24l01.tdma.stats.pkgs_received;
+    stats->tdma_leaves = n_rf24l01.tdma.stats.leaves;
+  }
+
+  if( n_rf24l01.pm_enabled )
+  {
+    n_rf24l01_pm_stats_t pm_stats;
+
+    n_rf24l01_pm_get_stats( &n_rf24l01.pm, _get_time_us(), &pm_stats );
+
+    stats->pm_down_us = pm_stats.state_mks[N_RF24L01_PM_DOWN];
+    stats->pm_standby_us = pm_stats.state_mks[N_RF24L01_PM_STANDBY];
+    stats->pm_rx_us = pm_stats.state_mks[N_RF24L01_PM_RX];
+    stats->pm_tx_us = pm_stats.state_mks[N_RF24L01_PM_TX];
+    stats->pm_wakes = pm_stats.wakes;
+    stats->pm_fast_wakes = pm_stats.fast_wakes;
+    stats->pm_windows = pm_stats.windows;
+  }
+
+  if( n_rf24l01.tun_fd >= 0 )
+  {
+    stats->tun_datagrams_sent = n_rf24l01.lowpan.stats.datagrams_sent;
+    stats->tun_datagrams_received = n_rf24l01.lowpan.stats.datagrams_received;
+    stats->tun_datagrams_dropped = n_rf24l01.lowpan.stats.datagrams_dropped;
+    stats->tun_pkgs_sent = n_rf24l01.lowpan.stats.pkgs_sent;
+    stats->tun_bytes_in = n_rf24l01.lowpan.stats.bytes_in;
+    stats->tun_bytes_out = n_rf24l01.lowpan.stats.bytes_out;
+  }
+
+  if( n_rf24l01.bonded )
+  {
+    u_int radio;
+
+    stats->bond_pkgs_reordered = n_rf24l01.bond.stats.pkgs_reordered;
+    stats->bond_pkgs_skipped = n_rf24l01.bond.stats.pkgs_skipped;
+    stats->bond_pkgs_late = n_rf24l01.bond.stats.pkgs_late;
+
+    for( radio = 0; radio < n_rf24l01.radios_num; radio++ )
+    {
+      stats->bond_link_weight[radio] = n_rf24l01.bond.links[radio].weight;
+      stats->bond_link_pkgs_sent[radio] = n_rf24l01.bond.links[radio].pkgs_sent;
+      stats->bond_link_pkgs_received[radio] = n_rf24l01.bond.links[radio].pkgs_received;
+    }
+  }
+
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  return 0;
 }
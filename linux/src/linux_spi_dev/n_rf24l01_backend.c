@@ -21,7 +21,7 @@
  *  CPOL = 0, CPHA = 0
  *  msbit first
  *  8 bits per word
- *  spi speed up to 8MHz (but now we use only 50kHz)
+ *  spi speed up to 8MHz (calibrated on a library's open, look at _calibrate_spi_speed)
  *  CSN - is active low
  */
 
@@ -30,6 +30,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
 
 #include <fcntl.h>
 #include <unistd.h>
@@ -40,10 +41,29 @@
 #include <linux/spi/spidev.h>
 
 #include "n_rf24l01_backend.h"
+#include "n_rf24l01_log.h"
 
+#ifdef IO_URING
+#include "n_rf24l01_uring.h"
+#endif
 
-#define stringizer_(NAME) #NAME
-#define _(NAME) stringizer_(NAME)
+
+/* how many commands can be sent by one SPI_IOC_MESSAGE ioctl */
+#define CMDS_PER_MESSAGE 8
+
+/* an spi speed calibration writes patterns to a 5-byte address register (RX_ADDR_P1)
+ * and reads them back, the register is restored afterwards */
+#define CALIBRATION_REG 0x0b
+#define CALIBRATION_REG_SIZE 5
+#define CALIBRATION_ROUNDS 16
+#define CALIBRATION_SLOT 8    /* CALIBRATION_REG's place among config_regs */
+
+/* registers a transceiver is configured by (all but read-only ones and the STATUS),
+ * a too fast speed may garble a command into a write to any of them */
+#define CONFIG_REGS_NUM ( sizeof(config_regs) / sizeof(config_regs[0]) )
+
+#define R_REGISTER 0x00
+#define W_REGISTER 0x20
 
 typedef struct
 {
@@ -54,51 +74,282 @@ typedef struct
    * as with files */
   int interrupt_line_fd;
   int ce_line_fd;
+
+  /* a calibrated spi speed */
+  __u32 speed_hz;
 } n_rf24l01__backend_t;
 
 
-static n_rf24l01__backend_t n_rf24l01_backend = {-1, -1, -1};
+static n_rf24l01__backend_t n_rf24l01_radios[N_RF24L01_BACKEND_MAX_RADIOS] =
+{
+  [0 ... N_RF24L01_BACKEND_MAX_RADIOS - 1] = {-1, -1, -1, 0}
+};
+
+/* a radio call-backs work with */
+static n_rf24l01__backend_t* n_rf24l01_backend = &n_rf24l01_radios[0];
+
+static const struct
+{
+  u_char addr;
+  u_char size;
+} config_regs[] =
+{
+  { 0x00, 1 }, { 0x01, 1 }, { 0x02, 1 }, { 0x03, 1 }, { 0x04, 1 }, { 0x05, 1 }, { 0x06, 1 },
+  { 0x0a, 5 }, { 0x0b, 5 }, { 0x0c, 1 }, { 0x0d, 1 }, { 0x0e, 1 }, { 0x0f, 1 }, { 0x10, 5 },
+  { 0x11, 1 }, { 0x12, 1 }, { 0x13, 1 }, { 0x14, 1 }, { 0x15, 1 }, { 0x16, 1 },
+  { 0x1c, 1 }, { 0x1d, 1 }
+};
+
+#ifdef IO_URING
+/* SPI messages go as IORING_OP_URING_CMD through a ring of their own (a library's thread
+ * waits on its ring without core_lock held), if spidev handles them, -1 - not probed yet */
+static n_rf24l01_uring_t spi_ring;
+static int spi_uring_cmd = -1;
+#endif
+
+
+/* send @num transfers as one SPI_IOC_MESSAGE, returns -1 on a failure */
+static int _spi_message( struct spi_ioc_transfer* transfers, u_int num )
+{
+#ifdef IO_URING
+  struct io_uring_sqe* sqe;
+  struct io_uring_cqe* cqe;
+  int ret;
+
+  if( spi_uring_cmd > 0 )
+  {
+    sqe = n_rf24l01_uring_get_sqe( &spi_ring );
+    if( sqe )
+    {
+      /* a command is an ioctl's request, an argument is in a command's data area */
+      sqe->opcode = IORING_OP_URING_CMD;
+      sqe->fd = n_rf24l01_backend->spi_fd;
+      sqe->cmd_op = SPI_IOC_MESSAGE(num);
+      sqe->addr3 = (uintptr_t)transfers;
+
+      /* a wait may get interrupted after the command has been submitted */
+      do
+      {
+        ret = n_rf24l01_uring_submit( &spi_ring, 1, NULL );
+        cqe = n_rf24l01_uring_peek_cqe( &spi_ring );
+      } while( !cqe && ( ret >= 0 || ret == -EINTR ) );
+
+      if( cqe )
+      {
+        ret = cqe->res;
+        n_rf24l01_uring_cqe_seen( &spi_ring );
+      }
+
+      if( ret >= 0 )
+        return ret;
+
+      errno = -ret;
+      return -1;
+    }
+  }
+#endif
+
+  return ioctl( n_rf24l01_backend->spi_fd, SPI_IOC_MESSAGE(num), transfers );
+}
+
+#ifdef IO_URING
+/* a kernel without IORING_OP_URING_CMD, or a driver without a uring_cmd handler (spidev of
+ * mainline kernels so far) fails an empty message, then ioctls are used */
+static void _probe_spi_uring_cmd( void )
+{
+  struct spi_ioc_transfer transfer;
+
+  if( spi_uring_cmd >= 0 )
+    return;
+
+  spi_uring_cmd = 0;
+
+  if( n_rf24l01_uring_init( &spi_ring, 4 ) < 0 )
+    return;
 
-static const char* interrupt_line_path = "/sys/class/gpio/gpio"_(INTERRUPT_LINE_PIN_NUM)"/value";
-static const char* ce_line_path = "/sys/class/gpio/gpio"_(CE_LINE_PIN_NUM)"/value";
+  memset( &transfer, 0, sizeof(transfer) );
 
+  spi_uring_cmd = 1;
+  if( _spi_message( &transfer, 1 ) >= 0 )
+  {
+    printf( "n_rf24l01_backend: spi messages go as io_uring commands.\n" );
+    return;
+  }
+
+  spi_uring_cmd = 0;
+  n_rf24l01_uring_exit( &spi_ring );
+}
+#endif
 
-static int _init_pins( void )
+
+static int _init_pins( u_int interrupt_line_pin, u_int ce_line_pin )
 {
-  n_rf24l01_backend.interrupt_line_fd = open( interrupt_line_path, O_RDONLY | O_CLOEXEC );
-  if( n_rf24l01_backend.interrupt_line_fd < 0 )
+  char path[64];
+
+  snprintf( path, sizeof path, "/sys/class/gpio/gpio%u/value", interrupt_line_pin );
+  n_rf24l01_backend->interrupt_line_fd = open( path, O_RDONLY | O_CLOEXEC );
+  if( n_rf24l01_backend->interrupt_line_fd < 0 )
     return -1;
 
-  n_rf24l01_backend.ce_line_fd = open( ce_line_path, O_WRONLY | O_CLOEXEC );
-  if( n_rf24l01_backend.ce_line_fd < 0 )
+  snprintf( path, sizeof path, "/sys/class/gpio/gpio%u/value", ce_line_pin );
+  n_rf24l01_backend->ce_line_fd = open( path, O_WRONLY | O_CLOEXEC );
+  if( n_rf24l01_backend->ce_line_fd < 0 )
     return -1;
 
 	return 0;
 }
 
+static int _set_spi_speed( __u32 speed_hz )
+{
+	int ret;
+
+	ret = ioctl( n_rf24l01_backend->spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed_hz );
+	if( ret < 0 )
+	{
+		perror( "error while SPI_IOC_WR_MAX_SPEED_HZ ioctl call" );
+		return -1;
+	}
+
+	/* a controller may round a speed down to what it can do */
+	ret = ioctl( n_rf24l01_backend->spi_fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed_hz );
+	if( ret < 0 )
+	{
+		perror( "error while SPI_IOC_RD_MAX_SPEED_HZ ioctl call" );
+		return -1;
+	}
+
+	n_rf24l01_backend->speed_hz = speed_hz;
+
+	return 0;
+}
+
+/* check a current spi speed: write patterns to an address register and read them back */
+static int _check_spi_speed( void )
+{
+	u_char pattern[CALIBRATION_REG_SIZE], read_back[CALIBRATION_REG_SIZE];
+	uint32_t seed = 0x2545f491;
+	int round, i;
+
+	for( round = 0; round < CALIBRATION_ROUNDS; round++ )
+	{
+		/* alternating bits stress edges the most, the rest are pseudo-random */
+		for( i = 0; i < CALIBRATION_REG_SIZE; i++ )
+		{
+			if( round == 0 )
+				pattern[i] = 0x55;
+			else if( round == 1 )
+				pattern[i] = 0xaa;
+			else
+			{
+				seed ^= seed << 13;
+				seed ^= seed >> 17;
+				seed ^= seed << 5;
+				pattern[i] = seed;
+			}
+		}
+
+		send_cmd( W_REGISTER | CALIBRATION_REG, NULL, pattern, CALIBRATION_REG_SIZE, 1 );
+		send_cmd( R_REGISTER | CALIBRATION_REG, NULL, read_back, CALIBRATION_REG_SIZE, 0 );
+
+		if( memcmp( pattern, read_back, CALIBRATION_REG_SIZE ) )
+			return -1;
+	}
+
+	return 0;
+}
+
+/* read configuration registers to @saved or write them back, at a current spi speed */
+static void _access_config_regs( u_char saved[][CALIBRATION_REG_SIZE], u_char direction )
+{
+	u_int i;
+
+	for( i = 0; i < CONFIG_REGS_NUM; i++ )
+		send_cmd( ( direction ? W_REGISTER : R_REGISTER ) | config_regs[i].addr, NULL, saved[i],
+		          config_regs[i].size, direction );
+}
+
+/* step an spi speed up from SPI_SPEED_MIN_HZ to SPI_SPEED_MAX_HZ (doubling it) while
+ * patterns survive a round trip; if some speed fails, settle a step below the fastest
+ * one which passed, as it may be marginal (e.g. on temperature drift) */
+static int _calibrate_spi_speed( void )
+{
+	u_char saved[CONFIG_REGS_NUM][CALIBRATION_REG_SIZE];
+	__u32 speed_hz, good_hz = 0, prev_good_hz = 0;
+	int ret, failed = 0;
+
+	ret = _set_spi_speed( SPI_SPEED_MIN_HZ );
+	if( ret < 0 )
+		return -1;
+
+	_access_config_regs( saved, 0 );
+
+	for( speed_hz = SPI_SPEED_MIN_HZ; ; speed_hz = speed_hz * 2 < SPI_SPEED_MAX_HZ ? speed_hz * 2 : SPI_SPEED_MAX_HZ )
+	{
+		ret = _set_spi_speed( speed_hz );
+		if( ret < 0 )
+			return -1;
+
+		if( _check_spi_speed() < 0 )
+		{
+			failed = 1;
+			break;
+		}
+
+		prev_good_hz = good_hz;
+		good_hz = n_rf24l01_backend->speed_hz;
+
+		if( speed_hz >= SPI_SPEED_MAX_HZ )
+			break;
+	}
+
+	/* a speed next to a failed one is too close to a limit, keep a margin */
+	if( failed && prev_good_hz )
+		good_hz = prev_good_hz;
+
+	if( !good_hz )
+	{
+		printf( "spi speed: no reliable speed found (is the transceiver connected?), use %uHz.\n", SPI_SPEED_MIN_HZ );
+		good_hz = SPI_SPEED_MIN_HZ;
+	}
+
+	ret = _set_spi_speed( good_hz );
+	if( ret < 0 )
+		return -1;
+
+	/* a failed step may have garbled any register, not only the one patterns go to */
+	if( failed )
+		_access_config_regs( saved, 1 );
+	else
+		send_cmd( W_REGISTER | CALIBRATION_REG, NULL, saved[CALIBRATION_SLOT], CALIBRATION_REG_SIZE, 1 );
+
+	printf( "spi speed: calibrated to %uHz (bounds: %u..%uHz).\n\n", n_rf24l01_backend->speed_hz,
+	        SPI_SPEED_MIN_HZ, SPI_SPEED_MAX_HZ );
+
+	return 0;
+}
+
 /* set up the spi master to correct settings
  * the spi on n_rf24l01 works with next settings:
  *  CPOL = 0, CPHA = 0
  *  msbit first
  *  8 bits per word
- *  spi speed up to 8MHz (but now we use only 50kHz) */
+ *  spi speed up to 8MHz (the slowest one till a calibration, n_rf24l01_open_dbg doesn't calibrate) */
 static int _setup_master_spi( void )
 {
 	int ret;
 	__u8 mode;
 	__u8 bits_order;
 	__u8 bits_per_word;
-	__u32 speed_hz;
 
 	mode = SPI_MODE_0; /* CPOL = 0, CPHA = 0 */
-	ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_WR_MODE, &mode );
+	ret = ioctl( n_rf24l01_backend->spi_fd, SPI_IOC_WR_MODE, &mode );
 	if( ret < 0 )
 	{
 		perror( "error while SPI_IOC_WR_MODE ioctl call" );
 		return -1;
 	}
 
-	ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_RD_MODE, &mode );
+	ret = ioctl( n_rf24l01_backend->spi_fd, SPI_IOC_RD_MODE, &mode );
 	if( ret < 0 )
 	{
 		perror( "error while SPI_IOC_RD_MODE ioctl call" );
@@ -106,14 +357,14 @@ static int _setup_master_spi( void )
 	}
 
 	bits_order = 0; /* msbit first */
-	ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_WR_LSB_FIRST, &bits_order );
+	ret = ioctl( n_rf24l01_backend->spi_fd, SPI_IOC_WR_LSB_FIRST, &bits_order );
 	if( ret < 0 )
 	{
 		perror( "error while SPI_IOC_WR_LSB_FIRST ioctl call" );
 		return -1;
 	}
 
-	ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_RD_LSB_FIRST, &bits_order );
+	ret = ioctl( n_rf24l01_backend->spi_fd, SPI_IOC_RD_LSB_FIRST, &bits_order );
 	if( ret < 0 )
 	{
 		perror( "error while SPI_IOC_RD_LSB_FIRST ioctl call" );
@@ -121,51 +372,39 @@ static int _setup_master_spi( void )
 	}
 
 	bits_per_word = 0; /* 8 bit per word */
-	ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits_per_word );
+	ret = ioctl( n_rf24l01_backend->spi_fd, SPI_IOC_WR_BITS_PER_WORD, &bits_per_word );
 	if( ret < 0 )
 	{
 		perror( "error while SPI_IOC_WR_BITS_PER_WORD ioctl call" );
 		return -1;
 	}
 
-	ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_RD_BITS_PER_WORD, &bits_per_word );
+	ret = ioctl( n_rf24l01_backend->spi_fd, SPI_IOC_RD_BITS_PER_WORD, &bits_per_word );
 	if( ret < 0 )
 	{
 		perror( "error while SPI_IOC_RD_BITS_PER_WORD ioctl call" );
 		return -1;
 	}
 
-	speed_hz = 500000; /* 500 kHz */
-	ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed_hz );
-	if( ret < 0 )
-	{
-		perror( "error while SPI_IOC_WR_MAX_SPEED_HZ ioctl call" );
-		return -1;
-	}
-
-	ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_RD_MAX_SPEED_HZ, &speed_hz );
-	if( ret < 0 )
-	{
-		perror( "error while SPI_IOC_RD_MAX_SPEED_HZ ioctl call" );
-		return -1;
-	}
-
 	printf( "spi mode: SPI_MODE_%hhu.\n", mode );
 	printf( "spi bits order: %s.\n", bits_order ? "lsbit first" : "msbit first" );
 	if (!bits_per_word)
 		printf( "spi bits per word: 8.\n" );
 	else
 		printf( "spi bits per word: %hhu.\n", bits_per_word );
-	printf( "spi speed: %uHz.\n\n", speed_hz );
 
-	return 0;
+	return _set_spi_speed( SPI_SPEED_MIN_HZ );
 }
 
 static void _stop_n_rf24l01_backend()
 {
-  close( n_rf24l01_backend.spi_fd );
-  close( n_rf24l01_backend.interrupt_line_fd );
-  close( n_rf24l01_backend.ce_line_fd );
+  close( n_rf24l01_backend->spi_fd );
+  close( n_rf24l01_backend->interrupt_line_fd );
+  close( n_rf24l01_backend->ce_line_fd );
+
+  n_rf24l01_backend->spi_fd = -1;
+  n_rf24l01_backend->interrupt_line_fd = -1;
+  n_rf24l01_backend->ce_line_fd = -1;
 }
 
 
@@ -174,10 +413,21 @@ static void _stop_n_rf24l01_backend()
 
 /* make all initialization steps to prepare an n_rf24l01 device to work */
 int init_n_rf24l01_backend()
+{
+  return init_n_rf24l01_backend_radio( 0, SPI_DEVICE_FILE, CE_LINE_PIN_NUM, INTERRUPT_LINE_PIN_NUM );
+}
+
+int init_n_rf24l01_backend_radio( u_int radio, const char* spi_device_file, u_int ce_line_pin,
+                                  u_int interrupt_line_pin )
 {
   int ret;
 
-  ret = _init_pins();
+  if( radio >= N_RF24L01_BACKEND_MAX_RADIOS )
+    return -1;
+
+  select_n_rf24l01_backend_radio( radio );
+
+  ret = _init_pins( interrupt_line_pin, ce_line_pin );
   if( ret < 0 )
   {
     _stop_n_rf24l01_backend();
@@ -186,17 +436,22 @@ int init_n_rf24l01_backend()
 
   printf( "n_rf24l01_backend: pins were successfully prepared to use.\n" );
 
-  n_rf24l01_backend.spi_fd = open( SPI_DEVICE_FILE, O_RDWR );
-  if( n_rf24l01_backend.spi_fd < 0 )
+  n_rf24l01_backend->spi_fd = open( spi_device_file, O_RDWR );
+  if( n_rf24l01_backend->spi_fd < 0 )
   {
     char temp[128];
 
-    snprintf( temp, sizeof temp, "error while open spidev device file: %s", SPI_DEVICE_FILE );
+    snprintf( temp, sizeof temp, "error while open spidev device file: %s", spi_device_file );
     perror( temp );
 
+    _stop_n_rf24l01_backend();
     return -1;
   }
 
+#ifdef IO_URING
+  _probe_spi_uring_cmd();
+#endif
+
   ret = _setup_master_spi();
   if( ret < 0 )
   {
@@ -208,15 +463,54 @@ int init_n_rf24l01_backend()
   return 0;
 }
 
+int calibrate_n_rf24l01_spi_speed()
+{
+  return _calibrate_spi_speed();
+}
+
+void select_n_rf24l01_backend_radio( u_int radio )
+{
+  if( radio < N_RF24L01_BACKEND_MAX_RADIOS )
+    n_rf24l01_backend = &n_rf24l01_radios[radio];
+}
+
 void deinit_n_rf24l01_backend()
 {
-  _stop_n_rf24l01_backend();
+  u_int radio;
+
+  for( radio = 0; radio < N_RF24L01_BACKEND_MAX_RADIOS; radio++ )
+  {
+    n_rf24l01_backend = &n_rf24l01_radios[radio];
+    _stop_n_rf24l01_backend();
+  }
+
+  n_rf24l01_backend = &n_rf24l01_radios[0];
+
+#ifdef IO_URING
+  if( spi_uring_cmd > 0 )
+    n_rf24l01_uring_exit( &spi_ring );
+  spi_uring_cmd = -1;
+#endif
+}
+
+unsigned int get_n_rf24l01_spi_speed()
+{
+  return n_rf24l01_backend->speed_hz;
+}
+
+int get_n_rf24l01_spi_uring_cmd()
+{
+#ifdef IO_URING
+  return spi_uring_cmd > 0;
+#else
+  return 0;
+#endif
 }
 
 int get_n_rf24l01_interrupt_line_fd()
 {
   /* no duplication, 'cause a backend and a wrapper are part of one thing - the library */
-  return n_rf24l01_backend.interrupt_line_fd;
+  return n_rf24l01_backend->interrupt_line_fd;
 }
 
 
@@ -231,9 +525,9 @@ void set_up_ce_pin( u_char value )
   /* write either 1 or 0 to construst either '0' or '1' */
   snprintf( str, sizeof str, "%u", !!value );
 
-  ret = write( n_rf24l01_backend.ce_line_fd, str, 1 );
+  ret = write( n_rf24l01_backend->ce_line_fd, str, 1 );
   if( ret < 0 || ret != 1 )
-    printf( "error while set_up_pin call.\n" );
+    N_RF24L01_LOG_ERRNO( "error while set_up_pin call" );
 
   return;
 }
@@ -268,13 +562,63 @@ void send_cmd( u_char cmd, u_char* status_reg, u_char* data, u_char num, u_char
   transfers[1].len = num;
 
   /* ask to do actually spi fullduplex transactions */
-  if( !num )
-    ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_MESSAGE(1), transfers );
-  else
-    ret = ioctl( n_rf24l01_backend.spi_fd, SPI_IOC_MESSAGE(2), transfers );
+  ret = _spi_message( transfers, num ? 2 : 1 );
 
   if( ret < 0 )
-      perror( "error while SPI_IOC_MESSAGE ioctl" );
+      N_RF24L01_LOG_ERRNO( "error while SPI_IOC_MESSAGE ioctl" );
+}
+
+void send_cmds( const n_rf24l01_cmd_t* cmds, u_int num )
+{
+  struct spi_ioc_transfer transfers[2 * CMDS_PER_MESSAGE];
+  u_int i, count;
+  int ret;
+
+  /* a batch goes as a whole or not at all, as commands of it may depend on each other */
+  for( i = 0; i < num; i++ )
+    if( cmds[i].num && !cmds[i].data )
+    {
+      N_RF24L01_LOG_ERROR( "send_cmds: a command #%lld (0x%llx) has no data, a batch isn't sent.", i, cmds[i].cmd );
+      return;
+    }
+
+  while( num )
+  {
+    memset( transfers, 0, sizeof(transfers) );
+
+    for( i = 0, count = 0; i < num && i < CMDS_PER_MESSAGE; i++ )
+    {
+      transfers[count].tx_buf = (uintptr_t)&cmds[i].cmd;
+      transfers[count].rx_buf = (uintptr_t)cmds[i].status_reg;
+      transfers[count].len = 1;
+      count++;
+
+      if( cmds[i].num )
+      {
+        if( cmds[i].direction )
+          transfers[count].tx_buf = (uintptr_t)cmds[i].data;
+        else
+          transfers[count].rx_buf = (uintptr_t)cmds[i].data;
+
+        transfers[count].len = cmds[i].num;
+        count++;
+      }
+
+      /* deassert CSN between commands, as each command has to be started by
+       * a high to low transition on CSN */
+      transfers[count - 1].cs_change = 1;
+    }
+
+    /* the last command of a message leaves CSN deasserted anyway */
+    transfers[count - 1].cs_change = 0;
+
+    ret = _spi_message( transfers, count );
+    if( ret < 0 )
+      N_RF24L01_LOG_ERRNO( "error while SPI_IOC_MESSAGE ioctl" );
+
+    cmds += i;
+    num -= i;
+  }
 }
 
 void usleep_( u_int delay_mks )
@@ -10,13 +10,36 @@
 
 #include "n_rf24l01_core.h"
 
+/* how many transceivers the backend can drive */
+#define N_RF24L01_BACKEND_MAX_RADIOS 4
+
+/* prepare a transceiver described by config.h as radio 0 */
 int init_n_rf24l01_backend();
+
+/* prepare one more transceiver, it gets selected */
+int init_n_rf24l01_backend_radio( u_int radio, const char* spi_device_file, u_int ce_line_pin,
+                                  u_int interrupt_line_pin );
+
+/* find the fastest reliable spi speed of a selected radio, a radio is prepared at the slowest one */
+int calibrate_n_rf24l01_spi_speed();
+
+/* cbs and get_n_rf24l01_interrupt_line_fd work with a selected radio (radio 0 by default) */
+void select_n_rf24l01_backend_radio( u_int radio );
+
+/* release all radios */
 void deinit_n_rf24l01_backend();
 int get_n_rf24l01_interrupt_line_fd();
 
+/* an spi speed a selected radio's calibration has settled on, in Hz */
+unsigned int get_n_rf24l01_spi_speed();
+
+/* 1 - spi messages go as io_uring commands, not as ioctls (an IO_URING build only) */
+int get_n_rf24l01_spi_uring_cmd();
+
 /* cbs provided by this backend */
 void set_up_ce_pin( u_char value );
 void send_cmd( u_char cmd, u_char* status_reg, u_char* data, u_char num, u_char direction );
+void send_cmds( const n_rf24l01_cmd_t* cmds, u_int num );
 void usleep_( u_int delay_mks );
 
 #endif /* N_RF24L01_BACKEND_H */
@@ -0,0 +1,327 @@
+/*
+ * n_rf24l01_client.c
+ *
+ * A client side of a daemon mode (look at n_rf24l01_serve): a process which doesn't own
+ * the transceiver talks to a daemon over a shared memory and a pair of eventfds.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/un.h>
+
+#include "n_rf24l01_shm.h"
+#include "n_rf24l01_linux.h"
+
+/* how many daemons a process may be connected to at once */
+#define MAX_CONNECTIONS 4
+
+typedef struct
+{
+  int client_bell;  /* an fd a user polls, -1 - a free slot */
+  int daemon_bell;
+  int sock_fd;
+  n_rf24l01_shm_t* shm;
+
+  /* one register access at time */
+  pthread_mutex_t reg_lock;
+} n_rf24l01_connection_t;
+
+
+static n_rf24l01_connection_t connections[MAX_CONNECTIONS] =
+{
+  [0 ... MAX_CONNECTIONS - 1] = { .client_bell = -1, .reg_lock = PTHREAD_MUTEX_INITIALIZER }
+};
+
+static pthread_mutex_t connections_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+static n_rf24l01_connection_t* _get_connection( int fd )
+{
+  int i;
+
+  if( fd < 0 )
+    return NULL;
+
+  for( i = 0; i < MAX_CONNECTIONS; i++ )
+    if( connections[i].client_bell == fd )
+      return &connections[i];
+
+  return NULL;
+}
+
+static void _ring_bell( int bell_fd )
+{
+  uint64_t value = 1;
+
+  write( bell_fd, &value, sizeof(value) );
+}
+
+/* wait for a daemon to ring, returns -1 if it's gone */
+static int _wait_daemon( n_rf24l01_connection_t* connection )
+{
+  struct pollfd events_fd[2];
+  uint64_t value;
+  int ret;
+
+  events_fd[0].fd = connection->client_bell;
+  events_fd[0].events = POLLIN;
+  events_fd[1].fd = connection->sock_fd;
+  events_fd[1].events = POLLIN;
+
+  do
+    ret = poll( events_fd, 2, -1 );
+  while( ret < 0 && errno == EINTR );
+
+  if( ret <= 0 || events_fd[1].revents )
+    return -1;
+
+  read( connection->client_bell, &value, sizeof(value) );
+
+  return 0;
+}
+
+/* the bell is shared with a user who polls it for data, so after it's been waited for
+ * let it ring again if there's data the ring might have been rung for */
+static void _rearm_bell( n_rf24l01_connection_t* connection )
+{
+  n_rf24l01_shm_ring_t* ring = &connection->shm->to_client;
+
+  if( atomic_load_explicit( &ring->head, memory_order_acquire ) != atomic_load_explicit( &ring->tail, memory_order_relaxed ) )
+    _ring_bell( connection->client_bell );
+}
+
+static int _access_register( int fd, unsigned char reg_addr, unsigned long long* value, int write_access )
+{
+  n_rf24l01_connection_t* connection = _get_connection( fd );
+  n_rf24l01_shm_t* shm;
+  int ret = 0;
+
+  if( !connection || !value )
+    return -1;
+
+  shm = connection->shm;
+
+  pthread_mutex_lock( &connection->reg_lock );
+
+  shm->reg_addr = reg_addr;
+  shm->reg_write = write_access;
+  shm->reg_value = *value;
+  atomic_store_explicit( &shm->reg_state, N_RF24L01_SHM_REG_REQUEST, memory_order_release );
+
+  _ring_bell( connection->daemon_bell );
+
+  while( atomic_load_explicit( &shm->reg_state, memory_order_acquire ) != N_RF24L01_SHM_REG_DONE )
+  {
+    ret = _wait_daemon( connection );
+    if( ret < 0 )
+      break;
+  }
+
+  if( ret == 0 )
+    *value = shm->reg_value;
+
+  atomic_store_explicit( &shm->reg_state, N_RF24L01_SHM_REG_IDLE, memory_order_relaxed );
+
+  pthread_mutex_unlock( &connection->reg_lock );
+
+  _rearm_bell( connection );
+
+  return ret;
+}
+
+
+/* Public API */
+
+
+int n_rf24l01_connect( const char* path )
+{
+  n_rf24l01_connection_t* connection = NULL;
+  char control[CMSG_SPACE(3 * sizeof(int))];
+  struct sockaddr_un addr;
+  struct msghdr msg;
+  struct cmsghdr* cmsg;
+  struct iovec iov;
+  n_rf24l01_shm_t* shm;
+  u_char version;
+  int fds[3];
+  int sock_fd, i, ret;
+
+  if( !path || strlen( path ) >= sizeof(addr.sun_path) )
+    return -1;
+
+  sock_fd = socket( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0 );
+  if( sock_fd < 0 )
+    return -1;
+
+  memset( &addr, 0, sizeof(addr) );
+  addr.sun_family = AF_UNIX;
+  strcpy( addr.sun_path, path );
+
+  ret = connect( sock_fd, (struct sockaddr*)&addr, sizeof(addr) );
+  if( ret < 0 )
+  {
+    close( sock_fd );
+    return -1;
+  }
+
+  iov.iov_base = &version;
+  iov.iov_len = sizeof(version);
+
+  memset( &msg, 0, sizeof(msg) );
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  /* a daemon passes a shared memory and doorbells right away, or closes a connection */
+  ret = recvmsg( sock_fd, &msg, MSG_CMSG_CLOEXEC );
+  cmsg = CMSG_FIRSTHDR( &msg );
+
+  if( ret <= 0 || !cmsg || cmsg->cmsg_type != SCM_RIGHTS || cmsg->cmsg_len != CMSG_LEN( sizeof(fds) ) )
+  {
+    close( sock_fd );
+    return -1;
+  }
+
+  memcpy( fds, CMSG_DATA( cmsg ), sizeof(fds) );
+
+  shm = mmap( NULL, sizeof(n_rf24l01_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0 );
+  close( fds[0] );
+
+  if( shm == MAP_FAILED || shm->magic != N_RF24L01_SHM_MAGIC )
+    goto fail;
+
+  pthread_mutex_lock( &connections_lock );
+
+  for( i = 0; i < MAX_CONNECTIONS; i++ )
+    if( connections[i].client_bell < 0 )
+    {
+      connection = &connections[i];
+
+      connection->sock_fd = sock_fd;
+      connection->daemon_bell = fds[1];
+      connection->shm = shm;
+      connection->client_bell = fds[2];
+      break;
+    }
+
+  pthread_mutex_unlock( &connections_lock );
+
+  if( connection )
+    return fds[2];
+
+fail:
+  if( shm != MAP_FAILED )
+    munmap( shm, sizeof(n_rf24l01_shm_t) );
+
+  close( fds[1] );
+  close( fds[2] );
+  close( sock_fd );
+
+  return -1;
+}
+
+int n_rf24l01_client_read( int fd, void* buf, unsigned int num )
+{
+  n_rf24l01_connection_t* connection = _get_connection( fd );
+  uint64_t value;
+
+  if( !connection || !buf )
+    return -1;
+
+  /* reset the bell before a ring is looked at, to not miss a next ring */
+  read( connection->client_bell, &value, sizeof(value) );
+
+  return n_rf24l01_shm_ring_read( &connection->shm->to_client, buf, num );
+}
+
+int n_rf24l01_client_write( int fd, const void* data, unsigned int num )
+{
+  n_rf24l01_connection_t* connection = _get_connection( fd );
+  const u_char* src = data;
+  u_int size;
+  int ret, waited = 0;
+
+  if( !connection || !data )
+    return -1;
+
+  while( num )
+  {
+    size = num < N_RF24L01_SHM_MAX_RECORD ? num : N_RF24L01_SHM_MAX_RECORD;
+
+    ret = n_rf24l01_shm_ring_put_record( &connection->shm->to_daemon, src, size );
+    if( ret < 0 )
+      return -1;
+
+    /* a daemon takes records as a transceiver goes, wait for a room */
+    if( ret == 0 )
+    {
+      _ring_bell( connection->daemon_bell );
+
+      if( _wait_daemon( connection ) < 0 )
+        return -1;
+
+      waited = 1;
+      continue;
+    }
+
+    src += size;
+    num -= size;
+  }
+
+  _ring_bell( connection->daemon_bell );
+
+  if( waited )
+    _rearm_bell( connection );
+
+  return src - (const u_char*)data;
+}
+
+unsigned int n_rf24l01_client_dropped( int fd )
+{
+  n_rf24l01_connection_t* connection = _get_connection( fd );
+
+  if( !connection )
+    return 0;
+
+  return atomic_load_explicit( &connection->shm->to_client_dropped, memory_order_relaxed );
+}
+
+int n_rf24l01_client_read_register( int fd, unsigned char reg_addr, unsigned long long* value )
+{
+  return _access_register( fd, reg_addr, value, 0 );
+}
+
+int n_rf24l01_client_write_register( int fd, unsigned char reg_addr, unsigned long long value )
+{
+  return _access_register( fd, reg_addr, &value, 1 );
+}
+
+void n_rf24l01_disconnect( int fd )
+{
+  n_rf24l01_connection_t* connection;
+
+  pthread_mutex_lock( &connections_lock );
+
+  connection = _get_connection( fd );
+  if( connection )
+  {
+    munmap( connection->shm, sizeof(n_rf24l01_shm_t) );
+
+    close( connection->sock_fd );
+    close( connection->daemon_bell );
+    close( connection->client_bell );
+
+    connection->client_bell = -1;
+  }
+
+  pthread_mutex_unlock( &connections_lock );
+}
@@ -0,0 +1,179 @@
+/*
+ * n_rf24l01_log.c
+ *
+ * Each thread which logs owns a ring while it lives, so a thread which puts records
+ * and one which drains them are the only ones to synchronize on a ring.
+ */
+
+#define _GNU_SOURCE /* strerror_r */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "n_rf24l01_log.h"
+
+#define RING_MASK ( N_RF24L01_LOG_RING_SIZE - 1 )
+
+typedef struct
+{
+  /* a thread which puts records, 0 - a ring is free */
+  _Atomic int owned;
+
+  /* positions are free-running */
+  _Atomic uint32_t head;
+  _Atomic uint32_t tail;
+
+  n_rf24l01_log_record_t records[N_RF24L01_LOG_RING_SIZE];
+} n_rf24l01_log_ring_t;
+
+
+static n_rf24l01_log_ring_t rings[N_RF24L01_LOG_MAX_THREADS];
+
+/* records which got no room, either in a ring or for a ring */
+static _Atomic uint32_t dropped;
+
+static __thread n_rf24l01_log_ring_t* thread_ring;
+
+/* to give a ring back once a thread is gone */
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+/* one thread drains at time */
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char* level_names[] = { "error", "warn", "info", "debug" };
+
+
+/* records a ring still has get drained by anyone, even if a ring is taken by another thread */
+static void _release_ring( void* ring )
+{
+  atomic_store_explicit( &((n_rf24l01_log_ring_t*)ring)->owned, 0, memory_order_release );
+}
+
+static void _create_ring_key( void )
+{
+  pthread_key_create( &ring_key, _release_ring );
+}
+
+static n_rf24l01_log_ring_t* _get_ring( void )
+{
+  int i, pass, free;
+
+  if( thread_ring )
+    return thread_ring;
+
+  pthread_once( &ring_key_once, _create_ring_key );
+
+  /* a ring a gone thread left records in is taken only if there're no drained ones */
+  for( pass = 0; pass < 2 && !thread_ring; pass++ )
+    for( i = 0; i < N_RF24L01_LOG_MAX_THREADS; i++ )
+    {
+      if( !pass && atomic_load_explicit( &rings[i].head, memory_order_relaxed ) !=
+                   atomic_load_explicit( &rings[i].tail, memory_order_relaxed ) )
+        continue;
+
+      free = 0;
+      if( atomic_compare_exchange_strong_explicit( &rings[i].owned, &free, 1, memory_order_acquire,
+                                                   memory_order_relaxed ) )
+      {
+        thread_ring = &rings[i];
+        pthread_setspecific( ring_key, thread_ring );
+        break;
+      }
+    }
+
+  return thread_ring;
+}
+
+void n_rf24l01_log_put( int level, int err, const char* fmt, long long arg0, long long arg1,
+                        long long arg2, long long arg3 )
+{
+  n_rf24l01_log_ring_t* ring = _get_ring();
+  n_rf24l01_log_record_t* record;
+  struct timespec time;
+  uint32_t head, tail;
+
+  if( !ring )
+  {
+    atomic_fetch_add_explicit( &dropped, 1, memory_order_relaxed );
+    return;
+  }
+
+  head = atomic_load_explicit( &ring->head, memory_order_relaxed );
+  tail = atomic_load_explicit( &ring->tail, memory_order_acquire );
+
+  /* the newest record gets dropped, a thread which logs mustn't wait */
+  if( head - tail >= N_RF24L01_LOG_RING_SIZE )
+  {
+    atomic_fetch_add_explicit( &dropped, 1, memory_order_relaxed );
+    return;
+  }
+
+  clock_gettime( CLOCK_MONOTONIC, &time );
+
+  record = &ring->records[head & RING_MASK];
+  record->time_ns = time.tv_sec * 1000000000ull + time.tv_nsec;
+  record->fmt = fmt;
+  record->level = level;
+  record->err = err;
+  record->args[0] = arg0;
+  record->args[1] = arg1;
+  record->args[2] = arg2;
+  record->args[3] = arg3;
+
+  atomic_store_explicit( &ring->head, head + 1, memory_order_release );
+}
+
+unsigned int n_rf24l01_log_drain( int out_fd )
+{
+  n_rf24l01_log_record_t* record;
+  char error_buf[128];
+  char line[256];
+  uint32_t head, tail;
+  unsigned int count = 0, len;
+  int i;
+
+  pthread_mutex_lock( &drain_lock );
+
+  for( i = 0; i < N_RF24L01_LOG_MAX_THREADS; i++ )
+  {
+    tail = atomic_load_explicit( &rings[i].tail, memory_order_relaxed );
+    head = atomic_load_explicit( &rings[i].head, memory_order_acquire );
+
+    for( ; tail != head; tail++, count++ )
+    {
+      record = &rings[i].records[tail & RING_MASK];
+
+      len = snprintf( line, sizeof(line), "[%llu.%06llu] %s: ", (unsigned long long)( record->time_ns / 1000000000 ),
+                      (unsigned long long)( record->time_ns % 1000000000 / 1000 ), level_names[record->level] );
+      len += snprintf( line + len, sizeof(line) - len, record->fmt, record->args[0], record->args[1],
+                       record->args[2], record->args[3] );
+
+      if( record->err && len < sizeof(line) )
+        len += snprintf( line + len, sizeof(line) - len, ": %s",
+                         strerror_r( record->err, error_buf, sizeof(error_buf) ) );
+
+      /* a too long line is cut */
+      if( len > sizeof(line) - 2 )
+        len = sizeof(line) - 2;
+
+      line[len++] = '\n';
+      write( out_fd, line, len );
+    }
+
+    atomic_store_explicit( &rings[i].tail, tail, memory_order_release );
+  }
+
+  pthread_mutex_unlock( &drain_lock );
+
+  return count;
+}
+
+unsigned int n_rf24l01_log_dropped( void )
+{
+  return atomic_load_explicit( &dropped, memory_order_relaxed );
+}
@@ -0,0 +1,91 @@
+/*
+ * n_rf24l01_log.h
+ *
+ * A logging for a library's hot paths: a record is a timestamp, a format string and up to
+ * 4 integer arguments put as is to a ring of a thread which logs, formatting and an output
+ * happen later, while rings get drained (look at n_rf24l01_log_drain).
+ */
+
+#ifndef N_RF24L01_LOG_H
+#define N_RF24L01_LOG_H
+
+#include <stdint.h>
+#include <errno.h>
+
+#include "config.h"
+
+#define N_RF24L01_LOG_LEVEL_ERROR 0
+#define N_RF24L01_LOG_LEVEL_WARN  1
+#define N_RF24L01_LOG_LEVEL_INFO  2
+#define N_RF24L01_LOG_LEVEL_DEBUG 3
+
+/* records above the level aren't compiled in at all */
+#ifndef LOG_LEVEL
+#define LOG_LEVEL N_RF24L01_LOG_LEVEL_INFO
+#endif
+
+/* how many threads may log at once, each of them gets its own ring of records,
+ * a size of a ring is a power of 2 */
+#define N_RF24L01_LOG_MAX_THREADS 8
+#define N_RF24L01_LOG_RING_SIZE 256
+
+#define N_RF24L01_LOG_MAX_ARGS 4
+
+typedef struct n_rf24l01_log_record_t
+{
+  uint64_t time_ns;   /* CLOCK_MONOTONIC */
+  const char* fmt;    /* a string literal, it's used after the record is put */
+  int level;
+  int err;            /* an errno to be appended as a text, 0 - none */
+  long long args[N_RF24L01_LOG_MAX_ARGS];
+} n_rf24l01_log_record_t;
+
+/* put a record to a ring of a calling thread, the record is dropped if the ring is full;
+ * use macros below instead */
+void n_rf24l01_log_put( int level, int err, const char* fmt, long long arg0, long long arg1,
+                        long long arg2, long long arg3 );
+
+/* format records of all rings and write them to @out_fd, returns an amount of records */
+unsigned int n_rf24l01_log_drain( int out_fd );
+
+/* an amount of records which were dropped as rings were full */
+unsigned int n_rf24l01_log_dropped( void );
+
+/* arguments are passed as long long, so a format has to use %ll* conversions only,
+ * and strings can't be passed (they may be gone till a record is drained) */
+#define N_RF24L01_LOG_ARGS_( dummy, arg0, arg1, arg2, arg3, ... ) \
+  (long long)(arg0), (long long)(arg1), (long long)(arg2), (long long)(arg3)
+
+#define N_RF24L01_LOG_PUT_( level, err, fmt, ... ) \
+  n_rf24l01_log_put( level, err, fmt, N_RF24L01_LOG_ARGS_( 0, ##__VA_ARGS__, 0, 0, 0, 0 ) )
+
+#define N_RF24L01_LOG_NOTHING_ do {} while( 0 )
+
+#if LOG_LEVEL >= N_RF24L01_LOG_LEVEL_ERROR
+#define N_RF24L01_LOG_ERROR( fmt, ... ) N_RF24L01_LOG_PUT_( N_RF24L01_LOG_LEVEL_ERROR, 0, fmt, ##__VA_ARGS__ )
+/* like perror, a current errno is appended */
+#define N_RF24L01_LOG_ERRNO( fmt, ... ) N_RF24L01_LOG_PUT_( N_RF24L01_LOG_LEVEL_ERROR, errno, fmt, ##__VA_ARGS__ )
+#else
+#define N_RF24L01_LOG_ERROR( fmt, ... ) N_RF24L01_LOG_NOTHING_
+#define N_RF24L01_LOG_ERRNO( fmt, ... ) N_RF24L01_LOG_NOTHING_
+#endif
+
+#if LOG_LEVEL >= N_RF24L01_LOG_LEVEL_WARN
+#define N_RF24L01_LOG_WARN( fmt, ... ) N_RF24L01_LOG_PUT_( N_RF24L01_LOG_LEVEL_WARN, 0, fmt, ##__VA_ARGS__ )
+#else
+#define N_RF24L01_LOG_WARN( fmt, ... ) N_RF24L01_LOG_NOTHING_
+#endif
+
+#if LOG_LEVEL >= N_RF24L01_LOG_LEVEL_INFO
+#define N_RF24L01_LOG_INFO( fmt, ... ) N_RF24L01_LOG_PUT_( N_RF24L01_LOG_LEVEL_INFO, 0, fmt, ##__VA_ARGS__ )
+#else
+#define N_RF24L01_LOG_INFO( fmt, ... ) N_RF24L01_LOG_NOTHING_
+#endif
+
+#if LOG_LEVEL >= N_RF24L01_LOG_LEVEL_DEBUG
+#define N_RF24L01_LOG_DEBUG( fmt, ... ) N_RF24L01_LOG_PUT_( N_RF24L01_LOG_LEVEL_DEBUG, 0, fmt, ##__VA_ARGS__ )
+#else
+#define N_RF24L01_LOG_DEBUG( fmt, ... ) N_RF24L01_LOG_NOTHING_
+#endif
+
+#endif /* N_RF24L01_LOG_H */
@@ -0,0 +1,145 @@
+/*
+ * n_rf24l01_shm.c
+ *
+ * Rings in a memory shared by a daemon and a client, each ring has one producer
+ * and one consumer, so positions are the only thing they synchronize on.
+ */
+
+#include <string.h>
+
+#include "n_rf24l01_shm.h"
+
+#define RING_MASK ( N_RF24L01_SHM_RING_SIZE - 1 )
+
+/* a record is a 4-byte length followed by data, aligned to 4 bytes; a record never wraps,
+ * a padding marker is put instead, if the rest of a ring is too short */
+#define RECORD_HEADER_SIZE 4
+#define RECORD_PADDING 0xffffffff
+#define RECORD_SIZE(NUM) ( RECORD_HEADER_SIZE + ( ( (NUM) + 3 ) & ~3u ) )
+
+
+u_int n_rf24l01_shm_ring_write( n_rf24l01_shm_ring_t* ring, const void* data, u_int num )
+{
+  uint32_t head, tail;
+  u_int pos, count;
+
+  head = atomic_load_explicit( &ring->head, memory_order_relaxed );
+  tail = atomic_load_explicit( &ring->tail, memory_order_acquire );
+
+  if( num > N_RF24L01_SHM_RING_SIZE - ( head - tail ) )
+    num = N_RF24L01_SHM_RING_SIZE - ( head - tail );
+
+  pos = head & RING_MASK;
+  count = N_RF24L01_SHM_RING_SIZE - pos < num ? N_RF24L01_SHM_RING_SIZE - pos : num;
+
+  memcpy( ring->data + pos, data, count );
+  memcpy( ring->data, (const u_char*)data + count, num - count );
+
+  atomic_store_explicit( &ring->head, head + num, memory_order_release );
+
+  return num;
+}
+
+u_int n_rf24l01_shm_ring_read( n_rf24l01_shm_ring_t* ring, void* buf, u_int num )
+{
+  uint32_t head, tail;
+  u_int pos, count;
+
+  tail = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+  head = atomic_load_explicit( &ring->head, memory_order_acquire );
+
+  if( num > head - tail )
+    num = head - tail;
+
+  pos = tail & RING_MASK;
+  count = N_RF24L01_SHM_RING_SIZE - pos < num ? N_RF24L01_SHM_RING_SIZE - pos : num;
+
+  memcpy( buf, ring->data + pos, count );
+  memcpy( (u_char*)buf + count, ring->data, num - count );
+
+  atomic_store_explicit( &ring->tail, tail + num, memory_order_release );
+
+  return num;
+}
+
+int n_rf24l01_shm_ring_put_record( n_rf24l01_shm_ring_t* ring, const void* data, u_int num )
+{
+  uint32_t head, tail, length;
+  u_int pos, till_end, size;
+
+  if( !num || num > N_RF24L01_SHM_MAX_RECORD )
+    return -1;
+
+  head = atomic_load_explicit( &ring->head, memory_order_relaxed );
+  tail = atomic_load_explicit( &ring->tail, memory_order_acquire );
+
+  size = RECORD_SIZE( num );
+  pos = head & RING_MASK;
+  till_end = N_RF24L01_SHM_RING_SIZE - pos;
+
+  if( till_end < size )
+  {
+    if( N_RF24L01_SHM_RING_SIZE - ( head - tail ) < till_end + size )
+      return 0;
+
+    length = RECORD_PADDING;
+    memcpy( ring->data + pos, &length, RECORD_HEADER_SIZE );
+
+    head += till_end;
+    pos = 0;
+  }
+  else if( N_RF24L01_SHM_RING_SIZE - ( head - tail ) < size )
+    return 0;
+
+  length = num;
+  memcpy( ring->data + pos, &length, RECORD_HEADER_SIZE );
+  memcpy( ring->data + pos + RECORD_HEADER_SIZE, data, num );
+
+  atomic_store_explicit( &ring->head, head + size, memory_order_release );
+
+  return 1;
+}
+
+const u_char* n_rf24l01_shm_ring_peek_record( n_rf24l01_shm_ring_t* ring, u_int* num )
+{
+  uint32_t head, tail, length;
+  u_int pos;
+
+  while( 1 )
+  {
+    tail = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+    head = atomic_load_explicit( &ring->head, memory_order_acquire );
+
+    if( head == tail )
+      return NULL;
+
+    pos = tail & RING_MASK;
+    memcpy( &length, ring->data + pos, RECORD_HEADER_SIZE );
+
+    if( length != RECORD_PADDING )
+      break;
+
+    atomic_store_explicit( &ring->tail, tail + N_RF24L01_SHM_RING_SIZE - pos, memory_order_release );
+  }
+
+  /* a broken record, a client is the only one to suffer */
+  if( !length || length > N_RF24L01_SHM_MAX_RECORD || pos + RECORD_SIZE( length ) > N_RF24L01_SHM_RING_SIZE )
+  {
+    atomic_store_explicit( &ring->tail, head, memory_order_release );
+    return NULL;
+  }
+
+  *num = length;
+
+  return ring->data + pos + RECORD_HEADER_SIZE;
+}
+
+void n_rf24l01_shm_ring_drop_record( n_rf24l01_shm_ring_t* ring )
+{
+  uint32_t tail, length;
+
+  tail = atomic_load_explicit( &ring->tail, memory_order_relaxed );
+  memcpy( &length, ring->data + ( tail & RING_MASK ), RECORD_HEADER_SIZE );
+
+  atomic_store_explicit( &ring->tail, tail + RECORD_SIZE( length ), memory_order_release );
+}
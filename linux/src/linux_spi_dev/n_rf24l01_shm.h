@@ -0,0 +1,77 @@
+/*
+ * n_rf24l01_shm.h
+ *
+ * A layout of a memory a daemon shares with each of its clients (look at n_rf24l01_serve),
+ * and single-producer/single-consumer rings in it.
+ */
+
+#ifndef N_RF24L01_SHM_H
+#define N_RF24L01_SHM_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "n_rf24l01_core.h"
+
+#define N_RF24L01_SHM_MAGIC 0x6e726632
+
+/* a size of a ring, a power of 2 */
+#define N_RF24L01_SHM_RING_SIZE 16384
+
+/* a max size of a record a client may put to a daemon at once */
+#define N_RF24L01_SHM_MAX_RECORD 256
+
+/* states of a register access */
+#define N_RF24L01_SHM_REG_IDLE    0
+#define N_RF24L01_SHM_REG_REQUEST 1
+#define N_RF24L01_SHM_REG_DONE    2
+
+/* positions are free-running, a producer and a consumer live on their own cache lines */
+typedef struct n_rf24l01_shm_ring_t
+{
+  _Atomic uint32_t head;
+  u_char pad_head[60];
+
+  _Atomic uint32_t tail;
+  u_char pad_tail[60];
+
+  u_char data[N_RF24L01_SHM_RING_SIZE];
+} n_rf24l01_shm_ring_t;
+
+typedef struct n_rf24l01_shm_t
+{
+  uint32_t magic;
+
+  /* records a client wants to transmit, each of them goes to the transceiver as is */
+  n_rf24l01_shm_ring_t to_daemon;
+
+  /* a stream received from a remote side */
+  n_rf24l01_shm_ring_t to_client;
+
+  /* bytes a daemon had to throw away, as a client didn't keep up with a stream */
+  _Atomic uint32_t to_client_dropped;
+
+  /* a register access, one at time, a client fills a request in and sets
+   * reg_state to N_RF24L01_SHM_REG_REQUEST, a daemon sets it to N_RF24L01_SHM_REG_DONE */
+  _Atomic uint32_t reg_state;
+  uint32_t reg_addr;
+  uint32_t reg_write;
+  uint64_t reg_value;
+} n_rf24l01_shm_t;
+
+/* copy up to @num bytes to a ring, returns an amount of copied bytes */
+u_int n_rf24l01_shm_ring_write( n_rf24l01_shm_ring_t* ring, const void* data, u_int num );
+
+/* copy up to @num bytes from a ring, returns an amount of copied bytes */
+u_int n_rf24l01_shm_ring_read( n_rf24l01_shm_ring_t* ring, void* buf, u_int num );
+
+/* put a record of @num [1..N_RF24L01_SHM_MAX_RECORD] bytes as a whole,
+ * returns 0 if there's no room, -1 if @num is wrong, 1 otherwise */
+int n_rf24l01_shm_ring_put_record( n_rf24l01_shm_ring_t* ring, const void* data, u_int num );
+
+/* get a pointer to a next record right in a ring, NULL - no records,
+ * the record stays in the ring till n_rf24l01_shm_ring_drop_record */
+const u_char* n_rf24l01_shm_ring_peek_record( n_rf24l01_shm_ring_t* ring, u_int* num );
+void n_rf24l01_shm_ring_drop_record( n_rf24l01_shm_ring_t* ring );
+
+#endif /* N_RF24L01_SHM_H */
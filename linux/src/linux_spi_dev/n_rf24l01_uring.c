@@ -0,0 +1,190 @@
+/*
+ * n_rf24l01_uring.c
+ *
+ * Rings are shared with a kernel, so positions are read with an acquire and
+ * written with a release, as in any single-producer/single-consumer ring.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "n_rf24l01_uring.h"
+
+
+static int _io_uring_setup( u_int entries, struct io_uring_params* params )
+{
+  return syscall( __NR_io_uring_setup, entries, params );
+}
+
+static int _io_uring_enter( int fd, u_int to_submit, u_int min_complete, u_int flags, void* arg, size_t size )
+{
+  return syscall( __NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, size );
+}
+
+int n_rf24l01_uring_init( n_rf24l01_uring_t* ring, u_int entries )
+{
+  struct io_uring_params params;
+  u_char* sq_ring;
+  u_char* cq_ring;
+
+  memset( ring, 0, sizeof(*ring) );
+  memset( &params, 0, sizeof(params) );
+
+  ring->fd = _io_uring_setup( entries, &params );
+  if( ring->fd < 0 )
+    return -1;
+
+  /* a timeout of a wait is passed to io_uring_enter (5.11+), not as an sqe */
+  if( !( params.features & IORING_FEAT_EXT_ARG ) )
+  {
+    close( ring->fd );
+    return -1;
+  }
+
+  ring->features = params.features;
+
+  ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(u_int);
+  ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+  /* both rings are in one mapping since 5.4 */
+  if( params.features & IORING_FEAT_SINGLE_MMAP )
+  {
+    if( ring->cq_ring_size > ring->sq_ring_size )
+      ring->sq_ring_size = ring->cq_ring_size;
+    ring->cq_ring_size = ring->sq_ring_size;
+  }
+
+  ring->sq_ring = mmap( NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING );
+  if( ring->sq_ring == MAP_FAILED )
+    goto fail_sq_ring;
+
+  if( params.features & IORING_FEAT_SINGLE_MMAP )
+    ring->cq_ring = ring->sq_ring;
+  else
+  {
+    ring->cq_ring = mmap( NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring->fd, IORING_OFF_CQ_RING );
+    if( ring->cq_ring == MAP_FAILED )
+      goto fail_cq_ring;
+  }
+
+  ring->sqes = mmap( NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     ring->fd, IORING_OFF_SQES );
+  if( ring->sqes == MAP_FAILED )
+    goto fail_sqes;
+
+  sq_ring = ring->sq_ring;
+  ring->sq_head = (u_int*)( sq_ring + params.sq_off.head );
+  ring->sq_tail = (u_int*)( sq_ring + params.sq_off.tail );
+  ring->sq_mask = *(u_int*)( sq_ring + params.sq_off.ring_mask );
+  ring->sq_array = (u_int*)( sq_ring + params.sq_off.array );
+
+  cq_ring = ring->cq_ring;
+  ring->cq_head = (u_int*)( cq_ring + params.cq_off.head );
+  ring->cq_tail = (u_int*)( cq_ring + params.cq_off.tail );
+  ring->cq_mask = *(u_int*)( cq_ring + params.cq_off.ring_mask );
+  ring->cqes = (struct io_uring_cqe*)( cq_ring + params.cq_off.cqes );
+
+  return 0;
+
+fail_sqes:
+  if( ring->cq_ring != ring->sq_ring )
+    munmap( ring->cq_ring, ring->cq_ring_size );
+fail_cq_ring:
+  munmap( ring->sq_ring, ring->sq_ring_size );
+fail_sq_ring:
+  close( ring->fd );
+  ring->fd = -1;
+
+  return -1;
+}
+
+/* a kernel cancels everything in flight once a ring's fd is closed */
+void n_rf24l01_uring_exit( n_rf24l01_uring_t* ring )
+{
+  if( ring->fd < 0 )
+    return;
+
+  munmap( ring->sqes, ring->sqes_size );
+  if( ring->cq_ring != ring->sq_ring )
+    munmap( ring->cq_ring, ring->cq_ring_size );
+  munmap( ring->sq_ring, ring->sq_ring_size );
+
+  close( ring->fd );
+  ring->fd = -1;
+}
+
+struct io_uring_sqe* n_rf24l01_uring_get_sqe( n_rf24l01_uring_t* ring )
+{
+  struct io_uring_sqe* sqe;
+  u_int tail = *ring->sq_tail;
+
+  /* a kernel takes all submitted sqes at once, so a full queue means they're all queued by us */
+  if( tail - __atomic_load_n( ring->sq_head, __ATOMIC_ACQUIRE ) > ring->sq_mask )
+  {
+    if( n_rf24l01_uring_submit( ring, 0, NULL ) < 0 )
+      return NULL;
+
+    tail = *ring->sq_tail;
+  }
+
+  sqe = &ring->sqes[tail & ring->sq_mask];
+  memset( sqe, 0, sizeof(*sqe) );
+
+  /* without SQPOLL a kernel looks at the queue in io_uring_enter only,
+   * so the sqe may be published before a caller fills it in */
+  ring->sq_array[tail & ring->sq_mask] = tail & ring->sq_mask;
+  __atomic_store_n( ring->sq_tail, tail + 1, __ATOMIC_RELEASE );
+
+  ring->to_submit++;
+
+  return sqe;
+}
+
+int n_rf24l01_uring_submit( n_rf24l01_uring_t* ring, u_int wait_nr, const struct timespec* timeout )
+{
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  int ret;
+
+  memset( &arg, 0, sizeof(arg) );
+
+  if( timeout )
+  {
+    ts.tv_sec = timeout->tv_sec;
+    ts.tv_nsec = timeout->tv_nsec;
+    arg.ts = (uintptr_t)&ts;
+  }
+
+  ring->enters++;
+
+  ret = _io_uring_enter( ring->fd, ring->to_submit, wait_nr, ( wait_nr ? IORING_ENTER_GETEVENTS : 0 ) | IORING_ENTER_EXT_ARG,
+                         &arg, sizeof(arg) );
+  if( ret < 0 )
+    return -errno;
+
+  /* a kernel may stop early (e.g. no memory), what's left goes with a next submit */
+  ring->to_submit -= ret;
+
+  return ret;
+}
+
+struct io_uring_cqe* n_rf24l01_uring_peek_cqe( n_rf24l01_uring_t* ring )
+{
+  u_int head = *ring->cq_head;
+
+  if( head == __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE ) )
+    return NULL;
+
+  return &ring->cqes[head & ring->cq_mask];
+}
+
+void n_rf24l01_uring_cqe_seen( n_rf24l01_uring_t* ring )
+{
+  __atomic_store_n( ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE );
+}
@@ -0,0 +1,67 @@
+/*
+ * n_rf24l01_uring.h
+ *
+ * A minimal io_uring over raw syscalls (no liburing), just what the library's thread
+ * and the backend need: get an sqe, submit what's queued and wait, reap cqes.
+ * A ring isn't thread-safe, each user (a thread, the backend) has its own one.
+ */
+
+#ifndef N_RF24L01_URING_H
+#define N_RF24L01_URING_H
+
+#include <stddef.h>
+#include <time.h>
+
+#include <linux/io_uring.h>
+
+#include "n_rf24l01_core.h"
+
+typedef struct n_rf24l01_uring_t
+{
+  int fd;
+  u_int features;   /* IORING_FEAT_* */
+
+  /* a submission queue: indexes of sqes a kernel takes from head to tail */
+  u_int* sq_head;
+  u_int* sq_tail;
+  u_int sq_mask;
+  u_int* sq_array;
+  struct io_uring_sqe* sqes;
+
+  /* sqes queued since a last submit */
+  u_int to_submit;
+
+  /* a completion queue */
+  u_int* cq_head;
+  u_int* cq_tail;
+  u_int cq_mask;
+  struct io_uring_cqe* cqes;
+
+  void* sq_ring;
+  size_t sq_ring_size;
+  void* cq_ring;
+  size_t cq_ring_size;
+  size_t sqes_size;
+
+  /* io_uring_enter calls made */
+  unsigned long long enters;
+} n_rf24l01_uring_t;
+
+/* set a ring of @entries (a power of 2) up, returns -1 if io_uring isn't available
+ * (an old kernel, a seccomp filter, io_uring_disabled sysctl) */
+int n_rf24l01_uring_init( n_rf24l01_uring_t* ring, u_int entries );
+void n_rf24l01_uring_exit( n_rf24l01_uring_t* ring );
+
+/* get a zeroed sqe to fill in, queued ones get submitted first if the queue is full,
+ * NULL - the submit failed */
+struct io_uring_sqe* n_rf24l01_uring_get_sqe( n_rf24l01_uring_t* ring );
+
+/* submit queued sqes and wait for @wait_nr cqes, for up to @timeout (NULL - infinite),
+ * one syscall for both; returns -errno on a failure (-ETIME - the timeout has expired) */
+int n_rf24l01_uring_submit( n_rf24l01_uring_t* ring, u_int wait_nr, const struct timespec* timeout );
+
+/* get a next cqe, NULL - no more, it has to be passed back by n_rf24l01_uring_cqe_seen */
+struct io_uring_cqe* n_rf24l01_uring_peek_cqe( n_rf24l01_uring_t* ring );
+void n_rf24l01_uring_cqe_seen( n_rf24l01_uring_t* ring );
+
+#endif /* N_RF24L01_URING_H */
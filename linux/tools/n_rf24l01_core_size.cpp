@@ -0,0 +1,60 @@
+/*
+ * n_rf24l01_core_size.cpp
+ *
+ * Instantiates every call of n_rf24l01_core.hpp for several configs over a backend whose calls
+ * aren't inlined, so n_rf24l01_core_size.sh can report what each config costs per call.
+ * It's only compiled, never linked.
+ */
+
+#include "n_rf24l01_core.hpp"
+
+struct backend
+{
+  void set_ce( bool value );
+  void transfer( u_char* frame, std::size_t num );
+  void usleep( u_int delay_mks );
+  void handle_received_data( const u_char* data, std::size_t num );
+};
+
+/* the C core's one */
+struct config_c : n_rf24l01::core::default_config
+{
+};
+
+struct config_small : n_rf24l01::core::default_config
+{
+  static constexpr std::size_t payload_size = 8;
+};
+
+struct config_dpl : n_rf24l01::core::default_config
+{
+  static constexpr bool dynamic_payload = true;
+};
+
+struct config_pipes : n_rf24l01::core::default_config
+{
+  static constexpr std::size_t pipes = 6;
+};
+
+struct config_debug : n_rf24l01::core::default_config
+{
+  static constexpr bool debug = true;
+};
+
+template class n_rf24l01::core::transceiver<config_c, backend>;
+template class n_rf24l01::core::transceiver<config_small, backend>;
+template class n_rf24l01::core::transceiver<config_dpl, backend>;
+template class n_rf24l01::core::transceiver<config_pipes, backend>;
+template class n_rf24l01::core::transceiver<config_debug, backend>;
+
+/* the debug API of a 1-byte register and of a 5-bytes one */
+using debug_transceiver = n_rf24l01::core::transceiver<config_debug, backend>;
+
+template debug_transceiver::register_t<n_rf24l01::core::reg::rf_setup>
+debug_transceiver::read_register_dbg<n_rf24l01::core::reg::rf_setup>();
+template debug_transceiver::register_t<n_rf24l01::core::reg::tx_addr>
+debug_transceiver::read_register_dbg<n_rf24l01::core::reg::tx_addr>();
+template void debug_transceiver::write_register_dbg<n_rf24l01::core::reg::rf_setup>(
+  debug_transceiver::register_t<n_rf24l01::core::reg::rf_setup> );
+template void debug_transceiver::write_register_dbg<n_rf24l01::core::reg::tx_addr>(
+  debug_transceiver::register_t<n_rf24l01::core::reg::tx_addr> );
@@ -0,0 +1,83 @@
+#!/bin/sh
+#
+# n_rf24l01_core_size.sh
+#
+# Reports a code size (bytes) and an amount of instructions of each call of n_rf24l01_core.hpp
+# per config of n_rf24l01_core_size.cpp, and a total of each config. A call is counted without
+# calls it makes (private helpers aren't inlined into explicitly instantiated calls, they're
+# reported on their own). A compiler and flags are taken from CXX and CXXFLAGS (c++, -Os
+# by default), so sizes of a target's build can be had with a cross compiler.
+#
+# usage: n_rf24l01_core_size.sh (or make core_size)
+
+dir=$( cd "$( dirname "$0" )" && pwd )
+obj=$( mktemp ) || exit 1
+trap 'rm -f "$obj"' EXIT
+
+${CXX:-c++} -std=c++17 ${CXXFLAGS:--Os} -I"$dir/../.." -c "$dir/n_rf24l01_core_size.cpp" -o "$obj" || exit 1
+
+{
+  nm -C -S --defined-only "$obj" | sed 's/^/nm /'
+  objdump -d -C --no-show-raw-insn "$obj" | sed 's/^/asm /'
+} | awk '
+function hex( s,    i, n )
+{
+  n = 0
+  s = tolower( s )
+  for( i = 1; i <= length( s ); i++ )
+    n = n * 16 + index( "0123456789abcdef", substr( s, i, 1 ) ) - 1
+  return n
+}
+
+# "nm <address> <size> <type> <name>", data members are skipped
+$1 == "nm" && NF >= 5 && $4 ~ /^[TtWw]$/ {
+  name = $0
+  sub( /^nm [^ ]+ [^ ]+ [^ ]+ /, "", name )
+  bytes[name] = hex( $3 )
+  next
+}
+
+# "asm <address> <<name>>:" starts a function, "asm <address>:<tab><instruction>" is its instruction
+$1 == "asm" && /^asm [0-9a-f]+ <.*>:$/ {
+  name = $0
+  sub( /^asm [0-9a-f]+ </, "", name )
+  sub( />:$/, "", name )
+  next
+}
+
+$1 == "asm" && /^asm +[0-9a-f]+:\t/ {
+  insns[name]++
+}
+
+END {
+  for( name in bytes )
+  {
+    if( !match( name, /transceiver<[a-z_]+, backend>::/ ) )
+      continue
+
+    config = substr( name, RSTART + 12, RLENGTH - 12 )
+    sub( /, backend>::$/, "", config )
+    # "read_register_dbg<(unsigned char)11>()" is "read_register_dbg<11>"
+    call = substr( name, RSTART + RLENGTH )
+    gsub( /\(unsigned char\)/, "", call )
+    sub( /\(.*$/, "", call )
+
+    # a constructor is trivial, and each is emitted twice
+    if( call == "transceiver" )
+      continue
+
+    printf "%s %s %u %u\n", config, call, bytes[name], insns[name]
+    total_bytes[config] += bytes[name]
+    total_insns[config] += insns[name]
+  }
+
+  for( config in total_bytes )
+    printf "%s ~total %u %u\n", config, total_bytes[config], total_insns[config]
+}' | sort -k1,1 -k2,2 | awk '
+BEGIN { printf "%-14s %-40s %6s %6s\n", "config", "call", "bytes", "insns" }
+{
+  if( NR > 1 && $1 != last )
+    printf "\n"
+  last = $1
+  printf "%-14s %-40s %6u %6u\n", $1, $2 == "~total" ? "total" : $2, $3, $4
+}'
@@ -0,0 +1,315 @@
+/*
+ * n_rf24l01_hpp_test.cpp
+ *
+ * Runs the C++ layer (n_rf24l01.hpp) over a socketpair instead of the library's fd,
+ * the same byte stream a user gets, so coroutines, the pool and the mux can be checked
+ * without a transceiver.
+ *
+ * usage: n_rf24l01_hpp_test <scenario>
+ *
+ *   stream   many coroutines send over one radio, the other side echoes, sends mustn't be
+ *            mixed up or reordered
+ *   mux      conversations over one radio, each has to get its own messages only, in order,
+ *            messages of a conversation which isn't open are dropped, a gone peer cancels awaiters
+ *
+ * A scenario exits with 1 if a check fails, each frame has to be back in a pool at the end.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include "n_rf24l01.hpp"
+
+/* radios here adopt socketpair's fds, the library itself isn't linked */
+extern "C" int n_rf24l01_open( void )
+{
+  return -1;
+}
+
+extern "C" void n_rf24l01_close( int fd )
+{
+  close( fd );
+}
+
+namespace
+{
+
+constexpr unsigned int SENDERS = 1000;
+constexpr unsigned int FRAMES = 100;
+constexpr unsigned int CONVERSATIONS = 1000;
+constexpr unsigned int MESSAGES = 20;
+
+struct result
+{
+  unsigned int done = 0;
+  unsigned int errors = 0;
+};
+
+int check( const char* name, bool ok )
+{
+  printf( "%-48s %s\n", name, ok ? "ok" : "FAILED" );
+
+  return !ok;
+}
+
+std::uint32_t get_u32( const std::byte* src )
+{
+  std::uint32_t value;
+
+  memcpy( &value, src, sizeof(value) );
+
+  return value;
+}
+
+void put_u32( std::byte* dst, std::uint32_t value )
+{
+  memcpy( dst, &value, sizeof(value) );
+}
+
+/* a peer which sends back whatever it gets */
+n_rf24l01::task echo( n_rf24l01::radio& radio )
+{
+  for( ;; )
+  {
+    n_rf24l01::frame frame = co_await radio.receive();
+    if( frame.empty() )
+      co_return;
+
+    if( co_await radio.send( std::move( frame ) ) < 0 )
+      co_return;
+  }
+}
+
+n_rf24l01::task echo( n_rf24l01::mux::conversation conversation )
+{
+  for( ;; )
+  {
+    n_rf24l01::frame frame = co_await conversation.receive();
+    if( frame.empty() )
+      co_return;
+
+    if( co_await conversation.send( std::move( frame ) ) < 0 )
+      co_return;
+  }
+}
+
+/* each frame is <sender> <seq> */
+n_rf24l01::task send_frames( n_rf24l01::radio& radio, n_rf24l01::frame_pool& pool, unsigned int sender,
+                             result& result )
+{
+  for( unsigned int seq = 0; seq < FRAMES; seq++ )
+  {
+    n_rf24l01::frame frame = pool.acquire();
+
+    frame.resize( 8 );
+    put_u32( frame.data(), sender );
+    put_u32( frame.data() + 4, seq );
+
+    if( co_await radio.send( std::move( frame ) ) < 0 )
+      result.errors++;
+  }
+
+  result.done++;
+}
+
+/* records may come split over frames any way, but each sender's ones are in order */
+n_rf24l01::task receive_frames( n_rf24l01::radio& radio, n_rf24l01::event_loop& loop, result& result )
+{
+  std::vector<unsigned int> next( SENDERS, 0 );
+  std::byte record[8];
+  std::size_t got = 0, records = 0;
+
+  while( records < SENDERS * FRAMES )
+  {
+    n_rf24l01::frame frame = co_await radio.receive();
+    if( frame.empty() )
+    {
+      result.errors++;
+      break;
+    }
+
+    for( std::byte byte : frame.bytes() )
+    {
+      record[got++] = byte;
+      if( got < sizeof(record) )
+        continue;
+
+      got = 0;
+      records++;
+
+      std::uint32_t sender = get_u32( record ), seq = get_u32( record + 4 );
+      if( sender >= SENDERS || seq != next[sender]++ )
+        result.errors++;
+    }
+  }
+
+  loop.stop();
+}
+
+/* each message is <id> <seq> <filler up to a size which depends on both> */
+n_rf24l01::task converse( n_rf24l01::mux::conversation conversation, n_rf24l01::frame_pool& pool, result& result )
+{
+  for( unsigned int seq = 0; seq < MESSAGES; seq++ )
+  {
+    std::size_t size = 8 + ( conversation.id() + seq ) % 57;
+    n_rf24l01::frame frame = pool.acquire();
+
+    frame.resize( size );
+    memset( frame.data(), 0x5a, size );
+    put_u32( frame.data(), conversation.id() );
+    put_u32( frame.data() + 4, seq );
+
+    if( co_await conversation.send( std::move( frame ) ) < 0 )
+      result.errors++;
+
+    frame = co_await conversation.receive();
+    if( frame.size() != size || get_u32( frame.data() ) != conversation.id() || get_u32( frame.data() + 4 ) != seq )
+      result.errors++;
+  }
+
+  result.done++;
+}
+
+n_rf24l01::task send_one( n_rf24l01::mux::conversation& conversation, n_rf24l01::frame_pool& pool )
+{
+  n_rf24l01::frame frame = pool.acquire();
+
+  frame.resize( 8 );
+  co_await conversation.send( std::move( frame ) );
+}
+
+n_rf24l01::task wait_end( n_rf24l01::mux::conversation& conversation, result& result )
+{
+  n_rf24l01::frame frame = co_await conversation.receive();
+
+  result.done += frame.empty();
+}
+
+/* run till nothing is left to resume */
+void drain( n_rf24l01::event_loop& loop )
+{
+  for( unsigned int i = 0; i < 16; i++ )
+    loop.run_once( 0 );
+}
+
+int scenario_stream()
+{
+  n_rf24l01::event_loop loop;
+  n_rf24l01::frame_pool pool( 64 );
+  result sent, received;
+  int fds[2], failed = 0;
+
+  if( socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds ) < 0 )
+    return 1;
+
+  {
+    n_rf24l01::radio radio( loop, pool, fds[0] );
+    n_rf24l01::radio peer( loop, pool, fds[1] );
+
+    echo( peer );
+    receive_frames( radio, loop, received );
+
+    for( unsigned int sender = 0; sender < SENDERS; sender++ )
+      send_frames( radio, pool, sender, sent );
+
+    loop.run();
+
+    failed |= check( "stream: every sender is done", sent.done == SENDERS && !sent.errors );
+    failed |= check( "stream: sends aren't mixed up or reordered", !received.errors );
+  }
+
+  drain( loop );
+
+  failed |= check( "stream: every frame is back in the pool", pool.available() == pool.allocated() );
+
+  return failed;
+}
+
+int scenario_mux()
+{
+  n_rf24l01::event_loop loop;
+  n_rf24l01::frame_pool pool( 64 );
+  result talked, ended;
+  int fds[2], failed = 0;
+
+  if( socketpair( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds ) < 0 )
+    return 1;
+
+  {
+    n_rf24l01::radio radio( loop, pool, fds[0] );
+    n_rf24l01::mux mux( radio );
+
+    /* no one listens to this one on the other side */
+    n_rf24l01::mux::conversation lost = mux.open( CONVERSATIONS );
+
+    {
+      n_rf24l01::radio peer( loop, pool, fds[1] );
+      n_rf24l01::mux peer_mux( peer );
+
+      for( unsigned int id = 0; id < CONVERSATIONS; id++ )
+        echo( peer_mux.open( id ) );
+
+      send_one( lost, pool );
+
+      for( unsigned int id = 0; id < CONVERSATIONS; id++ )
+        converse( mux.open( id ), pool, talked );
+
+      while( talked.done < CONVERSATIONS )
+        loop.run_once( 100 );
+
+      failed |= check( "mux: every conversation got its own messages", !talked.errors );
+      failed |= check( "mux: a message no one listens to is dropped", peer_mux.dropped() == 1 );
+
+      /* the peer goes while someone waits */
+      wait_end( lost, ended );
+    }
+
+    while( !ended.done )
+      loop.run_once( 100 );
+
+    failed |= check( "mux: a gone peer cancels awaiters", ended.done == 1 );
+  }
+
+  drain( loop );
+
+  failed |= check( "mux: every frame is back in the pool", pool.available() == pool.allocated() );
+
+  return failed;
+}
+
+struct scenario
+{
+  const char* name;
+  int (*run)();
+};
+
+const scenario scenarios[] =
+{
+  { "stream", scenario_stream },
+  { "mux", scenario_mux },
+};
+
+} /* namespace */
+
+int main( int argc, char* argv[] )
+{
+  if( argc != 2 )
+  {
+    fprintf( stderr, "usage: %s <scenario>, scenarios:", argv[0] );
+    for( const scenario& scenario : scenarios )
+      fprintf( stderr, " %s", scenario.name );
+    fprintf( stderr, "\n" );
+    return 2;
+  }
+
+  for( const scenario& scenario : scenarios )
+    if( !strcmp( argv[1], scenario.name ) )
+      return scenario.run();
+
+  fprintf( stderr, "unknown scenario: %s\n", argv[1] );
+
+  return 2;
+}
@@ -0,0 +1,712 @@
+/*
+ * n_rf24l01_perf.c
+ *
+ * Measures what a link delivers: a round-trip time (ping), a one-way goodput and loss (flood),
+ * both directions at once (bidir) and a time from n_rf24l01_open till a first package a responder
+ * sends back (open). One side runs a responder, another one a client, both have to use the same
+ * data rate.
+ *
+ * usage: n_rf24l01_perf -s [options]                          run a responder
+ *        n_rf24l01_perf -c ping|flood|bidir|open [options]    run a client
+ *
+ *   -n count   packages to send (opens for open), 1000 by default
+ *   -T sec     flood/bidir: send for @sec seconds instead of -n packages
+ *   -l size    a payload to account per package [16..32], 32 by default (16 bytes are a header)
+ *   -r rate    an air data rate: 250k, 1m (a default) or 2m
+ *   -i us      TX pacing: an interval between packages, 0 (a default) - as fast as possible
+ *   -w ms      ping: how long to wait for a reply, 100 by default
+ *   -S loss    run against a simulated link with @loss percents of packages lost each way
+ *              instead of the transceiver (a responder runs in-process then)
+ *
+ * The library's fd is used without the ARQ/FEC/compression, so each 32-byte write is one
+ * package on air and a lost package is lost for good.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#include "n_rf24l01_linux.h"
+
+#define PKG_SIZE 32
+#define HEADER_SIZE 16
+
+/* a package: <MAGIC> <type> <run id: 2 bytes> <sequence number: 4 bytes> <time: 8 bytes>
+ * <filler>, all LSByte first; a time is a sender's one, it comes back in a reply */
+#define MAGIC 0xa5
+
+#define PKG_PING      1
+#define PKG_PONG      2
+#define PKG_DATA      3   /* a flood package, a responder drops it */
+#define PKG_DATA_ECHO 4   /* a bidir package, a responder sends it back */
+#define PKG_END       5   /* a sequence number is an amount of sent packages */
+#define PKG_REPORT    6   /* a sequence number is an amount of received packages,
+                           * a time is a span they were received over */
+
+/* how many times an END and a REPORT are repeated, as any package may be lost */
+#define REPEATS 5
+#define REPORT_TIMEOUT_MS 1000
+
+/* RTT histogram: buckets[0] - below 1us, buckets[i] - [2^(i-1)..2^i)us */
+#define HIST_BUCKETS 24
+
+typedef struct
+{
+  int fd;
+  u_int count;
+  u_int duration_s;
+  u_int size;
+  u_int rate;
+  u_int interval_us;
+  u_int wait_ms;
+  uint16_t run_id;
+} perf_t;
+
+/* a responder's view of a current run */
+typedef struct
+{
+  uint16_t run_id;
+  u_int received;
+  uint64_t first_ns;
+  uint64_t last_ns;
+} responder_t;
+
+/* a simulated link: packages between a client and an in-process responder take their
+ * airtime and get lost with a given probability */
+typedef struct
+{
+  int fd;
+  u_int loss_pct;
+  u_int airtime_us;
+  uint32_t rand_state;
+} sim_t;
+
+static volatile sig_atomic_t stop;
+
+
+static uint64_t _get_time_ns( void )
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void _put_le( u_char* dst, uint64_t value, u_int num )
+{
+  u_int i;
+
+  for( i = 0; i < num; i++ )
+    dst[i] = value >> ( 8 * i );
+}
+
+static uint64_t _get_le( const u_char* src, u_int num )
+{
+  uint64_t value = 0;
+  u_int i;
+
+  for( i = 0; i < num; i++ )
+    value |= (uint64_t)src[i] << ( 8 * i );
+
+  return value;
+}
+
+static void _make_pkg( u_char* pkg, u_char type, uint16_t run_id, uint32_t seq, uint64_t time_ns )
+{
+  memset( pkg, 0x5a, PKG_SIZE );
+
+  pkg[0] = MAGIC;
+  pkg[1] = type;
+  _put_le( pkg + 2, run_id, 2 );
+  _put_le( pkg + 4, seq, 4 );
+  _put_le( pkg + 8, time_ns, 8 );
+}
+
+/* a whole package is written at once, so packages never get split on air */
+static int _send_pkg( int fd, const u_char* pkg )
+{
+  int ret;
+
+  do
+    ret = write( fd, pkg, PKG_SIZE );
+  while( ret < 0 && errno == EINTR );
+
+  return ret == PKG_SIZE ? 0 : -1;
+}
+
+/* get a next package within @timeout_ms (-1 - infinite),
+ * returns 1 - got a package, 0 - a timeout, -1 - the fd is broken */
+static int _recv_pkg( int fd, u_char* pkg, int timeout_ms )
+{
+  struct pollfd event_fd = { .fd = fd, .events = POLLIN };
+  u_int got = 0;
+  int ret;
+
+  while( got < PKG_SIZE )
+  {
+    ret = poll( &event_fd, 1, got ? -1 : timeout_ms );
+    if( ret < 0 && errno == EINTR )
+    {
+      if( stop )
+        return 0;
+      continue;
+    }
+
+    if( ret <= 0 )
+      return ret;
+
+    ret = read( fd, pkg + got, PKG_SIZE - got );
+    if( ret <= 0 )
+      return -1;
+
+    got += ret;
+  }
+
+  return 1;
+}
+
+static void _pace( uint64_t* next_ns, u_int interval_us )
+{
+  struct timespec ts;
+
+  if( !interval_us )
+    return;
+
+  *next_ns += interval_us * 1000ull;
+
+  ts.tv_sec = *next_ns / 1000000000;
+  ts.tv_nsec = *next_ns % 1000000000;
+
+  clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL );
+}
+
+
+/* a responder */
+
+
+static void _respond( responder_t* responder, const u_char* pkg, int (*send)( void*, const u_char* ), void* ctx )
+{
+  u_char reply[PKG_SIZE];
+  uint16_t run_id;
+  uint64_t now = _get_time_ns();
+  int i;
+
+  if( pkg[0] != MAGIC )
+    return;
+
+  run_id = _get_le( pkg + 2, 2 );
+
+  switch( pkg[1] )
+  {
+    case PKG_PING:
+      memcpy( reply, pkg, PKG_SIZE );
+      reply[1] = PKG_PONG;
+      send( ctx, reply );
+    break;
+
+    case PKG_DATA:
+    case PKG_DATA_ECHO:
+      if( run_id != responder->run_id || !responder->received )
+      {
+        responder->run_id = run_id;
+        responder->received = 0;
+        responder->first_ns = now;
+      }
+
+      responder->received++;
+      responder->last_ns = now;
+
+      if( pkg[1] == PKG_DATA_ECHO )
+        send( ctx, pkg );
+    break;
+
+    case PKG_END:
+      if( run_id != responder->run_id )
+      {
+        responder->run_id = run_id;
+        responder->received = 0;
+        responder->first_ns = responder->last_ns = now;
+      }
+
+      printf( "run %04x: %u of %u packages received.\n", run_id, responder->received,
+              (u_int)_get_le( pkg + 4, 4 ) );
+
+      _make_pkg( reply, PKG_REPORT, run_id, responder->received, responder->last_ns - responder->first_ns );
+      for( i = 0; i < REPEATS; i++ )
+        send( ctx, reply );
+
+      /* a next run starts anew, even with the same id */
+      responder->received = 0;
+    break;
+  }
+}
+
+static int _send_to_fd( void* ctx, const u_char* pkg )
+{
+  return _send_pkg( *(int*)ctx, pkg );
+}
+
+static int _run_responder( perf_t* perf )
+{
+  responder_t responder;
+  u_char pkg[PKG_SIZE];
+  int ret;
+
+  memset( &responder, 0, sizeof(responder) );
+
+  printf( "n_rf24l01_perf: a responder is waiting for packages...\n" );
+
+  while( !stop )
+  {
+    ret = _recv_pkg( perf->fd, pkg, -1 );
+    if( ret < 0 )
+      return -1;
+
+    if( ret > 0 )
+      _respond( &responder, pkg, _send_to_fd, &perf->fd );
+  }
+
+  return 0;
+}
+
+
+/* a simulated link */
+
+
+static int _sim_lost( sim_t* sim )
+{
+  uint32_t x = sim->rand_state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  sim->rand_state = x;
+
+  return x % 100 < sim->loss_pct;
+}
+
+/* a responder's way back takes airtime too */
+static int _sim_send( void* ctx, const u_char* pkg )
+{
+  sim_t* sim = ctx;
+
+  usleep( sim->airtime_us );
+
+  if( _sim_lost( sim ) )
+    return 0;
+
+  return _send_pkg( sim->fd, pkg );
+}
+
+static void* _sim_thread( void* data )
+{
+  sim_t* sim = data;
+  responder_t responder;
+  u_char pkg[PKG_SIZE];
+
+  memset( &responder, 0, sizeof(responder) );
+
+  while( _recv_pkg( sim->fd, pkg, -1 ) > 0 )
+  {
+    usleep( sim->airtime_us );
+
+    if( !_sim_lost( sim ) )
+      _respond( &responder, pkg, _sim_send, sim );
+  }
+
+  return NULL;
+}
+
+/* a package on air: a preamble, a 5-byte address, a payload and a 2-byte CRC,
+ * plus a TX settling (130us) the library pays for each switch to TX */
+static u_int _get_airtime_us( u_int rate )
+{
+  u_int bits = ( 1 + 5 + PKG_SIZE + 2 ) * 8;
+  u_int kbps = rate == N_RF24L01_RATE_2MBPS ? 2000 : rate == N_RF24L01_RATE_250KBPS ? 250 : 1000;
+
+  return bits * 1000 / kbps + 130;
+}
+
+static int _open_sim( perf_t* perf, u_int loss_pct )
+{
+  static sim_t sim;
+  pthread_t thread;
+  int fds[2];
+
+  if( socketpair( AF_UNIX, SOCK_STREAM, 0, fds ) < 0 )
+    return -1;
+
+  sim.fd = fds[1];
+  sim.loss_pct = loss_pct;
+  sim.airtime_us = _get_airtime_us( perf->rate );
+  sim.rand_state = 0x2545f491 ^ getpid();
+
+  if( pthread_create( &thread, NULL, _sim_thread, &sim ) )
+    return -1;
+
+  pthread_detach( thread );
+
+  printf( "n_rf24l01_perf: a simulated link, %u%% loss each way, %uus per package.\n", loss_pct, sim.airtime_us );
+
+  return fds[0];
+}
+
+
+/* a client */
+
+
+static int _compare_u64( const void* a, const void* b )
+{
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void _print_times( const char* name, uint64_t* rtts, u_int num )
+{
+  u_int hist[HIST_BUCKETS] = { 0, };
+  u_int i, bucket, max_count = 0;
+  uint64_t sum = 0, us;
+
+  qsort( rtts, num, sizeof(*rtts), _compare_u64 );
+
+  for( i = 0; i < num; i++ )
+  {
+    sum += rtts[i];
+
+    for( bucket = 0, us = rtts[i] / 1000; us && bucket < HIST_BUCKETS - 1; us >>= 1 )
+      bucket++;
+
+    if( ++hist[bucket] > max_count )
+      max_count = hist[bucket];
+  }
+
+  printf( "%s, us: min %.1f avg %.1f p50 %.1f p90 %.1f p99 %.1f max %.1f\n", name, rtts[0] / 1e3,
+          sum / 1e3 / num, rtts[num / 2] / 1e3, rtts[num * 90 / 100] / 1e3, rtts[num * 99 / 100] / 1e3,
+          rtts[num - 1] / 1e3 );
+
+  for( bucket = 0; bucket < HIST_BUCKETS; bucket++ )
+  {
+    if( !hist[bucket] )
+      continue;
+
+    printf( "  < %8uus %7u ", 1u << bucket, hist[bucket] );
+    for( i = 0; i < hist[bucket] * 50 / max_count; i++ )
+      putchar( '#' );
+    putchar( '\n' );
+  }
+}
+
+static int _run_ping( perf_t* perf )
+{
+  u_char pkg[PKG_SIZE];
+  uint64_t* rtts;
+  uint64_t now, deadline, next_ns;
+  u_int seq, received = 0;
+  int ret;
+
+  rtts = calloc( perf->count, sizeof(*rtts) );
+  if( !rtts )
+    return -1;
+
+  next_ns = _get_time_ns();
+
+  for( seq = 0; seq < perf->count && !stop; seq++ )
+  {
+    _make_pkg( pkg, PKG_PING, perf->run_id, seq, _get_time_ns() );
+    if( _send_pkg( perf->fd, pkg ) < 0 )
+      break;
+
+    deadline = _get_time_ns() + perf->wait_ms * 1000000ull;
+
+    /* late replies to previous pings are skipped */
+    while( ( now = _get_time_ns() ) < deadline )
+    {
+      ret = _recv_pkg( perf->fd, pkg, ( deadline - now ) / 1000000 + 1 );
+      if( ret <= 0 )
+        break;
+
+      if( pkg[0] == MAGIC && pkg[1] == PKG_PONG && _get_le( pkg + 2, 2 ) == perf->run_id &&
+          _get_le( pkg + 4, 4 ) == seq )
+      {
+        rtts[received++] = _get_time_ns() - _get_le( pkg + 8, 8 );
+        break;
+      }
+    }
+
+    _pace( &next_ns, perf->interval_us );
+  }
+
+  printf( "ping: %u sent, %u received, %.2f%% lost\n", seq, received, seq ? 100.0 * ( seq - received ) / seq : 0 );
+
+  if( received )
+    _print_times( "rtt", rtts, received );
+
+  free( rtts );
+
+  return 0;
+}
+
+static int _run_flood( perf_t* perf, int bidir )
+{
+  u_char pkg[PKG_SIZE];
+  uint64_t start, end, next_ns, deadline, span_ns = 0;
+  u_int sent = 0, echoed = 0, reported = 0;
+  int got_report = 0, i, ret;
+
+  start = next_ns = _get_time_ns();
+  end = start + perf->duration_s * 1000000000ull;
+
+  while( !stop && ( perf->duration_s ? _get_time_ns() < end : sent < perf->count ) )
+  {
+    _make_pkg( pkg, bidir ? PKG_DATA_ECHO : PKG_DATA, perf->run_id, sent, _get_time_ns() );
+    if( _send_pkg( perf->fd, pkg ) < 0 )
+      return -1;
+
+    sent++;
+
+    /* take echoes as they come, to not let them pile up */
+    while( bidir && _recv_pkg( perf->fd, pkg, 0 ) > 0 )
+      if( pkg[0] == MAGIC && pkg[1] == PKG_DATA_ECHO && _get_le( pkg + 2, 2 ) == perf->run_id )
+        echoed++;
+
+    _pace( &next_ns, perf->interval_us );
+  }
+
+  end = _get_time_ns();
+
+  /* ask for a report till it comes, echoes still in flight are counted meanwhile */
+  for( i = 0; i < REPEATS && !got_report; i++ )
+  {
+    _make_pkg( pkg, PKG_END, perf->run_id, sent, 0 );
+    _send_pkg( perf->fd, pkg );
+
+    deadline = _get_time_ns() + REPORT_TIMEOUT_MS / REPEATS * 1000000ull;
+
+    while( !got_report && _get_time_ns() < deadline )
+    {
+      ret = _recv_pkg( perf->fd, pkg, REPORT_TIMEOUT_MS / REPEATS );
+      if( ret <= 0 )
+        break;
+
+      if( pkg[0] != MAGIC || _get_le( pkg + 2, 2 ) != perf->run_id )
+        continue;
+
+      if( pkg[1] == PKG_DATA_ECHO )
+        echoed++;
+      else if( pkg[1] == PKG_REPORT )
+      {
+        got_report = 1;
+        reported = _get_le( pkg + 4, 4 );
+        span_ns = _get_le( pkg + 8, 8 );
+      }
+    }
+  }
+
+  printf( "%s: %u packages sent in %.3fs, %.0f packages/s\n", bidir ? "bidir" : "flood", sent,
+          ( end - start ) / 1e9, sent * 1e9 / ( end - start ) );
+
+  if( !got_report )
+  {
+    printf( "no report from a responder.\n" );
+    return -1;
+  }
+
+  /* a goodput is taken over a span the responder was receiving packages */
+  if( !span_ns )
+    span_ns = end - start;
+
+  printf( "forward: %u received, %.2f%% lost, goodput %.1f kbit/s\n", reported,
+          sent ? 100.0 * ( sent - reported ) / sent : 0, reported * perf->size * 8e6 / span_ns );
+
+  if( bidir )
+    printf( "backward: %u of %u echoes received, %.2f%% lost, goodput %.1f kbit/s\n", echoed, reported,
+            reported ? 100.0 * ( reported - echoed ) / reported : 0, echoed * perf->size * 8e6 / ( end - start ) );
+
+  return 0;
+}
+
+
+/* each round closes and opens the library anew and pings till a first pong, so rounds after
+ * a first one are warm starts (the transceiver is left powered up by n_rf24l01_close) */
+static int _run_open( perf_t* perf )
+{
+  n_rf24l01_stats_t stats;
+  u_char pkg[PKG_SIZE];
+  uint64_t* times;
+  uint64_t start, now, deadline, init_us = 0;
+  u_int round, opened = 0, received = 0, warm = 0;
+  int got, ret;
+
+  times = calloc( perf->count, sizeof(*times) );
+  if( !times )
+    return -1;
+
+  for( round = 0; round < perf->count && !stop; round++ )
+  {
+    n_rf24l01_close( perf->fd );
+
+    start = _get_time_ns();
+
+    perf->fd = n_rf24l01_open();
+    if( perf->fd < 0 )
+      break;
+
+    n_rf24l01_set_rate( perf->fd, perf->rate );
+
+    opened++;
+    if( n_rf24l01_get_stats( perf->fd, &stats ) == 0 )
+    {
+      init_us += stats.init_us;
+      warm += stats.warm_start;
+    }
+
+    /* a ping may be lost as any other package, it's repeated within a report timeout */
+    deadline = start + REPORT_TIMEOUT_MS * 1000000ull;
+    got = 0;
+
+    while( !got && !stop && ( now = _get_time_ns() ) < deadline )
+    {
+      _make_pkg( pkg, PKG_PING, perf->run_id, round, now );
+      if( _send_pkg( perf->fd, pkg ) < 0 )
+        break;
+
+      while( ( ret = _recv_pkg( perf->fd, pkg, perf->wait_ms ) ) > 0 )
+        if( pkg[0] == MAGIC && pkg[1] == PKG_PONG && _get_le( pkg + 2, 2 ) == perf->run_id &&
+            _get_le( pkg + 4, 4 ) == round )
+        {
+          got = 1;
+          break;
+        }
+
+      if( ret < 0 )
+        break;
+    }
+
+    if( got )
+      times[received++] = _get_time_ns() - start;
+  }
+
+  printf( "open: %u opens, %u warm, a first package after %u of them, init avg %.1fus\n", opened, warm,
+          received, opened ? (double)init_us / opened : 0 );
+
+  if( received )
+    _print_times( "open to a first package", times, received );
+
+  free( times );
+
+  return opened ? 0 : -1;
+}
+
+
+static void _on_signal( int signal_num )
+{
+  stop = 1;
+}
+
+static void _usage( void )
+{
+  printf( "usage: n_rf24l01_perf -s|-c ping|flood|bidir|open [-n count] [-T sec] [-l size] [-r 250k|1m|2m]\n"
+          "                      [-i interval_us] [-w wait_ms] [-S loss_pct]\n" );
+}
+
+int main( int argc, char* argv[] )
+{
+  perf_t perf = { .count = 1000, .size = PKG_SIZE, .rate = N_RF24L01_RATE_1MBPS, .wait_ms = 100 };
+  const char* mode = NULL;
+  struct sigaction action;
+  int responder = 0, sim = 0, opt, ret;
+  u_int loss_pct = 0;
+
+  while( ( opt = getopt( argc, argv, "sc:n:T:l:r:i:w:S:" ) ) != -1 )
+  {
+    switch( opt )
+    {
+      case 's': responder = 1; break;
+      case 'c': mode = optarg; break;
+      case 'n': perf.count = strtoul( optarg, NULL, 0 ); break;
+      case 'T': perf.duration_s = strtoul( optarg, NULL, 0 ); break;
+      case 'l': perf.size = strtoul( optarg, NULL, 0 ); break;
+      case 'i': perf.interval_us = strtoul( optarg, NULL, 0 ); break;
+      case 'w': perf.wait_ms = strtoul( optarg, NULL, 0 ); break;
+      case 'S': sim = 1; loss_pct = strtoul( optarg, NULL, 0 ); break;
+      case 'r':
+        if( !strcmp( optarg, "250k" ) )
+          perf.rate = N_RF24L01_RATE_250KBPS;
+        else if( !strcmp( optarg, "2m" ) )
+          perf.rate = N_RF24L01_RATE_2MBPS;
+        else if( strcmp( optarg, "1m" ) )
+        {
+          _usage();
+          return 1;
+        }
+      break;
+      default:
+        _usage();
+        return 1;
+    }
+  }
+
+  if( responder == !!mode || perf.size < HEADER_SIZE || perf.size > PKG_SIZE || !perf.count ||
+      loss_pct > 100 || ( responder && sim ) || ( sim && !strcmp( mode, "open" ) ) )
+  {
+    _usage();
+    return 1;
+  }
+
+  memset( &action, 0, sizeof(action) );
+  action.sa_handler = _on_signal;
+  sigaction( SIGINT, &action, NULL );
+  sigaction( SIGTERM, &action, NULL );
+
+  perf.run_id = getpid() ^ _get_time_ns();
+
+  if( sim )
+    perf.fd = _open_sim( &perf, loss_pct );
+  else
+  {
+    perf.fd = n_rf24l01_open();
+    if( perf.fd >= 0 && n_rf24l01_set_rate( perf.fd, perf.rate ) < 0 )
+      printf( "n_rf24l01_perf: fail to set a data rate.\n" );
+  }
+
+  if( perf.fd < 0 )
+  {
+    printf( "n_rf24l01_perf: fail to open a link.\n" );
+    return 1;
+  }
+
+  if( responder )
+    ret = _run_responder( &perf );
+  else if( !strcmp( mode, "ping" ) )
+    ret = _run_ping( &perf );
+  else if( !strcmp( mode, "flood" ) )
+    ret = _run_flood( &perf, 0 );
+  else if( !strcmp( mode, "bidir" ) )
+    ret = _run_flood( &perf, 1 );
+  else if( !strcmp( mode, "open" ) )
+    ret = _run_open( &perf );
+  else
+  {
+    _usage();
+    ret = -1;
+  }
+
+  if( sim )
+    close( perf.fd );
+  else if( perf.fd >= 0 )
+    n_rf24l01_close( perf.fd );
+
+  return ret < 0;
+}
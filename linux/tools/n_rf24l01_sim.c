@@ -0,0 +1,2126 @@
+/*
+ * n_rf24l01_sim.c
+ *
+ * Runs protocol layers of the library's core against a simulated link, so they can be checked
+ * without transceivers: each side has its own core's instance over a backend which keeps
+ * nothing but a state the layers need, packages go over a medium with losses and jammed
+ * channels a scenario sets up, time is simulated, so a run takes no real time and is repeatable.
+ *
+ * usage: n_rf24l01_sim <scenario>
+ *
+ *   pkgs   writes of any size are split into packages intact, the last one is padded by zeros
+ *   hop    hopping (slot timer and per-package modes) over channels some of which are jammed
+ *          and a slave's thread which runs late
+ *   arq    a reliable stream over a lossy link, and either side restarting amid it
+ *   fec    encode/decode speeds (MB/s of user data) and a share of packages recovered
+ *          over a link with random losses
+ *   lz     frames compressed and decompressed back: incompressible ones are left as they are,
+ *          long runs shrink, frames of any size up to the max one come back the same, a broken
+ *          frame or a too small buffer is told of
+ *   bond   striping over links of different latencies and losses, links' weights
+ *   tun    UDP between two network namespaces, each has a TUN interface, the interfaces are
+ *          bridged by the IP adaptation layer over a simulated link (needs CAP_SYS_ADMIN and
+ *          CAP_NET_ADMIN, skipped with 77 otherwise)
+ *   tdma   a gateway and nodes on one channel: data of each node is told apart, a slot of a node
+ *          which is gone is freed for another one, an idle node keeps its slot
+ *   adapt  a link adaptation over levels of different losses: a link settles at the best level
+ *          which meets a target and follows a change, a restarted side is hunted for, a hunt
+ *          ends at a base level once there's nothing to transmit
+ *   mesh   a chain of nodes, each hears its neighbours only: data is relayed end to end and told
+ *          a source of, a restarted source isn't taken for duplicates, a broadcast comes once
+ *   pm     power management over a timeline: standby-I, listen windows entered early by a wake
+ *          time, a carrier which comes in standby-I is heard in a window and holds a receiver,
+ *          then standby-I and a power down again; LBT from standby-I or a power down reads RPD
+ *          by a settled receiver only
+ *
+ * A scenario prints what it has measured and exits with 1 if a result is out of bounds
+ * the scenario expects, so scenarios run as tests (ctest); speeds depend on a machine,
+ * so they are only reported.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+#include "n_rf24l01_core.h"
+#include "core/n_rf24l01.h"
+#include "core/n_rf24l01_hop.h"
+#include "core/n_rf24l01_arq.h"
+#include "core/n_rf24l01_fec.h"
+#include "core/n_rf24l01_lz.h"
+#include "core/n_rf24l01_lowpan.h"
+#include "core/n_rf24l01_bond.h"
+#include "core/n_rf24l01_tdma.h"
+#include "core/n_rf24l01_mesh.h"
+#include "core/n_rf24l01_adapt.h"
+#include "core/n_rf24l01_pm.h"
+
+/* the medium is sampled per a time step, in us */
+#define SIM_STEP_US 10
+
+typedef struct
+{
+  const char* name;
+  int (*run)( void );
+} scenario_t;
+
+typedef struct
+{
+  n_rf24l01_instance_t instance;
+} side_t;
+
+static uint32_t rand_state = 0x12345678;
+
+/* payloads the core writes to the transceiver go here, if it's set */
+static u_char* tx_log;
+static u_int tx_logged;
+
+/* a deterministic xorshift32 */
+static uint32_t _rand( void )
+{
+  rand_state ^= rand_state << 13;
+  rand_state ^= rand_state >> 17;
+  rand_state ^= rand_state << 5;
+
+  return rand_state;
+}
+
+/* 1 with @pct percents */
+static int _chance( u_int pct )
+{
+  return _rand() % 100 < pct;
+}
+
+static void _set_up_ce_pin( u_char value )
+{
+}
+
+/* registers aren't kept, a channel and a mode the layers need are kept by a core's instance */
+static void _send_cmd( u_char cmd, u_char* status_reg, u_char* data, u_char num, u_char direction )
+{
+  if( status_reg )
+    *status_reg = 0;
+
+  if( tx_log && cmd == W_TX_PAYLOAD && direction )
+  {
+    memcpy( tx_log + tx_logged, data, num );
+    tx_logged += num;
+  }
+
+  if( !direction && data )
+    memset( data, 0, num );
+}
+
+static void _usleep( u_int delay_mks )
+{
+}
+
+static void _handle_received_data( const void* data, u_int num )
+{
+}
+
+static void _init_side( side_t* side )
+{
+  n_rf24l01_backend_t backend;
+
+  memset( &backend, 0, sizeof(backend) );
+  backend.set_up_ce_pin = _set_up_ce_pin;
+  backend.send_cmd = _send_cmd;
+  backend.usleep = _usleep;
+  backend.handle_received_data = _handle_received_data;
+
+  n_rf24l01_select( &side->instance );
+  n_rf24l01_init( &backend );
+}
+
+/* ----------------------------------------------- link ---------------------------------------------- */
+
+#define SIM_QUEUE_SIZE 256
+
+/* a package on its way to an end of a link, @tag - what a layer needs to know of it
+ * besides the package itself (a sender's level, a link of bonded ones) */
+typedef struct
+{
+  u_char pkg[N_RF24L01_PKG_SIZE];
+  uint64_t arrival_us;
+  u_int tag;
+} sim_pkg_t;
+
+typedef struct sim_end_t sim_end_t;
+
+/* a layer's hooks on an end: take a package which has come, do what's due by a current time;
+ * either may be NULL */
+typedef struct
+{
+  void (*on_pkg)( sim_end_t* end, const sim_pkg_t* pkg );
+  void (*poll)( sim_end_t* end );
+} sim_hooks_t;
+
+/* an end of a two-radio link: packages go from it one after another over the air, take
+ * a latency, some of them are lost, and wait in a queue of the other end till a step gets to them */
+struct sim_end_t
+{
+  sim_end_t* peer;
+  const sim_hooks_t* hooks;
+  void* ctx;                 /* a layer's side */
+
+  sim_pkg_t queue[SIM_QUEUE_SIZE];
+  u_int head, tail;
+
+  uint64_t now_us, air_free_us;
+  u_int latency_us, airtime_us, loss_pct;
+};
+
+typedef struct
+{
+  sim_end_t ends[2];
+} sim_link_t;
+
+/* set up a @link between layers' sides @ctx_a and @ctx_b, no package is lost till a scenario says so */
+static void _sim_link( sim_link_t* link, const sim_hooks_t* hooks, void* ctx_a, void* ctx_b, u_int latency_us,
+                       u_int airtime_us )
+{
+  u_int i;
+
+  memset( link, 0, sizeof(*link) );
+
+  for( i = 0; i < 2; i++ )
+  {
+    link->ends[i].peer = &link->ends[!i];
+    link->ends[i].hooks = hooks;
+    link->ends[i].ctx = i ? ctx_b : ctx_a;
+    link->ends[i].latency_us = latency_us;
+    link->ends[i].airtime_us = airtime_us;
+  }
+}
+
+/* transmit a package from an @end, it's lost by a chance or if a queue of the peer is full */
+static void _sim_transmit( sim_end_t* end, const u_char* pkg, u_int tag )
+{
+  sim_end_t* peer = end->peer;
+  sim_pkg_t* entry;
+
+  if( end->air_free_us < end->now_us )
+    end->air_free_us = end->now_us;
+  end->air_free_us += end->airtime_us;
+
+  if( ( end->loss_pct && _chance( end->loss_pct ) ) || peer->tail - peer->head == SIM_QUEUE_SIZE )
+    return;
+
+  entry = &peer->queue[peer->tail++ % SIM_QUEUE_SIZE];
+  memcpy( entry->pkg, pkg, N_RF24L01_PKG_SIZE );
+  entry->arrival_us = end->air_free_us + end->latency_us;
+  entry->tag = tag;
+}
+
+/* move both ends of a @link to @now_us: each gets packages which have come by then, then polls */
+static void _sim_step( sim_link_t* link, uint64_t now_us )
+{
+  sim_end_t* end;
+  sim_pkg_t* entry;
+  u_int i;
+
+  for( i = 0; i < 2; i++ )
+  {
+    end = &link->ends[i];
+    end->now_us = now_us;
+
+    while( end->head != end->tail && end->queue[end->head % SIM_QUEUE_SIZE].arrival_us <= now_us )
+    {
+      entry = &end->queue[end->head++ % SIM_QUEUE_SIZE];
+
+      if( end->hooks->on_pkg )
+        end->hooks->on_pkg( end, entry );
+    }
+
+    if( end->hooks->poll )
+      end->hooks->poll( end );
+  }
+}
+
+/* 1 if nothing is on its way over a @link */
+static int _sim_idle( const sim_link_t* link )
+{
+  return link->ends[0].head == link->ends[0].tail && link->ends[1].head == link->ends[1].tail;
+}
+
+/* ----------------------------------------------- pkgs ---------------------------------------------- */
+
+#define PKGS_MAX_WRITE ( 8 * N_RF24L01_PKG_SIZE )
+
+/* write each size up to PKGS_MAX_WRITE, sizes which are multiples of a package included */
+static int _scenario_pkgs( void )
+{
+  u_char data[PKGS_MAX_WRITE], log[PKGS_MAX_WRITE];
+  u_char zeros[N_RF24L01_PKG_SIZE] = { 0, };
+  side_t side;
+  u_int num, pkgs, broken = 0;
+  int ok;
+
+  for( num = 0; num < sizeof(data); num++ )
+    data[num] = _rand() | 1;
+
+  _init_side( &side );
+  tx_log = log;
+
+  for( num = 1; num <= PKGS_MAX_WRITE; num++ )
+  {
+    tx_logged = 0;
+    n_rf24l01_transmit_pkgs( data, num );
+
+    pkgs = ( num + N_RF24L01_PKG_SIZE - 1 ) / N_RF24L01_PKG_SIZE;
+    if( tx_logged != pkgs * N_RF24L01_PKG_SIZE || memcmp( log, data, num ) ||
+        memcmp( log + num, zeros, tx_logged - num ) )
+      broken++;
+  }
+
+  tx_log = NULL;
+
+  ok = !broken;
+  printf( "writes of 1..%u bytes, broken %u: %s\n", PKGS_MAX_WRITE, broken, ok ? "ok" : "FAILED" );
+
+  return !ok;
+}
+
+/* ----------------------------------------------- hop ----------------------------------------------- */
+
+#define HOP_CHANNELS 40
+#define HOP_JAMMED 10
+#define HOP_SECONDS 10
+
+/* run a master which transmits a package each @interval_us to a slave over HOP_CHANNELS channels,
+ * @jammed of them are jammed, @loss_pct percents of other packages are lost;
+ * @min_pct - the least share of sent packages the slave has to get each second */
+static int _run_hop( const char* name, uint32_t dwell_us, u_int interval_us, u_int jammed, u_int loss_pct,
+                     u_int min_pct )
+{
+  u_char channels[HOP_CHANNELS], is_jammed[N_RF24L01_CHANNELS_AMOUNT];
+  n_rf24l01_hop_t master, slave;
+  side_t sides[2];
+  uint64_t now, next_tx = 0;
+  u_int sent = 0, received = 0, total_sent = 0, total_received = 0, worst_pct = 100, i;
+  int failed = 0;
+
+  memset( is_jammed, 0, sizeof(is_jammed) );
+
+  for( i = 0; i < HOP_CHANNELS; i++ )
+    channels[i] = 2 + i * 3;
+
+  for( i = 0; i < jammed; i++ )
+    is_jammed[channels[i * HOP_CHANNELS / jammed]] = 1;
+
+  _init_side( &sides[0] );
+  _init_side( &sides[1] );
+
+  n_rf24l01_select( &sides[0].instance );
+  n_rf24l01_hop_init( &master, 0xbeef, channels, HOP_CHANNELS, dwell_us, N_RF24L01_HOP_MASTER );
+  n_rf24l01_hop_start( &master, 0 );
+
+  /* the slave starts later, somewhere in the master's cycle */
+  n_rf24l01_select( &sides[1].instance );
+  n_rf24l01_hop_init( &slave, 0xbeef, channels, HOP_CHANNELS, dwell_us, N_RF24L01_HOP_SLAVE );
+  n_rf24l01_hop_start( &slave, 12345 );
+
+  for( now = 12345; now < HOP_SECONDS * 1000000ull; now += SIM_STEP_US )
+  {
+    n_rf24l01_select( &sides[0].instance );
+    n_rf24l01_hop_tick( &master, now );
+
+    n_rf24l01_select( &sides[1].instance );
+    n_rf24l01_hop_tick( &slave, now );
+
+    if( now >= next_tx )
+    {
+      n_rf24l01_select( &sides[0].instance );
+
+      if( !n_rf24l01_hop_tx_delay( &master, now ) )
+      {
+        u_char channel = sides[0].instance.channel;
+
+        sent++;
+        next_tx = now + interval_us;
+
+        if( channel == sides[1].instance.channel && !is_jammed[channel] && !_chance( loss_pct ) )
+        {
+          received++;
+
+          n_rf24l01_select( &sides[1].instance );
+          n_rf24l01_hop_on_rx( &slave, now );
+        }
+
+        n_rf24l01_select( &sides[0].instance );
+        n_rf24l01_hop_on_tx( &master );
+      }
+    }
+
+    /* the first second is for the slave to find the master */
+    if( now % 1000000 < SIM_STEP_US )
+    {
+      if( now >= 2000000 )
+      {
+        if( sent && received * 100 / sent < worst_pct )
+          worst_pct = received * 100 / sent;
+
+        total_sent += sent;
+        total_received += received;
+      }
+
+      sent = received = 0;
+    }
+  }
+
+  if( worst_pct < min_pct )
+    failed = 1;
+
+  printf( "%-24s sent %6u received %6u (%3u%%), the worst second %3u%% (>= %u%%), resyncs %u: %s\n", name,
+          total_sent, total_received, total_sent ? total_received * 100 / total_sent : 0, worst_pct, min_pct,
+          slave.resyncs, failed ? "FAILED" : "ok" );
+
+  return failed;
+}
+
+/* a slave's timing is taken by a thread which may run late or be passed by a package
+ * stamped after it has taken a current time: neither parks a synced slave, and a timeout
+ * of a late tick is due at once instead of wrapping around */
+static int _check_hop_late( const char* name, uint32_t dwell_us )
+{
+  u_char channels[HOP_CHANNELS];
+  n_rf24l01_hop_t slave;
+  side_t side;
+  uint32_t early, late;
+  u_int i;
+  int ok;
+
+  for( i = 0; i < HOP_CHANNELS; i++ )
+    channels[i] = 2 + i * 3;
+
+  _init_side( &side );
+  n_rf24l01_hop_init( &slave, 0xbeef, channels, HOP_CHANNELS, dwell_us, N_RF24L01_HOP_SLAVE );
+  n_rf24l01_hop_start( &slave, 0 );
+
+  /* per-package hopping learns an interval of 400us */
+  for( i = 1; i <= 3; i++ )
+    n_rf24l01_hop_on_rx( &slave, i * 400 );
+
+  early = n_rf24l01_hop_tick( &slave, 3 * 400 - 10 );
+  late = n_rf24l01_hop_tick( &slave, 3 * 400 + 10 * 400 );
+
+  ok = slave.synced && !slave.resyncs && early <= N_RF24L01_HOP_PARK_MKS && late <= N_RF24L01_HOP_PARK_MKS;
+
+  printf( "%-24s a package stamped ahead, timeout %u, a late tick, timeout %u: %s\n", name, early, late,
+          ok ? "ok" : "FAILED" );
+
+  return !ok;
+}
+
+/* both modes are expected to lose packages sent on jammed channels only, a slave
+ * mustn't lose the master for longer */
+static int _scenario_hop( void )
+{
+  int failed = 0;
+
+  failed |= _check_hop_late( "slots, late", 4000 );
+  failed |= _check_hop_late( "per-package, late", 0 );
+
+  failed |= _run_hop( "slots, clear", 4000, 250, 0, 0, 95 );
+  failed |= _run_hop( "slots, 25% jammed", 4000, 250, HOP_JAMMED, 2, 65 );
+  failed |= _run_hop( "per-package, 2% loss", 0, 400, 0, 2, 90 );
+  failed |= _run_hop( "per-package, 1 jammed", 0, 400, 1, 0, 90 );
+  failed |= _run_hop( "per-package, 25% jammed", 0, 400, HOP_JAMMED, 2, 65 );
+
+  return failed;
+}
+
+/* ----------------------------------------------- arq ----------------------------------------------- */
+
+#define ARQ_STREAM_SIZE 100000
+#define ARQ_LATENCY_US 400
+#define ARQ_PKG_AIRTIME_US 160
+
+/* an ARQ on an end of a link */
+typedef struct
+{
+  n_rf24l01_arq_t arq;
+  sim_end_t* end;
+
+  /* what has been delivered to a user */
+  u_char* received;
+  u_int received_num;
+} arq_side_t;
+
+static u_char arq_stream[ARQ_STREAM_SIZE];
+
+static void _arq_send( void* ctx, const u_char* pkg )
+{
+  arq_side_t* side = ctx;
+
+  _sim_transmit( side->end, pkg, 0 );
+}
+
+static void _arq_deliver( void* ctx, const u_char* data, u_int num )
+{
+  arq_side_t* side = ctx;
+
+  if( side->received_num + num <= 2 * ARQ_STREAM_SIZE )
+    memcpy( side->received + side->received_num, data, num );
+
+  side->received_num += num;
+}
+
+static void _arq_on_pkg( sim_end_t* end, const sim_pkg_t* pkg )
+{
+  arq_side_t* side = end->ctx;
+
+  n_rf24l01_arq_on_pkg( &side->arq, pkg->pkg, end->now_us );
+}
+
+static void _arq_poll( sim_end_t* end )
+{
+  arq_side_t* side = end->ctx;
+
+  n_rf24l01_arq_poll( &side->arq, end->now_us );
+}
+
+static const sim_hooks_t arq_hooks = { _arq_on_pkg, _arq_poll };
+
+static void _arq_init_side( arq_side_t* side, uint64_t now_us )
+{
+  n_rf24l01_arq_init( &side->arq, 16, _arq_send, _arq_deliver, side, now_us );
+  side->received_num = 0;
+}
+
+/* stream ARQ_STREAM_SIZE bytes from sides[0] to sides[1] with @loss_pct percents of packages lost
+ * in each direction; @restart - 0, or 1/2 to restart the transmitter/the receiver in a middle
+ * of the stream; what the receiver gets after a restart has to be a contiguous tail of the stream */
+static int _run_arq( const char* name, u_int loss_pct, int restart, u_int min_pct )
+{
+  static u_char received[2 * ARQ_STREAM_SIZE];
+  static arq_side_t sides[2];
+  static sim_link_t link;
+  u_int offset = 0, start = 0, restarted = 0, pct;
+  uint64_t now = 1000;
+  int failed = 0;
+
+  memset( sides, 0, sizeof(sides) );
+  _sim_link( &link, &arq_hooks, &sides[0], &sides[1], ARQ_LATENCY_US, ARQ_PKG_AIRTIME_US );
+  link.ends[0].loss_pct = link.ends[1].loss_pct = loss_pct;
+
+  sides[0].end = &link.ends[0];
+  sides[1].end = &link.ends[1];
+  sides[0].received = sides[1].received = received;
+
+  _arq_init_side( &sides[0], now );
+  _arq_init_side( &sides[1], now + 1 );
+
+  for( ; now < 60000000 && ( offset < ARQ_STREAM_SIZE || sides[0].arq.tx_base != sides[0].arq.tx_next );
+       now += SIM_STEP_US )
+  {
+    if( restart && !restarted && offset >= ARQ_STREAM_SIZE / 2 )
+    {
+      restarted = 1;
+
+      /* a new transmitter starts the stream anew, a new receiver gets what is left of it */
+      if( restart == 1 )
+      {
+        _arq_init_side( &sides[0], now );
+        offset = 0;
+      }
+      else
+        _arq_init_side( &sides[1], now );
+    }
+
+    _sim_step( &link, now );
+
+    if( offset < ARQ_STREAM_SIZE && link.ends[0].air_free_us <= now )
+      offset += n_rf24l01_arq_send( &sides[0].arq, arq_stream + offset,
+                                    ARQ_STREAM_SIZE - offset < 500 ? ARQ_STREAM_SIZE - offset : 500, now );
+  }
+
+  /* let the last acknowledge go */
+  _sim_step( &link, now + 100000 );
+
+  if( restart == 1 )
+  {
+    /* the receiver has got a part of the previous stream, and then the whole new one */
+    start = sides[1].received_num - ARQ_STREAM_SIZE;
+
+    if( sides[1].received_num < ARQ_STREAM_SIZE || memcmp( received, arq_stream, start ) ||
+        memcmp( received + start, arq_stream, ARQ_STREAM_SIZE ) )
+      failed = 1;
+  }
+  else
+  {
+    /* the receiver (a new one) has got the stream from some point on */
+    while( start < ARQ_STREAM_SIZE && memcmp( arq_stream + start, received, 16 ) )
+      start++;
+
+    if( sides[1].received_num != ARQ_STREAM_SIZE - start ||
+        memcmp( received, arq_stream + start, sides[1].received_num ) )
+      failed = 1;
+  }
+
+  if( restart && !sides[restart == 1 ? 1 : 0].arq.stats.resets )
+    failed = 1;
+
+  /* a share of transmissions which were new data */
+  pct = sides[0].arq.stats.pkgs_sent * 100 / ( sides[0].arq.stats.pkgs_sent + sides[0].arq.stats.pkgs_retransmitted );
+  if( pct < min_pct )
+    failed = 1;
+
+  printf( "%-24s %llu ms, sent %5u, retransmitted %5u (new data %3u%%, >= %u%%), rtt %5u us: %s\n", name,
+          (unsigned long long)now / 1000, sides[0].arq.stats.pkgs_sent, sides[0].arq.stats.pkgs_retransmitted, pct,
+          min_pct, sides[0].arq.srtt_mks, failed ? "FAILED" : "ok" );
+
+  return failed;
+}
+
+/* a loss costs about one retransmission of a lost package, a restarted side is met anew
+ * within a round trip and the stream goes on */
+static int _scenario_arq( void )
+{
+  int failed = 0;
+  u_int i;
+
+  for( i = 0; i < ARQ_STREAM_SIZE; i++ )
+    arq_stream[i] = _rand();
+
+  failed |= _run_arq( "clear", 0, 0, 99 );
+  failed |= _run_arq( "10% loss", 10, 0, 80 );
+  failed |= _run_arq( "30% loss", 30, 0, 55 );
+  failed |= _run_arq( "10%, transmitter restart", 10, 1, 70 );
+  failed |= _run_arq( "10%, receiver restart", 10, 2, 70 );
+
+  return failed;
+}
+
+/* ----------------------------------------------- fec ----------------------------------------------- */
+
+#define FEC_STREAM_SIZE ( 2 * 1024 * 1024 )
+#define FEC_MAX_PKGS ( FEC_STREAM_SIZE / N_RF24L01_FEC_PAYLOAD_SIZE * 2 + 64 )
+
+typedef struct
+{
+  u_char* pkgs;
+  u_int pkgs_num;
+
+  u_char* received;
+  u_int received_num;
+} fec_link_t;
+
+static u_char fec_stream[FEC_STREAM_SIZE];
+
+static uint64_t _get_time_ns( void )
+{
+  struct timespec ts;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts );
+
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void _fec_send( void* ctx, const u_char* pkg )
+{
+  fec_link_t* link = ctx;
+
+  if( link->pkgs_num < FEC_MAX_PKGS )
+    memcpy( link->pkgs + link->pkgs_num++ * N_RF24L01_PKG_SIZE, pkg, N_RF24L01_PKG_SIZE );
+}
+
+static void _fec_deliver( void* ctx, const u_char* data, u_int num )
+{
+  fec_link_t* link = ctx;
+
+  if( link->received_num + num <= FEC_STREAM_SIZE )
+    memcpy( link->received + link->received_num, data, num );
+
+  link->received_num += num;
+}
+
+/* encode FEC_STREAM_SIZE bytes by groups of @k + @m packages, lose @loss_pct percents of packages
+ * and decode the rest; @min_permille - the least share of data packages the receiver has to get */
+static int _run_fec( const char* name, u_int k, u_int m, u_int loss_pct, u_int min_permille )
+{
+  static n_rf24l01_fec_t tx, rx;
+  fec_link_t link;
+  uint64_t encode_ns, decode_ns;
+  u_int i, permille;
+  int failed = 0;
+
+  memset( &link, 0, sizeof(link) );
+  link.pkgs = malloc( FEC_MAX_PKGS * N_RF24L01_PKG_SIZE );
+  link.received = malloc( FEC_STREAM_SIZE );
+
+  if( !link.pkgs || !link.received )
+  {
+    free( link.pkgs );
+    free( link.received );
+    return 1;
+  }
+
+  n_rf24l01_fec_init( &tx, k, m, _fec_send, _fec_deliver, &link );
+  n_rf24l01_fec_init( &rx, k, m, _fec_send, _fec_deliver, &link );
+
+  /* by writes of 10 packages, as a user's writes come */
+  encode_ns = _get_time_ns();
+
+  for( i = 0; i < FEC_STREAM_SIZE; i += 10 * N_RF24L01_FEC_PAYLOAD_SIZE )
+    n_rf24l01_fec_send( &tx, fec_stream + i, FEC_STREAM_SIZE - i < 10 * N_RF24L01_FEC_PAYLOAD_SIZE ?
+                        FEC_STREAM_SIZE - i : 10 * N_RF24L01_FEC_PAYLOAD_SIZE, 0 );
+
+  n_rf24l01_fec_poll( &tx, N_RF24L01_FEC_FLUSH_MKS );
+
+  encode_ns = _get_time_ns() - encode_ns;
+
+  /* losses are drawn ahead, not to measure them */
+  for( i = 0; i < link.pkgs_num; i++ )
+    if( _chance( loss_pct ) )
+      link.pkgs[i * N_RF24L01_PKG_SIZE] = 0;
+
+  decode_ns = _get_time_ns();
+
+  for( i = 0; i < link.pkgs_num; i++ )
+    if( link.pkgs[i * N_RF24L01_PKG_SIZE] )
+      n_rf24l01_fec_on_pkg( &rx, link.pkgs + i * N_RF24L01_PKG_SIZE );
+
+  decode_ns = _get_time_ns() - decode_ns;
+
+  permille = (uint64_t)( rx.stats.data_pkgs_received + rx.stats.pkgs_recovered ) * 1000 / tx.stats.data_pkgs_sent;
+  if( permille < min_permille )
+    failed = 1;
+
+  /* what has got through has to be the stream itself */
+  if( !rx.stats.pkgs_lost && ( link.received_num != FEC_STREAM_SIZE ||
+                                memcmp( link.received, fec_stream, FEC_STREAM_SIZE ) ) )
+    failed = 1;
+
+  printf( "%-18s encode %6.1f MB/s, decode %6.1f MB/s, data packages got %5.1f%% (>= %4.1f%%), "
+          "recovered %6u: %s\n", name, FEC_STREAM_SIZE * 1000.0 / ( encode_ns ? encode_ns : 1 ),
+          FEC_STREAM_SIZE * 1000.0 / ( decode_ns ? decode_ns : 1 ), permille / 10.0, min_permille / 10.0,
+          rx.stats.pkgs_recovered, failed ? "FAILED" : "ok" );
+
+  free( link.pkgs );
+  free( link.received );
+
+  return failed;
+}
+
+/* a group of k + m is lost only if more than m of its packages are */
+static int _scenario_fec( void )
+{
+  int failed = 0;
+  u_int i;
+
+  for( i = 0; i < FEC_STREAM_SIZE; i++ )
+    fec_stream[i] = _rand();
+
+  failed |= _run_fec( "8+2, no loss", 8, 2, 0, 1000 );
+  failed |= _run_fec( "8+2, 5% loss", 8, 2, 5, 990 );
+  failed |= _run_fec( "16+4, 5% loss", 16, 4, 5, 995 );
+  failed |= _run_fec( "16+4, 10% loss", 16, 4, 10, 980 );
+  failed |= _run_fec( "32+16, 20% loss", 32, 16, 20, 990 );
+
+  return failed;
+}
+
+/* ------------------------------------------------ lz ----------------------------------------------- */
+
+#define LZ_ROUNDS 200
+
+/* time spent to compress and decompress frames back */
+static uint64_t lz_ns;
+
+/* compress @num bytes of @src and decompress them back, returns a size of a compressed frame,
+ * 0 - @src has been left as it is, -1 - it hasn't come back the same */
+static int _lz_round_trip( const u_char* src, u_int num )
+{
+  static n_rf24l01_lz_t lz;
+  u_char packed[N_RF24L01_LZ_BOUND( N_RF24L01_LZ_MAX_FRAME )], unpacked[N_RF24L01_LZ_MAX_FRAME];
+  uint64_t start = _get_time_ns();
+  u_int size;
+  int ret;
+
+  size = n_rf24l01_lz_compress( &lz, src, num, packed, sizeof(packed) );
+  ret = size ? n_rf24l01_lz_decompress( packed, size, unpacked, sizeof(unpacked) ) : 0;
+
+  lz_ns += _get_time_ns() - start;
+
+  if( !size )
+    return 0;
+
+  if( size >= num || ret != (int)num || memcmp( unpacked, src, num ) )
+    return -1;
+
+  return size;
+}
+
+/* a text of a few words, which an encoder finds matches in */
+static void _lz_text( u_char* dst, u_int num )
+{
+  static const char* words[] = { "temperature ", "humidity ", "node ", "=", "21.5", "48", "; ", "ok\n" };
+  u_int i, len;
+
+  for( i = 0; i < num; i += len )
+  {
+    const char* word = words[_rand() % ( sizeof(words) / sizeof(words[0]) )];
+
+    len = strlen( word ) < num - i ? strlen( word ) : num - i;
+    memcpy( dst + i, word, len );
+  }
+}
+
+static int _scenario_lz( void )
+{
+  static n_rf24l01_lz_t lz;
+  u_char src[N_RF24L01_LZ_MAX_FRAME + 1], packed[N_RF24L01_LZ_BOUND( N_RF24L01_LZ_MAX_FRAME )];
+  u_char unpacked[N_RF24L01_LZ_MAX_FRAME];
+  u_int i, num, size, run, broken = 0, left = 0, total_in = 0, total_out = 0;
+  int ret, failed = 0;
+
+  /* random bytes have nothing to match, they're sent as they are */
+  for( i = 0; i < N_RF24L01_LZ_MAX_FRAME; i++ )
+    src[i] = _rand();
+
+  ret = _lz_round_trip( src, N_RF24L01_LZ_MAX_FRAME );
+  printf( "incompressible %4u bytes:   %s\n", N_RF24L01_LZ_MAX_FRAME, ret == 0 ? "left as is, ok" : "FAILED" );
+  failed |= ret != 0;
+
+  /* a run is matched by the longest matches, which overlap data they produce */
+  memset( src, 'a', N_RF24L01_LZ_MAX_FRAME );
+
+  ret = _lz_round_trip( src, N_RF24L01_LZ_MAX_FRAME );
+  printf( "a run of %4u bytes:         %4d bytes: %s\n", N_RF24L01_LZ_MAX_FRAME, ret,
+          ret > 0 && ret <= N_RF24L01_LZ_MAX_FRAME / 8 ? "ok" : "FAILED" );
+  failed |= ret <= 0 || ret > N_RF24L01_LZ_MAX_FRAME / 8;
+
+  /* runs of random lengths of random bytes, and a text, of any size up to the max one */
+  lz_ns = 0;
+
+  for( i = 0; i < LZ_ROUNDS; i++ )
+  {
+    num = i < 2 ? N_RF24L01_LZ_MAX_FRAME : 1 + _rand() % N_RF24L01_LZ_MAX_FRAME;
+
+    if( i % 2 )
+      _lz_text( src, num );
+    else
+      for( size = 0; size < num; size += run )
+      {
+        run = 1 + _rand() % 40;
+        memset( src + size, _rand(), run < num - size ? run : num - size );
+      }
+
+    ret = _lz_round_trip( src, num );
+    if( ret < 0 )
+      broken++;
+    else if( ret == 0 )
+      left++;
+    else
+    {
+      total_in += num;
+      total_out += ret;
+    }
+  }
+
+  printf( "%u frames of 1..%u bytes:  ratio %.2f, left as is %u, broken %u, a round trip %6.1f MB/s: %s\n",
+          LZ_ROUNDS, N_RF24L01_LZ_MAX_FRAME, total_out ? (double)total_in / total_out : 0.0, left, broken,
+          total_in * 1000.0 / ( lz_ns ? lz_ns : 1 ), !broken && left < LZ_ROUNDS / 10 ? "ok" : "FAILED" );
+  failed |= broken || left >= LZ_ROUNDS / 10;
+
+  /* a frame above the max one isn't compressed, nor is one which doesn't fit a buffer */
+  memset( src, 'a', sizeof(src) );
+  ret = n_rf24l01_lz_compress( &lz, src, N_RF24L01_LZ_MAX_FRAME + 1, packed, sizeof(packed) ) == 0 &&
+        n_rf24l01_lz_compress( &lz, src, N_RF24L01_LZ_MAX_FRAME, packed, 4 ) == 0;
+
+  /* a decoder tells of a buffer too small and of a match before a start of a frame */
+  size = n_rf24l01_lz_compress( &lz, src, N_RF24L01_LZ_MAX_FRAME, packed, sizeof(packed) );
+  ret = ret && size && n_rf24l01_lz_decompress( packed, size, unpacked, N_RF24L01_LZ_MAX_FRAME - 1 ) == -1;
+
+  packed[0] = 0x01;
+  packed[1] = 0x10;
+  packed[2] = 0x00;
+  ret = ret && n_rf24l01_lz_decompress( packed, 3, unpacked, sizeof(unpacked) ) == -1;
+
+  printf( "bounds and broken frames:   %s\n", ret ? "ok" : "FAILED" );
+  failed |= !ret;
+
+  return failed;
+}
+
+/* ----------------------------------------------- bond ---------------------------------------------- */
+
+#define BOND_LINKS 2
+#define BOND_SECONDS 5
+
+/* an end of bonded links, a radio of each is an end of a link of its own */
+typedef struct
+{
+  n_rf24l01_bond_t bond;
+  sim_end_t* ends[BOND_LINKS];
+
+  /* chunks carry a counter, which has to go up */
+  uint32_t last;
+  u_int delivered;
+  int disordered;
+} bond_side_t;
+
+/* a package carries a link it has gone over */
+static void _bond_send( void* ctx, u_int link, const u_char* pkg )
+{
+  bond_side_t* side = ctx;
+
+  _sim_transmit( side->ends[link], pkg, link );
+}
+
+static void _bond_deliver( void* ctx, const u_char* data, u_int num )
+{
+  bond_side_t* side = ctx;
+  uint32_t counter;
+
+  memcpy( &counter, data, sizeof(counter) );
+
+  if( num != N_RF24L01_BOND_PAYLOAD_SIZE || counter <= side->last )
+    side->disordered = 1;
+
+  side->last = counter;
+  side->delivered++;
+}
+
+static void _bond_on_pkg( sim_end_t* end, const sim_pkg_t* pkg )
+{
+  bond_side_t* side = end->ctx;
+
+  n_rf24l01_bond_on_pkg( &side->bond, pkg->tag, pkg->pkg, end->now_us );
+}
+
+/* a bonding polls once for all its links */
+static const sim_hooks_t bond_hooks = { _bond_on_pkg, NULL };
+
+/* stream a chunk of N_RF24L01_BOND_PAYLOAD_SIZE bytes each @interval_us from sides[0] to sides[1],
+ * links have latencies of @latency_us, sides[0]'s packages over links are lost by @loss_pct;
+ * @min_pct - the least share of chunks to get through,
+ * @max_weight - the most weight the last link may end with (it's a lossy one) */
+static int _run_bond( const char* name, u_int interval_us, const u_int latency_us[BOND_LINKS],
+                      const u_int loss_pct[BOND_LINKS], u_int min_pct, u_int max_weight )
+{
+  static bond_side_t sides[2];
+  static sim_link_t links[BOND_LINKS];
+  u_char chunk[N_RF24L01_BOND_PAYLOAD_SIZE];
+  uint32_t counter = 0;
+  uint64_t now;
+  u_int i, link, pct;
+  int failed = 0;
+
+  memset( sides, 0, sizeof(sides) );
+
+  for( link = 0; link < BOND_LINKS; link++ )
+  {
+    _sim_link( &links[link], &bond_hooks, &sides[0], &sides[1], latency_us[link], 0 );
+    links[link].ends[0].loss_pct = loss_pct[link];
+
+    sides[0].ends[link] = &links[link].ends[0];
+    sides[1].ends[link] = &links[link].ends[1];
+  }
+
+  for( i = 0; i < 2; i++ )
+    n_rf24l01_bond_init( &sides[i].bond, BOND_LINKS, _bond_send, _bond_deliver, &sides[i] );
+
+  memset( chunk, 0, sizeof(chunk) );
+
+  for( now = 0; now < BOND_SECONDS * 1000000ull; now += SIM_STEP_US )
+  {
+    for( link = 0; link < BOND_LINKS; link++ )
+      links[link].ends[0].now_us = links[link].ends[1].now_us = now;
+
+    /* the last chunks have time to get through */
+    if( !( now % interval_us ) && now < ( BOND_SECONDS - 1 ) * 1000000ull )
+    {
+      counter++;
+      memcpy( chunk, &counter, sizeof(counter) );
+      n_rf24l01_bond_send( &sides[0].bond, chunk, sizeof(chunk) );
+    }
+
+    for( link = 0; link < BOND_LINKS; link++ )
+      _sim_step( &links[link], now );
+
+    for( i = 0; i < 2; i++ )
+      n_rf24l01_bond_poll( &sides[i].bond, now );
+  }
+
+  pct = sides[1].delivered * 100 / counter;
+
+  if( sides[1].disordered || pct < min_pct || sides[0].bond.links[BOND_LINKS - 1].weight > max_weight )
+    failed = 1;
+
+  printf( "%-22s got %5u of %5u (%3u%%, >= %u%%), reordered %5u, skipped %4u, weights", name,
+          sides[1].delivered, counter, pct, min_pct, sides[1].bond.stats.pkgs_reordered,
+          sides[1].bond.stats.pkgs_skipped );
+
+  for( link = 0; link < BOND_LINKS; link++ )
+    printf( " %3u", sides[0].bond.links[link].weight );
+
+  printf( " (the last <= %u)%s: %s\n", max_weight, sides[1].disordered ? ", out of order" : "",
+          failed ? "FAILED" : "ok" );
+
+  return failed;
+}
+
+/* a receiver puts packages of links with different latencies back in order, a lossy link's
+ * weight follows a share of its packages which get through, so it carries less */
+static int _scenario_bond( void )
+{
+  static const u_int same[BOND_LINKS] = { 500, 500 }, skewed[BOND_LINKS] = { 300, 3000 };
+  static const u_int clear[BOND_LINKS] = { 0, 0 }, lossy[BOND_LINKS] = { 0, 40 };
+  int failed = 0;
+
+  failed |= _run_bond( "clear", 200, same, clear, 100, N_RF24L01_BOND_MAX_WEIGHT );
+  failed |= _run_bond( "latencies 0.3/3ms", 200, skewed, clear, 100, N_RF24L01_BOND_MAX_WEIGHT );
+  failed |= _run_bond( "40% loss on a link", 200, same, lossy, 80, N_RF24L01_BOND_MAX_WEIGHT * 2 / 3 );
+
+  return failed;
+}
+
+/* ----------------------------------------------- tun ----------------------------------------------- */
+
+#define TUN_MTU 1280
+#define TUN_PORT 0xf0b1
+#define TUN_WAIT_MS 200
+#define TUN_SKIPPED 77
+
+/* as in linux/ipv6.h, which doesn't go along with netinet/in.h */
+typedef struct
+{
+  struct in6_addr addr;
+  uint32_t prefixlen;
+  int ifindex;
+} tun_in6_ifreq_t;
+
+/* an end of a link: an interface in its own network namespace and a UDP socket on it */
+typedef struct
+{
+  n_rf24l01_lowpan_t lowpan;
+  sim_end_t* end;
+  int tun_fd;
+  int udp_fd;
+  int ifindex;
+  struct in6_addr addr;
+} tun_side_t;
+
+/* packages of a datagram come right away, no time is simulated here */
+static sim_link_t tun_link;
+
+static void _tun_send( void* ctx, const u_char* pkg )
+{
+  tun_side_t* side = ctx;
+
+  _sim_transmit( side->end, pkg, 0 );
+}
+
+static void _tun_deliver( void* ctx, const u_char* datagram, u_int num )
+{
+  tun_side_t* side = ctx;
+
+  if( write( side->tun_fd, datagram, num ) < 0 )
+    perror( "fail to write to a tun device" );
+}
+
+static void _tun_on_pkg( sim_end_t* end, const sim_pkg_t* pkg )
+{
+  tun_side_t* side = end->ctx;
+
+  n_rf24l01_lowpan_on_pkg( &side->lowpan, pkg->pkg );
+}
+
+static const sim_hooks_t tun_hooks = { _tun_on_pkg, NULL };
+
+/* make a network namespace with an interface rfsim<@index> of fe80::ff:fe00:<@index + 1> address,
+ * the namespace lives as long as the interface's and the socket's fds;
+ * returns -1 if failed, errno tells why */
+static int _tun_open_side( tun_side_t* side, u_int index )
+{
+  tun_in6_ifreq_t ifr6;
+  struct sockaddr_in6 sa;
+  struct ifreq ifr;
+  int i;
+
+  if( unshare( CLONE_NEWNET ) < 0 )
+    return -1;
+
+  side->tun_fd = open( "/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC );
+  side->udp_fd = socket( AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0 );
+  if( side->tun_fd < 0 || side->udp_fd < 0 )
+    return -1;
+
+  memset( &ifr, 0, sizeof(ifr) );
+  ifr.ifr_flags = IFF_TUN | IFF_NO_PI;
+  snprintf( ifr.ifr_name, IFNAMSIZ, "rfsim%u", index );
+
+  if( ioctl( side->tun_fd, TUNSETIFF, &ifr ) < 0 )
+    return -1;
+
+  ifr.ifr_mtu = TUN_MTU;
+  if( ioctl( side->udp_fd, SIOCSIFMTU, &ifr ) < 0 || ioctl( side->udp_fd, SIOCGIFFLAGS, &ifr ) < 0 )
+    return -1;
+
+  ifr.ifr_flags |= IFF_UP;
+  if( ioctl( side->udp_fd, SIOCSIFFLAGS, &ifr ) < 0 )
+    return -1;
+
+  side->ifindex = if_nametoindex( ifr.ifr_name );
+
+  /* a short interface identifier, so addresses get compressed to 16 bits */
+  inet_pton( AF_INET6, "fe80::ff:fe00:0", &side->addr );
+  side->addr.s6_addr[15] = index + 1;
+
+  memset( &ifr6, 0, sizeof(ifr6) );
+  ifr6.addr = side->addr;
+  ifr6.prefixlen = 64;
+  ifr6.ifindex = side->ifindex;
+
+  if( ioctl( side->udp_fd, SIOCSIFADDR, &ifr6 ) < 0 )
+    return -1;
+
+  memset( &sa, 0, sizeof(sa) );
+  sa.sin6_family = AF_INET6;
+  sa.sin6_addr = side->addr;
+  sa.sin6_port = htons( TUN_PORT + index );
+  sa.sin6_scope_id = side->ifindex;
+
+  /* an address may be tentative for a while */
+  for( i = 0; bind( side->udp_fd, (struct sockaddr*)&sa, sizeof(sa) ) < 0; i++ )
+  {
+    if( errno != EADDRNOTAVAIL || i == 100 )
+      return -1;
+
+    usleep( 10000 );
+  }
+
+  return 0;
+}
+
+/* move datagrams the kernel has put to interfaces over the link, till nothing comes for @wait_ms;
+ * @pkgs - packages the largest UDP datagram has taken */
+static void _tun_pump( tun_side_t sides[2], int wait_ms, u_int* pkgs )
+{
+  u_char datagram[N_RF24L01_LOWPAN_MAX_DATAGRAM];
+  struct pollfd fds[2];
+  u_int before, i;
+  int ret;
+
+  fds[0].fd = sides[0].tun_fd;
+  fds[1].fd = sides[1].tun_fd;
+  fds[0].events = fds[1].events = POLLIN;
+
+  while( poll( fds, 2, wait_ms ) > 0 )
+    for( i = 0; i < 2; i++ )
+    {
+      if( !( fds[i].revents & POLLIN ) )
+        continue;
+
+      while( ( ret = read( sides[i].tun_fd, datagram, sizeof(datagram) ) ) > 0 )
+      {
+        before = sides[i].lowpan.stats.pkgs_sent;
+        n_rf24l01_lowpan_send( &sides[i].lowpan, datagram, ret );
+        _sim_step( &tun_link, 0 );
+
+        /* the kernel sends its own datagrams (MLD, router solicitations) too, ours are UDP */
+        if( ret > 40 && datagram[0] >> 4 == 6 && datagram[6] == IPPROTO_UDP &&
+            sides[i].lowpan.stats.pkgs_sent - before > *pkgs )
+          *pkgs = sides[i].lowpan.stats.pkgs_sent - before;
+      }
+    }
+}
+
+/* send @count UDP datagrams of @size bytes each way with @loss_pct percents of packages lost;
+ * @max_pkgs - the most packages a datagram may take, @min_pct - the least share to get through */
+static int _run_tun( tun_side_t sides[2], const char* name, u_int size, u_int count, u_int loss_pct,
+                     u_int max_pkgs, u_int min_pct )
+{
+  u_char data[TUN_MTU], received[TUN_MTU];
+  struct sockaddr_in6 sa;
+  u_int i, j, k, sent = 0, got = 0, pkgs = 0, pct;
+  int ret, failed = 0;
+
+  tun_link.ends[0].loss_pct = tun_link.ends[1].loss_pct = loss_pct;
+
+  for( i = 0; i < count; i++ )
+    for( j = 0; j < 2; j++ )
+    {
+      for( k = 0; k < size; k++ )
+        data[k] = _rand();
+
+      /* a scope is an interface of a sender, which is in another namespace */
+      memset( &sa, 0, sizeof(sa) );
+      sa.sin6_family = AF_INET6;
+      sa.sin6_addr = sides[!j].addr;
+      sa.sin6_port = htons( TUN_PORT + !j );
+      sa.sin6_scope_id = sides[j].ifindex;
+
+      if( sendto( sides[j].udp_fd, data, size, 0, (struct sockaddr*)&sa, sizeof(sa) ) != size )
+      {
+        perror( "fail to send a datagram" );
+        return 1;
+      }
+
+      sent++;
+
+      _tun_pump( sides, 5, &pkgs );
+
+      ret = recv( sides[!j].udp_fd, received, sizeof(received), 0 );
+      if( ret < 0 )
+        continue;
+
+      if( ret == size && !memcmp( data, received, size ) )
+        got++;
+      else
+        failed = 1;
+    }
+
+  pct = got * 100 / sent;
+  if( pct < min_pct || pkgs > max_pkgs )
+    failed = 1;
+
+  printf( "%-22s got %3u of %3u (%3u%%, >= %3u%%), packages per datagram %2u (<= %2u): %s\n", name, got, sent,
+          pct, min_pct, pkgs, max_pkgs, failed ? "FAILED" : "ok" );
+
+  return failed;
+}
+
+/* datagrams go through the kernel's network stack in both namespaces, so the adaptation layer
+ * has to get them compressed and back bit-exact; small ones have to fit in one package */
+static int _scenario_tun( void )
+{
+  static tun_side_t sides[2];
+  int orig_fd, failed = 0, ret = 0;
+  u_int i;
+
+  orig_fd = open( "/proc/self/ns/net", O_RDONLY | O_CLOEXEC );
+  if( orig_fd < 0 )
+    return TUN_SKIPPED;
+
+  _sim_link( &tun_link, &tun_hooks, &sides[0], &sides[1], 0, 0 );
+
+  for( i = 0; i < 2 && !ret; i++ )
+  {
+    sides[i].end = &tun_link.ends[i];
+    n_rf24l01_lowpan_init( &sides[i].lowpan, _tun_send, _tun_deliver, &sides[i] );
+    ret = _tun_open_side( &sides[i], i );
+  }
+
+  if( setns( orig_fd, CLONE_NEWNET ) < 0 )
+    ret = -1;
+
+  if( ret < 0 )
+  {
+    if( errno != EPERM && errno != EACCES && errno != ENOENT )
+    {
+      perror( "fail to set up an interface" );
+      return 1;
+    }
+
+    printf( "skipped, network namespaces and TUN interfaces aren't available: %s\n", strerror( errno ) );
+    return TUN_SKIPPED;
+  }
+
+  /* let the kernel send what it sends on a new interface */
+  _tun_pump( sides, TUN_WAIT_MS, &i );
+
+  failed |= _run_tun( sides, "8 bytes", 8, 50, 0, 1, 100 );
+  failed |= _run_tun( sides, "100 bytes", 100, 50, 0, 5, 100 );
+  failed |= _run_tun( sides, "1200 bytes", 1200, 20, 0, 46, 100 );
+  failed |= _run_tun( sides, "1200 bytes, 1% loss", 1200, 50, 1, 46, 40 );
+  failed |= _run_tun( sides, "8 bytes after losses", 8, 50, 0, 1, 100 );
+
+  return failed;
+}
+
+/* ----------------------------------------------- tdma ---------------------------------------------- */
+
+#define TDMA_SIDES 7
+#define TDMA_SLOTS 7
+#define TDMA_SLOT_US 2000
+#define TDMA_STATIC_SLOT 5
+#define TDMA_QUEUE_SIZE 256
+#define TDMA_INTERVAL_US 20000
+#define TDMA_SECONDS 8
+
+typedef struct
+{
+  u_char pkg[N_RF24L01_PKG_SIZE];
+  uint64_t start_us;
+  u_int sender;
+  int collided;
+} tdma_pkg_t;
+
+/* the gateway or a node, nodes put <node id: 2 bytes> <counter: 4 bytes> to each chunk */
+typedef struct
+{
+  n_rf24l01_tdma_t tdma;
+  u_int index;
+  uint16_t node_id;
+  u_char slot;               /* a static slot */
+  uint64_t on_us, off_us;    /* a node is switched on/off at */
+  int idle;                  /* sends nothing */
+  uint64_t now_us, air_free_us;
+
+  uint32_t counter;
+  u_int sent;
+
+  /* the gateway: what it has got of each node */
+  uint32_t last[TDMA_SIDES];
+  u_int delivered[TDMA_SIDES];
+  u_int misattributed;
+  u_int disordered;
+} tdma_side_t;
+
+/* one channel everyone hears, packages which overlap on air are lost */
+static tdma_pkg_t tdma_air[TDMA_QUEUE_SIZE];
+static u_int tdma_air_head, tdma_air_tail;
+static tdma_side_t tdma_sides[TDMA_SIDES];
+
+static void _tdma_send( void* ctx, const u_char* pkg )
+{
+  tdma_side_t* side = ctx;
+  tdma_pkg_t* entry;
+  uint64_t start = side->air_free_us > side->now_us ? side->air_free_us : side->now_us;
+  u_int i;
+
+  side->air_free_us = start + N_RF24L01_TDMA_PKG_MKS;
+
+  if( tdma_air_tail - tdma_air_head == TDMA_QUEUE_SIZE )
+    return;
+
+  entry = &tdma_air[tdma_air_tail++ % TDMA_QUEUE_SIZE];
+  memcpy( entry->pkg, pkg, N_RF24L01_PKG_SIZE );
+  entry->start_us = start;
+  entry->sender = side->index;
+  entry->collided = 0;
+
+  for( i = tdma_air_head; i != tdma_air_tail - 1; i++ )
+    if( tdma_air[i % TDMA_QUEUE_SIZE].sender != side->index &&
+        tdma_air[i % TDMA_QUEUE_SIZE].start_us + N_RF24L01_TDMA_PKG_MKS > start )
+      tdma_air[i % TDMA_QUEUE_SIZE].collided = entry->collided = 1;
+}
+
+/* the gateway checks a sender it's told of against one a chunk carries */
+static void _tdma_deliver( void* ctx, u_int slot, uint16_t node_id, const u_char* data, u_int num )
+{
+  tdma_side_t* side = ctx;
+  tdma_side_t* node = NULL;
+  uint32_t counter;
+  uint16_t id;
+  u_int i;
+
+  memcpy( &id, data, sizeof(id) );
+  memcpy( &counter, data + 2, sizeof(counter) );
+
+  for( i = 1; i < TDMA_SIDES; i++ )
+    if( tdma_sides[i].node_id == id )
+      node = &tdma_sides[i];
+
+  if( !node || num != N_RF24L01_TDMA_PAYLOAD_SIZE )
+  {
+    side->misattributed++;
+    return;
+  }
+
+  if( node->slot ? slot != node->slot || node_id : node_id != id )
+    side->misattributed++;
+
+  if( counter <= side->last[node->index] )
+    side->disordered++;
+
+  side->last[node->index] = counter;
+  side->delivered[node->index]++;
+}
+
+/* the gateway, nodes 101..104 which ask for slots (103 is idle, 104 is switched off at 2s),
+ * a static node and a node 105 which comes at 2.2s, when there's no free slot till 104's
+ * one is freed (the static one mustn't be given away); nodes send a chunk each TDMA_INTERVAL_US */
+static int _scenario_tdma( void )
+{
+  u_char chunk[N_RF24L01_TDMA_PAYLOAD_SIZE];
+  tdma_side_t* gateway = &tdma_sides[0];
+  tdma_side_t* side;
+  tdma_pkg_t* entry;
+  u_int i, j, pct, old_slot = 0, idle_slot = 0;
+  uint64_t now;
+  int failed = 0, ok;
+
+  memset( tdma_sides, 0, sizeof(tdma_sides) );
+  memset( chunk, 0, sizeof(chunk) );
+
+  for( i = 0; i < TDMA_SIDES; i++ )
+  {
+    side = &tdma_sides[i];
+    side->index = i;
+    side->off_us = UINT64_MAX;
+
+    if( i )
+    {
+      side->node_id = 100 + i;
+      side->on_us = i * 100000;
+    }
+  }
+
+  tdma_sides[3].idle = 1;
+  tdma_sides[4].off_us = 2000000;
+  tdma_sides[5].node_id = 200;
+  tdma_sides[5].slot = TDMA_STATIC_SLOT;
+  tdma_sides[6].node_id = 105;
+  tdma_sides[6].on_us = 2200000;
+
+  for( now = 0; now < TDMA_SECONDS * 1000000ull; now += SIM_STEP_US )
+  {
+    /* a package is heard once it's over, as a later one may still collide with it */
+    while( tdma_air_head != tdma_air_tail &&
+           tdma_air[tdma_air_head % TDMA_QUEUE_SIZE].start_us + N_RF24L01_TDMA_PKG_MKS <= now )
+    {
+      entry = &tdma_air[tdma_air_head++ % TDMA_QUEUE_SIZE];
+
+      for( i = 0; i < TDMA_SIDES && !entry->collided; i++ )
+      {
+        side = &tdma_sides[i];
+
+        if( i != entry->sender && now >= side->on_us && now < side->off_us )
+          n_rf24l01_tdma_on_pkg( &side->tdma, entry->pkg, entry->start_us + N_RF24L01_TDMA_BEACON_DELAY_MKS );
+      }
+    }
+
+    for( i = 0; i < TDMA_SIDES; i++ )
+    {
+      side = &tdma_sides[i];
+      side->now_us = now;
+
+      if( now < side->on_us || now >= side->off_us )
+        continue;
+
+      if( now == side->on_us )
+        n_rf24l01_tdma_init( &side->tdma, i ? N_RF24L01_TDMA_NODE : N_RF24L01_TDMA_GATEWAY, side->node_id,
+                             side->slot, TDMA_SLOTS, TDMA_SLOT_US, _tdma_send, _tdma_deliver, side, now );
+
+      /* the last chunks have time to get through */
+      if( i && !side->idle && !( ( now - side->on_us ) % TDMA_INTERVAL_US ) && now < ( TDMA_SECONDS - 1 ) * 1000000ull )
+      {
+        side->counter++;
+        memcpy( chunk, &side->node_id, sizeof(side->node_id) );
+        memcpy( chunk + 2, &side->counter, sizeof(side->counter) );
+
+        if( n_rf24l01_tdma_send( &side->tdma, chunk, sizeof(chunk) ) == sizeof(chunk) )
+          side->sent++;
+      }
+
+      /* a transmitter is busy till its packages are out */
+      if( now >= side->air_free_us )
+        n_rf24l01_tdma_poll( &side->tdma, now );
+    }
+
+    if( now == 2000000 - SIM_STEP_US )
+    {
+      old_slot = tdma_sides[4].tdma.assigned ? tdma_sides[4].tdma.slot : 0;
+      idle_slot = tdma_sides[3].tdma.assigned ? tdma_sides[3].tdma.slot : 0;
+    }
+  }
+
+  for( i = 1; i < TDMA_SIDES; i++ )
+  {
+    side = &tdma_sides[i];
+    pct = side->sent ? gateway->delivered[i] * 100 / side->sent : 100;
+
+    /* a switched off node loses what it hasn't sent */
+    ok = i == 4 || pct >= 95;
+    failed |= !ok;
+
+    printf( "node %3u (%-7s slot %u) sent %4u, the gateway got %4u (%3u%%): %s\n", side->node_id,
+            side->slot ? "static" : side->idle ? "idle," : side->off_us != UINT64_MAX ? "gone," : "asked,",
+            side->tdma.assigned ? side->tdma.slot : 0, side->sent, gateway->delivered[i], pct,
+            ok ? "ok" : "FAILED" );
+  }
+
+  ok = !gateway->misattributed && !gateway->disordered;
+  failed |= !ok;
+  printf( "chunks of another node %u, out of order %u: %s\n", gateway->misattributed, gateway->disordered,
+          ok ? "ok" : "FAILED" );
+
+  for( j = 1; j < TDMA_SLOTS - 1 && gateway->tdma.owners[j] != 104; j++ )
+    ;
+
+  ok = gateway->tdma.stats.leaves == 1 && j == TDMA_SLOTS - 1 && old_slot &&
+       tdma_sides[6].tdma.assigned && tdma_sides[6].tdma.slot == old_slot;
+  failed |= !ok;
+  printf( "a gone node's slot %u is freed (leaves %u) and given to a late node (slot %u): %s\n", old_slot,
+          gateway->tdma.stats.leaves, tdma_sides[6].tdma.assigned ? tdma_sides[6].tdma.slot : 0,
+          ok ? "ok" : "FAILED" );
+
+  ok = idle_slot && tdma_sides[3].tdma.assigned && tdma_sides[3].tdma.slot == idle_slot &&
+       gateway->tdma.owners[idle_slot] == tdma_sides[3].node_id;
+  failed |= !ok;
+  printf( "an idle node keeps its slot %u: %s\n", idle_slot, ok ? "ok" : "FAILED" );
+
+  return failed;
+}
+
+/* ----------------------------------------------- adapt --------------------------------------------- */
+
+#define ADAPT_LATENCY_US 200
+#define ADAPT_INTERVAL_US 1000
+#define ADAPT_TARGET_LOSS 10
+#define ADAPT_BASE_LEVEL 0
+
+#define ADAPT_DATA 0x01
+#define ADAPT_ACK  0x02
+
+/* sides[0] transmits data and counts retransmissions, sides[1] acknowledges it */
+typedef struct
+{
+  n_rf24l01_adapt_t adapt;
+  sim_end_t* end;
+  int on;                    /* neither hears nor transmits if it's off */
+  u_char level;              /* the transceiver's one */
+
+  int has_data;
+  int pending;               /* a data package waits for an acknowledge */
+  uint64_t next_tx_us;
+  u_int sent, retransmitted;
+} adapt_side_t;
+
+/* a loss of each level, in percent, a scenario changes it on the way */
+static u_int adapt_loss[N_RF24L01_ADAPT_LEVELS];
+
+/* a package carries the sender's level at the time it's sent */
+static void _adapt_send( void* ctx, const u_char* pkg )
+{
+  adapt_side_t* side = ctx;
+
+  if( side->on )
+    _sim_transmit( side->end, pkg, side->level );
+}
+
+/* levels go by a link budget: rates first, then powers from the highest one */
+static void _adapt_apply( void* ctx, u_char data_rate, u_char tx_power )
+{
+  adapt_side_t* side = ctx;
+
+  if( data_rate == N_RF24L01_DATA_RATE_250KBPS )
+    side->level = 0;
+  else if( data_rate == N_RF24L01_DATA_RATE_1MBPS )
+    side->level = 1;
+  else
+    side->level = 2 + N_RF24L01_TX_POWER_0DBM - tx_power;
+}
+
+/* a package is heard only by a side at the sender's level */
+static void _adapt_on_pkg( sim_end_t* end, const sim_pkg_t* entry )
+{
+  u_char pkg[N_RF24L01_PKG_SIZE] = { 0, };
+  adapt_side_t* side = end->ctx;
+
+  if( !side->on || entry->tag != side->level || _chance( adapt_loss[entry->tag] ) )
+    return;
+
+  if( n_rf24l01_adapt_on_pkg( &side->adapt, entry->pkg, end->now_us ) == 0 )
+    return;
+
+  if( entry->pkg[0] == ADAPT_DATA )
+  {
+    pkg[0] = ADAPT_ACK;
+    _adapt_send( side, pkg );
+  }
+  else
+    side->pending = 0;
+}
+
+static void _adapt_poll( sim_end_t* end )
+{
+  u_char pkg[N_RF24L01_PKG_SIZE] = { 0, };
+  adapt_side_t* side = end->ctx;
+
+  if( !side->on )
+    return;
+
+  /* a reliable layer which has nothing to transmit doesn't retransmit either */
+  if( !side->has_data )
+    side->pending = 0;
+
+  if( side->has_data && end->now_us >= side->next_tx_us )
+  {
+    side->next_tx_us = end->now_us + ADAPT_INTERVAL_US;
+
+    if( side->pending )
+      side->retransmitted++;
+    else
+      side->sent++;
+    side->pending = 1;
+
+    pkg[0] = ADAPT_DATA;
+    _adapt_send( side, pkg );
+  }
+
+  n_rf24l01_adapt_poll( &side->adapt, end->now_us, side->sent, side->retransmitted );
+}
+
+static const sim_hooks_t adapt_hooks = { _adapt_on_pkg, _adapt_poll };
+
+static sim_link_t adapt_link;
+
+static void _adapt_init_side( adapt_side_t* side, uint64_t now_us )
+{
+  n_rf24l01_adapt_init( &side->adapt, ADAPT_BASE_LEVEL, ADAPT_TARGET_LOSS, _adapt_send, _adapt_apply, side, now_us );
+  side->pending = 0;
+}
+
+/* run both sides from @from_s to @to_s, time of the last @measure_s seconds both sides spend
+ * at @level is checked, in percent */
+static int _run_adapt( adapt_side_t sides[2], const char* name, u_int from_s, u_int to_s, u_int measure_s,
+                       u_int level )
+{
+  uint64_t now, at_level = 0, measured = 0;
+  u_int pct;
+  int ok;
+
+  for( now = from_s * 1000000ull; now < to_s * 1000000ull; now += SIM_STEP_US )
+  {
+    _sim_step( &adapt_link, now );
+
+    if( now >= ( to_s - measure_s ) * 1000000ull )
+    {
+      measured++;
+      at_level += sides[0].level == level && sides[1].level == level;
+    }
+  }
+
+  pct = at_level * 100 / measured;
+  ok = pct >= 80;
+
+  printf( "%-36s both sides at level %u %3u%% of the time (hunts %u): %s\n", name, level, pct,
+          sides[0].adapt.stats.hunts, ok ? "ok" : "FAILED" );
+
+  return !ok;
+}
+
+/* sides[0] transmits all the way but for a pause after the last restart of sides[1] */
+static int _scenario_adapt( void )
+{
+  static const u_int clear[N_RF24L01_ADAPT_LEVELS] = { 0, 0, 0, 1, 25, 50 };
+  static const u_int noisy[N_RF24L01_ADAPT_LEVELS] = { 0, 0, 0, 25, 50, 70 };
+  static adapt_side_t sides[2];
+  u_int hunts, requests_failed;
+  uint64_t now;
+  int failed = 0, ok;
+
+  memset( sides, 0, sizeof(sides) );
+  _sim_link( &adapt_link, &adapt_hooks, &sides[0], &sides[1], ADAPT_LATENCY_US, 0 );
+  sides[0].end = &adapt_link.ends[0];
+  sides[1].end = &adapt_link.ends[1];
+  sides[0].on = sides[1].on = 1;
+  sides[0].has_data = 1;
+
+  memcpy( adapt_loss, clear, sizeof(adapt_loss) );
+  _adapt_init_side( &sides[0], 0 );
+  _adapt_init_side( &sides[1], 1 );
+
+  failed |= _run_adapt( sides, "a clear link", 0, 10, 5, 3 );
+
+  memcpy( adapt_loss, noisy, sizeof(adapt_loss) );
+  failed |= _run_adapt( sides, "level 3 gets noisy", 10, 20, 5, 2 );
+
+  /* sides[1] comes up at the base level, sides[0] has to find it */
+  hunts = sides[0].adapt.stats.hunts;
+  _adapt_init_side( &sides[1], 20000000 );
+  failed |= _run_adapt( sides, "the peer restarts", 20, 30, 5, 2 );
+
+  ok = sides[0].adapt.stats.hunts > hunts;
+  failed |= !ok;
+  printf( "the restarted peer is hunted for: %s\n", ok ? "ok" : "FAILED" );
+
+  /* sides[1] is gone, sides[0] hunts till it has nothing to transmit, then asks for the base level */
+  sides[1].on = 0;
+  requests_failed = sides[0].adapt.stats.requests_failed;
+
+  for( now = 30000000; now < 31000000; now += SIM_STEP_US )
+  {
+    sides[0].has_data = now < 30500000;
+    _sim_step( &adapt_link, now );
+  }
+
+  ok = sides[0].adapt.state != N_RF24L01_ADAPT_HUNTING && sides[0].level == ADAPT_BASE_LEVEL &&
+       sides[0].adapt.stats.requests_failed > requests_failed;
+  failed |= !ok;
+  printf( "a hunt without data ends at the base level, the peer is asked for it: %s\n", ok ? "ok" : "FAILED" );
+
+  /* a peer which comes back is met at the base level */
+  sides[1].on = 1;
+  _adapt_init_side( &sides[1], 31000000 );
+  sides[0].has_data = 1;
+  failed |= _run_adapt( sides, "the peer comes back", 31, 40, 5, 2 );
+
+  return failed;
+}
+
+/* ----------------------------------------------- mesh ---------------------------------------------- */
+
+#define MESH_NODES 3
+#define MESH_CHUNKS 20
+#define MESH_RESTART_CHUNKS 20
+#define MESH_BROADCASTS 10
+
+/* node i has an address i + 1 and is an end of links to its neighbours,
+ * chunks are <source's address> <counter> */
+typedef struct
+{
+  n_rf24l01_mesh_t mesh;
+  u_int index;
+  sim_end_t* ends[2];
+  u_int ends_num;
+
+  u_int delivered[MESH_NODES];
+  u_int misattributed;
+} mesh_side_t;
+
+/* links[i] is between nodes i and i + 1 */
+static sim_link_t mesh_links[MESH_NODES - 1];
+static mesh_side_t mesh_sides[MESH_NODES];
+
+/* a package is heard by all neighbours at once */
+static void _mesh_send( void* ctx, const u_char* pkg )
+{
+  mesh_side_t* side = ctx;
+  u_int i;
+
+  for( i = 0; i < side->ends_num; i++ )
+    _sim_transmit( side->ends[i], pkg, 0 );
+}
+
+static void _mesh_deliver( void* ctx, u_char src, const u_char* data, u_int num )
+{
+  mesh_side_t* side = ctx;
+
+  if( num != 2 || !src || src > MESH_NODES || data[0] != src )
+  {
+    side->misattributed++;
+    return;
+  }
+
+  side->delivered[src - 1]++;
+}
+
+static void _mesh_on_pkg( sim_end_t* end, const sim_pkg_t* pkg )
+{
+  mesh_side_t* side = end->ctx;
+
+  n_rf24l01_mesh_on_pkg( &side->mesh, pkg->pkg );
+}
+
+static const sim_hooks_t mesh_hooks = { _mesh_on_pkg, NULL };
+
+/* (re)start a node, the chain's ends are routed to each other over the middle */
+static void _mesh_init_side( mesh_side_t* side, uint64_t now_us )
+{
+  n_rf24l01_mesh_init( &side->mesh, side->index + 1, _mesh_send, _mesh_deliver, side, now_us );
+
+  if( side->index == 0 )
+    n_rf24l01_mesh_set_route( &side->mesh, MESH_NODES, 2 );
+  else if( side->index == MESH_NODES - 1 )
+    n_rf24l01_mesh_set_route( &side->mesh, 1, MESH_NODES - 1 );
+}
+
+/* a node sends @count chunks to @dst one by one, each is carried as far as it goes */
+static void _mesh_send_chunks( mesh_side_t* side, u_char dst, u_int count )
+{
+  u_char chunk[2];
+  u_int i, j, busy;
+
+  for( i = 0; i < count; i++ )
+  {
+    chunk[0] = side->index + 1;
+    chunk[1] = i;
+    n_rf24l01_mesh_send( &side->mesh, dst, chunk, sizeof(chunk) );
+
+    do
+    {
+      busy = 0;
+
+      for( j = 0; j < MESH_NODES - 1; j++ )
+      {
+        busy |= !_sim_idle( &mesh_links[j] );
+        _sim_step( &mesh_links[j], 0 );
+      }
+    } while( busy );
+  }
+}
+
+/* nodes 1 - 2 - 3, 1 sends to 3, restarts amid it and goes on counting anew, then 3 broadcasts */
+static int _scenario_mesh( void )
+{
+  mesh_side_t* first = &mesh_sides[0];
+  mesh_side_t* middle = &mesh_sides[1];
+  mesh_side_t* last = &mesh_sides[MESH_NODES - 1];
+  u_int i;
+  int failed = 0, ok;
+
+  memset( mesh_sides, 0, sizeof(mesh_sides) );
+
+  for( i = 0; i < MESH_NODES - 1; i++ )
+  {
+    _sim_link( &mesh_links[i], &mesh_hooks, &mesh_sides[i], &mesh_sides[i + 1], 0, 0 );
+    mesh_sides[i].ends[mesh_sides[i].ends_num++] = &mesh_links[i].ends[0];
+    mesh_sides[i + 1].ends[mesh_sides[i + 1].ends_num++] = &mesh_links[i].ends[1];
+  }
+
+  for( i = 0; i < MESH_NODES; i++ )
+  {
+    mesh_sides[i].index = i;
+    _mesh_init_side( &mesh_sides[i], i );
+  }
+
+  _mesh_send_chunks( first, MESH_NODES, MESH_CHUNKS );
+
+  ok = last->delivered[0] == MESH_CHUNKS && !middle->delivered[0] && !last->misattributed &&
+       last->mesh.stats.delivered_relays[1] == MESH_CHUNKS;
+  failed |= !ok;
+  printf( "node 3 got %u of %u chunks of node 1 over a relay, of another node %u: %s\n", last->delivered[0],
+          MESH_CHUNKS, last->misattributed, ok ? "ok" : "FAILED" );
+
+  _mesh_init_side( first, 1000000 );
+  _mesh_send_chunks( first, MESH_NODES, MESH_RESTART_CHUNKS );
+
+  ok = last->delivered[0] == MESH_CHUNKS + MESH_RESTART_CHUNKS && !last->misattributed;
+  failed |= !ok;
+  printf( "node 3 got %u of %u chunks of restarted node 1: %s\n", last->delivered[0] - MESH_CHUNKS,
+          MESH_RESTART_CHUNKS, ok ? "ok" : "FAILED" );
+
+  _mesh_send_chunks( last, N_RF24L01_MESH_BROADCAST, MESH_BROADCASTS );
+
+  ok = first->delivered[MESH_NODES - 1] == MESH_BROADCASTS && middle->delivered[MESH_NODES - 1] == MESH_BROADCASTS &&
+       !first->misattributed && !middle->misattributed;
+  failed |= !ok;
+  printf( "a broadcast of node 3 got to node 2 %u and to node 1 %u times of %u (duplicates %u): %s\n",
+          middle->delivered[MESH_NODES - 1], first->delivered[MESH_NODES - 1], MESH_BROADCASTS,
+          middle->mesh.stats.pkgs_duplicated + last->mesh.stats.pkgs_duplicated, ok ? "ok" : "FAILED" );
+
+  return failed;
+}
+
+/* ------------------------------------------------ pm ----------------------------------------------- */
+
+#define PM_RX_HOLD_US 2000
+#define PM_PERIOD_US 20000
+#define PM_WINDOW_US 1000
+
+/* standby-I lasts past the next window, or ends well before it */
+#define PM_LONG_STANDBY_US 19000
+#define PM_SHORT_STANDBY_US 5000
+
+/* a peer keeps a carrier: a package each PM_CARRIER_INTERVAL_US from PM_CARRIER_FROM_US
+ * to PM_CARRIER_TO_US, the node is in standby-I by then, so it hears none till a listen window */
+#define PM_CARRIER_FROM_US 25000
+#define PM_CARRIER_TO_US 45000
+#define PM_CARRIER_INTERVAL_US 500
+
+#define PM_TRACE_SIZE 16
+
+typedef struct
+{
+  uint64_t at_us;
+  n_rf24l01_pm_state_t state;
+} pm_change_t;
+
+/* a transceiver of the node: what the core has put it to and by when it's a receiver,
+ * time goes by a step and by sleeps the core makes */
+typedef struct
+{
+  side_t side;
+  n_rf24l01_pm_t pm;
+
+  uint64_t clock_us;
+  u_char config, ce;
+  uint64_t powered_us;       /* the crystal oscillator runs from then on */
+  uint64_t rx_ready_us;      /* a receiver from then on, if CE is up */
+
+  u_int rpd_reads, rpd_bad;  /* RPD is read by a receiver which has settled, or it's bad */
+
+  pm_change_t trace[PM_TRACE_SIZE];
+  u_int traced;
+  u_int mismatched;          /* steps the transceiver isn't in a state the pm has put it to */
+  u_int sent, heard;
+  uint64_t first_rx_us;
+} pm_node_t;
+
+static pm_node_t pm_node;
+
+static void _pm_set_up_ce_pin( u_char value )
+{
+  uint64_t from_us = pm_node.clock_us > pm_node.powered_us ? pm_node.clock_us : pm_node.powered_us;
+
+  if( value && !pm_node.ce )
+    pm_node.rx_ready_us = from_us + RX_SETTLE_MKS;
+
+  pm_node.ce = value;
+}
+
+static int _pm_is_receiver( void )
+{
+  return pm_node.ce && ( pm_node.config & ( PWR_UP | PRIM_RX ) ) == ( PWR_UP | PRIM_RX ) &&
+         pm_node.clock_us >= pm_node.rx_ready_us;
+}
+
+/* CONFIG is kept, RPD reads are checked, the channel is clear */
+static void _pm_send_cmd( u_char cmd, u_char* status_reg, u_char* data, u_char num, u_char direction )
+{
+  if( status_reg )
+    *status_reg = 0;
+
+  if( cmd == ( W_REGISTER | CONFIG_RG ) && direction )
+  {
+    if( data[0] & PWR_UP && !(pm_node.config & PWR_UP) )
+      pm_node.powered_us = pm_node.clock_us + POWER_UP_MKS;
+    pm_node.config = data[0];
+  }
+
+  if( cmd == ( R_REGISTER | RPD_RG ) )
+  {
+    pm_node.rpd_reads++;
+    pm_node.rpd_bad += !_pm_is_receiver() ||
+                       pm_node.clock_us < pm_node.rx_ready_us + RPD_SETTLE_MKS - RX_SETTLE_MKS;
+  }
+
+  if( !direction && data )
+    memset( data, 0, num );
+}
+
+static void _pm_usleep( u_int delay_mks )
+{
+  pm_node.clock_us += delay_mks;
+}
+
+static void _pm_apply( void* ctx, n_rf24l01_pm_state_t state )
+{
+  pm_node_t* node = ctx;
+
+  if( node->traced < PM_TRACE_SIZE )
+  {
+    node->trace[node->traced].at_us = node->clock_us;
+    node->trace[node->traced++].state = state;
+  }
+
+  if( state == N_RF24L01_PM_RX )
+    n_rf24l01_prepare_to_receive();
+  else if( state == N_RF24L01_PM_STANDBY )
+    n_rf24l01_standby();
+  else
+    n_rf24l01_power_down();
+}
+
+/* 1 if the transceiver is in a @state the pm has put it to, a receiver may be settling yet */
+static int _pm_in_state( n_rf24l01_pm_state_t state )
+{
+  if( state == N_RF24L01_PM_RX )
+    return pm_node.ce && ( pm_node.config & ( PWR_UP | PRIM_RX ) ) == ( PWR_UP | PRIM_RX );
+
+  if( state == N_RF24L01_PM_STANDBY )
+    return !pm_node.ce && pm_node.config & PWR_UP;
+
+  return !pm_node.ce && !(pm_node.config & PWR_UP);
+}
+
+/* a node is up at time 0, a receiver for PM_RX_HOLD_US, then in standby-I for @standby_us */
+static void _pm_init_node( u_int standby_us )
+{
+  n_rf24l01_backend_t backend;
+
+  memset( &pm_node, 0, sizeof(pm_node) );
+  memset( &backend, 0, sizeof(backend) );
+  backend.set_up_ce_pin = _pm_set_up_ce_pin;
+  backend.send_cmd = _pm_send_cmd;
+  backend.usleep = _pm_usleep;
+  backend.handle_received_data = _handle_received_data;
+
+  n_rf24l01_select( &pm_node.side.instance );
+  n_rf24l01_init( &backend );
+
+  pm_node.clock_us = 0;
+  n_rf24l01_pm_init( &pm_node.pm, PM_RX_HOLD_US, standby_us, PM_PERIOD_US, PM_WINDOW_US, _pm_apply, &pm_node, 0 );
+}
+
+/* step the node till @end_us, a peer keeps a carrier if @carrier */
+static void _pm_run( uint64_t end_us, int carrier )
+{
+  uint64_t now;
+
+  for( now = 0; now < end_us; now += SIM_STEP_US )
+  {
+    pm_node.clock_us = now;
+    n_rf24l01_pm_poll( &pm_node.pm, now );
+
+    pm_node.mismatched += !_pm_in_state( pm_node.pm.state );
+
+    if( !carrier || now < PM_CARRIER_FROM_US || now > PM_CARRIER_TO_US || now % PM_CARRIER_INTERVAL_US )
+      continue;
+
+    /* the core sleeps as it switches the transceiver, a package comes at a step's time */
+    pm_node.clock_us = now;
+    pm_node.sent++;
+
+    if( _pm_is_receiver() )
+    {
+      if( !pm_node.heard++ )
+        pm_node.first_rx_us = now;
+      n_rf24l01_pm_on_rx( &pm_node.pm, now );
+    }
+  }
+}
+
+/* 1 if the node has gone through @expected states at their times, the transceiver along with it */
+static int _pm_trace_ok( const char* name, const pm_change_t* expected, u_int expected_num )
+{
+  u_int i;
+  int ok;
+
+  ok = pm_node.traced == expected_num && !pm_node.mismatched;
+  for( i = 0; ok && i < expected_num; i++ )
+    ok = pm_node.trace[i].at_us == expected[i].at_us && pm_node.trace[i].state == expected[i].state;
+
+  printf( "%-36s %u state changes, the transceiver off its state %u times: %s\n", name, pm_node.traced,
+          pm_node.mismatched, ok ? "ok" : "FAILED" );
+
+  return ok;
+}
+
+/* make a transmitter with LBT out of a node in a @state, RPD must be read by a settled receiver */
+static int _pm_lbt( n_rf24l01_pm_state_t state )
+{
+  u_int reads = pm_node.rpd_reads;
+  int ok;
+
+  _pm_apply( &pm_node, state );
+  pm_node.clock_us += 10000;
+  pm_node.rpd_bad = 0;
+
+  n_rf24l01_prepare_to_transmit();
+
+  ok = pm_node.rpd_reads > reads && !pm_node.rpd_bad && !pm_node.ce &&
+       ( pm_node.config & ( PWR_UP | PRIM_RX ) ) == PWR_UP && pm_node.clock_us >= pm_node.powered_us;
+
+  printf( "LBT from %-12s RPD read %u times by a settled receiver, then a transmitter: %s\n",
+          state == N_RF24L01_PM_DOWN ? "a power down," : "standby-I,", pm_node.rpd_reads - reads,
+          ok ? "ok" : "FAILED" );
+
+  return !ok;
+}
+
+/* the node listens in windows: a carrier which comes while it's in standby-I is heard in the next
+ * window, the node stays a receiver while it lasts, then goes back to standby-I; with a short
+ * standby-I the node powers down between windows and wakes for them earlier */
+static int _scenario_pm( void )
+{
+  static const pm_change_t carrier[] =
+  {
+    { 0, N_RF24L01_PM_RX },
+    { PM_RX_HOLD_US, N_RF24L01_PM_STANDBY },
+    { PM_PERIOD_US - RX_SETTLE_MKS, N_RF24L01_PM_RX },
+    { PM_PERIOD_US + PM_WINDOW_US, N_RF24L01_PM_STANDBY },
+    /* the carrier is heard in the second window and holds a receiver past it */
+    { 2 * PM_PERIOD_US - RX_SETTLE_MKS, N_RF24L01_PM_RX },
+    { PM_CARRIER_TO_US + PM_RX_HOLD_US, N_RF24L01_PM_STANDBY },
+    { 3 * PM_PERIOD_US - RX_SETTLE_MKS, N_RF24L01_PM_RX },
+    { 3 * PM_PERIOD_US + PM_WINDOW_US, N_RF24L01_PM_STANDBY },
+  };
+  static const pm_change_t down[] =
+  {
+    { 0, N_RF24L01_PM_RX },
+    { PM_RX_HOLD_US, N_RF24L01_PM_STANDBY },
+    { PM_RX_HOLD_US + PM_SHORT_STANDBY_US, N_RF24L01_PM_DOWN },
+    { PM_PERIOD_US - POWER_UP_MKS - RX_SETTLE_MKS, N_RF24L01_PM_RX },
+    { PM_PERIOD_US + PM_WINDOW_US, N_RF24L01_PM_STANDBY },
+    { PM_PERIOD_US + PM_WINDOW_US + PM_SHORT_STANDBY_US, N_RF24L01_PM_DOWN },
+  };
+  n_rf24l01_pm_stats_t stats;
+  int failed = 0, ok;
+
+  _pm_init_node( PM_LONG_STANDBY_US );
+  _pm_run( 3 * PM_PERIOD_US + 2 * PM_WINDOW_US, 1 );
+
+  failed |= !_pm_trace_ok( "a carrier in standby-I", carrier, sizeof(carrier) / sizeof(carrier[0]) );
+
+  /* a window is entered early by a wake time, so a package at its start is heard */
+  ok = pm_node.first_rx_us == 2 * PM_PERIOD_US &&
+       pm_node.heard == ( PM_CARRIER_TO_US - 2 * PM_PERIOD_US ) / PM_CARRIER_INTERVAL_US + 1;
+  failed |= !ok;
+  printf( "the carrier is heard from %llu us on, %u of %u packages: %s\n", (unsigned long long)pm_node.first_rx_us,
+          pm_node.heard, pm_node.sent, ok ? "ok" : "FAILED" );
+
+  n_rf24l01_pm_get_stats( &pm_node.pm, 3 * PM_PERIOD_US + 2 * PM_WINDOW_US, &stats );
+  ok = stats.windows == 3 && stats.fast_wakes == 3 && !stats.wakes;
+  failed |= !ok;
+  printf( "windows %u, wakes from standby-I %u, from a power down %u: %s\n", stats.windows, stats.fast_wakes,
+          stats.wakes, ok ? "ok" : "FAILED" );
+
+  /* a transmitter which listens before talk has to become a receiver for a while first */
+  n_rf24l01_set_lbt( 3, 100 );
+  failed |= _pm_lbt( N_RF24L01_PM_STANDBY );
+  failed |= _pm_lbt( N_RF24L01_PM_DOWN );
+
+  _pm_init_node( PM_SHORT_STANDBY_US );
+  _pm_run( PM_PERIOD_US + PM_WINDOW_US + PM_SHORT_STANDBY_US + PM_WINDOW_US, 0 );
+
+  failed |= !_pm_trace_ok( "a power down between windows", down, sizeof(down) / sizeof(down[0]) );
+
+  n_rf24l01_pm_get_stats( &pm_node.pm, PM_PERIOD_US + PM_WINDOW_US + PM_SHORT_STANDBY_US + PM_WINDOW_US, &stats );
+  ok = stats.windows == 1 && stats.wakes == 1 && stats.state_mks[N_RF24L01_PM_DOWN] ==
+       PM_PERIOD_US - POWER_UP_MKS - RX_SETTLE_MKS - PM_RX_HOLD_US - PM_SHORT_STANDBY_US + PM_WINDOW_US;
+  failed |= !ok;
+  printf( "windows %u, wakes from a power down %u, time down %llu us: %s\n", stats.windows, stats.wakes,
+          (unsigned long long)stats.state_mks[N_RF24L01_PM_DOWN], ok ? "ok" : "FAILED" );
+
+  return failed;
+}
+
+static const scenario_t scenarios[] =
+{
+  { "pkgs", _scenario_pkgs },
+  { "hop", _scenario_hop },
+  { "arq", _scenario_arq },
+  { "fec", _scenario_fec },
+  { "lz", _scenario_lz },
+  { "bond", _scenario_bond },
+  { "tun", _scenario_tun },
+  { "tdma", _scenario_tdma },
+  { "adapt", _scenario_adapt },
+  { "mesh", _scenario_mesh },
+  { "pm", _scenario_pm },
+};
+
+int main( int argc, char* argv[] )
+{
+  u_int i;
+
+  if( argc != 2 )
+  {
+    fprintf( stderr, "usage: %s <scenario>, scenarios:", argv[0] );
+    for( i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++ )
+      fprintf( stderr, " %s", scenarios[i].name );
+    fprintf( stderr, "\n" );
+    return 2;
+  }
+
+  for( i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++ )
+    if( !strcmp( argv[1], scenarios[i].name ) )
+      return scenarios[i].run();
+
+  fprintf( stderr, "unknown scenario: %s\n", argv[1] );
+
+  return 2;
+}
@@ -0,0 +1,877 @@
+/*
+ * n_rf24l01_wrapper_test.c
+ *
+ * Runs the library itself (the wrapper, its thread and protocol layers) over a fake backend,
+ * so what a user gets through the fd can be checked without a transceiver: the fake keeps
+ * registers, logs payloads the core writes and loops them back as received ones (some of them
+ * may be lost on the way), its interrupt line never fires, a scenario makes an interrupt itself.
+ *
+ * usage: n_rf24l01_wrapper_test <scenario>
+ *
+ *   reopen   a session with protocol layers and settings turned on is closed, a next open
+ *            has a raw link: payloads are data as it is, data comes back as it was sent
+ *   frames   compressed frames (compressible, incompressible, of the max size, a write split into
+ *            several frames) come back the same; a frame one of whose packages is lost is dropped,
+ *            a next frame is delivered
+ *   coalesce small writes share a package: one which leaves a lone padding byte at the end
+ *            doesn't break a next frame, a frame which spans a lost package is dropped, frames
+ *            coalesced before and after it are delivered
+ *   rx_queue a user reads nothing till the queue is full: data which doesn't fit is dropped
+ *            (the newest one, then the oldest one), the rest comes in order with a gap of what's
+ *            dropped; an eventfd is signaled once each time the queue reaches a watermark
+ *   metadata a header has the layout it's documented with, it precedes each package's data
+ *            and tells of the package; there's no header with metadata off, nor after a session
+ *            which had it on is closed and another one is opened
+ *
+ * A scenario exits with 1 if a check fails.
+ */
+
+/* the wrapper is built in, a scenario needs its statics to make an interrupt,
+ * as an edge on a sysfs gpio line (POLLPRI | POLLERR) can't be faked */
+#include "src/linux_spi_dev/n_rf24l01.c"
+
+#include "core/n_rf24l01.h"
+
+#define FAKE_FIFO_SIZE 256
+#define FAKE_TX_LOG_SIZE ( 64 * 1024 )
+
+/* how long a scenario waits for the library's thread to do something, in ms */
+#define WAIT_MS 2000
+
+typedef struct
+{
+  const char* name;
+  int (*run)( void );
+} scenario_t;
+
+/* the fake transceiver, protected by core_lock as the core is */
+typedef struct
+{
+  u_char regs[0x20];
+  u_char ce;
+  int irq_fd;
+
+  u_char tx_log[FAKE_TX_LOG_SIZE];
+  u_int tx_logged;
+  u_int pkgs_sent;
+
+  /* packages on their way back, sent ones with an index in @drop are lost */
+  u_char fifo[FAKE_FIFO_SIZE][N_RF24L01_PKG_SIZE];
+  u_int fifo_head, fifo_tail;
+  const u_int* drop;
+  u_int drop_num;
+} fake_radio_t;
+
+static fake_radio_t fake = { .irq_fd = -1 };
+
+/* ---------------------------------------------- backend -------------------------------------------- */
+
+int init_n_rf24l01_backend()
+{
+  memset( &fake, 0, sizeof(fake) );
+
+  fake.irq_fd = eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+
+  return fake.irq_fd < 0 ? -1 : 0;
+}
+
+int init_n_rf24l01_backend_radio( u_int radio, const char* spi_device_file, u_int ce_line_pin,
+                                  u_int interrupt_line_pin )
+{
+  return -1;
+}
+
+int calibrate_n_rf24l01_spi_speed()
+{
+  return 0;
+}
+
+void select_n_rf24l01_backend_radio( u_int radio )
+{
+}
+
+void deinit_n_rf24l01_backend()
+{
+  if( fake.irq_fd >= 0 )
+    close( fake.irq_fd );
+
+  fake.irq_fd = -1;
+}
+
+int get_n_rf24l01_interrupt_line_fd()
+{
+  return fake.irq_fd;
+}
+
+unsigned int get_n_rf24l01_spi_speed()
+{
+  return 0;
+}
+
+int get_n_rf24l01_spi_uring_cmd()
+{
+  return 0;
+}
+
+void set_up_ce_pin( u_char value )
+{
+  fake.ce = value;
+}
+
+static void _fake_transmit( const u_char* pkg )
+{
+  u_int i;
+
+  if( fake.tx_logged + N_RF24L01_PKG_SIZE <= sizeof(fake.tx_log) )
+  {
+    memcpy( fake.tx_log + fake.tx_logged, pkg, N_RF24L01_PKG_SIZE );
+    fake.tx_logged += N_RF24L01_PKG_SIZE;
+  }
+
+  for( i = 0; i < fake.drop_num; i++ )
+    if( fake.drop[i] == fake.pkgs_sent )
+      break;
+
+  fake.pkgs_sent++;
+
+  if( i < fake.drop_num || fake.fifo_head - fake.fifo_tail == FAKE_FIFO_SIZE )
+    return;
+
+  memcpy( fake.fifo[fake.fifo_head++ % FAKE_FIFO_SIZE], pkg, N_RF24L01_PKG_SIZE );
+}
+
+void send_cmd( u_char cmd, u_char* status_reg, u_char* data, u_char num, u_char direction )
+{
+  /* a package looped back is always on pipe 0, RX_P_NO is all ones if nothing has come */
+  if( status_reg )
+    *status_reg = fake.fifo_head != fake.fifo_tail ? RX_DR : RX_P_NO;
+
+  if( cmd == NOP )
+    return;
+
+  if( cmd == W_TX_PAYLOAD )
+    _fake_transmit( data );
+  else if( cmd == R_RX_PAYLOAD )
+  {
+    if( fake.fifo_head != fake.fifo_tail )
+      memcpy( data, fake.fifo[fake.fifo_tail++ % FAKE_FIFO_SIZE], num );
+    else
+      memset( data, 0, num );
+  }
+  else if( ( cmd & 0xe0 ) == W_REGISTER && num )
+    fake.regs[cmd & 0x1f] = data[0];
+  else if( ( cmd & 0xe0 ) == R_REGISTER && num )
+    memset( data, fake.regs[cmd & 0x1f], num );
+}
+
+void send_cmds( const n_rf24l01_cmd_t* cmds, u_int num )
+{
+  u_int i;
+
+  for( i = 0; i < num; i++ )
+    send_cmd( cmds[i].cmd, cmds[i].status_reg, cmds[i].data, cmds[i].num, cmds[i].direction );
+}
+
+void usleep_( u_int delay_mks )
+{
+}
+
+/* ---------------------------------------------- harness -------------------------------------------- */
+
+static void _clear_tx_log( void )
+{
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  fake.tx_logged = 0;
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+
+/* wait till the core has written @num bytes of payloads, returns -1 on a timeout */
+static int _wait_tx( u_int num )
+{
+  u_int i, logged = 0;
+
+  for( i = 0; i < WAIT_MS; i++ )
+  {
+    pthread_mutex_lock( &n_rf24l01.core_lock );
+    logged = fake.tx_logged;
+    pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+    if( logged >= num )
+      return 0;
+
+    usleep( 1000 );
+  }
+
+  fprintf( stderr, "only %u bytes of %u have been transmitted\n", logged, num );
+
+  return -1;
+}
+
+/* make an interrupt for each package which has come back */
+static void _receive_all( void )
+{
+  int pending;
+
+  while( 1 )
+  {
+    /* an interrupt line isn't read, a package's latency starts here, as it does there */
+    pthread_mutex_lock( &n_rf24l01.core_lock );
+    pending = fake.fifo_head != fake.fifo_tail;
+    n_rf24l01.irq_ns = _get_time_ns();
+    pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+    if( !pending )
+      break;
+
+    _interrupt_on_n_rf24l01_device( 0 );
+  }
+
+  /* the thread writes queued data to a socket (at once, if it works through a ring) */
+  _wakeup_n_rf_thread();
+}
+
+/* read @num bytes from @fd, returns how many have come in WAIT_MS */
+static u_int _read_fd( int fd, void* buf, u_int num )
+{
+  struct pollfd pfd = { .fd = fd, .events = POLLIN };
+  u_int got = 0;
+  ssize_t ret;
+
+  while( got < num && poll( &pfd, 1, WAIT_MS ) > 0 )
+  {
+    ret = read( fd, (u_char*)buf + got, num - got );
+    if( ret <= 0 )
+      break;
+
+    got += ret;
+  }
+
+  return got;
+}
+
+/* wait till the core has transmitted something and has been quiet for a while,
+ * returns an amount of packages sent since @before, 0 on a timeout */
+static u_int _wait_tx_quiet( u_int before )
+{
+  u_int i, sent, last = before, quiet = 0;
+
+  for( i = 0; i < WAIT_MS && quiet < 20; i++ )
+  {
+    usleep( 1000 );
+
+    pthread_mutex_lock( &n_rf24l01.core_lock );
+    sent = fake.pkgs_sent;
+    pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+    quiet = sent != before && sent == last ? quiet + 1 : 0;
+    last = sent;
+  }
+
+  return last - before;
+}
+
+/* write @num bytes of @data and wait till they're transmitted, returns packages they've taken */
+static u_int _send_chunk( int fd, const void* data, u_int num )
+{
+  u_int before;
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  before = fake.pkgs_sent;
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  if( write( fd, data, num ) != (ssize_t)num )
+    return 0;
+
+  return _wait_tx_quiet( before );
+}
+
+/* lose a package, which is going to be @ahead-th one transmitted from now on */
+static void _drop_pkg( u_int* drop, u_int ahead )
+{
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  *drop = fake.pkgs_sent + ahead;
+  fake.drop = drop;
+  fake.drop_num = 1;
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+}
+
+/* 1, if @fd has something to read within @ms */
+static int _has_more( int fd, int ms )
+{
+  struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+  return poll( &pfd, 1, ms ) > 0;
+}
+
+/* ----------------------------------------------- reopen -------------------------------------------- */
+
+#define REOPEN_DATA_SIZE 100
+#define REOPEN_SESSIONS 4
+
+/* a written chunk goes out as it is, padded to whole packages, and comes back the same */
+static int _check_raw_link( int fd )
+{
+  u_char data[REOPEN_DATA_SIZE];
+  u_char expected[( REOPEN_DATA_SIZE + N_RF24L01_PKG_SIZE - 1 ) / N_RF24L01_PKG_SIZE * N_RF24L01_PKG_SIZE];
+  u_char received[sizeof(expected)];
+  u_int i, got;
+
+  for( i = 0; i < sizeof(data); i++ )
+    data[i] = i * 7 + 1;
+
+  memset( expected, 0, sizeof(expected) );
+  memcpy( expected, data, sizeof(data) );
+
+  _clear_tx_log();
+
+  if( write( fd, data, sizeof(data) ) != sizeof(data) || _wait_tx( sizeof(expected) ) < 0 )
+    return -1;
+
+  /* nothing but the data, e.g. no acknowledges or beacons of a layer left on */
+  usleep( 50000 );
+
+  pthread_mutex_lock( &n_rf24l01.core_lock );
+  i = fake.tx_logged == sizeof(expected) && !memcmp( fake.tx_log, expected, sizeof(expected) );
+  pthread_mutex_unlock( &n_rf24l01.core_lock );
+
+  if( !i )
+  {
+    fprintf( stderr, "payloads aren't the raw data\n" );
+    return -1;
+  }
+
+  _receive_all();
+
+  got = _read_fd( fd, received, sizeof(received) );
+  if( got != sizeof(received) || memcmp( received, expected, sizeof(expected) ) || _has_more( fd, 50 ) )
+  {
+    fprintf( stderr, "received data isn't the raw data (%u bytes)\n", got );
+    return -1;
+  }
+
+  return 0;
+}
+
+/* turn session's @s layers and settings on */
+static int _set_up_session( int fd, u_int s )
+{
+  static const u_char channels[] = { 10, 40, 70 };
+
+  switch( s )
+  {
+    case 0:
+      n_rf24l01_set_compression( fd, 1 );
+      n_rf24l01_set_coalescing( fd, 1000 );
+
+      return n_rf24l01_set_reliable( fd, 8 ) || n_rf24l01_set_adaptation( fd, 10, N_RF24L01_RATE_250KBPS ) ||
+             n_rf24l01_hop( fd, 1, channels, sizeof(channels), 5000, 1 ) ||
+             n_rf24l01_set_power_saving( fd, 1000, 10000, 100000, 2000 ) ||
+             n_rf24l01_set_rx_metadata( fd, 1 ) ||
+             n_rf24l01_set_rx_queue( fd, N_RF24L01_RX_DROP_OLDEST, 0, 1024 ) ? -1 : 0;
+
+    case 1:
+      return n_rf24l01_set_fec( fd, 4, 2 );
+
+    case 2:
+      return n_rf24l01_tdma_node( fd, 1, 0 );
+
+    default:
+      return n_rf24l01_set_mesh( fd, 1, 2 );
+  }
+}
+
+static int _scenario_reopen( void )
+{
+  static const char* sessions[REOPEN_SESSIONS] =
+  {
+    "arq, adaptation, hopping, power saving, compression, coalescing, metadata, rx queue",
+    "fec", "tdma", "mesh"
+  };
+  int fd, failed = 0;
+  u_int s;
+
+  for( s = 0; s < REOPEN_SESSIONS; s++ )
+  {
+    fd = n_rf24l01_open();
+    if( fd < 0 || _set_up_session( fd, s ) < 0 )
+    {
+      fprintf( stderr, "can't set a session of %s up\n", sessions[s] );
+      return 1;
+    }
+
+    n_rf24l01_close( fd );
+
+    fd = n_rf24l01_open();
+    if( fd < 0 )
+      return 1;
+
+    if( _check_raw_link( fd ) < 0 )
+      failed = 1;
+
+    printf( "after %s: %s\n", sessions[s], failed ? "FAILED" : "a raw link" );
+
+    n_rf24l01_close( fd );
+
+    if( failed )
+      return 1;
+  }
+
+  return 0;
+}
+
+/* ----------------------------------------------- frames -------------------------------------------- */
+
+#define FRAMES_LOSSES 3
+
+/* send @num bytes of @data, let them come back and check they're the same */
+static int _frames_round_trip( int fd, const u_char* data, u_int num )
+{
+  u_char received[1024];
+  u_int got;
+
+  if( !_send_chunk( fd, data, num ) )
+    return -1;
+
+  _receive_all();
+
+  got = _read_fd( fd, received, num );
+
+  return got == num && !memcmp( received, data, num ) && !_has_more( fd, 20 ) ? 0 : -1;
+}
+
+/* a text of a few words, the compression finds matches in it */
+static void _fill_text( u_char* dst, u_int num )
+{
+  static const char text[] = "temperature=21.5; humidity=48; node=3; ok\n";
+  u_int i;
+
+  for( i = 0; i < num; i++ )
+    dst[i] = text[i % ( sizeof(text) - 1 )];
+}
+
+static int _scenario_frames( void )
+{
+  static const char* losses[FRAMES_LOSSES] = { "a first", "a middle", "a last" };
+  u_char text[1024], noise[USER_BUFF_SIZE], run[USER_BUFF_SIZE];
+  n_rf24l01_stats_t before, after;
+  u_int i, pkgs, drop;
+  int fd, ret, failed = 0;
+
+  _fill_text( text, sizeof(text) );
+  memset( run, 'a', sizeof(run) );
+
+  for( i = 0; i < sizeof(noise); i++ )
+    noise[i] = rand();
+
+  fd = n_rf24l01_open();
+  if( fd < 0 )
+    return 1;
+
+  n_rf24l01_set_compression( fd, 1 );
+  n_rf24l01_get_stats( fd, &before );
+
+  ret = _frames_round_trip( fd, text, 200 ) | _frames_round_trip( fd, run, sizeof(run) ) |
+        _frames_round_trip( fd, text, USER_BUFF_SIZE ) | _frames_round_trip( fd, text, sizeof(text) );
+
+  n_rf24l01_get_stats( fd, &after );
+
+  /* all of them are compressible */
+  ret |= after.lz_frames_decompressed - before.lz_frames_decompressed < 4 ? -1 : 0;
+
+  printf( "compressible frames:      %s\n", ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  ret = _frames_round_trip( fd, noise, 250 );
+  printf( "an incompressible frame:  %s\n", ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  /* an incompressible frame takes a known amount of packages, one of them is lost */
+  pkgs = ( FRAME_HEADER_SIZE + 250 + N_RF24L01_PKG_SIZE - 2 ) / ( N_RF24L01_PKG_SIZE - 1 );
+
+  for( i = 0; i < FRAMES_LOSSES; i++ )
+  {
+    n_rf24l01_get_stats( fd, &before );
+
+    _drop_pkg( &drop, i == 0 ? 0 : i == 1 ? pkgs / 2 : pkgs - 1 );
+    ret = _send_chunk( fd, noise, 250 ) == pkgs ? 0 : -1;
+    _receive_all();
+
+    /* nothing of the frame, the next one comes whole */
+    ret |= _has_more( fd, 20 ) || _frames_round_trip( fd, text, 100 ) ? -1 : 0;
+
+    n_rf24l01_get_stats( fd, &after );
+
+    /* a frame lost from its start is just never seen */
+    if( i && after.lz_frames_broken == before.lz_frames_broken )
+      ret = -1;
+
+    printf( "%s package of a frame lost: %s\n", losses[i], ret ? "FAILED" : "the next frame is delivered, ok" );
+    failed |= ret != 0;
+  }
+
+  n_rf24l01_close( fd );
+
+  return failed;
+}
+
+/* ---------------------------------------------- coalesce ------------------------------------------- */
+
+/* a deadline is long enough for a scenario to add a next write to a payload */
+#define COALESCE_DEADLINE_US 100000
+#define COALESCE_GAP_US 20000
+
+/* two frames of this size leave one byte of a payload, which isn't enough for a header */
+#define COALESCE_LONE_PAD_CHUNK ( ( N_RF24L01_PKG_SIZE - 2 ) / 2 - FRAME_HEADER_SIZE )
+
+/* a frame which fills more than two payloads, so it spans packages */
+#define COALESCE_LONG_CHUNK ( 2 * N_RF24L01_PKG_SIZE )
+
+static int _scenario_coalesce( void )
+{
+  u_char data[COALESCE_LONG_CHUNK + 2 * COALESCE_LONE_PAD_CHUNK], received[sizeof(data)];
+  n_rf24l01_stats_t before, after;
+  u_int i, drop, got;
+  int fd, ret, failed = 0;
+
+  for( i = 0; i < sizeof(data); i++ )
+    data[i] = i + 1;
+
+  fd = n_rf24l01_open();
+  if( fd < 0 )
+    return 1;
+
+  n_rf24l01_set_coalescing( fd, COALESCE_DEADLINE_US );
+
+  /* the second frame fills a payload up to a lone byte, the payload goes out at once,
+   * a third one goes in a next package at a deadline */
+  n_rf24l01_get_stats( fd, &before );
+
+  ret = write( fd, data, COALESCE_LONE_PAD_CHUNK ) == COALESCE_LONE_PAD_CHUNK ? 0 : -1;
+  usleep( COALESCE_GAP_US );
+  ret |= _send_chunk( fd, data + COALESCE_LONE_PAD_CHUNK, COALESCE_LONE_PAD_CHUNK ) == 1 ? 0 : -1;
+  ret |= _send_chunk( fd, data + 2 * COALESCE_LONE_PAD_CHUNK, COALESCE_LONE_PAD_CHUNK ) == 1 ? 0 : -1;
+  _receive_all();
+
+  got = _read_fd( fd, received, 3 * COALESCE_LONE_PAD_CHUNK );
+  ret |= got == 3 * COALESCE_LONE_PAD_CHUNK && !memcmp( received, data, got ) ? 0 : -1;
+
+  n_rf24l01_get_stats( fd, &after );
+  ret |= after.coalesce_full_flushes == before.coalesce_full_flushes + 1 &&
+         after.lz_frames_broken == before.lz_frames_broken ? 0 : -1;
+
+  printf( "a payload with a lone padding byte:  %s\n", ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  /* a small frame waits to be coalesced, a long one flushes it and goes over three packages,
+   * the middle one of them is lost, a next small frame is coalesced anew */
+  n_rf24l01_get_stats( fd, &before );
+
+  ret = write( fd, data, COALESCE_LONE_PAD_CHUNK ) == COALESCE_LONE_PAD_CHUNK ? 0 : -1;
+  usleep( COALESCE_GAP_US );
+
+  _drop_pkg( &drop, 2 );
+  ret |= _send_chunk( fd, data + COALESCE_LONE_PAD_CHUNK, COALESCE_LONG_CHUNK ) == 4 ? 0 : -1;
+  ret |= _send_chunk( fd, data + COALESCE_LONE_PAD_CHUNK + COALESCE_LONG_CHUNK, COALESCE_LONE_PAD_CHUNK ) == 1 ?
+         0 : -1;
+  _receive_all();
+
+  got = _read_fd( fd, received, 2 * COALESCE_LONE_PAD_CHUNK );
+  ret |= got == 2 * COALESCE_LONE_PAD_CHUNK && !memcmp( received, data, COALESCE_LONE_PAD_CHUNK ) &&
+         !memcmp( received + COALESCE_LONE_PAD_CHUNK, data + COALESCE_LONE_PAD_CHUNK + COALESCE_LONG_CHUNK,
+                  COALESCE_LONE_PAD_CHUNK ) && !_has_more( fd, 20 ) ? 0 : -1;
+
+  n_rf24l01_get_stats( fd, &after );
+  ret |= after.lz_frames_broken == before.lz_frames_broken + 1 ? 0 : -1;
+
+  printf( "a frame over a lost package:         %s\n",
+          ret ? "FAILED" : "dropped, frames before and after it are delivered, ok" );
+  failed |= ret != 0;
+
+  n_rf24l01_close( fd );
+
+  return failed;
+}
+
+/* ---------------------------------------------- rx_queue ------------------------------------------- */
+
+/* a raw link carries a write in whole packages, a round fits a fifo of the fake */
+#define RX_QUEUE_ROUND ( 200 * N_RF24L01_PKG_SIZE )
+#define RX_QUEUE_ROUNDS 4
+#define RX_QUEUE_HIGH_WATERMARK_TEST 4096
+
+/* a stream of bytes each of which tells its position */
+static u_char _stream_byte( u_int pos )
+{
+  return ( pos * 2654435761u ) >> 24;
+}
+
+/* send RX_QUEUE_ROUNDS rounds of a stream from @pos on and let them come back, a user reads nothing */
+static int _flood( int fd, u_int pos )
+{
+  u_char data[RX_QUEUE_ROUND];
+  u_int r, i;
+
+  for( r = 0; r < RX_QUEUE_ROUNDS; r++ )
+  {
+    for( i = 0; i < sizeof(data); i++ )
+      data[i] = _stream_byte( pos++ );
+
+    if( _send_chunk( fd, data, sizeof(data) ) != RX_QUEUE_ROUND / N_RF24L01_PKG_SIZE )
+      return -1;
+
+    _receive_all();
+  }
+
+  return 0;
+}
+
+/* read whatever comes till @fd is quiet */
+static u_int _read_all( int fd, u_char* buf, u_int size )
+{
+  u_int got = 0;
+  ssize_t ret;
+
+  while( got < size && _has_more( fd, 50 ) )
+  {
+    ret = read( fd, buf + got, size - got );
+    if( ret <= 0 )
+      break;
+
+    got += ret;
+  }
+
+  return got;
+}
+
+/* 1 if an @event_fd has been signaled @times (at least once) since a last check */
+static int _signaled( int event_fd, u_int times )
+{
+  uint64_t value = 0;
+
+  return times && read( event_fd, &value, sizeof(value) ) == sizeof(value) && value == times;
+}
+
+/* the stream from @pos on has come with a gap of @dropped bytes: at the end of it for
+ * a drop of the newest data, after what a socket has taken for a drop of the oldest one */
+static int _check_gap( const u_char* received, u_int got, u_int pos, unsigned long long dropped, int oldest )
+{
+  u_int i, k = got;
+
+  if( !dropped || got + dropped != RX_QUEUE_ROUNDS * RX_QUEUE_ROUND )
+    return -1;
+
+  for( i = 0; i < got; i++ )
+    if( received[i] != _stream_byte( pos + i ) )
+    {
+      k = i;
+      break;
+    }
+
+  if( !oldest || k == got )
+    return k == got && !oldest ? 0 : -1;
+
+  for( i = k; i < got; i++ )
+    if( received[i] != _stream_byte( pos + dropped + i ) )
+      return -1;
+
+  return 0;
+}
+
+static int _scenario_rx_queue( void )
+{
+  static u_char received[RX_QUEUE_ROUNDS * RX_QUEUE_ROUND];
+  n_rf24l01_stats_t before, after;
+  int fd, event_fd, size = 1, ret, failed = 0;
+  u_int got;
+
+  fd = n_rf24l01_open();
+  if( fd < 0 )
+    return 1;
+
+  /* a socket takes little, so the queue gets full soon */
+  setsockopt( n_rf24l01.sockets_pair[1], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size) );
+
+  event_fd = n_rf24l01_get_rx_queue_event_fd( fd );
+
+  /* data which doesn't fit is dropped, a user gets the stream up to a point */
+  n_rf24l01_get_stats( fd, &before );
+  ret = event_fd < 0 || _has_more( event_fd, 0 ) ||
+        n_rf24l01_set_rx_queue( fd, N_RF24L01_RX_DROP_NEWEST, 0, RX_QUEUE_HIGH_WATERMARK_TEST ) ||
+        _flood( fd, 0 ) < 0 ? -1 : 0;
+
+  n_rf24l01_get_stats( fd, &after );
+  ret |= after.rx_queue_bytes == N_RF24L01_RX_QUEUE_SIZE &&
+         _signaled( event_fd, after.rx_queue_high_watermark_hits - before.rx_queue_high_watermark_hits ) ? 0 : -1;
+
+  got = _read_all( fd, received, sizeof(received) );
+  ret |= _check_gap( received, got, 0, after.rx_queue_bytes_dropped - before.rx_queue_bytes_dropped, 0 );
+
+  printf( "drop newest:  %u bytes read, %llu dropped: %s\n", got,
+          after.rx_queue_bytes_dropped - before.rx_queue_bytes_dropped, ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  /* the oldest queued data is dropped for new one, the queue has been drained, so a watermark
+   * is signaled anew (the thread may drain the queue below a half of it on the way, through
+   * a ring it queues all it delivers, then it's signaled each time it's reached) */
+  n_rf24l01_get_stats( fd, &before );
+  ret = _has_more( event_fd, 0 ) ||
+        n_rf24l01_set_rx_queue( fd, N_RF24L01_RX_DROP_OLDEST, 0, RX_QUEUE_HIGH_WATERMARK_TEST ) ||
+        _flood( fd, RX_QUEUE_ROUNDS * RX_QUEUE_ROUND ) < 0 ? -1 : 0;
+
+  n_rf24l01_get_stats( fd, &after );
+  ret |= after.rx_queue_bytes == N_RF24L01_RX_QUEUE_SIZE &&
+         _signaled( event_fd, after.rx_queue_high_watermark_hits - before.rx_queue_high_watermark_hits ) ? 0 : -1;
+
+  got = _read_all( fd, received, sizeof(received) );
+  ret |= _check_gap( received, got, RX_QUEUE_ROUNDS * RX_QUEUE_ROUND,
+                     after.rx_queue_bytes_dropped - before.rx_queue_bytes_dropped, 1 );
+
+  printf( "drop oldest:  %u bytes read, %llu dropped: %s\n", got,
+          after.rx_queue_bytes_dropped - before.rx_queue_bytes_dropped, ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  /* a drained queue is quiet till it reaches the watermark again */
+  ret = _has_more( event_fd, 0 ) ? -1 : 0;
+  printf( "a watermark is signaled once per a time it's reached: %s\n", ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  n_rf24l01_close( fd );
+
+  return failed;
+}
+
+/* ---------------------------------------------- metadata ------------------------------------------- */
+
+#define METADATA_PKGS 2
+
+/* a header is what a user is told it is, a consumer written in another language relies on it */
+static int _check_meta_layout( void )
+{
+  return sizeof(n_rf24l01_rx_meta_t) == 32 && offsetof( n_rf24l01_rx_meta_t, irq_ns ) == 0 &&
+         offsetof( n_rf24l01_rx_meta_t, read_ns ) == 8 && offsetof( n_rf24l01_rx_meta_t, deliver_ns ) == 16 &&
+         offsetof( n_rf24l01_rx_meta_t, length ) == 24 && offsetof( n_rf24l01_rx_meta_t, pipe ) == 28 &&
+         offsetof( n_rf24l01_rx_meta_t, slot ) == 29 && offsetof( n_rf24l01_rx_meta_t, source ) == 30 ? 0 : -1;
+}
+
+/* send METADATA_PKGS packages of data, each comes back as a record: a header which tells
+ * of the package, then its data; without metadata the data comes as it is */
+static int _check_records( int fd, int metadata )
+{
+  u_char data[METADATA_PKGS * N_RF24L01_PKG_SIZE];
+  u_char received[METADATA_PKGS * ( sizeof(n_rf24l01_rx_meta_t) + N_RF24L01_PKG_SIZE )];
+  u_int i, got, num = metadata ? sizeof(received) : sizeof(data);
+  n_rf24l01_rx_meta_t meta;
+  uint64_t from, to, last = 0;
+
+  for( i = 0; i < sizeof(data); i++ )
+    data[i] = i * 3 + 1;
+
+  if( _send_chunk( fd, data, sizeof(data) ) != METADATA_PKGS )
+    return -1;
+
+  from = _get_time_ns();
+  _receive_all();
+
+  got = _read_fd( fd, received, num );
+  to = _get_time_ns();
+
+  if( got != num || _has_more( fd, 20 ) )
+    return -1;
+
+  if( !metadata )
+    return memcmp( received, data, sizeof(data) ) ? -1 : 0;
+
+  for( i = 0; i < METADATA_PKGS; i++ )
+  {
+    memcpy( &meta, received + i * ( sizeof(meta) + N_RF24L01_PKG_SIZE ), sizeof(meta) );
+
+    /* a package looped back by the fake comes over pipe 0, neither TDMA nor a mesh is on */
+    if( meta.length != N_RF24L01_PKG_SIZE || meta.pipe || meta.slot || meta.source ||
+        meta.irq_ns < from || meta.irq_ns < last || meta.read_ns < meta.irq_ns || meta.deliver_ns < meta.read_ns ||
+        meta.deliver_ns > to )
+      return -1;
+
+    if( memcmp( received + i * ( sizeof(meta) + N_RF24L01_PKG_SIZE ) + sizeof(meta),
+                data + i * N_RF24L01_PKG_SIZE, N_RF24L01_PKG_SIZE ) )
+      return -1;
+
+    last = meta.deliver_ns;
+  }
+
+  return 0;
+}
+
+static int _scenario_metadata( void )
+{
+  int fd, ret, failed = 0;
+
+  ret = _check_meta_layout();
+  printf( "a header's layout:                  %s\n", ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  fd = n_rf24l01_open();
+  if( fd < 0 )
+    return 1;
+
+  ret = _check_records( fd, 0 );
+  printf( "no metadata, no header:             %s\n", ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  ret = n_rf24l01_set_rx_metadata( fd, 1 ) || _check_records( fd, 1 ) ? -1 : 0;
+  printf( "metadata, a header before data:     %s\n", ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  ret = n_rf24l01_set_rx_metadata( fd, 0 ) || _check_records( fd, 0 ) ? -1 : 0;
+  printf( "metadata turned off, no header:     %s\n", ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  /* a next session starts without metadata */
+  n_rf24l01_set_rx_metadata( fd, 1 );
+  n_rf24l01_close( fd );
+
+  fd = n_rf24l01_open();
+  if( fd < 0 )
+    return 1;
+
+  ret = _check_records( fd, 0 );
+  printf( "reopened after metadata, no header: %s\n", ret ? "FAILED" : "ok" );
+  failed |= ret != 0;
+
+  n_rf24l01_close( fd );
+
+  return failed;
+}
+
+static const scenario_t scenarios[] =
+{
+  { "reopen", _scenario_reopen },
+  { "frames", _scenario_frames },
+  { "coalesce", _scenario_coalesce },
+  { "rx_queue", _scenario_rx_queue },
+  { "metadata", _scenario_metadata },
+};
+
+int main( int argc, char* argv[] )
+{
+  u_int i;
+
+  if( argc != 2 )
+  {
+    fprintf( stderr, "usage: %s <scenario>, scenarios:", argv[0] );
+    for( i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++ )
+      fprintf( stderr, " %s", scenarios[i].name );
+    fprintf( stderr, "\n" );
+    return 2;
+  }
+
+  /* the wrapper skips a first interrupt as a fake one */
+  _interrupt_on_n_rf24l01_device( 0 );
+
+  for( i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++ )
+    if( !strcmp( argv[1], scenarios[i].name ) )
+      return scenarios[i].run();
+
+  fprintf( stderr, "unknown scenario: %s\n", argv[1] );
+
+  return 2;
+}
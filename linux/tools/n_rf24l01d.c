@@ -0,0 +1,47 @@
+/*
+ * n_rf24l01d.c
+ *
+ * A daemon which owns the transceiver and shares it with other processes,
+ * look at n_rf24l01_serve and n_rf24l01_connect.
+ *
+ * usage: n_rf24l01d [socket path]
+ */
+
+#include <stdio.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "n_rf24l01_linux.h"
+
+int main( int argc, char* argv[] )
+{
+  const char* path = argc > 1 ? argv[1] : N_RF24L01_DAEMON_SOCKET;
+  sigset_t signals;
+  int fd, signal_num;
+
+  /* a library's thread inherits a mask, so signals come to sigwait only */
+  sigemptyset( &signals );
+  sigaddset( &signals, SIGINT );
+  sigaddset( &signals, SIGTERM );
+  pthread_sigmask( SIG_BLOCK, &signals, NULL );
+
+  fd = n_rf24l01_open();
+  if( fd < 0 )
+  {
+    printf( "n_rf24l01d: fail to open the library.\n" );
+    return 1;
+  }
+
+  if( n_rf24l01_serve( fd, path ) < 0 )
+  {
+    printf( "n_rf24l01d: fail to serve on %s.\n", path );
+    n_rf24l01_close( fd );
+    return 1;
+  }
+
+  sigwait( &signals, &signal_num );
+
+  n_rf24l01_close( fd );
+
+  return 0;
+}
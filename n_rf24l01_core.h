@@ -28,8 +28,36 @@ extern "C" {
 typedef unsigned char u_char;
 typedef unsigned int u_int;
 
+/* a size of a package the library transmits/receives for time, in bytes */
+#define N_RF24L01_PKG_SIZE 32
+
+/* an amount of RF channels the n_rf24l01 can be tuned to (2400MHz + [0..125]MHz) */
+#define N_RF24L01_CHANNELS_AMOUNT 126
+
+/* air data rates, 250kbps is supported by an nRF24L01+ only */
+#define N_RF24L01_DATA_RATE_1MBPS   0
+#define N_RF24L01_DATA_RATE_2MBPS   1
+#define N_RF24L01_DATA_RATE_250KBPS 2
+
+/* transmit powers */
+#define N_RF24L01_TX_POWER_M18DBM 0
+#define N_RF24L01_TX_POWER_M12DBM 1
+#define N_RF24L01_TX_POWER_M6DBM  2
+#define N_RF24L01_TX_POWER_0DBM   3
+
+/* one command of a batch, look at the send_cmd cb for a meaning of fields */
+typedef struct n_rf24l01_cmd_t
+{
+  u_char cmd;
+  u_char* status_reg;
+  u_char* data;
+  u_char num;
+  u_char direction;
+} n_rf24l01_cmd_t;
+
 typedef void (*set_up_ce_pin_ptr)( u_char value );
 typedef void (*send_cmd_ptr)( u_char cmd, u_char* status_reg, u_char* data, u_char num, u_char direction );
+typedef void (*send_cmds_ptr)( const n_rf24l01_cmd_t* cmds, u_int num );
 typedef void (*usleep_ptr)( u_int delay_mks );
 typedef void (*handle_received_data_ptr)( const void* data, u_int num );
 
@@ -77,6 +105,21 @@ typedef struct n_rf24l01_backend_t
    */
   send_cmd_ptr send_cmd;
 
+  /**
+   * @brief send several commands to n_rf24l01 at once (optional, may be NULL)
+   *
+   * void (*send_cmds_ptr)( const n_rf24l01_cmd_t* cmds, u_int num );
+   *
+   * @param[in] cmds - an array of commands, each one has the same meaning as send_cmd's parameters
+   * @param[in] num  - an amount of commands in @cmds
+   *
+   * Note: each command has to be performed as a separate CSN session (as send_cmd does), but
+   *       the backend is free to queue all of them to the SPI peripheral at once (e.g. one
+   *       spidev ioctl) to save on a per-command overhead;
+   *       if NULL, the library calls send_cmd for each command in turn.
+   */
+  send_cmds_ptr send_cmds;
+
   /**
    * @brief put to sleep a library execution flow, max sleep interval ~1500 ms
    *
@@ -104,6 +147,27 @@ typedef struct n_rf24l01_backend_t
 
 } n_rf24l01_backend_t;
 
+/**
+ * @brief This structure keeps a state of one transceiver
+ *
+ * Note: the library works with one transceiver at time, an instance to work with
+ *       is selected by n_rf24l01_select; fields are for the library's internal use
+ */
+typedef struct n_rf24l01_instance_t
+{
+  n_rf24l01_backend_t backend;
+
+  // a state of the transceiver the library keeps track of, to not read it back over SPI
+  u_char ce;        // a current level on the CE pin
+  u_char config;    // the CONFIG register (PWR_UP, PRIM_RX), a mode changes with one write or none
+  u_char channel;   // a current RF channel
+  u_char rx_pipe;   // a pipe a last received package came over
+
+  u_int lbt_attempts;
+  u_int lbt_backoff_mks;
+  uint32_t rand_state;
+} n_rf24l01_instance_t;
+
 // -------------------------------------- IRQ handlers --------------------------------------------------
 
 /**
@@ -130,25 +194,51 @@ void n_rf24l01_bottom_half_irq( void );
  * @brief configure the library and the transceiver
  *
  * @param[in] - a pointer to a structure with callbacks
- * @return -1, if failed
+ * @return -1, if failed, 1 - a warm start, 0 otherwise
  *
- * Note: call this function before start the work with the library
+ * Note: call this function before start the work with the library;
+ *       a current configuration is read back at once and only registers which differ
+ *       get written, a power-up delay (1.5ms) is skipped if the transceiver has been left
+ *       powered up (a warm start), e.g. by a previous run of a service; whatever a previous run
+ *       has left, the transceiver is at 2Mbps and the lowermost transmit power after the call
  */
 //======================================================================================================
 int n_rf24l01_init( const n_rf24l01_backend_t* n_rf24l01_backend );
 
 /**
  * @brief configure the n_rf24l01 to be a transmitter
+ *
+ * Note: it's the only CE change if the transceiver is already in standby-I as a transmitter
+ *       (n_rf24l01_standby after a transmission), a wake from a power down takes 1.5ms
  */
 //======================================================================================================
 void n_rf24l01_prepare_to_transmit( void );
 
 /**
  * @brief configure the n_rf24l01 to be a receiver
+ *
+ * Note: a wake from a power down takes 1.5ms more
  */
 //======================================================================================================
 void n_rf24l01_prepare_to_receive( void );
 
+/**
+ * @brief put the n_rf24l01 to standby-I: a crystal oscillator keeps running (~26uA),
+ *        so it becomes a receiver or a transmitter in 130us
+ *
+ * Note: from a power down it takes 1.5ms
+ */
+//======================================================================================================
+void n_rf24l01_standby( void );
+
+/**
+ * @brief power the n_rf24l01 down (~0.9uA), registers keep their values
+ *
+ * Note: a next n_rf24l01_prepare_to_* or n_rf24l01_standby powers it up
+ */
+//======================================================================================================
+void n_rf24l01_power_down( void );
+
 /**
  * @brief transmit packages through the n_rf24l01 transceiver
  *
@@ -160,6 +250,94 @@ void n_rf24l01_prepare_to_receive( void );
 //======================================================================================================
 void n_rf24l01_transmit_pkgs( const void* data, u_int num );
 
+/**
+ * @brief tune the n_rf24l01 to an RF channel
+ *
+ * @param[in] channel - a channel to tune to, [0..N_RF24L01_CHANNELS_AMOUNT)
+ * @return -1, if failed
+ *
+ * Note: both sides have to be tuned to the same channel to communicate
+ */
+//======================================================================================================
+int n_rf24l01_set_channel( u_char channel );
+
+/**
+ * @brief set an air data rate
+ *
+ * @param[in] rate - one of N_RF24L01_DATA_RATE_*
+ * @return -1, if failed
+ *
+ * Note: both sides have to use the same data rate to communicate;
+ *       a lower rate gives a better receiver sensitivity (a longer range)
+ */
+//======================================================================================================
+int n_rf24l01_set_data_rate( u_char rate );
+
+/**
+ * @brief set a transmit power
+ *
+ * @param[in] power - one of N_RF24L01_TX_POWER_*
+ * @return -1, if failed
+ *
+ * Note: the lowermost power is set by n_rf24l01_init
+ */
+//======================================================================================================
+int n_rf24l01_set_tx_power( u_char power );
+
+/**
+ * @brief sweep all RF channels and sample a received power detector (RPD) on each of them
+ *
+ * @param[out] occupancy - an array of N_RF24L01_CHANNELS_AMOUNT counters, occupancy[channel] gets
+ *                         an amount of sweeps a carrier (> -64dBm) was detected on the channel
+ * @param[in]  sweeps    - an amount of sweeps to perform, [1..255]
+ * @param[in]  dwell_mks - time to listen each channel, not less than 170us (RX settling + AGC)
+ * @return -1, if failed
+ *
+ * Note: this is block call, a sweep takes about N_RF24L01_CHANNELS_AMOUNT * @dwell_mks;
+ *       the transceiver is put back to the channel and the mode it was in before the call
+ */
+//======================================================================================================
+int n_rf24l01_scan_channels( u_char* occupancy, u_int sweeps, u_int dwell_mks );
+
+/**
+ * @brief set up a listen-before-talk check for n_rf24l01_prepare_to_transmit
+ *
+ * @param[in] attempts   - how many times to sample a carrier before to give up, 0 - disable the check
+ * @param[in] backoff_mks - a base time to wait between two attempts, a random jitter up to
+ *                          @backoff_mks is added to each wait
+ *
+ * Note: if the channel is still busy after @attempts samples, the transceiver gets configured as
+ *       a transmitter anyway, so the check only lowers a chance of collision;
+ *       the check relies on the transceiver to be a receiver for at least 170us before the call,
+ *       one which isn't a receiver (standby-I, a power down) becomes it for 170us first
+ *       (after a 1.5ms wake, if it's powered down).
+ */
+//======================================================================================================
+void n_rf24l01_set_lbt( u_int attempts, u_int backoff_mks );
+
+/**
+ * @brief select an instance (a transceiver) all other library's calls work with
+ *
+ * @param[in] instance - an instance to select, NULL - a default one
+ *
+ * Note: it's needed only to drive several transceivers, each of them has its own instance,
+ *       n_rf24l01_init has to be called for each instance after it's selected;
+ *       backend's callbacks get called for a selected instance only, so a backend
+ *       has to be switched to an appropriate transceiver together with an instance
+ */
+//======================================================================================================
+void n_rf24l01_select( n_rf24l01_instance_t* instance );
+
+/**
+ * @brief get a pipe a last received package came over
+ *
+ * @return a pipe number, [0..5]
+ *
+ * Note: it's valid within handle_received_data callback and till a next package is received
+ */
+//======================================================================================================
+u_char n_rf24l01_get_rx_pipe( void );
+
 
 /* for debug purposes only; for values appropriate as reg_addr arguments look
  * at core/n_rf24l01.h;
@@ -0,0 +1,438 @@
+/*
+ * n_rf24l01_core.hpp
+ *
+ * A header-only C++17 variant of the library's core, a transceiver is configured at
+ * compile time instead of at run time:
+ *
+ *   struct config : n_rf24l01::core::default_config
+ *   {
+ *     static constexpr std::size_t payload_size = 16;
+ *     static constexpr std::size_t pipes = 2;
+ *   };
+ *
+ *   my_backend backend;
+ *   n_rf24l01::core::transceiver<config, my_backend> radio( backend );
+ *
+ *   radio.init();
+ *   radio.prepare_to_receive();
+ *
+ * Every SPI command is built as a fixed-size frame (a command byte and its data) whose
+ * size is known at compile time, and everything a config turns off is compiled out:
+ * a pipe number isn't tracked for a single pipe, a payload width isn't read without
+ * a dynamic payload length, the debug API doesn't exist without the debug option and
+ * a width of a register it accesses is picked at compile time.
+ *
+ * A backend is a class (no virtual calls, no callbacks) with these members:
+ *
+ *   void set_ce( bool value );                         - as set_up_ce_pin of n_rf24l01_backend_t
+ *   void transfer( u_char* frame, std::size_t num );   - one CSN session: shift @num bytes of @frame
+ *                                                        out and replace them by bytes shifted in,
+ *                                                        so frame[0] (a command) gets a STATUS register
+ *   void usleep( u_int delay_mks );                    - as usleep of n_rf24l01_backend_t
+ *   void handle_received_data( const u_char* data, std::size_t num );
+ *
+ * Meaning of calls is the same as of the C core (look at n_rf24l01_core.h), a channel scan and
+ * a listen-before-talk check are available in the C core only. Nothing here is thread-safe.
+ *
+ * What each call costs per config (bytes and instructions) is reported by
+ * linux/tools/n_rf24l01_core_size.sh (make core_size in a linux build).
+ */
+
+#ifndef N_RF24L01_CORE_HPP
+#define N_RF24L01_CORE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "n_rf24l01_core.h"
+
+namespace n_rf24l01::core
+{
+
+/* commands set */
+namespace cmd
+{
+inline constexpr u_char r_register = 0x00;
+inline constexpr u_char w_register = 0x20;
+inline constexpr u_char r_rx_pl_wid = 0x60;
+inline constexpr u_char r_rx_payload = 0x61;
+inline constexpr u_char w_tx_payload = 0xa0;
+inline constexpr u_char w_tx_payload_noack = 0xb0;
+inline constexpr u_char flush_rx = 0xe2;
+inline constexpr u_char nop = 0xff;
+}
+
+/* registers set */
+namespace reg
+{
+inline constexpr u_char config = 0x00;
+inline constexpr u_char en_aa = 0x01;
+inline constexpr u_char en_rxaddr = 0x02;
+inline constexpr u_char rf_ch = 0x05;
+inline constexpr u_char rf_setup = 0x06;
+inline constexpr u_char status = 0x07;
+inline constexpr u_char rpd = 0x09;
+inline constexpr u_char rx_addr_p0 = 0x0a;  /* 5 bytes */
+inline constexpr u_char rx_addr_p1 = 0x0b;  /* 5 bytes */
+inline constexpr u_char tx_addr = 0x10;     /* 5 bytes */
+inline constexpr u_char rx_pw_p0 = 0x11;    /* rx_pw_p1..rx_pw_p5 follow it */
+inline constexpr u_char dynpd = 0x1c;
+inline constexpr u_char feature = 0x1d;
+
+/* each register has 5 bits address in registers map */
+inline constexpr u_char addr_bits = 0x1f;
+
+constexpr std::size_t width( u_char addr )
+{
+  return addr == rx_addr_p0 || addr == rx_addr_p1 || addr == tx_addr ? 5 : 1;
+}
+}
+
+/* bits definition */
+namespace bits
+{
+/* CONFIG register */
+inline constexpr u_char pwr_up = 0x02;
+inline constexpr u_char prim_rx = 0x01;
+
+/* STATUS register */
+inline constexpr u_char rx_dr = 0x40;
+inline constexpr u_char rx_p_no = 0x0e;
+
+/* RF_SETUP register */
+inline constexpr u_char rf_dr_low = 0x20;
+inline constexpr u_char rf_dr_high = 0x08;
+inline constexpr u_char rf_pwr = 0x06;
+
+/* FEATURE register */
+inline constexpr u_char en_dpl = 0x04;
+inline constexpr u_char en_dyn_ack = 0x01;
+}
+
+/* a command byte and @N bytes of its data */
+template<std::size_t N>
+using frame = std::array<u_char, 1 + N>;
+
+/* a config the C core is built with, derive from it and hide what's to change */
+struct default_config
+{
+  /* a size of a package (a max one, if a payload length is dynamic), [1..32] bytes */
+  static constexpr std::size_t payload_size = N_RF24L01_PKG_SIZE;
+
+  /* packages are transmitted as long as data is, not padded to @payload_size;
+   * an nRF24L01+ only, both sides have to use it */
+  static constexpr bool dynamic_payload = false;
+
+  /* an amount of receive pipes enabled, [1..6] */
+  static constexpr std::size_t pipes = 1;
+
+  /* read_register_dbg and write_register_dbg */
+  static constexpr bool debug = false;
+};
+
+template<typename Config, typename Backend>
+class transceiver
+{
+  static_assert( Config::payload_size >= 1 && Config::payload_size <= 32, "a payload is [1..32] bytes" );
+  static_assert( Config::pipes >= 1 && Config::pipes <= 6, "the n_rf24l01 has [1..6] pipes" );
+
+public:
+  static constexpr std::size_t payload_size = Config::payload_size;
+
+  /* a value a debug call reads or writes, a 5-bytes register is LSByte first */
+  template<u_char Reg>
+  using register_t = std::conditional_t<reg::width( Reg ) == 5, uint64_t, u_char>;
+
+  explicit transceiver( Backend& backend ) noexcept : backend_( backend ) {}
+
+  transceiver( const transceiver& ) = delete;
+  transceiver& operator=( const transceiver& ) = delete;
+
+  /* @return 1 - a warm start (the transceiver was already powered up), 0 otherwise */
+  int init()
+  {
+    u_char config = read_register( reg::config );
+    int warm = !!( config & bits::pwr_up );
+    u_char rf_setup;
+
+    channel_ = read_register( reg::rf_ch );
+
+    /* an acknowledge is disabled for all pipes, a dynamic payload length needs it enabled
+     * on a receiver, so a transmitter asks for no acknowledge per package instead */
+    if constexpr( Config::dynamic_payload )
+    {
+      update_register( reg::feature, bits::en_dpl | bits::en_dyn_ack );
+      update_register( reg::en_aa, pipes_mask );
+      update_register( reg::dynpd, pipes_mask );
+    }
+    else
+    {
+      /* a previous run may have left a dynamic payload length on, widths are ignored then */
+      update_register( reg::feature, 0x00 );
+      update_register( reg::dynpd, 0x00 );
+      update_register( reg::en_aa, 0x00 );
+
+      for( std::size_t i = 0; i < Config::pipes; i++ )
+        update_register( reg::rx_pw_p0 + i, payload_size );
+    }
+
+    update_register( reg::en_rxaddr, pipes_mask );
+
+    /* set the lowermost transmit power and a default 2Mbps data rate, as the C core does */
+    rf_setup = read_register( reg::rf_setup );
+    if( ( rf_setup & ( bits::rf_pwr | bits::rf_dr_low | bits::rf_dr_high ) ) != bits::rf_dr_high )
+      write_register( reg::rf_setup, ( rf_setup & ~( bits::rf_pwr | bits::rf_dr_low ) ) | bits::rf_dr_high );
+
+    if( !warm )
+    {
+      write_register( reg::config, config | bits::pwr_up );
+      backend_.usleep( 1500 );
+    }
+
+    return warm;
+  }
+
+  void prepare_to_transmit()
+  {
+    set_ce( 0 );
+
+    write_register( reg::config, read_register( reg::config ) & ~bits::prim_rx );
+    backend_.usleep( 140 );
+  }
+
+  void prepare_to_receive()
+  {
+    write_register( reg::config, read_register( reg::config ) | bits::prim_rx );
+
+    set_ce( 1 );
+    backend_.usleep( 140 );
+  }
+
+  /* a last package is padded with zeros, unless a payload length is dynamic */
+  void transmit_pkgs( const void* data, std::size_t num )
+  {
+    const u_char* src = static_cast<const u_char*>( data );
+    std::size_t size;
+
+    if( !data )
+      return;
+
+    while( num )
+    {
+      size = num < payload_size ? num : payload_size;
+
+      transmit_pkg( src, size );
+      backend_.usleep( 300 );
+
+      src += size;
+      num -= size;
+    }
+  }
+
+  void bottom_half_irq()
+  {
+    frame<payload_size> pkg;
+    std::size_t num = payload_size;
+    u_char status = read_status();
+
+    if( status & bits::rx_dr )
+    {
+      if constexpr( Config::pipes > 1 )
+        rx_pipe_ = ( status & bits::rx_p_no ) >> 1;
+
+      /* a width above a max one means a corrupted package, it has to be flushed */
+      if constexpr( Config::dynamic_payload )
+      {
+        num = read_cmd( cmd::r_rx_pl_wid );
+        if( num > payload_size )
+        {
+          frame<0> flush{ cmd::flush_rx };
+
+          backend_.transfer( flush.data(), flush.size() );
+          status &= ~bits::rx_dr;
+        }
+      }
+
+      if( status & bits::rx_dr )
+      {
+        pkg[0] = cmd::r_rx_payload;
+        backend_.transfer( pkg.data(), 1 + num );
+      }
+    }
+
+    write_register( reg::status, read_status() );
+
+    if( status & bits::rx_dr )
+      backend_.handle_received_data( pkg.data() + 1, num );
+  }
+
+  /* @return -1, if failed */
+  int set_channel( u_char channel )
+  {
+    if( channel >= N_RF24L01_CHANNELS_AMOUNT )
+      return -1;
+
+    if( ce_ )
+      backend_.set_ce( 0 );
+
+    write_register( reg::rf_ch, channel );
+    channel_ = channel;
+
+    if( ce_ )
+      backend_.set_ce( 1 );
+
+    return 0;
+  }
+
+  /* @rate - one of N_RF24L01_DATA_RATE_*, @return -1, if failed */
+  int set_data_rate( u_char rate )
+  {
+    u_char rf_setup;
+
+    if( rate > N_RF24L01_DATA_RATE_250KBPS )
+      return -1;
+
+    rf_setup = read_register( reg::rf_setup ) & ~( bits::rf_dr_low | bits::rf_dr_high );
+
+    if( rate == N_RF24L01_DATA_RATE_2MBPS )
+      rf_setup |= bits::rf_dr_high;
+    else if( rate == N_RF24L01_DATA_RATE_250KBPS )
+      rf_setup |= bits::rf_dr_low;
+
+    write_register( reg::rf_setup, rf_setup );
+
+    return 0;
+  }
+
+  /* @power - one of N_RF24L01_TX_POWER_*, @return -1, if failed */
+  int set_tx_power( u_char power )
+  {
+    if( power > N_RF24L01_TX_POWER_0DBM )
+      return -1;
+
+    write_register( reg::rf_setup, ( read_register( reg::rf_setup ) & ~bits::rf_pwr ) | power << 1 );
+
+    return 0;
+  }
+
+  /* a pipe a last received package came over, always 0 for a single pipe */
+  u_char get_rx_pipe() const noexcept { return rx_pipe_; }
+
+  u_char get_channel() const noexcept { return channel_; }
+
+  /* for debug purposes only, as n_rf24l01_read_register_dbg/n_rf24l01_write_register_dbg,
+   * they don't need init to be called */
+  template<u_char Reg>
+  register_t<Reg> read_register_dbg()
+  {
+    static_assert( Config::debug, "the debug API is off in the config" );
+
+    frame<reg::width( Reg )> f{ static_cast<u_char>( cmd::r_register | ( Reg & reg::addr_bits ) ) };
+    register_t<Reg> value = 0;
+
+    backend_.transfer( f.data(), f.size() );
+
+    for( std::size_t i = f.size() - 1; i; i-- )
+      value = value << 8 | f[i];
+
+    return value;
+  }
+
+  template<u_char Reg>
+  void write_register_dbg( register_t<Reg> value )
+  {
+    static_assert( Config::debug, "the debug API is off in the config" );
+
+    frame<reg::width( Reg )> f{ static_cast<u_char>( cmd::w_register | ( Reg & reg::addr_bits ) ) };
+
+    for( std::size_t i = 1; i < f.size(); i++, value >>= 8 )
+      f[i] = static_cast<u_char>( value );
+
+    backend_.transfer( f.data(), f.size() );
+  }
+
+private:
+  static constexpr u_char pipes_mask = ( 1u << Config::pipes ) - 1;
+
+  u_char read_status()
+  {
+    frame<0> f{ cmd::nop };
+
+    backend_.transfer( f.data(), f.size() );
+
+    return f[0];
+  }
+
+  /* a command with 1 byte of a response */
+  u_char read_cmd( u_char command )
+  {
+    frame<1> f{ command, 0 };
+
+    backend_.transfer( f.data(), f.size() );
+
+    return f[1];
+  }
+
+  /* for 1-byte registers only */
+  u_char read_register( u_char addr )
+  {
+    return read_cmd( cmd::r_register | addr );
+  }
+
+  void write_register( u_char addr, u_char value )
+  {
+    frame<1> f{ static_cast<u_char>( cmd::w_register | addr ), value };
+
+    backend_.transfer( f.data(), f.size() );
+  }
+
+  /* write a register only if it differs, the transceiver may be left configured by a previous run */
+  void update_register( u_char addr, u_char value )
+  {
+    if( read_register( addr ) != value )
+      write_register( addr, value );
+  }
+
+  void transmit_pkg( const u_char* data, std::size_t num )
+  {
+    frame<payload_size> pkg;
+
+    std::memcpy( pkg.data() + 1, data, num );
+
+    if constexpr( Config::dynamic_payload )
+    {
+      pkg[0] = cmd::w_tx_payload_noack;
+      backend_.transfer( pkg.data(), 1 + num );
+    }
+    else
+    {
+      pkg[0] = cmd::w_tx_payload;
+      std::memset( pkg.data() + 1 + num, 0, payload_size - num );
+      backend_.transfer( pkg.data(), pkg.size() );
+    }
+
+    // CE up... sleep 10 us... CE down - to actual data transmit (in space)
+    set_ce( 1 );
+    backend_.usleep( 10 );
+    set_ce( 0 );
+  }
+
+  void set_ce( bool value )
+  {
+    ce_ = value;
+    backend_.set_ce( value );
+  }
+
+  Backend& backend_;
+
+  bool ce_ = false;
+  u_char channel_ = 0;
+  u_char rx_pipe_ = 0;
+};
+
+}
+
+#endif // N_RF24L01_CORE_HPP